@@ -40,7 +40,7 @@ DESCRIPTOR = _descriptor.FileDescriptor(
   name='tensorflow_serving/apis/prediction_service.proto',
   package='tensorflow.serving',
   syntax='proto3',
-  serialized_pb=_b('\n0tensorflow_serving/apis/prediction_service.proto\x12\x12tensorflow.serving\x1a,tensorflow_serving/apis/classification.proto\x1a\x30tensorflow_serving/apis/get_model_metadata.proto\x1a\'tensorflow_serving/apis/inference.proto\x1a%tensorflow_serving/apis/predict.proto\x1a(tensorflow_serving/apis/regression.proto2\xfc\x03\n\x11PredictionService\x12\x61\n\x08\x43lassify\x12).tensorflow.serving.ClassificationRequest\x1a*.tensorflow.serving.ClassificationResponse\x12X\n\x07Regress\x12%.tensorflow.serving.RegressionRequest\x1a&.tensorflow.serving.RegressionResponse\x12R\n\x07Predict\x12\".tensorflow.serving.PredictRequest\x1a#.tensorflow.serving.PredictResponse\x12g\n\x0eMultiInference\x12).tensorflow.serving.MultiInferenceRequest\x1a*.tensorflow.serving.MultiInferenceResponse\x12m\n\x10GetModelMetadata\x12+.tensorflow.serving.GetModelMetadataRequest\x1a,.tensorflow.serving.GetModelMetadataResponseB\x03\xf8\x01\x01\x62\x06proto3')
+  serialized_pb=_b('\n0tensorflow_serving/apis/prediction_service.proto\x12\x12tensorflow.serving\x1a,tensorflow_serving/apis/classification.proto\x1a\x30tensorflow_serving/apis/get_model_metadata.proto\x1a\'tensorflow_serving/apis/inference.proto\x1a%tensorflow_serving/apis/predict.proto\x1a(tensorflow_serving/apis/regression.proto2\xc9\x05\n\x11PredictionService\x12\x61\n\x08\x43lassify\x12).tensorflow.serving.ClassificationRequest\x1a*.tensorflow.serving.ClassificationResponse\x12X\n\x07Regress\x12%.tensorflow.serving.RegressionRequest\x1a&.tensorflow.serving.RegressionResponse\x12R\n\x07Predict\x12\".tensorflow.serving.PredictRequest\x1a#.tensorflow.serving.PredictResponse\x12h\n\rStreamPredict\x12(.tensorflow.serving.StreamPredictRequest\x1a).tensorflow.serving.StreamPredictResponse(\x01\x30\x01\x12\x61\n\x0c\x42\x61tchPredict\x12\'.tensorflow.serving.BatchPredictRequest\x1a(.tensorflow.serving.BatchPredictResponse\x12g\n\x0eMultiInference\x12).tensorflow.serving.MultiInferenceRequest\x1a*.tensorflow.serving.MultiInferenceResponse\x12m\n\x10GetModelMetadata\x12+.tensorflow.serving.GetModelMetadataRequest\x1a,.tensorflow.serving.GetModelMetadataResponseB\x03\xf8\x01\x01\x62\x06proto3')
   ,
   dependencies=[tensorflow__serving_dot_apis_dot_classification__pb2.DESCRIPTOR,tensorflow__serving_dot_apis_dot_get__model__metadata__pb2.DESCRIPTOR,tensorflow__serving_dot_apis_dot_inference__pb2.DESCRIPTOR,tensorflow__serving_dot_apis_dot_predict__pb2.DESCRIPTOR,tensorflow__serving_dot_apis_dot_regression__pb2.DESCRIPTOR,])
 _sym_db.RegisterFileDescriptor(DESCRIPTOR)
@@ -88,6 +88,16 @@ try:
           request_serializer=tensorflow__serving_dot_apis_dot_predict__pb2.PredictRequest.SerializeToString,
           response_deserializer=tensorflow__serving_dot_apis_dot_predict__pb2.PredictResponse.FromString,
           )
+      self.StreamPredict = channel.stream_stream(
+          '/tensorflow.serving.PredictionService/StreamPredict',
+          request_serializer=tensorflow__serving_dot_apis_dot_predict__pb2.StreamPredictRequest.SerializeToString,
+          response_deserializer=tensorflow__serving_dot_apis_dot_predict__pb2.StreamPredictResponse.FromString,
+          )
+      self.BatchPredict = channel.unary_unary(
+          '/tensorflow.serving.PredictionService/BatchPredict',
+          request_serializer=tensorflow__serving_dot_apis_dot_predict__pb2.BatchPredictRequest.SerializeToString,
+          response_deserializer=tensorflow__serving_dot_apis_dot_predict__pb2.BatchPredictResponse.FromString,
+          )
       self.MultiInference = channel.unary_unary(
           '/tensorflow.serving.PredictionService/MultiInference',
           request_serializer=tensorflow__serving_dot_apis_dot_inference__pb2.MultiInferenceRequest.SerializeToString,
@@ -127,6 +137,26 @@ try:
       context.set_details('Method not implemented!')
       raise NotImplementedError('Method not implemented!')
 
+    def StreamPredict(self, request_iterator, context):
+      """StreamPredict -- pipelines many Predict calls over a single stream.
+      Requests are processed concurrently and their responses written back as
+      they complete, which may be out of order; match them up by request_id.
+      The server finishes the stream once the client has half-closed it and all
+      outstanding responses have been sent.
+      """
+      context.set_code(grpc.StatusCode.UNIMPLEMENTED)
+      context.set_details('Method not implemented!')
+      raise NotImplementedError('Method not implemented!')
+
+    def BatchPredict(self, request, context):
+      """BatchPredict -- evaluates a list of independent PredictRequests, possibly
+      for different models, in one call. A failed item does not fail the call;
+      each item's outcome is reported separately.
+      """
+      context.set_code(grpc.StatusCode.UNIMPLEMENTED)
+      context.set_details('Method not implemented!')
+      raise NotImplementedError('Method not implemented!')
+
     def MultiInference(self, request, context):
       """MultiInference API for multi-headed models.
       """
@@ -159,6 +189,16 @@ try:
             request_deserializer=tensorflow__serving_dot_apis_dot_predict__pb2.PredictRequest.FromString,
             response_serializer=tensorflow__serving_dot_apis_dot_predict__pb2.PredictResponse.SerializeToString,
         ),
+        'StreamPredict': grpc.stream_stream_rpc_method_handler(
+            servicer.StreamPredict,
+            request_deserializer=tensorflow__serving_dot_apis_dot_predict__pb2.StreamPredictRequest.FromString,
+            response_serializer=tensorflow__serving_dot_apis_dot_predict__pb2.StreamPredictResponse.SerializeToString,
+        ),
+        'BatchPredict': grpc.unary_unary_rpc_method_handler(
+            servicer.BatchPredict,
+            request_deserializer=tensorflow__serving_dot_apis_dot_predict__pb2.BatchPredictRequest.FromString,
+            response_serializer=tensorflow__serving_dot_apis_dot_predict__pb2.BatchPredictResponse.SerializeToString,
+        ),
         'MultiInference': grpc.unary_unary_rpc_method_handler(
             servicer.MultiInference,
             request_deserializer=tensorflow__serving_dot_apis_dot_inference__pb2.MultiInferenceRequest.FromString,
@@ -197,6 +237,20 @@ try:
       """Predict -- provides access to loaded TensorFlow model.
       """
       context.code(beta_interfaces.StatusCode.UNIMPLEMENTED)
+    def StreamPredict(self, request_iterator, context):
+      """StreamPredict -- pipelines many Predict calls over a single stream.
+      Requests are processed concurrently and their responses written back as
+      they complete, which may be out of order; match them up by request_id.
+      The server finishes the stream once the client has half-closed it and all
+      outstanding responses have been sent.
+      """
+      context.code(beta_interfaces.StatusCode.UNIMPLEMENTED)
+    def BatchPredict(self, request, context):
+      """BatchPredict -- evaluates a list of independent PredictRequests, possibly
+      for different models, in one call. A failed item does not fail the call;
+      each item's outcome is reported separately.
+      """
+      context.code(beta_interfaces.StatusCode.UNIMPLEMENTED)
     def MultiInference(self, request, context):
       """MultiInference API for multi-headed models.
       """
@@ -232,6 +286,21 @@ try:
       """
       raise NotImplementedError()
     Predict.future = None
+    def StreamPredict(self, request_iterator, timeout, metadata=None, protocol_options=None):
+      """StreamPredict -- pipelines many Predict calls over a single stream.
+      Requests are processed concurrently and their responses written back as
+      they complete, which may be out of order; match them up by request_id.
+      The server finishes the stream once the client has half-closed it and all
+      outstanding responses have been sent.
+      """
+      raise NotImplementedError()
+    def BatchPredict(self, request, timeout, metadata=None, with_call=False, protocol_options=None):
+      """BatchPredict -- evaluates a list of independent PredictRequests, possibly
+      for different models, in one call. A failed item does not fail the call;
+      each item's outcome is reported separately.
+      """
+      raise NotImplementedError()
+    BatchPredict.future = None
     def MultiInference(self, request, timeout, metadata=None, with_call=False, protocol_options=None):
       """MultiInference API for multi-headed models.
       """
@@ -251,25 +320,31 @@ try:
     file not marked beta) for all further purposes. This function was
     generated only to ease transition from grpcio<0.15.0 to grpcio>=0.15.0"""
     request_deserializers = {
+      ('tensorflow.serving.PredictionService', 'BatchPredict'): tensorflow__serving_dot_apis_dot_predict__pb2.BatchPredictRequest.FromString,
       ('tensorflow.serving.PredictionService', 'Classify'): tensorflow__serving_dot_apis_dot_classification__pb2.ClassificationRequest.FromString,
       ('tensorflow.serving.PredictionService', 'GetModelMetadata'): tensorflow__serving_dot_apis_dot_get__model__metadata__pb2.GetModelMetadataRequest.FromString,
       ('tensorflow.serving.PredictionService', 'MultiInference'): tensorflow__serving_dot_apis_dot_inference__pb2.MultiInferenceRequest.FromString,
       ('tensorflow.serving.PredictionService', 'Predict'): tensorflow__serving_dot_apis_dot_predict__pb2.PredictRequest.FromString,
       ('tensorflow.serving.PredictionService', 'Regress'): tensorflow__serving_dot_apis_dot_regression__pb2.RegressionRequest.FromString,
+      ('tensorflow.serving.PredictionService', 'StreamPredict'): tensorflow__serving_dot_apis_dot_predict__pb2.StreamPredictRequest.FromString,
     }
     response_serializers = {
+      ('tensorflow.serving.PredictionService', 'BatchPredict'): tensorflow__serving_dot_apis_dot_predict__pb2.BatchPredictResponse.SerializeToString,
       ('tensorflow.serving.PredictionService', 'Classify'): tensorflow__serving_dot_apis_dot_classification__pb2.ClassificationResponse.SerializeToString,
       ('tensorflow.serving.PredictionService', 'GetModelMetadata'): tensorflow__serving_dot_apis_dot_get__model__metadata__pb2.GetModelMetadataResponse.SerializeToString,
       ('tensorflow.serving.PredictionService', 'MultiInference'): tensorflow__serving_dot_apis_dot_inference__pb2.MultiInferenceResponse.SerializeToString,
       ('tensorflow.serving.PredictionService', 'Predict'): tensorflow__serving_dot_apis_dot_predict__pb2.PredictResponse.SerializeToString,
       ('tensorflow.serving.PredictionService', 'Regress'): tensorflow__serving_dot_apis_dot_regression__pb2.RegressionResponse.SerializeToString,
+      ('tensorflow.serving.PredictionService', 'StreamPredict'): tensorflow__serving_dot_apis_dot_predict__pb2.StreamPredictResponse.SerializeToString,
     }
     method_implementations = {
+      ('tensorflow.serving.PredictionService', 'BatchPredict'): face_utilities.unary_unary_inline(servicer.BatchPredict),
       ('tensorflow.serving.PredictionService', 'Classify'): face_utilities.unary_unary_inline(servicer.Classify),
       ('tensorflow.serving.PredictionService', 'GetModelMetadata'): face_utilities.unary_unary_inline(servicer.GetModelMetadata),
       ('tensorflow.serving.PredictionService', 'MultiInference'): face_utilities.unary_unary_inline(servicer.MultiInference),
       ('tensorflow.serving.PredictionService', 'Predict'): face_utilities.unary_unary_inline(servicer.Predict),
       ('tensorflow.serving.PredictionService', 'Regress'): face_utilities.unary_unary_inline(servicer.Regress),
+      ('tensorflow.serving.PredictionService', 'StreamPredict'): face_utilities.stream_stream_inline(servicer.StreamPredict),
     }
     server_options = beta_implementations.server_options(request_deserializers=request_deserializers, response_serializers=response_serializers, thread_pool=pool, thread_pool_size=pool_size, default_timeout=default_timeout, maximum_timeout=maximum_timeout)
     return beta_implementations.server(method_implementations, options=server_options)
@@ -282,25 +357,31 @@ try:
     file not marked beta) for all further purposes. This function was
     generated only to ease transition from grpcio<0.15.0 to grpcio>=0.15.0"""
     request_serializers = {
+      ('tensorflow.serving.PredictionService', 'BatchPredict'): tensorflow__serving_dot_apis_dot_predict__pb2.BatchPredictRequest.SerializeToString,
       ('tensorflow.serving.PredictionService', 'Classify'): tensorflow__serving_dot_apis_dot_classification__pb2.ClassificationRequest.SerializeToString,
       ('tensorflow.serving.PredictionService', 'GetModelMetadata'): tensorflow__serving_dot_apis_dot_get__model__metadata__pb2.GetModelMetadataRequest.SerializeToString,
       ('tensorflow.serving.PredictionService', 'MultiInference'): tensorflow__serving_dot_apis_dot_inference__pb2.MultiInferenceRequest.SerializeToString,
       ('tensorflow.serving.PredictionService', 'Predict'): tensorflow__serving_dot_apis_dot_predict__pb2.PredictRequest.SerializeToString,
       ('tensorflow.serving.PredictionService', 'Regress'): tensorflow__serving_dot_apis_dot_regression__pb2.RegressionRequest.SerializeToString,
+      ('tensorflow.serving.PredictionService', 'StreamPredict'): tensorflow__serving_dot_apis_dot_predict__pb2.StreamPredictRequest.SerializeToString,
     }
     response_deserializers = {
+      ('tensorflow.serving.PredictionService', 'BatchPredict'): tensorflow__serving_dot_apis_dot_predict__pb2.BatchPredictResponse.FromString,
       ('tensorflow.serving.PredictionService', 'Classify'): tensorflow__serving_dot_apis_dot_classification__pb2.ClassificationResponse.FromString,
       ('tensorflow.serving.PredictionService', 'GetModelMetadata'): tensorflow__serving_dot_apis_dot_get__model__metadata__pb2.GetModelMetadataResponse.FromString,
       ('tensorflow.serving.PredictionService', 'MultiInference'): tensorflow__serving_dot_apis_dot_inference__pb2.MultiInferenceResponse.FromString,
       ('tensorflow.serving.PredictionService', 'Predict'): tensorflow__serving_dot_apis_dot_predict__pb2.PredictResponse.FromString,
       ('tensorflow.serving.PredictionService', 'Regress'): tensorflow__serving_dot_apis_dot_regression__pb2.RegressionResponse.FromString,
+      ('tensorflow.serving.PredictionService', 'StreamPredict'): tensorflow__serving_dot_apis_dot_predict__pb2.StreamPredictResponse.FromString,
     }
     cardinalities = {
+      'BatchPredict': cardinality.Cardinality.UNARY_UNARY,
       'Classify': cardinality.Cardinality.UNARY_UNARY,
       'GetModelMetadata': cardinality.Cardinality.UNARY_UNARY,
       'MultiInference': cardinality.Cardinality.UNARY_UNARY,
       'Predict': cardinality.Cardinality.UNARY_UNARY,
       'Regress': cardinality.Cardinality.UNARY_UNARY,
+      'StreamPredict': cardinality.Cardinality.STREAM_STREAM,
     }
     stub_options = beta_implementations.stub_options(host=host, metadata_transformer=metadata_transformer, request_serializers=request_serializers, response_deserializers=response_deserializers, thread_pool=pool, thread_pool_size=pool_size)
     return beta_implementations.dynamic_stub(channel, 'tensorflow.serving.PredictionService', cardinalities, options=stub_options)
@@ -0,0 +1,118 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_serving/batching/admission_controller.h"
+
+#include <algorithm>
+
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/monitoring/counter.h"
+
+namespace tensorflow {
+namespace serving {
+namespace {
+
+auto* admission_rejected_count = monitoring::Counter<1>::New(
+    "/tensorflow/serving/batching/admission_rejected_count",
+    "The number of tasks rejected by batching admission control, by reason.",
+    "reason");
+
+// The weight of each new sample in the moving average of the sojourn time.
+constexpr double kQueueDelaySmoothing = 0.125;
+
+}  // namespace
+
+// static
+Status AdmissionController::Create(
+    const Options& options, std::unique_ptr<AdmissionController>* controller) {
+  if (options.target_queue_delay_micros <= 0) {
+    return errors::InvalidArgument(
+        "target_queue_delay_micros must be > 0; was ",
+        options.target_queue_delay_micros);
+  }
+  if (options.interval_micros <= 0) {
+    return errors::InvalidArgument("interval_micros must be > 0; was ",
+                                   options.interval_micros);
+  }
+  if (options.env == nullptr) {
+    return errors::InvalidArgument("env must be set");
+  }
+  controller->reset(new AdmissionController(options));
+  return Status::OK();
+}
+
+AdmissionController::AdmissionController(const Options& options)
+    : options_(options) {}
+
+Status AdmissionController::Admit(const size_t task_size,
+                                  const size_t scheduling_capacity) {
+  if (task_size > scheduling_capacity) {
+    admission_rejected_count->GetCell("queue_full")->IncrementBy(1);
+    return errors::ResourceExhausted(
+        "Batching queue is full; task size: ", task_size,
+        ", remaining capacity: ", scheduling_capacity);
+  }
+  {
+    mutex_lock l(mu_);
+    if (!shedding_) {
+      return Status::OK();
+    }
+    // Admitting target/delay of the tasks lets the queue drain at the rate at
+    // which it was overloaded.
+    admission_credit_ += std::min(
+        1.0, options_.target_queue_delay_micros /
+                 std::max(1.0, average_queue_delay_micros_));
+    if (admission_credit_ >= 1) {
+      admission_credit_ -= 1;
+      return Status::OK();
+    }
+  }
+  admission_rejected_count->GetCell("queue_delay")->IncrementBy(1);
+  return errors::ResourceExhausted(
+      "Batching queue delay has been above its target of ",
+      options_.target_queue_delay_micros, " microseconds for over ",
+      options_.interval_micros, " microseconds; shedding load");
+}
+
+void AdmissionController::RecordQueueDelay(const int64 queue_delay_micros) {
+  const uint64 now_micros = options_.env->NowMicros();
+  mutex_lock l(mu_);
+  average_queue_delay_micros_ +=
+      kQueueDelaySmoothing * (queue_delay_micros - average_queue_delay_micros_);
+  if (queue_delay_micros < options_.target_queue_delay_micros) {
+    if (shedding_) {
+      VLOG(1) << "Batching queue delay back under target; admitting all tasks";
+    }
+    shed_start_micros_ = 0;
+    shedding_ = false;
+    admission_credit_ = 0;
+    return;
+  }
+  if (shed_start_micros_ == 0) {
+    shed_start_micros_ = now_micros + options_.interval_micros;
+  } else if (!shedding_ && now_micros >= shed_start_micros_) {
+    VLOG(1) << "Batching queue delay above target for a full interval; "
+               "shedding load";
+    shedding_ = true;
+  }
+}
+
+bool AdmissionController::IsShedding() const {
+  mutex_lock l(mu_);
+  return shedding_;
+}
+
+}  // namespace serving
+}  // namespace tensorflow
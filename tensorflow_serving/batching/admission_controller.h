@@ -0,0 +1,115 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_SERVING_BATCHING_ADMISSION_CONTROLLER_H_
+#define TENSORFLOW_SERVING_BATCHING_ADMISSION_CONTROLLER_H_
+
+#include <stddef.h>
+#include <memory>
+
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace serving {
+
+// Decides whether to admit tasks into a batch scheduler queue, based on how
+// long tasks have recently been waiting in it (their "sojourn time"), in the
+// manner of the CoDel active queue management algorithm.
+//
+// A queue whose sojourn time exceeds a target now and then is merely absorbing
+// a burst. One whose sojourn time has stayed above the target for a whole
+// interval has a standing backlog: admitting more tasks only makes every task
+// in it slower. In that state the controller sheds a fraction of the incoming
+// tasks, proportional to how far the sojourn time is above the target, so that
+// the queue drains back towards it. It stops shedding as soon as a task is
+// dequeued within the target.
+//
+// Independently, tasks that would not fit in the queue's remaining scheduling
+// capacity are rejected up front, rather than being handed to the scheduler
+// only to be refused there.
+//
+// Rejections carry error::RESOURCE_EXHAUSTED, so that clients can tell them
+// apart from failures and back off.
+//
+// Thread-safe.
+class AdmissionController {
+ public:
+  struct Options {
+    // The sojourn time the controller aims to keep tasks within, in
+    // microseconds (CoDel's 'target'). It includes the time a task spends in
+    // a batch that is still open, so it must exceed the batch timeout of the
+    // queue.
+    int64 target_queue_delay_micros = 10 * 1000;
+
+    // How long the sojourn time must stay above the target before tasks are
+    // shed, in microseconds (CoDel's 'interval'). Should be on the order of
+    // the time it takes to process a few batches.
+    int64 interval_micros = 100 * 1000;
+
+    // The environment to use for time.
+    Env* env = Env::Default();
+  };
+
+  static Status Create(const Options& options,
+                       std::unique_ptr<AdmissionController>* controller);
+
+  ~AdmissionController() = default;
+
+  // Returns OK if a task of size 'task_size' may be scheduled onto a queue with
+  // 'scheduling_capacity' left (see BatchScheduler::SchedulingCapacity()),
+  // and a RESOURCE_EXHAUSTED error otherwise.
+  Status Admit(size_t task_size, size_t scheduling_capacity);
+
+  // Records that a task was dequeued (i.e. handed to a batch thread) after
+  // spending 'queue_delay_micros' in the queue. Callers processing a batch
+  // need only report its oldest task.
+  void RecordQueueDelay(int64 queue_delay_micros);
+
+  // Whether the controller is currently shedding load.
+  bool IsShedding() const;
+
+ private:
+  explicit AdmissionController(const Options& options);
+
+  const Options options_;
+
+  mutable mutex mu_;
+
+  // When the sojourn time went above the target, plus the interval; zero if it
+  // is below the target.
+  uint64 shed_start_micros_ GUARDED_BY(mu_) = 0;
+
+  bool shedding_ GUARDED_BY(mu_) = false;
+
+  // A moving average of the sojourn time, in microseconds.
+  double average_queue_delay_micros_ GUARDED_BY(mu_) = 0;
+
+  // While shedding, accumulates the fraction of tasks to admit, and is drawn
+  // down by one for each admitted task. This spreads the admitted tasks evenly
+  // over time.
+  double admission_credit_ GUARDED_BY(mu_) = 0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(AdmissionController);
+};
+
+}  // namespace serving
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_SERVING_BATCHING_ADMISSION_CONTROLLER_H_
@@ -0,0 +1,103 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_serving/batching/admission_controller.h"
+
+#include <gtest/gtest.h>
+#include "tensorflow/contrib/batching/test_util/fake_clock_env.h"
+#include "tensorflow/core/lib/core/error_codes.pb.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+
+namespace tensorflow {
+namespace serving {
+namespace {
+
+class AdmissionControllerTest : public ::testing::Test {
+ protected:
+  AdmissionControllerTest() : env_(Env::Default()) {
+    AdmissionController::Options options;
+    options.target_queue_delay_micros = 10;
+    options.interval_micros = 100;
+    options.env = &env_;
+    TF_CHECK_OK(AdmissionController::Create(options, &controller_));
+  }
+
+  // Returns the number of tasks admitted out of 'num_tasks'.
+  int CountAdmitted(const int num_tasks) {
+    int num_admitted = 0;
+    for (int i = 0; i < num_tasks; ++i) {
+      const Status status = controller_->Admit(1, 1000);
+      if (status.ok()) {
+        ++num_admitted;
+      } else {
+        EXPECT_EQ(error::RESOURCE_EXHAUSTED, status.code());
+      }
+    }
+    return num_admitted;
+  }
+
+  test_util::FakeClockEnv env_;
+  std::unique_ptr<AdmissionController> controller_;
+};
+
+TEST_F(AdmissionControllerTest, InvalidOptions) {
+  std::unique_ptr<AdmissionController> controller;
+  AdmissionController::Options options;
+  options.target_queue_delay_micros = 0;
+  EXPECT_FALSE(AdmissionController::Create(options, &controller).ok());
+  options = AdmissionController::Options();
+  options.interval_micros = 0;
+  EXPECT_FALSE(AdmissionController::Create(options, &controller).ok());
+}
+
+TEST_F(AdmissionControllerTest, RejectsTasksThatDoNotFit) {
+  TF_EXPECT_OK(controller_->Admit(4, 4));
+  const Status status = controller_->Admit(5, 4);
+  EXPECT_EQ(error::RESOURCE_EXHAUSTED, status.code());
+}
+
+TEST_F(AdmissionControllerTest, ToleratesShortBursts) {
+  controller_->RecordQueueDelay(50);
+  env_.AdvanceByMicroseconds(90);
+  controller_->RecordQueueDelay(50);
+  // Back under target before the interval elapsed.
+  controller_->RecordQueueDelay(5);
+  env_.AdvanceByMicroseconds(100);
+  controller_->RecordQueueDelay(50);
+  EXPECT_FALSE(controller_->IsShedding());
+  EXPECT_EQ(100, CountAdmitted(100));
+}
+
+TEST_F(AdmissionControllerTest, ShedsStandingQueue) {
+  for (int i = 0; i < 100; ++i) {
+    controller_->RecordQueueDelay(20);
+  }
+  env_.AdvanceByMicroseconds(100);
+  controller_->RecordQueueDelay(20);
+  ASSERT_TRUE(controller_->IsShedding());
+  // The sojourn time is twice the target, so about half the tasks get in.
+  const int num_admitted = CountAdmitted(100);
+  EXPECT_GE(num_admitted, 45);
+  EXPECT_LE(num_admitted, 55);
+
+  // Stops shedding as soon as the queue is back under target.
+  controller_->RecordQueueDelay(5);
+  EXPECT_FALSE(controller_->IsShedding());
+  EXPECT_EQ(100, CountAdmitted(100));
+}
+
+}  // namespace
+}  // namespace serving
+}  // namespace tensorflow
@@ -0,0 +1,478 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow_serving/batching/batch_input_merger.h"
+
+#include <algorithm>
+#include <deque>
+#include <unordered_map>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/gtl/inlined_vector.h"
+#include "tensorflow/core/platform/mem.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+namespace serving {
+namespace {
+
+// Dimension sizes or strides of a tensor.
+using Dims = gtl::InlinedVector<int64, 8>;
+
+// Stands in for 16-byte dtypes (i.e. DT_COMPLEX128) when copying elements.
+struct Bytes16 {
+  uint64 low;
+  uint64 high;
+};
+
+template <typename T>
+const T* ElementData(const Tensor& tensor) {
+  return reinterpret_cast<const T*>(tensor.tensor_data().data());
+}
+
+template <>
+const string* ElementData<string>(const Tensor& tensor) {
+  // Slices of a tensor, e.g. the chunks of a split task, need not be aligned.
+  return tensor.unaligned_flat<string>().data();
+}
+
+template <typename T>
+T* MutableElementData(Tensor* tensor) {
+  return const_cast<T*>(ElementData<T>(*tensor));
+}
+
+// Writes the row-major block 'src', with dimensions 'src_dims', to 'dst', whose
+// dimensions 'dst_dims' are each at least as large, and fills the elements of
+// 'dst' that 'src' doesn't cover with 'pad'. The strides are the number of
+// elements spanned by one index of each dimension.
+template <typename T>
+void PadCopy(const T* src, const int64* src_dims, const int64* src_strides,
+             T* dst, const int64* dst_dims, const int64* dst_strides,
+             const int num_dims, const T& pad) {
+  if (std::equal(src_dims + 1, src_dims + num_dims, dst_dims + 1)) {
+    // The rest of the block is contiguous on both sides.
+    const int64 num_elements = src_dims[0] * src_strides[0];
+    std::copy(src, src + num_elements, dst);
+    std::fill(dst + num_elements, dst + dst_dims[0] * dst_strides[0], pad);
+    return;
+  }
+  for (int64 i = 0; i < src_dims[0]; ++i) {
+    PadCopy(src + i * src_strides[0], src_dims + 1, src_strides + 1,
+            dst + i * dst_strides[0], dst_dims + 1, dst_strides + 1,
+            num_dims - 1, pad);
+  }
+  std::fill(dst + src_dims[0] * dst_strides[0],
+            dst + dst_dims[0] * dst_strides[0], pad);
+}
+
+template <typename T>
+void WriteRowsOfType(const Tensor& src, const int64 dst_row, Tensor* dst) {
+  const int num_dims = src.dims();
+  Dims src_dims(num_dims);
+  Dims dst_dims(num_dims);
+  for (int i = 0; i < num_dims; ++i) {
+    src_dims[i] = src.dim_size(i);
+    dst_dims[i] = dst->dim_size(i);
+  }
+  // Only the rows of 'src' are written.
+  dst_dims[0] = src_dims[0];
+  Dims src_strides(num_dims);
+  Dims dst_strides(num_dims);
+  int64 src_stride = 1;
+  int64 dst_stride = 1;
+  for (int i = num_dims - 1; i >= 0; --i) {
+    src_strides[i] = src_stride;
+    src_stride *= src_dims[i];
+    dst_strides[i] = dst_stride;
+    dst_stride *= dst_dims[i];
+  }
+  const T* const src_data = ElementData<T>(src);
+  PadCopy(src_data, src_dims.data(), src_strides.data(),
+          MutableElementData<T>(dst) + dst_row * dst_strides[0],
+          dst_dims.data(), dst_strides.data(), num_dims, src_data[0]);
+}
+
+// Writes the rows of 'src' to 'dst', starting at row 'dst_row'. Every other
+// dimension of 'src' is padded up to its size in 'dst' with the first element
+// of 'src'. The tensors must have the same dtype and rank.
+Status WriteRows(const Tensor& src, const int64 dst_row, Tensor* dst) {
+  if (src.NumElements() == 0) {
+    const int64 dst_row_elements =
+        dst->dim_size(0) == 0 ? 0 : dst->NumElements() / dst->dim_size(0);
+    if (src.dim_size(0) > 0 && dst_row_elements > 0) {
+      return errors::InvalidArgument(
+          "Got empty tensor in batch of non-empty tensors.");
+    }
+    return Status::OK();
+  }
+  const DataType dtype = src.dtype();
+  if (dtype == DT_STRING) {
+    WriteRowsOfType<string>(src, dst_row, dst);
+    return Status::OK();
+  }
+  if (DataTypeCanUseMemcpy(dtype)) {
+    // Only the size of the elements matters for copying them.
+    switch (DataTypeSize(dtype)) {
+      case 1:
+        WriteRowsOfType<uint8>(src, dst_row, dst);
+        return Status::OK();
+      case 2:
+        WriteRowsOfType<uint16>(src, dst_row, dst);
+        return Status::OK();
+      case 4:
+        WriteRowsOfType<uint32>(src, dst_row, dst);
+        return Status::OK();
+      case 8:
+        WriteRowsOfType<uint64>(src, dst_row, dst);
+        return Status::OK();
+      case 16:
+        WriteRowsOfType<Bytes16>(src, dst_row, dst);
+        return Status::OK();
+    }
+  }
+  return errors::Unimplemented("Cannot merge batch input tensors of type ",
+                               DataTypeString(dtype));
+}
+
+// Writes copies of row 'src_row' of 'buffer' to rows [begin_row, end_row).
+Status RepeatRow(const int64 src_row, const int64 begin_row,
+                 const int64 end_row, Tensor* buffer) {
+  if (begin_row == end_row) {
+    return Status::OK();
+  }
+  if (begin_row == 0) {
+    return errors::Internal("Cannot pad a batch with no rows");
+  }
+  const Tensor row = buffer->Slice(src_row, src_row + 1);
+  for (int64 i = begin_row; i < end_row; ++i) {
+    TF_RETURN_IF_ERROR(WriteRows(row, i, buffer));
+  }
+  return Status::OK();
+}
+
+Tensor AllocateBuffer(BatchInputBufferPool* pool, const DataType dtype,
+                      const TensorShape& shape) {
+  if (pool == nullptr) {
+    return Tensor(dtype, shape);
+  }
+  return pool->Acquire(dtype, shape);
+}
+
+Status NonConformingTaskError() {
+  return errors::Internal(
+      "One or more tasks does not conform to batch signature");
+}
+
+}  // namespace
+
+// Allocates the buffers of the tensors of a BatchInputBufferPool, and keeps the
+// most recently released ones to hand them out again for allocations of the
+// same size.
+class BatchInputBufferPool::BufferAllocator : public Allocator {
+ public:
+  explicit BufferAllocator(const int max_released_buffers)
+      : max_released_buffers_(max_released_buffers) {}
+
+  string Name() override { return "batch_input_buffer_pool"; }
+
+  void* AllocateRaw(const size_t alignment, const size_t num_bytes) override {
+    {
+      mutex_lock l(mu_);
+      if (alignment <= kAllocatorAlignment) {
+        for (auto it = released_buffers_.begin(); it != released_buffers_.end();
+             ++it) {
+          if (it->second == num_bytes) {
+            void* const ptr = it->first;
+            released_buffers_.erase(it);
+            live_buffers_.emplace(ptr, num_bytes);
+            return ptr;
+          }
+        }
+      }
+    }
+    void* const ptr = port::AlignedMalloc(
+        num_bytes, std::max<size_t>(alignment, kAllocatorAlignment));
+    if (ptr != nullptr) {
+      mutex_lock l(mu_);
+      live_buffers_.emplace(ptr, num_bytes);
+    }
+    return ptr;
+  }
+
+  void DeallocateRaw(void* const ptr) override {
+    bool delete_this = false;
+    {
+      mutex_lock l(mu_);
+      const auto it = live_buffers_.find(ptr);
+      DCHECK(it != live_buffers_.end());
+      const size_t num_bytes = it->second;
+      live_buffers_.erase(it);
+      if (orphaned_) {
+        port::AlignedFree(ptr);
+        delete_this = live_buffers_.empty();
+      } else {
+        released_buffers_.emplace_back(ptr, num_bytes);
+        if (static_cast<int>(released_buffers_.size()) >
+            max_released_buffers_) {
+          port::AlignedFree(released_buffers_.front().first);
+          released_buffers_.pop_front();
+        }
+      }
+    }
+    if (delete_this) {
+      delete this;
+    }
+  }
+
+  // Called by the pool when it is destroyed. Frees the released buffers, and
+  // deletes this object once no buffer is live anymore.
+  void Orphan() {
+    bool delete_this;
+    {
+      mutex_lock l(mu_);
+      orphaned_ = true;
+      for (const auto& buffer : released_buffers_) {
+        port::AlignedFree(buffer.first);
+      }
+      released_buffers_.clear();
+      delete_this = live_buffers_.empty();
+    }
+    if (delete_this) {
+      delete this;
+    }
+  }
+
+ private:
+  ~BufferAllocator() override = default;
+
+  const int max_released_buffers_;
+
+  mutex mu_;
+  // The size of each buffer that is in use.
+  std::unordered_map<void*, size_t> live_buffers_ GUARDED_BY(mu_);
+  // The buffers that are no longer in use, with their sizes, least recently
+  // released first.
+  std::deque<std::pair<void*, size_t>> released_buffers_ GUARDED_BY(mu_);
+  // Whether the pool is gone.
+  bool orphaned_ GUARDED_BY(mu_) = false;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(BufferAllocator);
+};
+
+BatchInputBufferPool::BatchInputBufferPool(const int max_buffers)
+    : max_buffers_(max_buffers), allocator_(new BufferAllocator(max_buffers)) {}
+
+BatchInputBufferPool::~BatchInputBufferPool() { allocator_->Orphan(); }
+
+Tensor BatchInputBufferPool::Acquire(const DataType dtype,
+                                     const TensorShape& shape) {
+  // Empty tensors have no buffer to reuse.
+  if (max_buffers_ <= 0 || shape.num_elements() == 0) {
+    return Tensor(dtype, shape);
+  }
+  return Tensor(allocator_, dtype, shape);
+}
+
+BatchInputMerger::BatchInputMerger(const int64 expected_num_rows,
+                                   BatchInputBufferPool* const pool)
+    : expected_num_rows_(expected_num_rows), pool_(pool) {}
+
+Status BatchInputMerger::Add(
+    const std::vector<std::pair<string, Tensor>>& inputs) {
+  if (inputs.empty()) {
+    return errors::Internal("Batch task has no inputs");
+  }
+  const bool first_task = buffers_.empty();
+  if (!first_task && inputs.size() != buffers_.size()) {
+    return NonConformingTaskError();
+  }
+  const int64 task_rows = inputs[0].second.dim_size(0);
+
+  for (const auto& entry : inputs) {
+    const string& tensor_name = entry.first;
+    const Tensor& tensor = entry.second;
+    if (tensor.dims() == 0 || tensor.dim_size(0) != task_rows) {
+      return errors::InvalidArgument(
+          "Batching session Run() input tensors must have equal "
+          "0th-dimension size");
+    }
+    Tensor* buffer;
+    if (first_task) {
+      TensorShape shape = tensor.shape();
+      shape.set_dim(0, std::max(expected_num_rows_, task_rows));
+      buffer = &buffers_[tensor_name];
+      *buffer = AllocateBuffer(pool_, tensor.dtype(), shape);
+    } else {
+      auto found = buffers_.find(tensor_name);
+      if (found == buffers_.end()) {
+        return NonConformingTaskError();
+      }
+      buffer = &found->second;
+      if (tensor.dtype() != buffer->dtype() ||
+          tensor.dims() != buffer->dims() ||
+          !std::equal(tensor.shape().begin() + 1, tensor.shape().end(),
+                      buffer->shape().begin() + 1)) {
+        return errors::FailedPrecondition(
+            "Tensors with name '" + tensor_name + "' from different tasks" +
+            " have different shapes and padding is turned off." +
+            "Set pad_variable_length_inputs to true, or ensure that " +
+            "all tensors with the same name" +
+            "have equal dimensions starting with the first dim.");
+      }
+    }
+    TF_RETURN_IF_ERROR(Reserve(num_rows_ + task_rows, buffer));
+    TF_RETURN_IF_ERROR(WriteRows(tensor, num_rows_, buffer));
+  }
+
+  if (task_rows > 0) {
+    last_task_first_row_ = num_rows_;
+  }
+  num_rows_ += task_rows;
+  return Status::OK();
+}
+
+Status BatchInputMerger::Finish(
+    const std::vector<string>& tensor_names, const int64 padded_num_rows,
+    std::vector<std::pair<string, Tensor>>* merged) {
+  if (tensor_names.size() != buffers_.size()) {
+    return NonConformingTaskError();
+  }
+  if (padded_num_rows < num_rows_) {
+    return errors::Internal("Cannot pad a batch of ", num_rows_, " rows to ",
+                            padded_num_rows);
+  }
+  for (const string& tensor_name : tensor_names) {
+    auto found = buffers_.find(tensor_name);
+    if (found == buffers_.end()) {
+      return NonConformingTaskError();
+    }
+    Tensor* buffer = &found->second;
+    TF_RETURN_IF_ERROR(Reserve(padded_num_rows, buffer));
+    // Use the first row of the last task as the padding data. (We know it
+    // represents a valid input tensor row, so it should always be safe to use
+    // for padding.)
+    TF_RETURN_IF_ERROR(RepeatRow(last_task_first_row_, num_rows_,
+                                 padded_num_rows, buffer));
+    merged->push_back({tensor_name, buffer->Slice(0, padded_num_rows)});
+  }
+  return Status::OK();
+}
+
+Status BatchInputMerger::Reserve(const int64 num_rows, Tensor* buffer) const {
+  const int64 capacity = buffer->dim_size(0);
+  if (num_rows <= capacity) {
+    return Status::OK();
+  }
+  TensorShape shape = buffer->shape();
+  shape.set_dim(0, std::max(num_rows, 2 * capacity));
+  Tensor grown = AllocateBuffer(pool_, buffer->dtype(), shape);
+  if (num_rows_ > 0) {
+    TF_RETURN_IF_ERROR(WriteRows(buffer->Slice(0, num_rows_), 0, &grown));
+  }
+  *buffer = std::move(grown);
+  return Status::OK();
+}
+
+Status MergePaddedBatchInputs(
+    const std::vector<const std::vector<std::pair<string, Tensor>>*>&
+        task_inputs,
+    const std::vector<string>& tensor_names, const int64 padded_num_rows,
+    BatchInputBufferPool* pool,
+    std::vector<std::pair<string, Tensor>>* merged) {
+  // The dtype and the largest size of each dimension of the tensors of each
+  // name; the 0th dimension counts the rows of the batch.
+  struct MergedShape {
+    DataType dtype;
+    Dims dims;
+  };
+  std::unordered_map<string, MergedShape> merged_shapes;
+  int64 num_rows = 0;
+  for (const auto* inputs : task_inputs) {
+    if (inputs->size() != tensor_names.size()) {
+      return NonConformingTaskError();
+    }
+    for (const auto& entry : *inputs) {
+      const Tensor& tensor = entry.second;
+      if (tensor.dims() == 0) {
+        return errors::InvalidArgument(
+            "Batching session Run() input tensors must have at least one "
+            "dimension");
+      }
+      MergedShape& merged_shape = merged_shapes[entry.first];
+      if (merged_shape.dims.empty()) {
+        merged_shape.dtype = tensor.dtype();
+        merged_shape.dims.assign(tensor.shape().begin(), tensor.shape().end());
+        merged_shape.dims[0] = 0;
+      } else if (tensor.dtype() != merged_shape.dtype ||
+                 tensor.dims() != static_cast<int>(merged_shape.dims.size())) {
+        return errors::InvalidArgument(
+            "Tensors with name '", entry.first,
+            "' from different tasks have different dtypes or ranks, and "
+            "can't be padded to the same shape");
+      }
+      merged_shape.dims[0] += tensor.dim_size(0);
+      for (int i = 1; i < tensor.dims(); ++i) {
+        merged_shape.dims[i] =
+            std::max(merged_shape.dims[i], tensor.dim_size(i));
+      }
+    }
+    num_rows += (*inputs)[0].second.dim_size(0);
+  }
+  if (merged_shapes.size() != tensor_names.size()) {
+    return NonConformingTaskError();
+  }
+  if (padded_num_rows < num_rows) {
+    return errors::Internal("Cannot pad a batch of ", num_rows, " rows to ",
+                            padded_num_rows);
+  }
+
+  std::unordered_map<string, Tensor> buffers;
+  for (const auto& entry : merged_shapes) {
+    TensorShape shape({padded_num_rows});
+    for (int i = 1; i < entry.second.dims.size(); ++i) {
+      shape.AddDim(entry.second.dims[i]);
+    }
+    buffers[entry.first] = AllocateBuffer(pool, entry.second.dtype, shape);
+  }
+
+  int64 row = 0;
+  int64 last_task_first_row = 0;
+  for (const auto* inputs : task_inputs) {
+    for (const auto& entry : *inputs) {
+      TF_RETURN_IF_ERROR(WriteRows(entry.second, row, &buffers[entry.first]));
+    }
+    const int64 task_rows = (*inputs)[0].second.dim_size(0);
+    if (task_rows > 0) {
+      last_task_first_row = row;
+    }
+    row += task_rows;
+  }
+
+  for (const string& tensor_name : tensor_names) {
+    auto found = buffers.find(tensor_name);
+    if (found == buffers.end()) {
+      return NonConformingTaskError();
+    }
+    TF_RETURN_IF_ERROR(RepeatRow(last_task_first_row, num_rows,
+                                 padded_num_rows, &found->second));
+    merged->push_back({tensor_name, found->second});
+  }
+  return Status::OK();
+}
+
+}  // namespace serving
+}  // namespace tensorflow
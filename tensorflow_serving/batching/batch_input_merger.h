@@ -0,0 +1,135 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_SERVING_BATCHING_BATCH_INPUT_MERGER_H_
+#define TENSORFLOW_SERVING_BATCHING_BATCH_INPUT_MERGER_H_
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace serving {
+
+// A pool of batch-sized tensors to merge batch inputs into, so that a batching
+// queue that keeps producing batches of the same shapes stops allocating
+// them.
+//
+// The tensors are allocated by the pool's own allocator, which gets their
+// memory back once the last tensor sharing it is destroyed, i.e. once the
+// session run it was fed to, and any output that aliases it, are done with it.
+// Only then is the memory handed out again.
+//
+// Thread-safe.
+class BatchInputBufferPool {
+ public:
+  // Keeps at most 'max_buffers' released buffers, dropping the least recently
+  // released one to make room.
+  explicit BatchInputBufferPool(int max_buffers);
+
+  // Tensors acquired from the pool may outlive it.
+  ~BatchInputBufferPool();
+
+  // Returns a tensor of 'dtype' and 'shape' that nobody else is using, with
+  // unspecified contents.
+  Tensor Acquire(DataType dtype, const TensorShape& shape);
+
+ private:
+  class BufferAllocator;
+
+  const int max_buffers_;
+
+  // Owned by the pool until it is destroyed, and from then on by the
+  // outstanding buffers: it deletes itself once the last of them is released.
+  BufferAllocator* const allocator_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(BatchInputBufferPool);
+};
+
+// Concatenates the input tensors of the tasks of a batch along the 0th
+// dimension, one task at a time. Each task's rows are copied straight into a
+// buffer per tensor name, so tasks can be added as they join an open batch,
+// and the batch padding is written last.
+//
+// The tensors of all tasks with the same name must have the same dtype, and
+// the same shape apart from the 0th dimension (i.e. no variable-length
+// padding; see MergePaddedBatchInputs() for that). Numeric and DT_STRING
+// tensors are supported.
+//
+// Not thread-safe.
+class BatchInputMerger {
+ public:
+  // 'expected_num_rows' sizes the buffers up front; they grow as needed if
+  // more rows are added. Buffers come from 'pool' if it is non-null.
+  BatchInputMerger(int64 expected_num_rows, BatchInputBufferPool* pool);
+
+  ~BatchInputMerger() = default;
+
+  // Appends the rows of one task's 'inputs'.
+  Status Add(const std::vector<std::pair<string, Tensor>>& inputs);
+
+  // The number of rows added so far.
+  int64 num_rows() const { return num_rows_; }
+
+  // Pads the merged tensors to 'padded_num_rows' rows, by repeating the first
+  // row of the last task added, and appends them to 'merged' in the order of
+  // 'tensor_names'. Every name in 'tensor_names' must have been added, and
+  // vice versa. The merged tensors share the merger's buffers, so Add() must
+  // not be called afterwards.
+  Status Finish(const std::vector<string>& tensor_names, int64 padded_num_rows,
+                std::vector<std::pair<string, Tensor>>* merged);
+
+ private:
+  // Makes room for 'num_rows' rows in 'buffer', keeping the rows filled in so
+  // far.
+  Status Reserve(int64 num_rows, Tensor* buffer) const;
+
+  const int64 expected_num_rows_;
+  BatchInputBufferPool* const pool_;
+  // The buffer of each tensor name. Rows [0, num_rows_) are filled in.
+  std::map<string, Tensor> buffers_;
+  int64 num_rows_ = 0;
+  // The first row of the last task added, which is used as padding.
+  int64 last_task_first_row_ = 0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(BatchInputMerger);
+};
+
+// Concatenates the input tensors of the tasks of a batch, given by
+// 'task_inputs', whose shapes may differ in any dimension but the 0th.
+// Each tensor is padded up to the largest size of each dimension among the
+// tensors of the same name, with its own first element, and the batch is then
+// padded up to 'padded_num_rows' rows with the first row of the last task.
+// Every row and padding element is written straight into one buffer per
+// tensor name, taken from 'pool' if it is non-null. Appends the merged tensors
+// to 'merged' in the order of 'tensor_names'.
+Status MergePaddedBatchInputs(
+    const std::vector<const std::vector<std::pair<string, Tensor>>*>&
+        task_inputs,
+    const std::vector<string>& tensor_names, int64 padded_num_rows,
+    BatchInputBufferPool* pool,
+    std::vector<std::pair<string, Tensor>>* merged);
+
+}  // namespace serving
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_SERVING_BATCHING_BATCH_INPUT_MERGER_H_
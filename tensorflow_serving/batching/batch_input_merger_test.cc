@@ -0,0 +1,166 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow_serving/batching/batch_input_merger.h"
+
+#include <gtest/gtest.h>
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+
+namespace tensorflow {
+namespace serving {
+namespace {
+
+TEST(BatchInputMergerTest, MergesAndPads) {
+  // Start small so that the buffers have to grow.
+  BatchInputMerger merger(1, nullptr);
+  TF_ASSERT_OK(merger.Add(
+      {{"x", test::AsTensor<float>({1, 2, 3, 4}, {2, 2})},
+       {"y", test::AsTensor<string>({"a", "b"}, {2})}}));
+  TF_ASSERT_OK(merger.Add({{"x", test::AsTensor<float>({5, 6}, {1, 2})},
+                           {"y", test::AsTensor<string>({"c"}, {1})}}));
+  EXPECT_EQ(3, merger.num_rows());
+
+  std::vector<std::pair<string, Tensor>> merged;
+  TF_ASSERT_OK(merger.Finish({"x", "y"}, 5, &merged));
+  ASSERT_EQ(2, merged.size());
+  EXPECT_EQ("x", merged[0].first);
+  test::ExpectTensorEqual<float>(
+      test::AsTensor<float>({1, 2, 3, 4, 5, 6, 5, 6, 5, 6}, {5, 2}),
+      merged[0].second);
+  EXPECT_EQ("y", merged[1].first);
+  test::ExpectTensorEqual<string>(
+      test::AsTensor<string>({"a", "b", "c", "c", "c"}, {5}),
+      merged[1].second);
+}
+
+TEST(BatchInputMergerTest, NoPadding) {
+  BatchInputMerger merger(8, nullptr);
+  TF_ASSERT_OK(merger.Add({{"x", test::AsTensor<int32>({1, 2}, {2})}}));
+  std::vector<std::pair<string, Tensor>> merged;
+  TF_ASSERT_OK(merger.Finish({"x"}, 2, &merged));
+  ASSERT_EQ(1, merged.size());
+  test::ExpectTensorEqual<int32>(test::AsTensor<int32>({1, 2}, {2}),
+                                 merged[0].second);
+}
+
+TEST(BatchInputMergerTest, MismatchedTasks) {
+  BatchInputMerger merger(8, nullptr);
+  TF_ASSERT_OK(merger.Add({{"x", test::AsTensor<float>({1, 2}, {1, 2})}}));
+  EXPECT_EQ(error::FAILED_PRECONDITION,
+            merger.Add({{"x", test::AsTensor<float>({1, 2, 3}, {1, 3})}})
+                .code());
+  EXPECT_EQ(error::FAILED_PRECONDITION,
+            merger.Add({{"x", test::AsTensor<int32>({1, 2}, {1, 2})}}).code());
+  EXPECT_EQ(error::INTERNAL,
+            merger.Add({{"z", test::AsTensor<float>({1, 2}, {1, 2})}}).code());
+
+  std::vector<std::pair<string, Tensor>> merged;
+  EXPECT_EQ(error::INTERNAL, merger.Finish({"x", "z"}, 1, &merged).code());
+}
+
+TEST(BatchInputMergerTest, UsesPool) {
+  BatchInputBufferPool pool(4);
+  std::vector<std::pair<string, Tensor>> merged;
+  {
+    BatchInputMerger merger(2, &pool);
+    TF_ASSERT_OK(merger.Add({{"x", test::AsTensor<int64>({1, 2}, {2})}}));
+    TF_ASSERT_OK(merger.Finish({"x"}, 2, &merged));
+  }
+  const char* const first_data = merged[0].second.tensor_data().data();
+
+  // The buffer is handed out again only once the merged tensor is released.
+  BatchInputMerger busy_merger(2, &pool);
+  TF_ASSERT_OK(busy_merger.Add({{"x", test::AsTensor<int64>({3, 4}, {2})}}));
+  std::vector<std::pair<string, Tensor>> busy_merged;
+  TF_ASSERT_OK(busy_merger.Finish({"x"}, 2, &busy_merged));
+  EXPECT_NE(first_data, busy_merged[0].second.tensor_data().data());
+
+  merged.clear();
+  BatchInputMerger merger(2, &pool);
+  TF_ASSERT_OK(merger.Add({{"x", test::AsTensor<int64>({5, 6}, {2})}}));
+  TF_ASSERT_OK(merger.Finish({"x"}, 2, &merged));
+  EXPECT_EQ(first_data, merged[0].second.tensor_data().data());
+  test::ExpectTensorEqual<int64>(test::AsTensor<int64>({5, 6}, {2}),
+                                 merged[0].second);
+}
+
+TEST(BatchInputBufferPoolTest, KeepsMostRecentlyReleasedBuffer) {
+  BatchInputBufferPool pool(1);
+  Tensor first = pool.Acquire(DT_FLOAT, TensorShape({2}));
+  Tensor second = pool.Acquire(DT_FLOAT, TensorShape({3}));
+  const char* const second_data = second.tensor_data().data();
+  first = Tensor();
+  // Takes the only slot from the first buffer.
+  second = Tensor();
+  EXPECT_EQ(second_data,
+            pool.Acquire(DT_FLOAT, TensorShape({3})).tensor_data().data());
+}
+
+TEST(BatchInputBufferPoolTest, BuffersOutliveThePool) {
+  Tensor buffer;
+  {
+    BatchInputBufferPool pool(1);
+    buffer = pool.Acquire(DT_STRING, TensorShape({2}));
+  }
+  buffer.flat<string>()(1) = "a";
+  EXPECT_EQ("a", buffer.flat<string>()(1));
+}
+
+TEST(MergePaddedBatchInputsTest, PadsEachDimension) {
+  const std::vector<std::pair<string, Tensor>> task0 = {
+      {"x", test::AsTensor<int32>({1, 2, 3, 4}, {2, 2})},
+      {"y", test::AsTensor<string>({"a"}, {1, 1})}};
+  const std::vector<std::pair<string, Tensor>> task1 = {
+      {"x", test::AsTensor<int32>({5, 6, 7}, {1, 3})},
+      {"y", test::AsTensor<string>({"b", "c"}, {1, 2})}};
+  BatchInputBufferPool pool(4);
+  std::vector<std::pair<string, Tensor>> merged;
+  TF_ASSERT_OK(MergePaddedBatchInputs({&task0, &task1}, {"x", "y"}, 4, &pool,
+                                      &merged));
+  ASSERT_EQ(2, merged.size());
+  EXPECT_EQ("x", merged[0].first);
+  test::ExpectTensorEqual<int32>(
+      test::AsTensor<int32>({1, 2, 1, 3, 4, 1, 5, 6, 7, 5, 6, 7}, {4, 3}),
+      merged[0].second);
+  EXPECT_EQ("y", merged[1].first);
+  test::ExpectTensorEqual<string>(
+      test::AsTensor<string>({"a", "a", "b", "c", "b", "c", "b", "c"}, {4, 2}),
+      merged[1].second);
+}
+
+TEST(MergePaddedBatchInputsTest, MismatchedTasks) {
+  const std::vector<std::pair<string, Tensor>> task0 = {
+      {"x", test::AsTensor<int32>({1, 2}, {1, 2})}};
+  const std::vector<std::pair<string, Tensor>> different_rank = {
+      {"x", test::AsTensor<int32>({1, 2}, {2})}};
+  const std::vector<std::pair<string, Tensor>> different_name = {
+      {"z", test::AsTensor<int32>({1, 2}, {1, 2})}};
+  std::vector<std::pair<string, Tensor>> merged;
+  EXPECT_EQ(error::INVALID_ARGUMENT,
+            MergePaddedBatchInputs({&task0, &different_rank}, {"x"}, 3,
+                                   nullptr, &merged)
+                .code());
+  EXPECT_EQ(error::INTERNAL,
+            MergePaddedBatchInputs({&task0, &different_name}, {"x"}, 2,
+                                   nullptr, &merged)
+                .code());
+  EXPECT_EQ(error::INTERNAL,
+            MergePaddedBatchInputs({&task0}, {"x"}, 0, nullptr, &merged)
+                .code());
+}
+
+}  // namespace
+}  // namespace serving
+}  // namespace tensorflow
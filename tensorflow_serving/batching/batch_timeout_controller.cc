@@ -0,0 +1,172 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow_serving/batching/batch_timeout_controller.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/monitoring/counter.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace serving {
+namespace {
+
+auto* batch_timeout_adjustment_count = monitoring::Counter<1>::New(
+    "/tensorflow/serving/batching/batch_timeout_adjustment_count",
+    "The number of times an adaptive batch timeout was changed, by direction.",
+    "direction");
+
+// The weight of each new sample in the moving averages of batch size and run
+// time.
+constexpr double kBatchSmoothing = 0.125;
+
+}  // namespace
+
+// static
+Status BatchTimeoutController::Create(
+    const Options& options,
+    std::unique_ptr<BatchTimeoutController>* controller) {
+  if (options.max_batch_size <= 0) {
+    return errors::InvalidArgument("max_batch_size must be > 0; was ",
+                                   options.max_batch_size);
+  }
+  if (options.min_batch_timeout_micros < 0 ||
+      options.max_batch_timeout_micros < options.min_batch_timeout_micros) {
+    return errors::InvalidArgument(
+        "Batch timeout range must satisfy 0 <= min <= max; was [",
+        options.min_batch_timeout_micros, ", ",
+        options.max_batch_timeout_micros, "]");
+  }
+  if (options.adjustment_interval_micros <= 0) {
+    return errors::InvalidArgument(
+        "adjustment_interval_micros must be > 0; was ",
+        options.adjustment_interval_micros);
+  }
+  if (options.min_adjustment_fraction < 0 ||
+      options.min_adjustment_fraction >= 1) {
+    return errors::InvalidArgument(
+        "min_adjustment_fraction must be in [0, 1); was ",
+        options.min_adjustment_fraction);
+  }
+  if (options.env == nullptr) {
+    return errors::InvalidArgument("env must be set");
+  }
+  controller->reset(new BatchTimeoutController(options));
+  return Status::OK();
+}
+
+BatchTimeoutController::BatchTimeoutController(const Options& options)
+    : options_(options), interval_start_micros_(options.env->NowMicros()) {
+  decision_.batch_timeout_micros = options_.max_batch_timeout_micros;
+}
+
+void BatchTimeoutController::RecordArrival(const size_t task_size) {
+  mutex_lock l(mu_);
+  interval_rows_ += task_size;
+}
+
+void BatchTimeoutController::RecordBatch(const size_t batch_size,
+                                         const int64 run_micros) {
+  mutex_lock l(mu_);
+  if (average_batch_run_micros_ == 0) {
+    average_batch_size_ = batch_size;
+    average_batch_run_micros_ = run_micros;
+    return;
+  }
+  average_batch_size_ += kBatchSmoothing * (batch_size - average_batch_size_);
+  average_batch_run_micros_ +=
+      kBatchSmoothing * (run_micros - average_batch_run_micros_);
+}
+
+bool BatchTimeoutController::Adjust(Decision* decision) {
+  mutex_lock l(mu_);
+  const uint64 now_micros = options_.env->NowMicros();
+  const uint64 elapsed_micros = now_micros - interval_start_micros_;
+  if (elapsed_micros <
+      static_cast<uint64>(options_.adjustment_interval_micros)) {
+    return false;
+  }
+  // Rows per microsecond.
+  const double arrival_rate =
+      static_cast<double>(interval_rows_) / elapsed_micros;
+  interval_start_micros_ = now_micros;
+  interval_rows_ = 0;
+
+  decision_.arrival_rate = arrival_rate * 1e6;
+  decision_.fill_ratio = average_batch_size_ / options_.max_batch_size;
+  decision_.batch_run_micros = average_batch_run_micros_;
+  if (average_batch_run_micros_ == 0) {
+    // There is nothing to go on until a batch has run.
+    return false;
+  }
+
+  int64 target_batch_size = options_.max_batch_size;
+  if (options_.target_latency_micros > 0) {
+    // Collecting b rows takes (b - 1) / arrival_rate, on top of which the
+    // batch has to run.
+    const double slack_micros =
+        options_.target_latency_micros - average_batch_run_micros_;
+    target_batch_size =
+        slack_micros <= 0
+            ? 1
+            : 1 + static_cast<int64>(std::min<double>(
+                      std::floor(arrival_rate * slack_micros),
+                      options_.max_batch_size));
+  }
+  target_batch_size =
+      std::max<int64>(1, std::min(target_batch_size, options_.max_batch_size));
+
+  int64 batch_timeout_micros = options_.min_batch_timeout_micros;
+  if (arrival_rate * options_.max_batch_timeout_micros >= 1) {
+    batch_timeout_micros = static_cast<int64>(
+        std::round(std::min<double>((target_batch_size - 1) / arrival_rate,
+                                    options_.max_batch_timeout_micros)));
+    batch_timeout_micros =
+        std::max(batch_timeout_micros, options_.min_batch_timeout_micros);
+  }
+
+  const int64 change_micros =
+      std::abs(batch_timeout_micros - decision_.batch_timeout_micros);
+  if (change_micros == 0 ||
+      change_micros < options_.min_adjustment_fraction *
+                          (options_.max_batch_timeout_micros -
+                           options_.min_batch_timeout_micros)) {
+    return false;
+  }
+  batch_timeout_adjustment_count
+      ->GetCell(batch_timeout_micros > decision_.batch_timeout_micros ? "up"
+                                                                      : "down")
+      ->IncrementBy(1);
+  LOG(INFO) << "Changing batch timeout from " << decision_.batch_timeout_micros
+            << " to " << batch_timeout_micros
+            << " microseconds; target batch size: " << target_batch_size
+            << ", arrival rate: " << decision_.arrival_rate
+            << " rows/s, fill ratio: " << decision_.fill_ratio
+            << ", batch run time: " << decision_.batch_run_micros
+            << " microseconds";
+  decision_.batch_timeout_micros = batch_timeout_micros;
+  *decision = decision_;
+  return true;
+}
+
+BatchTimeoutController::Decision BatchTimeoutController::decision() const {
+  mutex_lock l(mu_);
+  return decision_;
+}
+
+}  // namespace serving
+}  // namespace tensorflow
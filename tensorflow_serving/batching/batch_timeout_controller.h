@@ -0,0 +1,136 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_SERVING_BATCHING_BATCH_TIMEOUT_CONTROLLER_H_
+#define TENSORFLOW_SERVING_BATCHING_BATCH_TIMEOUT_CONTROLLER_H_
+
+#include <stddef.h>
+#include <memory>
+
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace serving {
+
+// Tunes the batch timeout of a batch scheduler queue online, from the rate at
+// which rows arrive, how full its batches are, and how long they take to run.
+//
+// A static timeout is a compromise: when traffic is light, tasks wait out the
+// whole timeout for company that never comes, and when it is heavy a timeout
+// tuned for light traffic closes batches before they are full. Instead, once
+// per adjustment interval, the controller picks a target batch size and the
+// timeout it takes for that many rows to arrive at the current rate:
+//
+//  - With a latency goal, the target is the largest batch that can be
+//    collected and run within 'target_latency_micros', given the current
+//    batch run time.
+//  - Otherwise the goal is throughput, and the target is a full batch.
+//
+// If not even one more row is expected to arrive within the longest timeout,
+// waiting is pointless and the timeout drops to its minimum. Changes smaller
+// than 'min_adjustment_fraction' of the timeout range are not worth the churn
+// of applying them, and are ignored.
+//
+// Decisions are logged, counted in a monitoring counter, and available from
+// decision().
+//
+// Thread-safe.
+class BatchTimeoutController {
+ public:
+  struct Options {
+    // The largest batch the queue forms.
+    int64 max_batch_size = 1000;
+
+    // The range the timeout is tuned within, in microseconds.
+    int64 min_batch_timeout_micros = 0;
+    int64 max_batch_timeout_micros = 10 * 1000;
+
+    // If positive, the latency the controller aims to keep tasks within, from
+    // being scheduled until their batch has run, in microseconds. Otherwise it
+    // aims for full batches.
+    int64 target_latency_micros = 0;
+
+    // How often the timeout is revised, in microseconds. The arrival rate is
+    // measured over this interval, so it should span many tasks.
+    int64 adjustment_interval_micros = 1000 * 1000;
+
+    // The smallest change worth applying, as a fraction of the timeout range.
+    double min_adjustment_fraction = 0.1;
+
+    // The environment to use for time.
+    Env* env = Env::Default();
+  };
+
+  // What the controller has decided, and the observations it was based on.
+  struct Decision {
+    int64 batch_timeout_micros = 0;
+
+    // Rows per second scheduled onto the queue.
+    double arrival_rate = 0;
+    // The average batch size, as a fraction of 'max_batch_size'.
+    double fill_ratio = 0;
+    // The average time it takes to run a batch, in microseconds.
+    int64 batch_run_micros = 0;
+  };
+
+  static Status Create(const Options& options,
+                       std::unique_ptr<BatchTimeoutController>* controller);
+
+  ~BatchTimeoutController() = default;
+
+  // Records that a task with 'task_size' rows was scheduled.
+  void RecordArrival(size_t task_size);
+
+  // Records that a batch of 'batch_size' rows took 'run_micros' to run.
+  void RecordBatch(size_t batch_size, int64 run_micros);
+
+  // Revises the decision if an adjustment interval has passed since the last
+  // revision. Returns true, and sets 'decision', iff the timeout has changed
+  // enough to be worth applying.
+  bool Adjust(Decision* decision);
+
+  // The current decision. Initially the timeout is the longest one.
+  Decision decision() const;
+
+ private:
+  explicit BatchTimeoutController(const Options& options);
+
+  const Options options_;
+
+  mutable mutex mu_;
+
+  Decision decision_ GUARDED_BY(mu_);
+
+  // When the current adjustment interval started, and the number of rows that
+  // have arrived since.
+  uint64 interval_start_micros_ GUARDED_BY(mu_);
+  int64 interval_rows_ GUARDED_BY(mu_) = 0;
+
+  // Moving averages of the batch size and run time; zero until the first batch
+  // has run.
+  double average_batch_size_ GUARDED_BY(mu_) = 0;
+  double average_batch_run_micros_ GUARDED_BY(mu_) = 0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(BatchTimeoutController);
+};
+
+}  // namespace serving
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_SERVING_BATCHING_BATCH_TIMEOUT_CONTROLLER_H_
@@ -0,0 +1,152 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow_serving/batching/batch_timeout_controller.h"
+
+#include <gtest/gtest.h>
+#include "tensorflow/contrib/batching/test_util/fake_clock_env.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+
+namespace tensorflow {
+namespace serving {
+namespace {
+
+class BatchTimeoutControllerTest : public ::testing::Test {
+ protected:
+  BatchTimeoutControllerTest() : env_(Env::Default()) {}
+
+  void CreateController(const int64 target_latency_micros) {
+    BatchTimeoutController::Options options;
+    options.max_batch_size = 100;
+    options.min_batch_timeout_micros = 0;
+    options.max_batch_timeout_micros = 10000;
+    options.target_latency_micros = target_latency_micros;
+    options.adjustment_interval_micros = 100000;
+    options.env = &env_;
+    TF_CHECK_OK(BatchTimeoutController::Create(options, &controller_));
+  }
+
+  // Spreads 'num_rows' arrivals, and batches that take 'run_micros', over one
+  // adjustment interval.
+  void RunInterval(const int num_rows, const int64 run_micros) {
+    for (int i = 0; i < num_rows; ++i) {
+      controller_->RecordArrival(1);
+    }
+    controller_->RecordBatch(10, run_micros);
+    env_.AdvanceByMicroseconds(100000);
+  }
+
+  test_util::FakeClockEnv env_;
+  std::unique_ptr<BatchTimeoutController> controller_;
+};
+
+TEST_F(BatchTimeoutControllerTest, InvalidOptions) {
+  std::unique_ptr<BatchTimeoutController> controller;
+  BatchTimeoutController::Options options;
+  options.max_batch_size = 0;
+  EXPECT_FALSE(BatchTimeoutController::Create(options, &controller).ok());
+  options = BatchTimeoutController::Options();
+  options.min_batch_timeout_micros = 20;
+  options.max_batch_timeout_micros = 10;
+  EXPECT_FALSE(BatchTimeoutController::Create(options, &controller).ok());
+  options = BatchTimeoutController::Options();
+  options.min_adjustment_fraction = 1;
+  EXPECT_FALSE(BatchTimeoutController::Create(options, &controller).ok());
+}
+
+TEST_F(BatchTimeoutControllerTest, StartsAtLongestTimeout) {
+  CreateController(0);
+  const BatchTimeoutController::Decision decision = controller_->decision();
+  EXPECT_EQ(10000, decision.batch_timeout_micros);
+
+  // Nothing changes before the end of the interval, or before a batch ran.
+  BatchTimeoutController::Decision new_decision;
+  controller_->RecordArrival(1);
+  EXPECT_FALSE(controller_->Adjust(&new_decision));
+  env_.AdvanceByMicroseconds(100000);
+  EXPECT_FALSE(controller_->Adjust(&new_decision));
+}
+
+TEST_F(BatchTimeoutControllerTest, ShortensTimeoutWhenIdle) {
+  CreateController(0);
+  // Five rows per 100ms: not even one is expected within the longest timeout.
+  RunInterval(5, 1000);
+  BatchTimeoutController::Decision decision;
+  ASSERT_TRUE(controller_->Adjust(&decision));
+  EXPECT_EQ(0, decision.batch_timeout_micros);
+  EXPECT_NEAR(50, decision.arrival_rate, 1e-6);
+  EXPECT_NEAR(0.1, decision.fill_ratio, 1e-6);
+  EXPECT_EQ(1000, decision.batch_run_micros);
+}
+
+TEST_F(BatchTimeoutControllerTest, WaitsToFillBatchesForThroughput) {
+  CreateController(0);
+  RunInterval(5, 1000);
+  BatchTimeoutController::Decision decision;
+  ASSERT_TRUE(controller_->Adjust(&decision));
+  EXPECT_EQ(0, decision.batch_timeout_micros);
+
+  // 2000 rows per 100ms, i.e. 99 more rows every 4950us.
+  RunInterval(2000, 1000);
+  ASSERT_TRUE(controller_->Adjust(&decision));
+  EXPECT_EQ(4950, decision.batch_timeout_micros);
+
+  // At half the rate, batches take twice as long to fill.
+  RunInterval(1000, 1000);
+  ASSERT_TRUE(controller_->Adjust(&decision));
+  EXPECT_EQ(9900, decision.batch_timeout_micros);
+  EXPECT_EQ(9900, controller_->decision().batch_timeout_micros);
+
+  // Filling a batch at a tenth of the rate would take longer than the longest
+  // timeout.
+  RunInterval(200, 1000);
+  EXPECT_FALSE(controller_->Adjust(&decision));
+  RunInterval(100, 1000);
+  EXPECT_FALSE(controller_->Adjust(&decision));
+  EXPECT_EQ(9900, controller_->decision().batch_timeout_micros);
+}
+
+TEST_F(BatchTimeoutControllerTest, MeetsLatencyTarget) {
+  CreateController(5000);
+  // 1000 rows per 100ms, with 3000us left after running a batch: batches of 31
+  // rows, which take 3000us to collect.
+  RunInterval(1000, 2000);
+  BatchTimeoutController::Decision decision;
+  ASSERT_TRUE(controller_->Adjust(&decision));
+  EXPECT_EQ(3000, decision.batch_timeout_micros);
+
+  // Once batches take longer than the target to run, there is no point in
+  // waiting.
+  controller_->RecordBatch(10, 60000);
+  RunInterval(1000, 60000);
+  ASSERT_TRUE(controller_->Adjust(&decision));
+  EXPECT_EQ(0, decision.batch_timeout_micros);
+}
+
+TEST_F(BatchTimeoutControllerTest, IgnoresSmallChanges) {
+  CreateController(0);
+  RunInterval(2000, 1000);
+  BatchTimeoutController::Decision decision;
+  ASSERT_TRUE(controller_->Adjust(&decision));
+  EXPECT_EQ(4950, decision.batch_timeout_micros);
+
+  // 5211us is within 10% of the range of 4950us.
+  RunInterval(1900, 1000);
+  EXPECT_FALSE(controller_->Adjust(&decision));
+  EXPECT_EQ(4950, controller_->decision().batch_timeout_micros);
+}
+
+}  // namespace
+}  // namespace serving
+}  // namespace tensorflow
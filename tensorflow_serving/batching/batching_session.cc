@@ -16,27 +16,39 @@ limitations under the License.
 #include "tensorflow_serving/batching/batching_session.h"
 
 #include <stddef.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <tuple>
+#include <unordered_map>
 
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/tensor_util.h"
+#include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow_serving/batching/batch_input_merger.h"
+#include "tensorflow_serving/servables/tensorflow/deadline_util.h"
 #include "tensorflow_serving/servables/tensorflow/serving_session.h"
 #include "tensorflow_serving/util/cleanup.h"
 #include "tensorflow_serving/util/hash.h"
-#include "tensorflow_serving/batching/batching_util.h"
-#include "tensorflow_serving/util/optional.h"
 
 namespace tensorflow {
 namespace serving {
 
 namespace {
 
+// How many merged-input buffers each batching queue keeps for reuse.
+constexpr int kMaxPooledInputBuffers = 32;
+
 string TensorSignatureDebugString(const TensorSignature& signature) {
   return strings::StrCat("{input_tensors: <",
                          str_util::Join(signature.input_tensors, ", "),
@@ -81,32 +93,29 @@ TensorSignature TensorSignatureFromRunArgs(
   return signature;
 }
 
-// Constructs vector of all task inputs from Batch of BatchingSessionTasks.
-// Input for each task is a vector of pairs (tensor_name, tensor_value).
-std::vector<std::vector<std::pair<string, Tensor>>> GetTaskInputsVector(
-    const Batch<BatchingSessionTask>& batch) {
-  std::vector<std::vector<std::pair<string, Tensor>>> all_task_inputs;
-  for (int i = 0; i < batch.num_tasks(); ++i) {
-    const std::vector<std::pair<string, Tensor>>& task_inputs =
-      *batch.task(i).inputs;
-    all_task_inputs.push_back(task_inputs);
-  }
-  return all_task_inputs;
-}
-// Returns true iff all dims of shape1 are equal to dims of shape2 starting with
-// the first (not zeroth) dimension.
-// For example, for shapes [1, 2, 3] and [4, 2, 3] the result is true.
-bool AreShapesEqualExceptZeroDim(const TensorShape& shape1,
-    const TensorShape& shape2) {
-  if (shape1.dims() != shape2.dims()) {
-    return false;
+// Returns rows [begin, end) of 'tensor', sharing its buffer. If the rows start
+// at an address that is not aligned for Eigen, which would keep the caller from
+// using e.g. Tensor::flat(), they are copied into a new buffer instead.
+Status SliceRows(const Tensor& tensor, const int64 begin, const int64 end,
+                 Tensor* rows) {
+  const Tensor slice = tensor.Slice(begin, end);
+  if (slice.IsAligned()) {
+    *rows = slice;
+    return Status::OK();
   }
-  for (int i = 1; i < shape1.dims(); ++i) {
-    if (shape1.dim_size(i) != shape2.dim_size(i)) {
-      return false;
-    }
+  Tensor copy(tensor.dtype(), slice.shape());
+  if (DataTypeCanUseMemcpy(tensor.dtype())) {
+    const StringPiece bytes = slice.tensor_data();
+    memcpy(const_cast<char*>(copy.tensor_data().data()), bytes.data(),
+           bytes.size());
+  } else if (tensor.dtype() == DT_STRING) {
+    copy.flat<string>() = slice.unaligned_flat<string>();
+  } else {
+    return errors::Unimplemented("Cannot split batched output tensors of type ",
+                                 DataTypeString(tensor.dtype()));
   }
-  return true;
+  *rows = std::move(copy);
+  return Status::OK();
 }
 
 }  // namespace
@@ -170,6 +179,15 @@ class BatchingSession : public ServingSession {
              const std::vector<string>& target_node_names,
              std::vector<Tensor>* outputs, RunMetadata* run_metadata) override;
 
+  // Schedules the call and returns. 'done' is called on the batch thread once
+  // the call's outputs have been split off the batch's (or right away, if the
+  // call can't be scheduled). Run() is RunAsync() plus a wait.
+  void RunAsync(const RunOptions& run_options,
+                const std::vector<std::pair<string, Tensor>>& inputs,
+                const std::vector<string>& output_tensor_names,
+                std::vector<Tensor>* outputs, RunMetadata* run_metadata,
+                RunAsyncCallback done) override;
+
   Status ListDevices(std::vector<DeviceAttributes>* response) override;
 
  private:
@@ -187,33 +205,160 @@ class BatchingSession : public ServingSession {
   // empty, simply returns 'batch_size'.
   int RoundToLowestAllowedBatchSize(int batch_size) const;
 
-  // Merges the input tensors in a batch, via concatenation of correspondingly-
-  // named tensors. Puts the merged inputs in the order they are in in the
-  // signature. Assumes 'batch' is non-empty. Returns an error if there are any
-  // mismatches among the tasks in the batch that violate the constraints for
-  // batchability.
+  // The batching queue of one signature, and the state kept about it.
+  struct SignatureQueue;
+
+  // Schedules 'task' onto 'queue', subject to admission control.
+  Status ScheduleTask(SignatureQueue* queue,
+                      std::unique_ptr<BatchingSessionTask>* task);
+
+  // A Run() call that is split into chunks. See RunInChunks().
+  struct ChunkedCall;
+
+  // Runs 'task', which is larger than 'options_.max_task_size', as chunks of at
+  // most that size, each scheduled as a task of its own. Once all chunks are
+  // done, concatenates their outputs into 'task->outputs' and calls
+  // 'task->done'.
+  void RunInChunks(SignatureQueue* queue,
+                   std::unique_ptr<BatchingSessionTask> task);
+
+  // Merges the input tensors of the tasks of a batch, via concatenation of
+  // correspondingly-named tensors. Puts the merged inputs in the order they are
+  // in in the signature. Assumes 'tasks' is non-empty. Returns an error if
+  // there are any mismatches among the tasks that violate the constraints for
+  // batchability. Padded inputs are merged into buffers from 'pool'.
   Status MergeInputTensors(
-      const TensorSignature& signature, const Batch<BatchingSessionTask>& batch,
+      const TensorSignature& signature,
+      const std::vector<BatchingSessionTask*>& tasks,
+      BatchInputBufferPool* pool,
       std::vector<std::pair<string, Tensor>>* merged_inputs);
 
-  // Splits the output of a batched call to 'wrapped_->Run()' into individual
-  // task outputs. Assumes the output tensor order matches the signature.
+  // Splits the output of a batched call to 'wrapped_->Run()' into the outputs
+  // of 'tasks'. Assumes the output tensor order matches the signature.
   Status SplitOutputTensors(const TensorSignature& signature,
                             const std::vector<Tensor>& combined_outputs,
-                            Batch<BatchingSessionTask>* batch);
+                            const std::vector<BatchingSessionTask*>& tasks);
+
+  // Orders the Run() calls that are waiting to be batched by deadline, then
+  // by arrival. The task pointer breaks ties.
+  using PendingTaskKey = std::tuple<uint64, uint64, BatchingSessionTask*>;
+  static PendingTaskKey GetPendingTaskKey(BatchingSessionTask* task);
+
+  // A Run() call that is waiting to be batched, and the placeholder task in
+  // the scheduler that is bound to it.
+  struct PendingTask {
+    std::unique_ptr<BatchingSessionTask> task;
+    const BatchingSessionTask* placeholder;
+  };
+
+  struct SignatureQueue {
+    // Waits for the schedulers to have been destroyed.
+    ~SignatureQueue();
+
+    // Null unless 'options_.admission_control_options' is set.
+    std::unique_ptr<AdmissionController> admission_controller;
+
+    // Null unless 'options_.batch_timeout_controller_options' is set, in which
+    // case 'scheduler' is replaced with one from 'tunable_scheduler_creator'
+    // whenever the controller changes the batch timeout.
+    std::unique_ptr<BatchTimeoutController> timeout_controller;
+    TunableBatchingSessionSchedulerCreator tunable_scheduler_creator;
+    std::function<void(std::unique_ptr<Batch<BatchingSessionTask>>)>
+        process_batch;
+
+    // A moving average of how long 'wrapped_' takes to run a batch, in
+    // microseconds. Zero until the first batch has run.
+    std::atomic<int64> average_batch_run_micros{0};
+
+    // If the signature's scheduler hands over open batches, the feed it passes
+    // their tasks on to; null otherwise.
+    std::unique_ptr<OpenBatchTaskFeed<BatchingSessionTask>> task_feed;
+
+    // Buffers for the merged inputs of this queue's batches, which tend to
+    // come in a handful of shapes.
+    BatchInputBufferPool input_buffer_pool{kMaxPooledInputBuffers};
+
+    // If the signature's Run() calls are bucketed by sequence length, the
+    // buckets and the index of this queue's bucket; null otherwise.
+    SequenceLengthBuckets* buckets = nullptr;
+    int bucket = 0;
+
+    // If 'options_.earliest_deadline_first' is set, the Run() calls that have
+    // been scheduled but not yet taken up by a closed batch, by size and then
+    // in deadline order. The scheduler only holds a placeholder task of the
+    // same size for each, and 'placeholder_bindings' maps each placeholder to
+    // the key of the call it is bound to. See TakePendingTask().
+    mutex pending_tasks_mu;
+    std::map<size_t, std::map<PendingTaskKey, PendingTask>> pending_tasks
+        GUARDED_BY(pending_tasks_mu);
+    std::unordered_map<const BatchingSessionTask*, PendingTaskKey>
+        placeholder_bindings GUARDED_BY(pending_tasks_mu);
+
+    // The scheduler new tasks are scheduled onto. A scheduler that has been
+    // replaced lives on until the Run() calls that hold it let go of it, and
+    // processes the tasks it has. See ShareScheduler(). (Declared last, so
+    // that it is done with its tasks before the state above that they use is
+    // destroyed.)
+    mutex scheduler_mu;
+    std::shared_ptr<BatchScheduler<BatchingSessionTask>> scheduler
+        GUARDED_BY(scheduler_mu);
+
+    // The number of schedulers that haven't been destroyed yet. Notified when
+    // one is.
+    int num_schedulers GUARDED_BY(scheduler_mu) = 0;
+    condition_variable scheduler_destroyed;
+  };
+
+  // The queues of one signature: one per sequence length bucket, or just one.
+  struct SignatureQueues {
+    // Null unless 'options_.sequence_length_bucketing_options' is set.
+    std::unique_ptr<SequenceLengthBuckets> buckets;
+    std::vector<std::unique_ptr<SignatureQueue>> queues;
+  };
 
   // Processes one batch of Run() calls with 'signature'. Called by
-  // 'batch_scheduler_' in a batch thread.
-  void ProcessBatch(const TensorSignature& signature,
+  // 'queue->scheduler' in a batch thread.
+  void ProcessBatch(const TensorSignature& signature, SignatureQueue* queue,
                     std::unique_ptr<Batch<BatchingSessionTask>> batch);
 
+  // Takes a pending Run() call for 'placeholder', a placeholder task of a
+  // closed batch, into 'task'. If 'earliest_deadline' is true, takes the call
+  // of the placeholder's size with the earliest deadline, and binds the call
+  // of 'placeholder' to the placeholder of the taken one instead. Otherwise,
+  // takes the call bound to 'placeholder'. Sizes are what the scheduler forms
+  // batches from, but which calls make up the batch follows deadlines rather
+  // than arrival order.
+  static Status TakePendingTask(SignatureQueue* queue,
+                                const BatchingSessionTask* placeholder,
+                                bool earliest_deadline,
+                                std::unique_ptr<BatchingSessionTask>* task);
+
+  // Returns the scheduler to schedule tasks onto.
+  static std::shared_ptr<BatchScheduler<BatchingSessionTask>> GetScheduler(
+      SignatureQueue* queue);
+
+  // Wraps 'scheduler' for 'queue->scheduler'. Destroying a scheduler waits
+  // for its tasks to be processed, so whichever thread lets go of it last,
+  // it is destroyed on a thread of its own rather than hold up a Run() call.
+  static std::shared_ptr<BatchScheduler<BatchingSessionTask>> ShareScheduler(
+      SignatureQueue* queue,
+      std::unique_ptr<BatchScheduler<BatchingSessionTask>> scheduler);
+
+  // Replaces 'queue->scheduler' with a new one whose batch timeout is
+  // 'batch_timeout_micros'.
+  static Status ReplaceScheduler(int64 batch_timeout_micros,
+                                 SignatureQueue* queue);
+
+  // Folds 'batch_run_micros' into 'queue->average_batch_run_micros'.
+  static void RecordBatchRunTime(int64 batch_run_micros,
+                                 SignatureQueue* queue);
+
   const BatchingSessionOptions options_;
 
   std::unique_ptr<Session> wrapped_;
-  std::unordered_map<TensorSignature,
-                     std::unique_ptr<BatchScheduler<BatchingSessionTask>>,
+  std::unordered_map<TensorSignature, std::unique_ptr<SignatureQueues>,
                      HashTensorSignature, EqTensorSignature>
-      batch_schedulers_;
+      queues_;
 
   TF_DISALLOW_COPY_AND_ASSIGN(BatchingSession);
 };
@@ -223,6 +368,11 @@ Status BatchingSession::Create(
     const std::vector<SignatureWithBatchingSessionSchedulerCreator>&
         signatures_with_scheduler_creators,
     std::unique_ptr<BatchingSession>* result) {
+  if (options.sequence_length_bucketing_options &&
+      !options.pad_variable_length_inputs) {
+    return errors::InvalidArgument(
+        "Sequence length bucketing requires pad_variable_length_inputs");
+  }
   auto batching_session =
       std::unique_ptr<BatchingSession>(new BatchingSession(options));
   BatchingSession* raw_batching_session = batching_session.get();
@@ -232,15 +382,67 @@ Status BatchingSession::Create(
     const TensorSignature& signature = entry.signature;
     const BatchingSessionSchedulerCreator& scheduler_creator =
         entry.scheduler_creator;
+    if (entry.streaming_scheduler_creator != nullptr &&
+        options.batch_timeout_controller_options) {
+      return errors::InvalidArgument(
+          "Batch timeout control doesn't support a streaming scheduler creator "
+          "for signature: ",
+          TensorSignatureDebugString(signature));
+    }
 
-    std::unique_ptr<BatchScheduler<BatchingSessionTask>> batch_scheduler;
-    TF_RETURN_IF_ERROR(scheduler_creator(
-        [signature, raw_batching_session](
-            std::unique_ptr<Batch<BatchingSessionTask>> batch) {
-          raw_batching_session->ProcessBatch(signature, std::move(batch));
-        },
-        &batch_scheduler));
-    batching_session->batch_schedulers_[signature] = std::move(batch_scheduler);
+    std::unique_ptr<SignatureQueues> signature_queues(new SignatureQueues);
+    int num_queues = 1;
+    if (options.sequence_length_bucketing_options) {
+      SequenceLengthBuckets::Options bucketing_options =
+          *options.sequence_length_bucketing_options;
+      bucketing_options.signature_name = TensorSignatureDebugString(signature);
+      TF_RETURN_IF_ERROR(SequenceLengthBuckets::Create(
+          bucketing_options, &signature_queues->buckets));
+      num_queues = signature_queues->buckets->num_buckets();
+    }
+    for (int bucket = 0; bucket < num_queues; ++bucket) {
+      std::unique_ptr<SignatureQueue> queue(new SignatureQueue);
+      queue->buckets = signature_queues->buckets.get();
+      queue->bucket = bucket;
+      SignatureQueue* raw_queue = queue.get();
+      if (options.admission_control_options) {
+        TF_RETURN_IF_ERROR(AdmissionController::Create(
+            *options.admission_control_options, &queue->admission_controller));
+      }
+      if (options.batch_timeout_controller_options) {
+        if (entry.tunable_scheduler_creator == nullptr) {
+          return errors::InvalidArgument(
+              "Batch timeout control requires a tunable scheduler creator for "
+              "signature: ",
+              TensorSignatureDebugString(signature));
+        }
+        TF_RETURN_IF_ERROR(BatchTimeoutController::Create(
+            *options.batch_timeout_controller_options,
+            &queue->timeout_controller));
+        queue->tunable_scheduler_creator = entry.tunable_scheduler_creator;
+      }
+      queue->process_batch = [signature, raw_queue, raw_batching_session](
+          std::unique_ptr<Batch<BatchingSessionTask>> batch) {
+        raw_batching_session->ProcessBatch(signature, raw_queue,
+                                           std::move(batch));
+      };
+      std::unique_ptr<BatchScheduler<BatchingSessionTask>> scheduler;
+      if (entry.streaming_scheduler_creator != nullptr) {
+        queue->task_feed.reset(new OpenBatchTaskFeed<BatchingSessionTask>);
+        TF_RETURN_IF_ERROR(entry.streaming_scheduler_creator(
+            queue->process_batch, queue->task_feed.get(), &scheduler));
+      } else {
+        TF_RETURN_IF_ERROR(scheduler_creator(queue->process_batch, &scheduler));
+      }
+      std::shared_ptr<BatchScheduler<BatchingSessionTask>> shared_scheduler =
+          ShareScheduler(queue.get(), std::move(scheduler));
+      {
+        mutex_lock l(queue->scheduler_mu);
+        queue->scheduler = std::move(shared_scheduler);
+      }
+      signature_queues->queues.push_back(std::move(queue));
+    }
+    batching_session->queues_[signature] = std::move(signature_queues);
   }
 
   *result = std::move(batching_session);
@@ -267,11 +469,27 @@ Status BatchingSession::Run(
     return errors::PermissionDenied(
         "BatchingSession does not support target nodes");
   }
+  Notification done;
+  Status status;
+  RunAsync(run_options, inputs, output_tensor_names, outputs, run_metadata,
+           [&done, &status](const Status& run_status) {
+             status = run_status;
+             done.Notify();
+           });
+  done.WaitForNotification();
+  return status;
+}
 
+void BatchingSession::RunAsync(
+    const RunOptions& run_options,
+    const std::vector<std::pair<string, Tensor>>& inputs,
+    const std::vector<string>& output_tensor_names,
+    std::vector<Tensor>* outputs, RunMetadata* run_metadata,
+    RunAsyncCallback done) {
   const TensorSignature signature =
       TensorSignatureFromRunArgs(inputs, output_tensor_names);
-  auto batch_scheduler_it = batch_schedulers_.find(signature);
-  if (batch_scheduler_it == batch_schedulers_.end()) {
+  auto queue_it = queues_.find(signature);
+  if (queue_it == queues_.end()) {
     // We have a Run() call that doesn't match one of our batching signatures.
     // Run it in-line.
     static uint64 last_log_message_secs = 0;
@@ -283,30 +501,208 @@ Status BatchingSession::Run(
                    << TensorSignatureDebugString(signature);
       last_log_message_secs = now_secs;
     }
-    return wrapped_->Run(run_options, inputs, output_tensor_names,
-                         target_node_names, outputs, run_metadata);
+    RunSessionAsync(wrapped_.get(), run_options, inputs, output_tensor_names,
+                    outputs, run_metadata, std::move(done));
+    return;
+  }
+  const SignatureQueues& signature_queues = *queue_it->second;
+  SignatureQueue* queue = signature_queues.queues[0].get();
+  if (signature_queues.buckets != nullptr) {
+    const int bucket = signature_queues.buckets->Bucket(
+        SequenceLengthBuckets::TaskLength(inputs));
+    queue = signature_queues.queues[bucket].get();
   }
-  BatchScheduler<BatchingSessionTask>* batch_scheduler =
-      batch_scheduler_it->second.get();
 
   outputs->clear();
 
-  Notification done;
-  Status status;
   auto task = std::unique_ptr<BatchingSessionTask>(new BatchingSessionTask);
   task->enqueue_time_micros = Env::Default()->NowMicros();
+  task->deadline_micros =
+      DeadlineMicrosFromRunOptions(run_options, task->enqueue_time_micros);
   task->run_options = run_options;
-  TF_RETURN_IF_ERROR(ComputeInputSize(inputs, &task->zeroth_dim_size));
   task->inputs = &inputs;
   task->output_tensor_names = &output_tensor_names;
-  task->done = &done;
-  task->status = &status;
   task->outputs = outputs;
   task->run_metadata = run_metadata;
 
-  TF_RETURN_IF_ERROR(batch_scheduler->Schedule(&task));
-  done.WaitForNotification();
-  return status;
+  Status status = ComputeInputSize(inputs, &task->zeroth_dim_size);
+  if (status.ok()) {
+    // Don't enqueue a task that would miss its deadline even if its batch ran
+    // right away.
+    status = CheckDeadline(
+        task->deadline_micros, task->enqueue_time_micros,
+        queue->average_batch_run_micros.load(std::memory_order_relaxed),
+        "before batching");
+  }
+  if (!status.ok()) {
+    done(status);
+    return;
+  }
+  task->done = std::move(done);
+  if (options_.max_task_size > 0 &&
+      task->zeroth_dim_size > options_.max_task_size) {
+    RunInChunks(queue, std::move(task));
+    return;
+  }
+  status = ScheduleTask(queue, &task);
+  if (!status.ok()) {
+    // The scheduler only takes the task if it accepts it.
+    task->done(status);
+  }
+}
+
+Status BatchingSession::ScheduleTask(
+    SignatureQueue* queue, std::unique_ptr<BatchingSessionTask>* task) {
+  const size_t task_size = (*task)->zeroth_dim_size;
+  {
+    const std::shared_ptr<BatchScheduler<BatchingSessionTask>> scheduler =
+        GetScheduler(queue);
+    if (queue->admission_controller != nullptr) {
+      TF_RETURN_IF_ERROR(queue->admission_controller->Admit(
+          task_size, scheduler->SchedulingCapacity()));
+    }
+    if (options_.earliest_deadline_first) {
+      // The scheduler gets a placeholder of the same size, and the call waits
+      // among the pending ones. Hold the lock until it is pending, so that no
+      // batch can look for it before.
+      std::unique_ptr<BatchingSessionTask> placeholder(new BatchingSessionTask);
+      placeholder->zeroth_dim_size = task_size;
+      const BatchingSessionTask* const bound_placeholder = placeholder.get();
+      // Failing the placeholder, as is done to a batch that won't run, fails
+      // the call bound to it.
+      placeholder->done = [queue, bound_placeholder](const Status& status) {
+        std::unique_ptr<BatchingSessionTask> bound_task;
+        const Status take_status =
+            TakePendingTask(queue, bound_placeholder,
+                            false /* earliest_deadline */, &bound_task);
+        if (!take_status.ok()) {
+          LOG(ERROR) << "Failed to fail a placeholder task: " << take_status;
+          return;
+        }
+        bound_task->done(status);
+      };
+      mutex_lock l(queue->pending_tasks_mu);
+      TF_RETURN_IF_ERROR(scheduler->Schedule(&placeholder));
+      const PendingTaskKey key = GetPendingTaskKey(task->get());
+      queue->pending_tasks[task_size].emplace(
+          key, PendingTask{std::move(*task), bound_placeholder});
+      queue->placeholder_bindings.emplace(bound_placeholder, key);
+    } else {
+      TF_RETURN_IF_ERROR(scheduler->Schedule(task));
+    }
+  }
+  if (queue->timeout_controller != nullptr) {
+    queue->timeout_controller->RecordArrival(task_size);
+    BatchTimeoutController::Decision decision;
+    if (queue->timeout_controller->Adjust(&decision)) {
+      const Status replace_status =
+          ReplaceScheduler(decision.batch_timeout_micros, queue);
+      if (!replace_status.ok()) {
+        LOG(ERROR) << "Failed to apply a batch timeout of "
+                   << decision.batch_timeout_micros
+                   << " microseconds: " << replace_status;
+      }
+    }
+  }
+  return Status::OK();
+}
+
+struct BatchingSession::ChunkedCall {
+  // The state of one chunk of the call.
+  struct Chunk {
+    std::vector<std::pair<string, Tensor>> inputs;
+    std::vector<Tensor> outputs;
+    RunMetadata run_metadata;
+  };
+
+  explicit ChunkedCall(std::unique_ptr<BatchingSessionTask> task)
+      : task(std::move(task)) {}
+
+  // Records the outcome of a chunk, or of scheduling the chunks. Whichever
+  // comes last finishes the call.
+  void Done(const Status& chunk_status) {
+    Status call_status;
+    {
+      mutex_lock l(mu);
+      status.Update(chunk_status);
+      if (--num_pending > 0) {
+        return;
+      }
+      call_status = status;
+    }
+    if (call_status.ok()) {
+      call_status = ConcatOutputs();
+    }
+    task->done(call_status);
+  }
+
+  // Reassembles the outputs of the chunks, in order, into the call's.
+  Status ConcatOutputs() {
+    for (int i = 0; i < task->output_tensor_names->size(); ++i) {
+      std::vector<Tensor> chunk_outputs;
+      chunk_outputs.reserve(chunks.size());
+      for (const Chunk& chunk : chunks) {
+        if (chunk.outputs.size() != task->output_tensor_names->size()) {
+          return errors::Internal(
+              "Wrong number of outputs for a chunk of a split Run() call");
+        }
+        chunk_outputs.push_back(chunk.outputs[i]);
+      }
+      Tensor output;
+      TF_RETURN_IF_ERROR(tensor::Concat(chunk_outputs, &output));
+      task->outputs->push_back(std::move(output));
+    }
+    if (task->run_metadata != nullptr) {
+      *task->run_metadata = chunks[0].run_metadata;
+    }
+    return Status::OK();
+  }
+
+  const std::unique_ptr<BatchingSessionTask> task;
+  // Sized up front, since the chunks' tasks point into it.
+  std::vector<Chunk> chunks;
+
+  mutex mu;
+  Status status GUARDED_BY(mu);
+  // The chunks that have been scheduled and aren't done yet, plus one until
+  // all have been scheduled.
+  int num_pending GUARDED_BY(mu) = 1;
+};
+
+void BatchingSession::RunInChunks(SignatureQueue* queue,
+                                  std::unique_ptr<BatchingSessionTask> task) {
+  const int64 chunk_size = options_.max_task_size;
+  const int64 task_size = task->zeroth_dim_size;
+  const std::shared_ptr<ChunkedCall> call(new ChunkedCall(std::move(task)));
+  call->chunks.resize((task_size + chunk_size - 1) / chunk_size);
+  for (int i = 0; i < call->chunks.size(); ++i) {
+    const int64 begin = i * chunk_size;
+    const int64 end = std::min(begin + chunk_size, task_size);
+    ChunkedCall::Chunk* chunk = &call->chunks[i];
+    for (const auto& entry : *call->task->inputs) {
+      // Slice() operates on the 0th dimension, and doesn't copy.
+      chunk->inputs.push_back({entry.first, entry.second.Slice(begin, end)});
+    }
+    auto chunk_task = std::unique_ptr<BatchingSessionTask>(
+        new BatchingSessionTask(*call->task));
+    chunk_task->zeroth_dim_size = end - begin;
+    chunk_task->inputs = &chunk->inputs;
+    chunk_task->outputs = &chunk->outputs;
+    chunk_task->run_metadata = &chunk->run_metadata;
+    chunk_task->done = [call](const Status& status) { call->Done(status); };
+    {
+      mutex_lock l(call->mu);
+      ++call->num_pending;
+    }
+    const Status schedule_status = ScheduleTask(queue, &chunk_task);
+    if (!schedule_status.ok()) {
+      // The chunk is still ours; the ones already scheduled are left to
+      // finish.
+      chunk_task->done(schedule_status);
+      break;
+    }
+  }
+  call->Done(Status::OK());
 }
 
 Status BatchingSession::ListDevices(std::vector<DeviceAttributes>* response) {
@@ -363,126 +759,66 @@ int BatchingSession::RoundToLowestAllowedBatchSize(int batch_size) const {
 }
 
 Status BatchingSession::MergeInputTensors(
-    const TensorSignature& signature, const Batch<BatchingSessionTask>& batch,
+    const TensorSignature& signature,
+    const std::vector<BatchingSessionTask*>& tasks, BatchInputBufferPool* pool,
     std::vector<std::pair<string, Tensor>>* merged_inputs) {
-  DCHECK_GE(batch.num_tasks(), 1);
-  if (batch.num_tasks() < 1) {
-    return errors::Internal("Batch size expected to be positive; was ",
-                            batch.num_tasks());
+  DCHECK_GE(tasks.size(), 1);
+  if (tasks.empty()) {
+    return errors::Internal("Batch size expected to be positive; was 0");
   }
 
-  const int padding_size =
-      RoundToLowestAllowedBatchSize(batch.size()) - batch.size();
+  int batch_size = 0;
+  for (const BatchingSessionTask* task : tasks) {
+    batch_size += task->size();
+  }
+  const int padded_batch_size = RoundToLowestAllowedBatchSize(batch_size);
+  const std::vector<string> input_tensor_names(signature.input_tensors.begin(),
+                                               signature.input_tensors.end());
 
-  // For each input tensor name, a vector of tensors from the individual tasks.
-  std::map<string, std::vector<Tensor>> tensors_to_merge;
-  // For each input tensor name a vector of maximum dimension sizes
-  // among tensors from individual tasks.
-  optional<std::map<string, std::vector<int>>> max_dim_sizes;
   if (options_.pad_variable_length_inputs) {
-    std::vector<std::vector<std::pair<string, Tensor>>> all_task_inputs =
-      GetTaskInputsVector(batch);
-    max_dim_sizes = CalculateMaxDimSizes(all_task_inputs);
-  }
-  // Populate 'tensors_to_merge'.
-  for (int i = 0; i < batch.num_tasks(); ++i) {
-    const std::vector<std::pair<string, Tensor>>& task_inputs =
-        *batch.task(i).inputs;
-    for (const auto& entry : task_inputs) {
-      const string& tensor_name = entry.first;
-      const Tensor& tensor = entry.second;
-
-      std::vector<Tensor>& tensor_vec = tensors_to_merge[tensor_name];
-      Tensor optionally_padded_tensor;
-      if (options_.pad_variable_length_inputs) {
-        TF_RETURN_IF_ERROR(AddPadding(tensor, (*max_dim_sizes)[tensor_name],
-                                      &optionally_padded_tensor));
-      } else {
-        optionally_padded_tensor = tensor;
-        // Check whether tensors with the same name have equal dims
-        // (except zeroth dim) when padding is turned off.
-        if (i > 0) {  // added at least one task to tensors_to_merge
-          TensorShape reference_shape =
-            tensors_to_merge[tensor_name][0].shape();
-          if (!AreShapesEqualExceptZeroDim(tensor.shape(), reference_shape)) {
-            return errors::FailedPrecondition(
-              "Tensors with name '" + tensor_name + "' from different tasks" +
-              " have different shapes and padding is turned off." +
-              "Set pad_variable_length_inputs to true, or ensure that " +
-              "all tensors with the same name" +
-              "have equal dimensions starting with the first dim.");
-          }
-        }
-      }
-      tensor_vec.push_back(optionally_padded_tensor);
-      if (i == batch.num_tasks() - 1 && padding_size > 0) {
-        // This is the last task. Insert padding.
-        //
-        // Use the first row of this task's tensor as the padding data. (We know
-        // it represents a valid input tensor row, so it should always be safe
-        // to use for padding.)
-        //
-        // Slice() operates on the 0th dimension, which is the batch dimension.
-        // It avoids a deep copy, which is a nice efficiency bonus.
-        const Tensor padding_tensor = optionally_padded_tensor.Slice(0, 1);
-        for (int i = 0; i < padding_size; ++i) {
-          tensor_vec.push_back(padding_tensor);
-        }
-      }
+    // Pad and concatenate in one pass, straight into the merged buffers.
+    std::vector<const std::vector<std::pair<string, Tensor>>*> task_inputs;
+    task_inputs.reserve(tasks.size());
+    for (const BatchingSessionTask* task : tasks) {
+      task_inputs.push_back(task->inputs);
     }
+    return MergePaddedBatchInputs(task_inputs, input_tensor_names,
+                                  padded_batch_size, pool, merged_inputs);
   }
 
-  // Merge the tensors.
-  DCHECK_EQ(signature.input_tensors.size(), tensors_to_merge.size());
-  if (tensors_to_merge.size() != signature.input_tensors.size()) {
-    return errors::Internal(
-        "One or more tasks does not conform to batch signature");
-  }
-  for (const string& tensor_name : signature.input_tensors) {
-    auto tensors = tensors_to_merge.find(tensor_name);
-    DCHECK(tensors != tensors_to_merge.end());
-    if (tensors == tensors_to_merge.end()) {
-      return errors::Internal(
-          "One or more tasks does not conform to batch signature");
-    }
-    Tensor concated;
-    const Status concat_status = tensor::Concat(tensors->second, &concated);
-    DCHECK(concat_status.ok()) << concat_status.ToString();
-    if (!concat_status.ok()) {
-      return errors::Internal("Tensor concat operation failed: ",
-                              concat_status.ToString());
-    }
-    merged_inputs->push_back({tensor_name, concated});
+  // Concatenate the tasks' rows straight into the merged buffers.
+  BatchInputMerger merger(padded_batch_size, pool);
+  for (const BatchingSessionTask* task : tasks) {
+    TF_RETURN_IF_ERROR(merger.Add(*task->inputs));
   }
-
-  return Status::OK();
+  return merger.Finish(input_tensor_names, padded_batch_size, merged_inputs);
 }
 
 Status BatchingSession::SplitOutputTensors(
     const TensorSignature& signature,
     const std::vector<Tensor>& combined_outputs,
-    Batch<BatchingSessionTask>* batch) {
-  DCHECK_GE(batch->num_tasks(), 1);
-  if (batch->num_tasks() < 1) {
-    return errors::Internal("Batch size expected to be positive; was ",
-                            batch->num_tasks());
+    const std::vector<BatchingSessionTask*>& tasks) {
+  DCHECK_GE(tasks.size(), 1);
+  if (tasks.empty()) {
+    return errors::Internal("Batch size expected to be positive; was 0");
   }
 
-  std::vector<int64> task_sizes_plus_optional_padding;
-  task_sizes_plus_optional_padding.reserve(batch->num_tasks());
-  for (int i = 0; i < batch->num_tasks(); ++i) {
-    task_sizes_plus_optional_padding.push_back(batch->task(i).zeroth_dim_size);
+  // The first row of each task in the batched tensors.
+  std::vector<int64> task_offsets;
+  task_offsets.reserve(tasks.size());
+  int64 offset = 0;
+  for (const BatchingSessionTask* task : tasks) {
+    task_offsets.push_back(offset);
+    offset += task->zeroth_dim_size;
   }
+  const int batch_size = offset;
   const int padding_size =
-      RoundToLowestAllowedBatchSize(batch->size()) - batch->size();
-  if (padding_size > 0) {
-    task_sizes_plus_optional_padding.push_back(padding_size);
-  }
+      RoundToLowestAllowedBatchSize(batch_size) - batch_size;
 
-  // For each output tensor name, a divided-up tensor with one entry per task.
-  std::map<string, std::vector<Tensor>> split_tensors;
+  // For each output tensor name, the batched tensor.
+  std::unordered_map<string, const Tensor*> batched_tensors;
 
-  // Populate 'split_tensors'.
+  // Populate 'batched_tensors'.
   DCHECK_EQ(signature.output_tensors.size(), combined_outputs.size());
   if (combined_outputs.size() != signature.output_tensors.size()) {
     return errors::Internal("Wrong number of batched output tensors");
@@ -497,128 +833,333 @@ Status BatchingSession::SplitOutputTensors(
       return errors::FailedPrecondition(
           "Batched output tensor has 0 dimensions");
     }
-    if (tensor.shape().dim_size(0) != batch->size() + padding_size) {
+    if (tensor.shape().dim_size(0) != batch_size + padding_size) {
       return errors::FailedPrecondition(
           "Batched output tensor's 0th dimension does not equal the sum of the "
           "0th dimension sizes of the input tensors");
     }
-
-    std::vector<Tensor> split_tensor;
-    const Status split_status =
-        tensor::Split(tensor, task_sizes_plus_optional_padding, &split_tensor);
-    DCHECK(split_status.ok()) << split_status.ToString();
-    if (!split_status.ok()) {
-      return errors::Internal("Tensor split operation failed: ",
-                              split_status.ToString());
-    }
-    DCHECK_EQ(split_tensor.size(), task_sizes_plus_optional_padding.size());
-    if (split_tensor.size() != task_sizes_plus_optional_padding.size()) {
-      return errors::Internal(
-          "Tensor split operation did not work as expected; got ",
-          split_tensor.size(), " splits; expected ",
-          task_sizes_plus_optional_padding.size());
-    }
-    split_tensors[tensor_name] = std::move(split_tensor);
+    batched_tensors[tensor_name] = &tensor;
   }
 
-  for (int i = 0; i < batch->num_tasks(); ++i) {
-    BatchingSessionTask* task = batch->mutable_task(i);
+  // Hand each task a slice of the batched tensors rather than a copy. (The
+  // rows of a possible final padding entry are simply never handed out.)
+  for (int i = 0; i < tasks.size(); ++i) {
+    BatchingSessionTask* task = tasks[i];
     for (const string& tensor_name : *task->output_tensor_names) {
-      auto split_tensor = split_tensors.find(tensor_name);
-      DCHECK(split_tensor != split_tensors.end());
-      if (split_tensor == split_tensors.end()) {
+      auto batched_tensor = batched_tensors.find(tensor_name);
+      DCHECK(batched_tensor != batched_tensors.end());
+      if (batched_tensor == batched_tensors.end()) {
         return errors::Internal("Task does not conform to batch signature");
       }
-      task->outputs->push_back(split_tensor->second[i]);
+      Tensor task_tensor;
+      TF_RETURN_IF_ERROR(SliceRows(*batched_tensor->second, task_offsets[i],
+                                   task_offsets[i] + task->zeroth_dim_size,
+                                   &task_tensor));
+      task->outputs->push_back(std::move(task_tensor));
     }
   }
-  // (Ignore a possible final split_tensors entry containing the padding.)
 
   return Status::OK();
 }
 
+// static
+void BatchingSession::RecordBatchRunTime(const int64 batch_run_micros,
+                                         SignatureQueue* queue) {
+  int64 average = queue->average_batch_run_micros.load();
+  int64 new_average;
+  do {
+    new_average = average == 0 ? batch_run_micros
+                                : average + (batch_run_micros - average) / 8;
+  } while (!queue->average_batch_run_micros.compare_exchange_weak(
+      average, new_average));
+}
+
+// static
+std::shared_ptr<BatchScheduler<BatchingSessionTask>>
+BatchingSession::GetScheduler(SignatureQueue* queue) {
+  mutex_lock l(queue->scheduler_mu);
+  return queue->scheduler;
+}
+
+// static
+std::shared_ptr<BatchScheduler<BatchingSessionTask>>
+BatchingSession::ShareScheduler(
+    SignatureQueue* queue,
+    std::unique_ptr<BatchScheduler<BatchingSessionTask>> scheduler) {
+  {
+    mutex_lock l(queue->scheduler_mu);
+    ++queue->num_schedulers;
+  }
+  return std::shared_ptr<BatchScheduler<BatchingSessionTask>>(
+      scheduler.release(),
+      [queue](BatchScheduler<BatchingSessionTask>* released_scheduler) {
+        Env::Default()->SchedClosure([queue, released_scheduler] {
+          delete released_scheduler;
+          mutex_lock l(queue->scheduler_mu);
+          --queue->num_schedulers;
+          queue->scheduler_destroyed.notify_all();
+        });
+      });
+}
+
+BatchingSession::SignatureQueue::~SignatureQueue() {
+  std::shared_ptr<BatchScheduler<BatchingSessionTask>> current_scheduler;
+  {
+    mutex_lock l(scheduler_mu);
+    current_scheduler = std::move(scheduler);
+  }
+  current_scheduler.reset();
+  mutex_lock l(scheduler_mu);
+  while (num_schedulers > 0) {
+    scheduler_destroyed.wait(l);
+  }
+}
+
+// static
+Status BatchingSession::ReplaceScheduler(const int64 batch_timeout_micros,
+                                         SignatureQueue* queue) {
+  std::unique_ptr<BatchScheduler<BatchingSessionTask>> unique_new_scheduler;
+  TF_RETURN_IF_ERROR(queue->tunable_scheduler_creator(
+      batch_timeout_micros, queue->process_batch, &unique_new_scheduler));
+  std::shared_ptr<BatchScheduler<BatchingSessionTask>> new_scheduler =
+      ShareScheduler(queue, std::move(unique_new_scheduler));
+  // The old scheduler is destroyed on a thread of its own once the Run()
+  // calls that hold it have let go of it.
+  std::shared_ptr<BatchScheduler<BatchingSessionTask>> old_scheduler;
+  {
+    mutex_lock l(queue->scheduler_mu);
+    old_scheduler = std::move(queue->scheduler);
+    queue->scheduler = std::move(new_scheduler);
+  }
+  return Status::OK();
+}
+
+// static
+BatchingSession::PendingTaskKey BatchingSession::GetPendingTaskKey(
+    BatchingSessionTask* task) {
+  return PendingTaskKey(task->deadline_micros, task->enqueue_time_micros,
+                        task);
+}
+
+// static
+Status BatchingSession::TakePendingTask(
+    SignatureQueue* queue, const BatchingSessionTask* placeholder,
+    const bool earliest_deadline, std::unique_ptr<BatchingSessionTask>* task) {
+  mutex_lock l(queue->pending_tasks_mu);
+  auto binding_it = queue->placeholder_bindings.find(placeholder);
+  if (binding_it == queue->placeholder_bindings.end()) {
+    return errors::Internal("Placeholder task is not bound to a Run() call");
+  }
+  const PendingTaskKey bound_key = binding_it->second;
+  queue->placeholder_bindings.erase(binding_it);
+  auto pending_it = queue->pending_tasks.find(placeholder->size());
+  if (pending_it == queue->pending_tasks.end()) {
+    return errors::Internal("No pending Run() call of size ",
+                            placeholder->size());
+  }
+  std::map<PendingTaskKey, PendingTask>& pending = pending_it->second;
+  auto bound_it = pending.find(bound_key);
+  if (bound_it == pending.end()) {
+    return errors::Internal("The Run() call bound to a placeholder task of ",
+                            "size ", placeholder->size(), " is not pending");
+  }
+  auto taken_it = bound_it;
+  if (earliest_deadline && pending.begin() != bound_it) {
+    // Take the call with the earliest deadline, and leave the bound one to the
+    // placeholder that call was bound to, so that every placeholder still in
+    // the scheduler is bound to a call of its own.
+    taken_it = pending.begin();
+    const BatchingSessionTask* const other_placeholder =
+        taken_it->second.placeholder;
+    bound_it->second.placeholder = other_placeholder;
+    queue->placeholder_bindings[other_placeholder] = bound_key;
+  }
+  *task = std::move(taken_it->second.task);
+  pending.erase(taken_it);
+  if (pending.empty()) {
+    queue->pending_tasks.erase(pending_it);
+  }
+  return Status::OK();
+}
+
 void BatchingSession::ProcessBatch(
-    const TensorSignature& signature,
+    const TensorSignature& signature, SignatureQueue* queue,
     std::unique_ptr<Batch<BatchingSessionTask>> batch) {
-  // As a possible performance optimization, consider overlapping the tensor
-  // concatenation with waiting for the batch to close (i.e. do the
-  // concatenation incrementally as tasks stream into the batch).
+  // If the scheduler hands over open batches, concatenate the inputs of the
+  // tasks as they join the batch, so that only the padding is left once it
+  // closes. That takes tasks that are Run() calls (rather than placeholders),
+  // whose inputs don't need variable-length padding, which depends on every
+  // task in the batch.
+  std::unique_ptr<BatchInputMerger> open_batch_merger;
+  Status open_batch_merge_status;
+  int num_merged = 0;
+  if (queue->task_feed != nullptr && !options_.earliest_deadline_first &&
+      !options_.pad_variable_length_inputs) {
+    open_batch_merger.reset(new BatchInputMerger(
+        options_.allowed_batch_sizes.empty()
+            ? 0
+            : options_.allowed_batch_sizes.back(),
+        &queue->input_buffer_pool));
+    while (open_batch_merge_status.ok()) {
+      const BatchingSessionTask* task =
+          queue->task_feed->WaitForTask(*batch, num_merged);
+      if (task == nullptr) {
+        break;
+      }
+      open_batch_merge_status = open_batch_merger->Add(*task->inputs);
+      ++num_merged;
+    }
+  }
   batch->WaitUntilClosed();
 
   if (batch->empty()) {
     return;
   }
+  // With earliest deadline first, the batch holds placeholders, and the Run()
+  // calls that make it up are taken from the pending ones.
+  std::vector<std::unique_ptr<BatchingSessionTask>> taken_tasks;
+  std::vector<BatchingSessionTask*> batch_tasks;
+  if (options_.earliest_deadline_first) {
+    for (int i = 0; i < batch->num_tasks(); ++i) {
+      std::unique_ptr<BatchingSessionTask> task;
+      const Status take_status = TakePendingTask(
+          queue, &batch->task(i), true /* earliest_deadline */, &task);
+      if (!take_status.ok()) {
+        LOG(ERROR) << "Failed to take a Run() call for a placeholder task: "
+                   << take_status;
+        continue;
+      }
+      batch_tasks.push_back(task.get());
+      taken_tasks.push_back(std::move(task));
+    }
+    if (batch_tasks.empty()) {
+      return;
+    }
+  } else {
+    for (int i = 0; i < batch->num_tasks(); ++i) {
+      batch_tasks.push_back(batch->mutable_task(i));
+    }
+  }
 
   const uint64 dequeue_time_micros = Env::Default()->NowMicros();
-
-  // Regardless of the outcome, we need to propagate the status to the
-  // individual tasks and signal that they are done. We use MakeCleanup() to
-  // ensure that this happens no matter how we exit the method below.
-  Status status;
-  auto finally = MakeCleanup([&status, &batch] {
-    for (int i = 0; i < batch->num_tasks(); ++i) {
-      *batch->mutable_task(i)->status = status;
-      batch->mutable_task(i)->done->Notify();
+  if (queue->admission_controller != nullptr) {
+    uint64 earliest_enqueue_time_micros = batch_tasks[0]->enqueue_time_micros;
+    for (const BatchingSessionTask* task : batch_tasks) {
+      earliest_enqueue_time_micros =
+          std::min(earliest_enqueue_time_micros, task->enqueue_time_micros);
     }
-  });
+    queue->admission_controller->RecordQueueDelay(
+        dequeue_time_micros - earliest_enqueue_time_micros);
+  }
 
-  // Make sure we have at least one task that hasn't exceeded its timeout from
-  // queue time alone, and find the latest task deadline which we'll use for the
-  // overall batch.
-  bool all_tasks_timeout_exceeded = true;
+  // Fail the tasks that can no longer meet their deadline right away, and
+  // leave them out of the batch rather than spend a share of it on them. Find
+  // the latest deadline of the rest, which we'll use for the overall batch.
+  const int64 batch_run_micros_estimate =
+      queue->average_batch_run_micros.load(std::memory_order_relaxed);
+  std::vector<BatchingSessionTask*> tasks;
+  tasks.reserve(batch_tasks.size());
+  int64 batch_size = 0;
   uint64 batch_deadline_micros = 0;
-  for (int i = 0; i < batch->num_tasks(); ++i) {
-    const BatchingSessionTask& task = batch->task(i);
-    // If the caller doesn't populate RunOptions, the timeout is 0 by default.
-    // Interpret that as "no timeout" i.e. infinity.
-    const int64 task_timeout_micros =
-        task.run_options.timeout_in_ms() <= 0
-            ? INT_MAX
-            : task.run_options.timeout_in_ms() * 1000;
-    const uint64 task_deadline_micros =
-        task.enqueue_time_micros + task_timeout_micros;
-    if (task_deadline_micros > dequeue_time_micros) {
-      all_tasks_timeout_exceeded = false;
-      if (task_deadline_micros > batch_deadline_micros) {
-        batch_deadline_micros = task_deadline_micros;
-      }
+  for (BatchingSessionTask* task : batch_tasks) {
+    const Status deadline_status = CheckDeadline(
+        task->deadline_micros, dequeue_time_micros, batch_run_micros_estimate,
+        "while waiting in batching queue");
+    if (!deadline_status.ok()) {
+      task->done(deadline_status);
+      continue;
     }
+    tasks.push_back(task);
+    batch_size += task->size();
+    batch_deadline_micros =
+        std::max(batch_deadline_micros, task->deadline_micros);
   }
-  if (all_tasks_timeout_exceeded) {
-    status = Status(error::RESOURCE_EXHAUSTED,
-                    "Run() timeout exceeded while waiting in batching queue");
+  if (tasks.empty()) {
     return;
   }
 
-  RunOptions run_options = batch->task(0).run_options;
-  if (batch_deadline_micros == INT_MAX) {
-    run_options.set_timeout_in_ms(0);
-  } else {
-    run_options.set_timeout_in_ms(
-        (batch_deadline_micros - dequeue_time_micros) / 1000);
-  }
+  // Regardless of the outcome, we need to propagate the status to the
+  // remaining tasks and signal that they are done. We use MakeCleanup() to
+  // ensure that this happens no matter how we exit the method below.
+  Status status;
+  auto finally = MakeCleanup([&status, &tasks] {
+    for (BatchingSessionTask* task : tasks) {
+      task->done(status);
+    }
+  });
+
+  RunOptions run_options = tasks[0]->run_options;
+  SetRunOptionsTimeout(batch_deadline_micros, dequeue_time_micros,
+                       &run_options);
 
   std::vector<std::pair<string, Tensor>> merged_inputs;
-  status = MergeInputTensors(signature, *batch, &merged_inputs);
+  if (open_batch_merger != nullptr && open_batch_merge_status.ok() &&
+      tasks.size() == batch_tasks.size()) {
+    // Every task of the batch runs, so add the ones that joined as it closed,
+    // and pad.
+    for (int i = num_merged; status.ok() && i < tasks.size(); ++i) {
+      status = open_batch_merger->Add(*tasks[i]->inputs);
+    }
+    if (status.ok()) {
+      const std::vector<string> input_tensor_names(
+          signature.input_tensors.begin(), signature.input_tensors.end());
+      status = open_batch_merger->Finish(
+          input_tensor_names, RoundToLowestAllowedBatchSize(batch_size),
+          &merged_inputs);
+    }
+  } else {
+    // Merge from scratch, leaving out the tasks that have been failed (and
+    // reporting merge errors for the ones that run).
+    status = MergeInputTensors(signature, tasks, &queue->input_buffer_pool,
+                               &merged_inputs);
+  }
   if (!status.ok()) {
     return;
   }
+  if (queue->buckets != nullptr) {
+    int64 task_elements = 0;
+    for (const BatchingSessionTask* task : tasks) {
+      for (const auto& entry : *task->inputs) {
+        task_elements += entry.second.NumElements();
+      }
+    }
+    int64 merged_elements = 0;
+    for (const auto& entry : merged_inputs) {
+      merged_elements += entry.second.NumElements();
+    }
+    queue->buckets->RecordPadding(queue->bucket,
+                                  merged_elements - task_elements,
+                                  merged_elements);
+  }
 
   const std::vector<string> output_tensor_names(
       signature.output_tensors.begin(), signature.output_tensors.end());
   std::vector<Tensor> combined_outputs;
   RunMetadata run_metadata;
+  const uint64 run_start_micros = Env::Default()->NowMicros();
   status = wrapped_->Run(run_options, merged_inputs, output_tensor_names,
                          {} /* target node names */, &combined_outputs,
                          &run_metadata);
-  for (int i = 0; i < batch->num_tasks(); ++i) {
-    *(batch->mutable_task(i)->run_metadata) = run_metadata;
+  if (status.ok()) {
+    const int64 batch_run_micros =
+        Env::Default()->NowMicros() - run_start_micros;
+    RecordBatchRunTime(batch_run_micros, queue);
+    if (queue->timeout_controller != nullptr) {
+      queue->timeout_controller->RecordBatch(batch_size, batch_run_micros);
+    }
+    // Lets the callers tell the run apart from their wait for the batch.
+    SetSessionRunMicros(run_start_micros, batch_run_micros, &run_metadata);
+  }
+  for (BatchingSessionTask* task : tasks) {
+    if (task->run_metadata != nullptr) {
+      *task->run_metadata = run_metadata;
+    }
   }
   if (!status.ok()) {
     return;
   }
 
-  status = SplitOutputTensors(signature, combined_outputs, batch.get());
+  status = SplitOutputTensors(signature, combined_outputs, tasks);
 }
 
 Status CreateBatchingSession(
@@ -30,6 +30,11 @@ limitations under the License.
 #include "tensorflow/contrib/batching/batch_scheduler.h"
 #include "tensorflow/core/protobuf/meta_graph.pb.h"
 #include "tensorflow/core/public/session.h"
+#include "tensorflow_serving/batching/admission_controller.h"
+#include "tensorflow_serving/batching/batch_timeout_controller.h"
+#include "tensorflow_serving/batching/open_batch_task_feed.h"
+#include "tensorflow_serving/batching/sequence_length_buckets.h"
+#include "tensorflow_serving/util/optional.h"
 
 namespace tensorflow {
 namespace serving {
@@ -44,6 +49,23 @@ using BatchingSessionSchedulerCreator = std::function<Status(
     std::function<void(std::unique_ptr<Batch<BatchingSessionTask>>)>,
     std::unique_ptr<BatchScheduler<BatchingSessionTask>>*)>;
 
+// Like BatchingSessionSchedulerCreator, but constructs a batch scheduler whose
+// batch timeout is 'batch_timeout_micros'. Used to apply the decisions of a
+// BatchTimeoutController.
+using TunableBatchingSessionSchedulerCreator = std::function<Status(
+    int64 batch_timeout_micros,
+    std::function<void(std::unique_ptr<Batch<BatchingSessionTask>>)>,
+    std::unique_ptr<BatchScheduler<BatchingSessionTask>>*)>;
+
+// Like BatchingSessionSchedulerCreator, but for a batch scheduler that hands
+// batches to the process-batch callback while they are still open (such as
+// StreamingBatchScheduler), and passes their tasks on to 'task_feed' as they
+// join them.
+using StreamingBatchingSessionSchedulerCreator = std::function<Status(
+    std::function<void(std::unique_ptr<Batch<BatchingSessionTask>>)>,
+    OpenBatchTaskFeed<BatchingSessionTask>* task_feed,
+    std::unique_ptr<BatchScheduler<BatchingSessionTask>>*)>;
+
 // The signature associated with a Session::Run() call, in terms of input and
 // output tensor names (with the order in which the tensors are listed factored
 // out). (Note that 'target_node_names' are not supported in batching sessions.)
@@ -74,6 +96,19 @@ TensorSignature TensorSignatureFromSignatureDefs(
 struct SignatureWithBatchingSessionSchedulerCreator {
   TensorSignature signature;
   BatchingSessionSchedulerCreator scheduler_creator;
+
+  // Required iff 'BatchingSessionOptions::batch_timeout_controller_options' is
+  // set.
+  TunableBatchingSessionSchedulerCreator tunable_scheduler_creator;
+
+  // If set, used instead of 'scheduler_creator'. The inputs of the Run() calls
+  // are then concatenated as the calls join a batch, so that once the batch
+  // closes, only the batch padding is left to write before it runs. (Unless
+  // 'BatchingSessionOptions::pad_variable_length_inputs' or
+  // 'earliest_deadline_first' is set: they only merge closed batches.) Not
+  // supported along with
+  // 'BatchingSessionOptions::batch_timeout_controller_options'.
+  StreamingBatchingSessionSchedulerCreator streaming_scheduler_creator;
 };
 
 // Options for batching tensorflow Sessions; see the Create*() functions below.
@@ -130,6 +165,61 @@ struct BatchingSessionOptions {
   // (modulo zeroth dimension) and this option is set to false,
   // then error Status will be returned.
   bool pad_variable_length_inputs = false;
+
+  // If set, each signature's batch scheduler queue gets an AdmissionController
+  // with these options. It rejects Run() calls with RESOURCE_EXHAUSTED before
+  // they are scheduled when they would not fit in the queue, or when tasks
+  // have been waiting in the queue for longer than the target for a while.
+  // See admission_controller.h.
+  optional<AdmissionController::Options> admission_control_options;
+
+  // If set, each signature's batch scheduler queue gets a
+  // BatchTimeoutController with these options, which tunes the queue's batch
+  // timeout to the traffic it sees. A new queue is created with each timeout
+  // it decides on, using the signature's 'tunable_scheduler_creator'; tasks
+  // already in the old queue are processed as usual. See
+  // batch_timeout_controller.h.
+  optional<BatchTimeoutController::Options> batch_timeout_controller_options;
+
+  // If positive, a Run() call whose inputs have a larger 0th dimension is
+  // split into chunks of at most this size, which are scheduled as separate
+  // tasks. The chunks may land in different batches and run in parallel, and
+  // their outputs are concatenated back together in order before Run()
+  // returns. Batch schedulers reject tasks larger than their maximum batch
+  // size, so that is the natural value.
+  //
+  // With 'pad_variable_length_inputs', chunks may be padded differently, and
+  // Run() fails if that leaves their outputs with different shapes.
+  //
+  // If zero, oversized Run() calls are handed to the batch scheduler as is.
+  int64 max_task_size = 0;
+
+  // If set, each signature gets a batch scheduler queue per bucket of sequence
+  // lengths, made with its 'scheduler_creator', and Run() calls are routed to
+  // the queue of their length's bucket. The length of a Run() call is the
+  // largest size of the 1st dimension among its inputs. Batches then hold
+  // calls of similar lengths, which 'pad_variable_length_inputs' pads less.
+  // The fraction of each bucket's batched inputs that is padding is exported
+  // as monitoring counters, labelled with the signature's tensors (which
+  // override the options' 'signature_name'). See sequence_length_buckets.h.
+  //
+  // Requires 'pad_variable_length_inputs'.
+  optional<SequenceLengthBuckets::Options> sequence_length_bucketing_options;
+
+  // If true, a batch is made up of the queued Run() calls with the earliest
+  // deadlines (and, among those without one, the earliest arrivals) rather
+  // than the ones that arrived first. The calls wait in a deadline-ordered
+  // queue of the batching session, and the batch scheduler is only given a
+  // placeholder task of the same size for each, from which it forms batches
+  // in arrival order. Once a batch closes, each placeholder in it takes up the
+  // queued call of its size with the earliest deadline. Calls of the same size
+  // thus run in deadline order, so that calls with tight deadlines aren't
+  // stuck behind lenient ones. Calls of different sizes are not reordered
+  // relative to each other: the scheduler has fitted the sizes of a batch's
+  // placeholders to its maximum batch size, and a call of another size could
+  // overflow the batch. A batch that is failed rather than processed fails the
+  // pending calls bound to its placeholders.
+  bool earliest_deadline_first = false;
 };
 
 // Wraps a session in a new session that automatically batches Run() calls.
@@ -148,12 +238,31 @@ struct BatchingSessionOptions {
 // have the same 0th-dimension size B; the produced output tensors are also
 // assumed to have 0th-dimension size B.
 //
+// The output tensors of a batched call are slices of the batch's output
+// tensors, and share their buffers: the whole batch output stays alive for as
+// long as any call's output does. Callers that hold on to a small output for a
+// long time, or that need to modify it, should copy it (e.g. with
+// tensor::DeepCopy()).
+//
+// Once a batch has closed, calls whose deadline (from the timeout in their
+// RunOptions) has passed, or is closer than the time batches take to run, are
+// taken out of it and fail with DEADLINE_EXCEEDED; the rest of the batch runs
+// without them.
+//
 // IMPORTANT: Each call to Session::Run() is synchronous, and blocks waiting for
 // other Run() calls with the same signature to merge with to form a large
 // batch. Consequently, to achieve good throughput we recommend setting the
 // number of client threads that call Session::Run() equal to about twice the
 // sum over all signatures of the maximum batch size.
 //
+// The batching session is a ServingSession, so callers that can't spare a
+// thread per call can use ServingSession::RunAsync() (or RunSessionAsync())
+// instead. It returns once the call has been scheduled, and its callback runs
+// on the batch thread once the call's outputs have been split off the batch's.
+// The callback holds up the batch thread, so it should be short (e.g. encode a
+// response and hand it to the RPC system), and must not call into the batching
+// session.
+//
 // Example usage, for the common case of a single signature:
 //
 // BatchingSessionOptions options = ...;
@@ -199,16 +308,22 @@ struct BatchingSessionTask : public BatchTask {
 
   // Fields populated when a task is received.
   uint64 enqueue_time_micros;
+  // The absolute deadline implied by 'run_options', per Env::NowMicros(), or
+  // kInfiniteDeadlineMicros.
+  uint64 deadline_micros;
   RunOptions run_options;
   size_t zeroth_dim_size;
   const std::vector<std::pair<string, Tensor>>* inputs;
   const std::vector<string>* output_tensor_names;
 
   // Fields populated when a task is processed (as part of a batch).
-  Notification* done;
-  Status* status;
   std::vector<Tensor>* outputs;
+  // May be null, like Session::Run()'s.
   RunMetadata* run_metadata;
+
+  // Called with the outcome of the task once it has been processed, typically
+  // on the batch thread.
+  std::function<void(const Status& status)> done;
 };
 
 }  // namespace serving
@@ -15,6 +15,10 @@ limitations under the License.
 
 #include "tensorflow_serving/batching/batching_session.h"
 
+#include <algorithm>
+#include <memory>
+#include <numeric>
+
 #include <gtest/gtest.h>
 #include "tensorflow/cc/saved_model/loader.h"
 #include "tensorflow/cc/saved_model/tag_constants.h"
@@ -22,13 +26,20 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/io/path.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/public/session.h"
 #include "tensorflow/core/public/session_options.h"
+#include "tensorflow_serving/batching/streaming_batch_scheduler.h"
+#include "tensorflow_serving/servables/tensorflow/deadline_util.h"
 #include "tensorflow_serving/servables/tensorflow/serving_session.h"
 #include "tensorflow_serving/test_util/test_util.h"
 
@@ -80,6 +91,61 @@ class BatchSizeCapturingSession : public ServingSession {
   TF_DISALLOW_COPY_AND_ASSIGN(BatchSizeCapturingSession);
 };
 
+// A wrapper around a Session that records the first input value of each batch,
+// and holds up the first batch until released.
+class InputRecordingSession : public ServingSession {
+ public:
+  InputRecordingSession(std::unique_ptr<Session> wrapped,
+                        Notification* release)
+      : wrapped_(std::move(wrapped)), release_(release) {}
+  ~InputRecordingSession() override = default;
+
+  Status Run(const std::vector<std::pair<string, Tensor>>& inputs,
+             const std::vector<string>& output_tensor_names,
+             const std::vector<string>& target_node_names,
+             std::vector<Tensor>* outputs) override {
+    RunMetadata run_metadata;
+    return Run(RunOptions(), inputs, output_tensor_names, target_node_names,
+               outputs, &run_metadata);
+  }
+
+  Status Run(const RunOptions& run_options,
+             const std::vector<std::pair<string, Tensor>>& inputs,
+             const std::vector<string>& output_tensor_names,
+             const std::vector<string>& target_node_names,
+             std::vector<Tensor>* outputs, RunMetadata* run_metadata) override {
+    bool first;
+    {
+      mutex_lock l(mu_);
+      first = recorded_inputs_.empty();
+      recorded_inputs_.push_back(inputs[0].second.flat<float>()(0));
+    }
+    if (first) {
+      release_->WaitForNotification();
+    }
+    return wrapped_->Run(run_options, inputs, output_tensor_names,
+                         target_node_names, outputs, run_metadata);
+  }
+
+  Status ListDevices(std::vector<DeviceAttributes>* response) override {
+    return wrapped_->ListDevices(response);
+  }
+
+  std::vector<float> recorded_inputs() const {
+    mutex_lock l(mu_);
+    return recorded_inputs_;
+  }
+
+ private:
+  std::unique_ptr<Session> wrapped_;
+  Notification* const release_;
+
+  mutable mutex mu_;
+  std::vector<float> recorded_inputs_ GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(InputRecordingSession);
+};
+
 // Creates a (non-batching) session with the half-plus-two model loaded.
 std::unique_ptr<Session> CreateHalfPlusTwoSession() {
   tensorflow::SessionOptions session_options;
@@ -103,6 +169,21 @@ std::unique_ptr<Session> CreateMatrixHalfPlusTwoSession() {
   return std::move(bundle.session);
 }
 
+// Creates a (non-batching) session whose output "y" is its float input "x", of
+// any shape.
+std::unique_ptr<Session> CreateIdentitySession() {
+  GraphDef graph_def;
+  CHECK(protobuf::TextFormat::ParseFromString(
+      "node { name: 'x' op: 'Placeholder' "
+      "       attr { key: 'dtype' value { type: DT_FLOAT } } } "
+      "node { name: 'y' op: 'Identity' input: 'x' "
+      "       attr { key: 'T' value { type: DT_FLOAT } } }",
+      &graph_def));
+  std::unique_ptr<Session> session(NewSession(SessionOptions()));
+  TF_CHECK_OK(session->Create(graph_def));
+  return session;
+}
+
 // Test that a session handles a single request for the half-plus-two model
 // properly. The request has two input floats (size=2 for batching purposes).
 void TestSingleRequest(float input_0, float input_1, Session* session) {
@@ -204,6 +285,115 @@ TEST(BatchingSessionTest, Basic) {
       }));
 }
 
+TEST(BatchingSessionTest, OutputsAreSlicesOfTheBatchOutput) {
+  BasicBatchScheduler<BatchingSessionTask>::Options schedule_options;
+  schedule_options.max_batch_size = 4;  // fits two 2-unit tasks
+  schedule_options.batch_timeout_micros = 1 * 1000 * 1000;  // won't trigger
+  schedule_options.num_batch_threads = 1;
+  std::unique_ptr<Session> batching_session;
+  BatchingSessionOptions batching_session_options;
+  TF_ASSERT_OK(CreateBasicBatchingSession(
+      schedule_options, batching_session_options, {{"x"}, {"y"}},
+      CreateHalfPlusTwoSession(), &batching_session));
+
+  Tensor first_output;
+  Tensor second_output;
+  {
+    auto run = [&batching_session](float input_0, float input_1,
+                                   Tensor* output) {
+      std::vector<Tensor> outputs;
+      TF_ASSERT_OK(batching_session->Run(
+          {{"x", test::AsTensor<float>({input_0, input_1}, {2})}}, {"y"},
+          {} /* target nodes */, &outputs));
+      ASSERT_EQ(1, outputs.size());
+      *output = outputs[0];
+    };
+    std::unique_ptr<Thread> first_request_thread(Env::Default()->StartThread(
+        ThreadOptions(), "first_request_thread",
+        [&run, &first_output] { run(100.0f, 42.0f, &first_output); }));
+    std::unique_ptr<Thread> second_request_thread(Env::Default()->StartThread(
+        ThreadOptions(), "second_request_thread",
+        [&run, &second_output] { run(71.5f, 18.3f, &second_output); }));
+  }
+  test::ExpectTensorEqual<float>(
+      test::AsTensor<float>({100.0f / 2 + 2, 42.0f / 2 + 2}, {2}),
+      first_output);
+  test::ExpectTensorEqual<float>(
+      test::AsTensor<float>({71.5f / 2 + 2, 18.3f / 2 + 2}, {2}),
+      second_output);
+
+  // The two outputs are adjacent rows of one buffer, in either order.
+  const char* const first_data = first_output.tensor_data().data();
+  const char* const second_data = second_output.tensor_data().data();
+  const size_t row_bytes = first_output.tensor_data().size();
+  EXPECT_TRUE(second_data == first_data + row_bytes ||
+              first_data == second_data + row_bytes);
+}
+
+TEST(BatchingSessionTest, RunAsync) {
+  BasicBatchScheduler<BatchingSessionTask>::Options schedule_options;
+  schedule_options.max_batch_size = 4;  // fits two 2-unit tasks
+  schedule_options.batch_timeout_micros = 1 * 1000 * 1000;  // won't trigger
+  schedule_options.num_batch_threads = 1;
+  std::unique_ptr<Session> batching_session;
+  BatchingSessionOptions batching_session_options;
+  TF_ASSERT_OK(CreateBasicBatchingSession(
+      schedule_options, batching_session_options, {{"x"}, {"y"}},
+      CreateHalfPlusTwoSession(), &batching_session));
+
+  // Both calls are made from this thread, which would block on the first one
+  // if it had to wait for the batch to fill up.
+  const std::vector<std::pair<string, Tensor>> inputs_0 = {
+      {"x", test::AsTensor<float>({100.0f, 42.0f}, {2})}};
+  const std::vector<std::pair<string, Tensor>> inputs_1 = {
+      {"x", test::AsTensor<float>({71.5f, 18.0f}, {2})}};
+  const std::vector<string> output_tensor_names = {"y"};
+  std::vector<Tensor> outputs_0, outputs_1;
+  RunMetadata run_metadata_0;
+  Notification done_0, done_1;
+  Status status_0, status_1;
+  RunSessionAsync(batching_session.get(), RunOptions(), inputs_0,
+                  output_tensor_names, &outputs_0, &run_metadata_0,
+                  [&](const Status& status) {
+                    status_0 = status;
+                    done_0.Notify();
+                  });
+  EXPECT_FALSE(done_0.HasBeenNotified());
+  // Like Run(), RunAsync() doesn't require run metadata.
+  RunSessionAsync(batching_session.get(), RunOptions(), inputs_1,
+                  output_tensor_names, &outputs_1, nullptr /* run_metadata */,
+                  [&](const Status& status) {
+                    status_1 = status;
+                    done_1.Notify();
+                  });
+  done_0.WaitForNotification();
+  done_1.WaitForNotification();
+  TF_ASSERT_OK(status_0);
+  TF_ASSERT_OK(status_1);
+  ASSERT_EQ(1, outputs_0.size());
+  test::ExpectTensorEqual<float>(test::AsTensor<float>({52.0f, 23.0f}, {2}),
+                                 outputs_0[0]);
+  ASSERT_EQ(1, outputs_1.size());
+  test::ExpectTensorEqual<float>(test::AsTensor<float>({37.75f, 11.0f}, {2}),
+                                 outputs_1[0]);
+  // The run of the batch is reported apart from the wait for it.
+  EXPECT_GE(GetSessionRunMicros(run_metadata_0), 0);
+
+  // A call that can't be scheduled fails before RunAsync() returns.
+  const std::vector<std::pair<string, Tensor>> scalar_inputs = {
+      {"x", test::AsScalar<float>(1.0f)}};
+  bool scalar_done = false;
+  Status scalar_status;
+  RunSessionAsync(batching_session.get(), RunOptions(), scalar_inputs,
+                  output_tensor_names, &outputs_0, &run_metadata_0,
+                  [&](const Status& status) {
+                    scalar_status = status;
+                    scalar_done = true;
+                  });
+  EXPECT_TRUE(scalar_done);
+  EXPECT_EQ(error::INVALID_ARGUMENT, scalar_status.code());
+}
+
 TEST(BatchingSessionTest, BatchingWithPadding) {
   BasicBatchScheduler<BatchingSessionTask>::Options schedule_options;
   schedule_options.max_batch_size = 2;
@@ -279,6 +469,176 @@ TEST(BatchingSessionTest, SingletonBatch) {
   TestSingleRequest(100.0f, 42.0f, batching_session.get());
 }
 
+TEST(BatchingSessionTest, AdmissionControl) {
+  BasicBatchScheduler<BatchingSessionTask>::Options schedule_options;
+  schedule_options.max_batch_size = 4;
+  schedule_options.batch_timeout_micros = 0;
+  schedule_options.num_batch_threads = 1;
+  std::unique_ptr<Session> batching_session;
+  BatchingSessionOptions batching_session_options;
+  batching_session_options.admission_control_options =
+      AdmissionController::Options();
+  TF_ASSERT_OK(CreateBasicBatchingSession(
+      schedule_options, batching_session_options, {{"x"}, {"y"}},
+      CreateHalfPlusTwoSession(), &batching_session));
+  // An idle queue admits everything.
+  for (int i = 0; i < 10; ++i) {
+    TestSingleRequest(100.0f, 42.0f, batching_session.get());
+  }
+}
+
+TEST(BatchingSessionTest, AdaptiveBatchTimeout) {
+  // The batch timeouts queues have been created with.
+  std::vector<int64> batch_timeouts;
+  auto create_scheduler = [&batch_timeouts](
+      const int64 batch_timeout_micros,
+      std::function<void(std::unique_ptr<Batch<BatchingSessionTask>>)>
+          process_batch_callback,
+      std::unique_ptr<BatchScheduler<BatchingSessionTask>>* scheduler) {
+    BasicBatchScheduler<BatchingSessionTask>::Options options;
+    options.max_batch_size = 4;
+    options.batch_timeout_micros = batch_timeout_micros;
+    options.num_batch_threads = 1;
+    std::unique_ptr<BasicBatchScheduler<BatchingSessionTask>> basic_scheduler;
+    TF_RETURN_IF_ERROR(BasicBatchScheduler<BatchingSessionTask>::Create(
+        options, process_batch_callback, &basic_scheduler));
+    batch_timeouts.push_back(batch_timeout_micros);
+    *scheduler = std::move(basic_scheduler);
+    return Status::OK();
+  };
+  auto create_default_scheduler = [&create_scheduler](
+      std::function<void(std::unique_ptr<Batch<BatchingSessionTask>>)>
+          process_batch_callback,
+      std::unique_ptr<BatchScheduler<BatchingSessionTask>>* scheduler) {
+    return create_scheduler(100, process_batch_callback, scheduler);
+  };
+  BatchingSessionOptions batching_session_options;
+  BatchTimeoutController::Options controller_options;
+  controller_options.max_batch_size = 4;
+  controller_options.max_batch_timeout_micros = 100;
+  controller_options.adjustment_interval_micros = 1;
+  controller_options.min_adjustment_fraction = 0;
+  batching_session_options.batch_timeout_controller_options =
+      controller_options;
+
+  // The controller needs a way to create queues with other timeouts.
+  std::unique_ptr<Session> batching_session;
+  EXPECT_FALSE(
+      CreateBatchingSession(batching_session_options,
+                            {{{{"x"}, {"y"}}, create_default_scheduler}},
+                            CreateHalfPlusTwoSession(), &batching_session)
+          .ok());
+
+  batch_timeouts.clear();
+  TF_ASSERT_OK(CreateBatchingSession(
+      batching_session_options,
+      {{{{"x"}, {"y"}}, create_default_scheduler, create_scheduler}},
+      CreateHalfPlusTwoSession(), &batching_session));
+  // Requests issued one at a time never have company to wait for.
+  for (int i = 0; i < 10; ++i) {
+    TestSingleRequest(100.0f, 42.0f, batching_session.get());
+  }
+  EXPECT_EQ(100, batch_timeouts.front());
+  EXPECT_NE(batch_timeouts.end(),
+            std::find(batch_timeouts.begin(), batch_timeouts.end(), 0));
+}
+
+TEST(BatchingSessionTest, SplitsOversizedTasks) {
+  BasicBatchScheduler<BatchingSessionTask>::Options schedule_options;
+  schedule_options.max_batch_size = 2;
+  schedule_options.batch_timeout_micros = 0;
+  schedule_options.num_batch_threads = 2;
+  std::unique_ptr<Session> batching_session;
+  BatchingSessionOptions batching_session_options;
+  batching_session_options.max_task_size = 2;
+  TF_ASSERT_OK(CreateBasicBatchingSession(
+      schedule_options, batching_session_options, {{"x"}, {"y"}},
+      CreateHalfPlusTwoSession(), &batching_session));
+
+  // Three chunks, the last one short.
+  const Tensor input =
+      test::AsTensor<float>({100.0f, 42.0f, 10.0f, 20.0f, 30.0f}, {5});
+  const Tensor expected_output =
+      test::AsTensor<float>({52.0f, 23.0f, 7.0f, 12.0f, 17.0f}, {5});
+  std::vector<Tensor> outputs;
+  TF_ASSERT_OK(batching_session->Run({{"x", input}}, {"y"} /* outputs */,
+                                     {} /* target nodes */, &outputs));
+  ASSERT_EQ(1, outputs.size());
+  test::ExpectTensorEqual<float>(expected_output, outputs[0]);
+
+  // Without splitting, the scheduler rejects the task.
+  batching_session_options.max_task_size = 0;
+  TF_ASSERT_OK(CreateBasicBatchingSession(
+      schedule_options, batching_session_options, {{"x"}, {"y"}},
+      CreateHalfPlusTwoSession(), &batching_session));
+  EXPECT_FALSE(batching_session->Run({{"x", input}}, {"y"} /* outputs */,
+                                     {} /* target nodes */, &outputs)
+                   .ok());
+}
+
+TEST(BatchingSessionTest, SequenceLengthBuckets) {
+  std::vector<BatchScheduler<BatchingSessionTask>*> schedulers;
+  auto create_scheduler = [&schedulers](
+      std::function<void(std::unique_ptr<Batch<BatchingSessionTask>>)>
+          process_batch_callback,
+      std::unique_ptr<BatchScheduler<BatchingSessionTask>>* scheduler) {
+    BasicBatchScheduler<BatchingSessionTask>::Options options;
+    options.max_batch_size = 2;
+    options.batch_timeout_micros = 1 * 1000 * 1000;  // won't trigger
+    options.num_batch_threads = 1;
+    std::unique_ptr<BasicBatchScheduler<BatchingSessionTask>> basic_scheduler;
+    TF_RETURN_IF_ERROR(BasicBatchScheduler<BatchingSessionTask>::Create(
+        options, process_batch_callback, &basic_scheduler));
+    schedulers.push_back(basic_scheduler.get());
+    *scheduler = std::move(basic_scheduler);
+    return Status::OK();
+  };
+  BatchingSessionOptions batching_session_options;
+  SequenceLengthBuckets::Options bucketing_options;
+  bucketing_options.bucket_boundaries = {2};
+  batching_session_options.sequence_length_bucketing_options =
+      bucketing_options;
+  std::unique_ptr<Session> batching_session;
+
+  // Bucketing is only useful with padding.
+  EXPECT_FALSE(CreateBatchingSession(batching_session_options,
+                                     {{{{"x"}, {"y"}}, create_scheduler}},
+                                     CreateIdentitySession(),
+                                     &batching_session)
+                   .ok());
+  batching_session_options.pad_variable_length_inputs = true;
+  TF_ASSERT_OK(CreateBatchingSession(batching_session_options,
+                                     {{{{"x"}, {"y"}}, create_scheduler}},
+                                     CreateIdentitySession(),
+                                     &batching_session));
+  ASSERT_EQ(2, schedulers.size());
+
+  auto run_request = [&batching_session](const int64 length) {
+    std::vector<float> values(length);
+    std::iota(values.begin(), values.end(), 1.0f);
+    const Tensor input = test::AsTensor<float>(values, {1, length});
+    std::vector<Tensor> outputs;
+    TF_ASSERT_OK(batching_session->Run({{"x", input}}, {"y"} /* outputs */,
+                                       {} /* target nodes */, &outputs));
+    ASSERT_EQ(1, outputs.size());
+    // Neither request was padded to the length of the other bucket's.
+    test::ExpectTensorEqual<float>(input, outputs[0]);
+  };
+
+  // A short and a long request go into separate queues, where they wait for a
+  // second request of their length.
+  std::unique_ptr<Thread> short_thread(Env::Default()->StartThread(
+      ThreadOptions(), "short_thread", [&] { run_request(2); }));
+  std::unique_ptr<Thread> long_thread(Env::Default()->StartThread(
+      ThreadOptions(), "long_thread", [&] { run_request(5); }));
+  while (schedulers[0]->NumEnqueuedTasks() != 1 ||
+         schedulers[1]->NumEnqueuedTasks() != 1) {
+    Env::Default()->SleepForMicroseconds(100);
+  }
+  run_request(2);
+  run_request(5);
+}
+
 TEST(BatchingSessionTest, RequestThatDoesntMatchSignatureGetsRunAnyway) {
   BasicBatchScheduler<BatchingSessionTask>::Options schedule_options;
   // Set the batching parameters s.t. if the request is batched the test will
@@ -355,6 +715,58 @@ TEST(BatchingSessionTest, AllowedBatchSizesRequirePadding) {
   EXPECT_EQ(3, batch_size_capturing_session_raw->latest_batch_size());
 }
 
+TEST(BatchingSessionTest, StreamingSchedulerMergesOpenBatches) {
+  // Arrange to capture the batch size.
+  std::unique_ptr<BatchSizeCapturingSession> batch_size_capturing_session(
+      new BatchSizeCapturingSession(CreateHalfPlusTwoSession()));
+  auto batch_size_capturing_session_raw = batch_size_capturing_session.get();
+
+  SignatureWithBatchingSessionSchedulerCreator signature_with_creator;
+  signature_with_creator.signature = {{"x"}, {"y"}};
+  signature_with_creator.streaming_scheduler_creator = [](
+      std::function<void(std::unique_ptr<Batch<BatchingSessionTask>>)>
+          process_batch_callback,
+      OpenBatchTaskFeed<BatchingSessionTask>* task_feed,
+      std::unique_ptr<BatchScheduler<BatchingSessionTask>>* new_scheduler) {
+    StreamingBatchScheduler<BatchingSessionTask>::Options options;
+    options.max_batch_size = 4;
+    options.batch_timeout_micros = 100 * 1000;  // 100 milliseconds
+    // One thread for a batch that is being processed, and one for the next,
+    // which is handed over as soon as it opens.
+    options.num_batch_threads = 2;
+    options.task_feed = task_feed;
+    std::unique_ptr<StreamingBatchScheduler<BatchingSessionTask>>
+        streaming_scheduler;
+    TF_RETURN_IF_ERROR(StreamingBatchScheduler<BatchingSessionTask>::Create(
+        options, process_batch_callback, &streaming_scheduler));
+    *new_scheduler = std::move(streaming_scheduler);
+    return Status::OK();
+  };
+  BatchingSessionOptions batching_session_options;
+  batching_session_options.allowed_batch_sizes = {1, 3, 4};
+  std::unique_ptr<Session> batching_session;
+  TF_ASSERT_OK(CreateBatchingSession(
+      batching_session_options, {signature_with_creator},
+      std::move(batch_size_capturing_session), &batching_session));
+
+  // A lone request times out the batch, which is padded from 2 to 3.
+  TestSingleRequest(100.0f, 42.0f, batching_session.get());
+  EXPECT_EQ(3, batch_size_capturing_session_raw->latest_batch_size());
+
+  // Two requests fill a batch.
+  {
+    std::unique_ptr<Thread> first_request_thread(Env::Default()->StartThread(
+        ThreadOptions(), "first_request_thread", [&batching_session] {
+          TestSingleRequest(100.0f, 42.0f, batching_session.get());
+        }));
+    std::unique_ptr<Thread> second_request_thread(Env::Default()->StartThread(
+        ThreadOptions(), "second_request_thread", [&batching_session] {
+          TestSingleRequest(71.5f, 18.3f, batching_session.get());
+        }));
+  }
+  EXPECT_EQ(4, batch_size_capturing_session_raw->latest_batch_size());
+}
+
 TEST(BatchingSessionTest, UnsortedAllowedBatchSizesRejected) {
   BasicBatchScheduler<BatchingSessionTask>::Options schedule_options;
   schedule_options.max_batch_size = 4;
@@ -528,10 +940,9 @@ TEST(BatchingSessionTest, EnqueuedLongerThanTimeout) {
         batching_session->Run(run_options, {{"x", input}}, {"y"} /* outputs */,
                               {} /* target nodes */, &outputs, &run_metadata);
     EXPECT_FALSE(status.ok());
-    EXPECT_EQ(error::RESOURCE_EXHAUSTED, status.code());
-    EXPECT_THAT(
-        status.error_message(),
-        HasSubstr("Run() timeout exceeded while waiting in batching queue"));
+    EXPECT_EQ(error::DEADLINE_EXCEEDED, status.code());
+    EXPECT_THAT(status.error_message(),
+                HasSubstr("while waiting in batching queue"));
     request_returned.Notify();
   };
   std::unique_ptr<Thread> request_thread(Env::Default()->StartThread(
@@ -547,6 +958,233 @@ TEST(BatchingSessionTest, EnqueuedLongerThanTimeout) {
   request_returned.WaitForNotification();
 }
 
+TEST(BatchingSessionTest, DropsExpiredTasksFromBatch) {
+  BatchScheduler<BatchingSessionTask>* scheduler = nullptr;
+  auto create_scheduler = [&scheduler](
+      std::function<void(std::unique_ptr<Batch<BatchingSessionTask>>)>
+          process_batch_callback,
+      std::unique_ptr<BatchScheduler<BatchingSessionTask>>* new_scheduler) {
+    BasicBatchScheduler<BatchingSessionTask>::Options options;
+    options.max_batch_size = 4;                      // fits two 2-unit tasks
+    options.batch_timeout_micros = 1 * 1000 * 1000;  // won't trigger
+    options.num_batch_threads = 1;
+    std::unique_ptr<BasicBatchScheduler<BatchingSessionTask>> basic_scheduler;
+    TF_RETURN_IF_ERROR(BasicBatchScheduler<BatchingSessionTask>::Create(
+        options, process_batch_callback, &basic_scheduler));
+    scheduler = basic_scheduler.get();
+    *new_scheduler = std::move(basic_scheduler);
+    return Status::OK();
+  };
+  BatchingSessionOptions batching_session_options;
+  std::unique_ptr<Session> batching_session;
+  TF_CHECK_OK(CreateBatchingSession(
+      batching_session_options, {{{{"x"}, {"y"}}, create_scheduler}},
+      CreateHalfPlusTwoSession(), &batching_session));
+  ASSERT_FALSE(scheduler == nullptr);
+
+  // Enqueue a request with a timeout, and let it expire in the queue.
+  std::unique_ptr<Thread> expiring_thread(Env::Default()->StartThread(
+      ThreadOptions(), "expiring_thread", [&batching_session] {
+        RunOptions run_options;
+        run_options.set_timeout_in_ms(1);
+        std::vector<Tensor> outputs;
+        RunMetadata run_metadata;
+        const Status status = batching_session->Run(
+            run_options, {{"x", test::AsTensor<float>({1.0f, 2.0f}, {2})}},
+            {"y"} /* outputs */, {} /* target nodes */, &outputs,
+            &run_metadata);
+        EXPECT_EQ(error::DEADLINE_EXCEEDED, status.code());
+      }));
+  while (scheduler->NumEnqueuedTasks() != 1) {
+    Env::Default()->SleepForMicroseconds(100);
+  }
+  Env::Default()->SleepForMicroseconds(10 * 1000);
+
+  // A request without a timeout fills the batch, and runs without the expired
+  // one.
+  TestSingleRequest(100.0f, 42.0f, batching_session.get());
+}
+
+TEST(BatchingSessionTest, EarliestDeadlineFirst) {
+  BatchScheduler<BatchingSessionTask>* scheduler = nullptr;
+  auto create_scheduler = [&scheduler](
+      std::function<void(std::unique_ptr<Batch<BatchingSessionTask>>)>
+          process_batch_callback,
+      std::unique_ptr<BatchScheduler<BatchingSessionTask>>* new_scheduler) {
+    BasicBatchScheduler<BatchingSessionTask>::Options options;
+    options.max_batch_size = 1;
+    options.batch_timeout_micros = 0;
+    options.num_batch_threads = 1;
+    std::unique_ptr<BasicBatchScheduler<BatchingSessionTask>> basic_scheduler;
+    TF_RETURN_IF_ERROR(BasicBatchScheduler<BatchingSessionTask>::Create(
+        options, process_batch_callback, &basic_scheduler));
+    scheduler = basic_scheduler.get();
+    *new_scheduler = std::move(basic_scheduler);
+    return Status::OK();
+  };
+  BatchingSessionOptions batching_session_options;
+  batching_session_options.earliest_deadline_first = true;
+  Notification release;
+  auto* recording_session =
+      new InputRecordingSession(CreateHalfPlusTwoSession(), &release);
+  std::unique_ptr<Session> batching_session;
+  TF_CHECK_OK(CreateBatchingSession(
+      batching_session_options, {{{{"x"}, {"y"}}, create_scheduler}},
+      std::unique_ptr<Session>(recording_session), &batching_session));
+  ASSERT_FALSE(scheduler == nullptr);
+
+  auto run_request = [&batching_session](const float input,
+                                         const int64 timeout_in_ms) {
+    RunOptions run_options;
+    run_options.set_timeout_in_ms(timeout_in_ms);
+    std::vector<Tensor> outputs;
+    RunMetadata run_metadata;
+    TF_ASSERT_OK(batching_session->Run(
+        run_options, {{"x", test::AsTensor<float>({input}, {1})}},
+        {"y"} /* outputs */, {} /* target nodes */, &outputs, &run_metadata));
+    ASSERT_EQ(1, outputs.size());
+    test::ExpectTensorEqual<float>(test::AsTensor<float>({input / 2 + 2}, {1}),
+                                   outputs[0]);
+  };
+
+  // The first request holds up the batch thread, while a request without a
+  // deadline and then one with a deadline queue up behind it.
+  std::vector<std::unique_ptr<Thread>> request_threads;
+  request_threads.emplace_back(Env::Default()->StartThread(
+      ThreadOptions(), "first_request", [&] { run_request(1.0f, 0); }));
+  while (recording_session->recorded_inputs().empty()) {
+    Env::Default()->SleepForMicroseconds(100);
+  }
+  request_threads.emplace_back(Env::Default()->StartThread(
+      ThreadOptions(), "lenient_request", [&] { run_request(2.0f, 0); }));
+  while (scheduler->NumEnqueuedTasks() != 1) {
+    Env::Default()->SleepForMicroseconds(100);
+  }
+  request_threads.emplace_back(Env::Default()->StartThread(
+      ThreadOptions(), "tight_request", [&] { run_request(3.0f, 60 * 1000); }));
+  while (scheduler->NumEnqueuedTasks() != 2) {
+    Env::Default()->SleepForMicroseconds(100);
+  }
+  release.Notify();
+  request_threads.clear();
+
+  // The request with a deadline overtook the one without.
+  EXPECT_EQ(std::vector<float>({1.0f, 3.0f, 2.0f}),
+            recording_session->recorded_inputs());
+}
+
+TEST(BatchingSessionTest, EarliestDeadlineFirstFailsCallsOfDroppedBatches) {
+  // The scheduler's batches are failed rather than processed, as a batch
+  // thread does with a batch it can't take on.
+  auto create_scheduler = [](
+      std::function<void(std::unique_ptr<Batch<BatchingSessionTask>>)>
+          process_batch_callback,
+      std::unique_ptr<BatchScheduler<BatchingSessionTask>>* new_scheduler) {
+    BasicBatchScheduler<BatchingSessionTask>::Options options;
+    options.max_batch_size = 1;
+    options.batch_timeout_micros = 0;
+    options.num_batch_threads = 1;
+    std::unique_ptr<BasicBatchScheduler<BatchingSessionTask>> basic_scheduler;
+    TF_RETURN_IF_ERROR(BasicBatchScheduler<BatchingSessionTask>::Create(
+        options,
+        [](std::unique_ptr<Batch<BatchingSessionTask>> batch) {
+          batch->WaitUntilClosed();
+          for (int i = 0; i < batch->num_tasks(); ++i) {
+            batch->mutable_task(i)->done(errors::Unavailable("Dropped"));
+          }
+        },
+        &basic_scheduler));
+    *new_scheduler = std::move(basic_scheduler);
+    return Status::OK();
+  };
+  BatchingSessionOptions batching_session_options;
+  batching_session_options.earliest_deadline_first = true;
+  std::unique_ptr<Session> batching_session;
+  TF_CHECK_OK(CreateBatchingSession(
+      batching_session_options, {{{{"x"}, {"y"}}, create_scheduler}},
+      CreateHalfPlusTwoSession(), &batching_session));
+
+  std::vector<Tensor> outputs;
+  const Status status = batching_session->Run(
+      {{"x", test::AsTensor<float>({1.0f}, {1})}}, {"y"} /* outputs */,
+      {} /* target nodes */, &outputs);
+  EXPECT_EQ(error::UNAVAILABLE, status.code());
+}
+
+TEST(BatchingSessionTest, EarliestDeadlineFirstDroppedBatchFailsItsOwnCall) {
+  // The first batch is held up and then failed; later ones are processed.
+  BatchScheduler<BatchingSessionTask>* scheduler = nullptr;
+  Notification first_batch_started;
+  Notification release;
+  auto create_scheduler = [&scheduler, &first_batch_started, &release](
+      std::function<void(std::unique_ptr<Batch<BatchingSessionTask>>)>
+          process_batch_callback,
+      std::unique_ptr<BatchScheduler<BatchingSessionTask>>* new_scheduler) {
+    BasicBatchScheduler<BatchingSessionTask>::Options options;
+    options.max_batch_size = 1;
+    options.batch_timeout_micros = 0;
+    options.num_batch_threads = 1;
+    auto num_batches = std::make_shared<int>(0);
+    std::unique_ptr<BasicBatchScheduler<BatchingSessionTask>> basic_scheduler;
+    TF_RETURN_IF_ERROR(BasicBatchScheduler<BatchingSessionTask>::Create(
+        options,
+        [num_batches, &first_batch_started, &release,
+         process_batch_callback](
+            std::unique_ptr<Batch<BatchingSessionTask>> batch) {
+          if (++*num_batches > 1) {
+            process_batch_callback(std::move(batch));
+            return;
+          }
+          first_batch_started.Notify();
+          release.WaitForNotification();
+          batch->WaitUntilClosed();
+          for (int i = 0; i < batch->num_tasks(); ++i) {
+            batch->mutable_task(i)->done(errors::Unavailable("Dropped"));
+          }
+        },
+        &basic_scheduler));
+    scheduler = basic_scheduler.get();
+    *new_scheduler = std::move(basic_scheduler);
+    return Status::OK();
+  };
+  BatchingSessionOptions batching_session_options;
+  batching_session_options.earliest_deadline_first = true;
+  std::unique_ptr<Session> batching_session;
+  TF_CHECK_OK(CreateBatchingSession(
+      batching_session_options, {{{{"x"}, {"y"}}, create_scheduler}},
+      CreateHalfPlusTwoSession(), &batching_session));
+  ASSERT_FALSE(scheduler == nullptr);
+
+  auto run_request = [&batching_session](const float input,
+                                         const int64 timeout_in_ms,
+                                         const error::Code expected_code) {
+    RunOptions run_options;
+    run_options.set_timeout_in_ms(timeout_in_ms);
+    std::vector<Tensor> outputs;
+    RunMetadata run_metadata;
+    const Status status = batching_session->Run(
+        run_options, {{"x", test::AsTensor<float>({input}, {1})}},
+        {"y"} /* outputs */, {} /* target nodes */, &outputs, &run_metadata);
+    EXPECT_EQ(expected_code, status.code());
+  };
+
+  // A request without a deadline is in the dropped batch. One with a deadline
+  // queues up behind it, and must not be failed in its stead.
+  std::vector<std::unique_ptr<Thread>> request_threads;
+  request_threads.emplace_back(Env::Default()->StartThread(
+      ThreadOptions(), "dropped_request",
+      [&] { run_request(1.0f, 0, error::UNAVAILABLE); }));
+  first_batch_started.WaitForNotification();
+  request_threads.emplace_back(Env::Default()->StartThread(
+      ThreadOptions(), "tight_request",
+      [&] { run_request(2.0f, 60 * 1000, error::OK); }));
+  while (scheduler->NumEnqueuedTasks() != 1) {
+    Env::Default()->SleepForMicroseconds(100);
+  }
+  release.Notify();
+  request_threads.clear();
+}
+
 }  // namespace
 }  // namespace serving
 }  // namespace tensorflow
@@ -0,0 +1,220 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow_serving/batching/fair_share_batch_executor.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/monitoring/counter.h"
+
+namespace tensorflow {
+namespace serving {
+namespace {
+
+auto* busy_micros_counter = monitoring::Counter<1>::New(
+    "/tensorflow/serving/batching/fair_share_busy_micros",
+    "The thread time taken by the batches of each fair-share batch queue, in "
+    "microseconds.",
+    "queue");
+
+// The weight of the latest batch run time in the moving average that
+// batches are charged by when they start.
+constexpr double kRunTimeSmoothing = 0.125;
+
+}  // namespace
+
+struct FairShareBatchExecutor::QueueState {
+  explicit QueueState(const QueueOptions& options) : options(options) {}
+
+  const QueueOptions options;
+  std::deque<std::function<void()>> batches;
+  int num_running = 0;
+  double virtual_time = 0;
+  double average_run_micros = 0;
+  int64 busy_micros = 0;
+};
+
+// static
+Status FairShareBatchExecutor::Create(
+    const Options& options, std::shared_ptr<FairShareBatchExecutor>* executor) {
+  if (options.num_threads < 1) {
+    return errors::InvalidArgument("num_threads must be positive; was ",
+                                   options.num_threads);
+  }
+  executor->reset(new FairShareBatchExecutor(options));
+  return Status::OK();
+}
+
+FairShareBatchExecutor::FairShareBatchExecutor(const Options& options)
+    : options_(options) {}
+
+FairShareBatchExecutor::~FairShareBatchExecutor() {
+  mutex_lock l(mu_);
+  DCHECK(queues_.empty());
+}
+
+Status FairShareBatchExecutor::AddQueue(const QueueOptions& options,
+                                        std::unique_ptr<Queue>* queue) {
+  if (options.weight <= 0) {
+    return errors::InvalidArgument("weight must be positive; was ",
+                                   options.weight);
+  }
+  if (options.max_enqueued_batches < 1) {
+    return errors::InvalidArgument(
+        "max_enqueued_batches must be positive; was ",
+        options.max_enqueued_batches);
+  }
+  std::unique_ptr<QueueState> state(new QueueState(options));
+  QueueState* const raw_state = state.get();
+  {
+    mutex_lock l(mu_);
+    queues_.push_back(std::move(state));
+  }
+  queue->reset(new Queue(shared_from_this(), raw_state));
+  return Status::OK();
+}
+
+FairShareBatchExecutor::QueueState* FairShareBatchExecutor::NextQueue() {
+  if (num_running_ >= options_.num_threads) {
+    return nullptr;
+  }
+  // Only the queues of the highest priority with a batch kept get a thread,
+  // even if they are over their share.
+  int top_priority = 0;
+  bool any_kept = false;
+  for (const std::unique_ptr<QueueState>& queue : queues_) {
+    if (!queue->batches.empty() &&
+        (!any_kept || queue->options.priority > top_priority)) {
+      top_priority = queue->options.priority;
+      any_kept = true;
+    }
+  }
+  if (!any_kept) {
+    return nullptr;
+  }
+  double active_weight = 0;
+  for (const std::unique_ptr<QueueState>& queue : queues_) {
+    if (queue->options.priority == top_priority &&
+        (queue->num_running > 0 || !queue->batches.empty())) {
+      active_weight += queue->options.weight;
+    }
+  }
+  QueueState* next = nullptr;
+  for (const std::unique_ptr<QueueState>& queue : queues_) {
+    if (queue->batches.empty() || queue->options.priority != top_priority) {
+      continue;
+    }
+    const int share = std::max(
+        1, static_cast<int>(std::ceil(
+               options_.num_threads * queue->options.weight / active_weight)));
+    if (queue->num_running >= share) {
+      continue;
+    }
+    if (next == nullptr || queue->virtual_time < next->virtual_time) {
+      next = queue.get();
+    }
+  }
+  return next;
+}
+
+void FairShareBatchExecutor::RunBatches() {
+  for (;;) {
+    QueueState* queue;
+    std::function<void()> batch;
+    double charged_micros;
+    {
+      mutex_lock l(mu_);
+      queue = NextQueue();
+      if (queue == nullptr) {
+        return;
+      }
+      batch = std::move(queue->batches.front());
+      queue->batches.pop_front();
+      ++queue->num_running;
+      ++num_running_;
+      // The run time isn't known yet, so charge the queue what its batches
+      // usually take, and settle up once the batch has run. This keeps other
+      // threads from picking the same queue in the meantime.
+      charged_micros = std::max(queue->average_run_micros, 1.0);
+      virtual_time_ = queue->virtual_time;
+      queue->virtual_time += charged_micros / queue->options.weight;
+    }
+
+    const uint64 start_micros = options_.env->NowMicros();
+    batch();
+    const int64 run_micros = options_.env->NowMicros() - start_micros;
+    busy_micros_counter->GetCell(queue->options.name)->IncrementBy(run_micros);
+
+    {
+      mutex_lock l(mu_);
+      queue->virtual_time +=
+          (run_micros - charged_micros) / queue->options.weight;
+      queue->average_run_micros =
+          queue->average_run_micros == 0
+              ? run_micros
+              : queue->average_run_micros +
+                    kRunTimeSmoothing *
+                        (run_micros - queue->average_run_micros);
+      queue->busy_micros += run_micros;
+      --queue->num_running;
+      --num_running_;
+    }
+    batch_done_.notify_all();
+  }
+}
+
+FairShareBatchExecutor::Queue::Queue(
+    std::shared_ptr<FairShareBatchExecutor> executor, QueueState* state)
+    : executor_(std::move(executor)), state_(state) {}
+
+FairShareBatchExecutor::Queue::~Queue() {
+  mutex_lock l(executor_->mu_);
+  while (!state_->batches.empty() || state_->num_running > 0) {
+    executor_->batch_done_.wait(l);
+  }
+  auto& queues = executor_->queues_;
+  queues.erase(std::find_if(queues.begin(), queues.end(),
+                            [this](const std::unique_ptr<QueueState>& queue) {
+                              return queue.get() == state_;
+                            }));
+}
+
+Status FairShareBatchExecutor::Queue::Schedule(std::function<void()> batch) {
+  {
+    mutex_lock l(executor_->mu_);
+    if (state_->batches.size() >= state_->options.max_enqueued_batches) {
+      return errors::Unavailable(
+          "The fair-share batch queue of ", state_->options.name,
+          " is full, with its share of the batch threads used up");
+    }
+    if (state_->batches.empty()) {
+      // Don't let the queue claim the share it didn't use while idle.
+      state_->virtual_time =
+          std::max(state_->virtual_time, executor_->virtual_time_);
+    }
+    state_->batches.push_back(std::move(batch));
+  }
+  executor_->RunBatches();
+  return Status::OK();
+}
+
+int64 FairShareBatchExecutor::Queue::busy_micros() const {
+  mutex_lock l(executor_->mu_);
+  return state_->busy_micros;
+}
+
+}  // namespace serving
+}  // namespace tensorflow
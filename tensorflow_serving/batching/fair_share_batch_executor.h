@@ -0,0 +1,162 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_SERVING_BATCHING_FAIR_SHARE_BATCH_EXECUTOR_H_
+#define TENSORFLOW_SERVING_BATCHING_FAIR_SHARE_BATCH_EXECUTOR_H_
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace serving {
+
+// Shares the batch threads of a SharedBatchScheduler out among several of its
+// queues, typically of different models, in proportion to their weights.
+//
+// A SharedBatchScheduler hands its batch threads to its queues in turn, one
+// batch at a time. A model whose batches take long thus gets a larger share of
+// the threads than one whose batches are quick, and when the threads are busy
+// the latter waits behind the former. To share the threads out by weight
+// instead, have the batch threads hand each batch to a queue of a
+// FairShareBatchExecutor. The executor has no threads of its own, and never
+// blocks a batch thread: a batch whose queue is within its share of the
+// threads runs on the thread that hands it over, and one whose queue has used
+// up its share is kept until a batch thread that has finished a batch picks
+// it up. A queue that already keeps 'max_enqueued_batches' rejects the batch.
+//
+// A queue's share is the number of batch threads, divided among the queues of
+// its priority class that have batches running or kept in proportion to their
+// weights, and rounded up. The kept batches are run by start-time fair
+// queueing on thread time. Each queue has a virtual time, which advances by
+// the time its batches take to run divided by its weight, and the next batch
+// to run comes from the queue with the least virtual time. A queue that has
+// been idle catches up with the virtual time of the others, so that it can't
+// save up a share. Queues also belong to priority classes: a queue only gets a
+// thread when no queue of a higher priority has a batch kept.
+//
+// The thread time of each queue is exported as a monitoring counter, labelled
+// with the queue's name, so that the shares can be checked against the
+// weights.
+class FairShareBatchExecutor
+    : public std::enable_shared_from_this<FairShareBatchExecutor> {
+ public:
+  struct Options {
+    // The number of batch threads that hand batches to the executor, i.e. the
+    // SharedBatchScheduler's 'num_batch_threads'.
+    int num_threads = port::NumSchedulableCPUs();
+
+    // The environment to use (typically only overridden by test code).
+    Env* env = Env::Default();
+  };
+
+  struct QueueOptions {
+    // The name the queue's thread time is exported under.
+    string name;
+
+    // The queue's share of the threads, relative to the other queues of its
+    // priority class. Must be positive.
+    double weight = 1.0;
+
+    // Queues of a higher priority are served first.
+    int priority = 0;
+
+    // The most batches the queue keeps while it is over its share. Schedule()
+    // rejects batches beyond that.
+    int max_enqueued_batches = 10;
+  };
+
+  class Queue;
+
+  static Status Create(const Options& options,
+                       std::shared_ptr<FairShareBatchExecutor>* executor);
+
+  // All queues must have been destroyed.
+  ~FairShareBatchExecutor();
+
+  // Adds a queue. The queue keeps the executor alive.
+  Status AddQueue(const QueueOptions& options, std::unique_ptr<Queue>* queue);
+
+ private:
+  struct QueueState;
+
+  explicit FairShareBatchExecutor(const Options& options);
+
+  // Runs kept batches on the calling thread, for as long as there are some
+  // that are within their queue's share.
+  void RunBatches();
+
+  // Returns the queue to run the next batch of, or null if none has one that
+  // is within its share.
+  QueueState* NextQueue() EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const Options options_;
+
+  mutex mu_;
+
+  // Notified when a batch has run.
+  condition_variable batch_done_;
+
+  std::vector<std::unique_ptr<QueueState>> queues_ GUARDED_BY(mu_);
+
+  // The number of batches running, across all queues.
+  int num_running_ GUARDED_BY(mu_) = 0;
+
+  // The virtual time of the queue whose batch was started last.
+  double virtual_time_ GUARDED_BY(mu_) = 0;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(FairShareBatchExecutor);
+};
+
+// One queue of a FairShareBatchExecutor.
+class FairShareBatchExecutor::Queue {
+ public:
+  // Waits for the batches in the queue to have run.
+  ~Queue();
+
+  // Called on a batch thread to run 'batch'. Keeps 'batch', then runs kept
+  // batches that are within their queue's share on the calling thread, in
+  // fair queueing order, until there are none left. If the queue is over its
+  // share, 'batch' is left to the next batch thread to finish a batch. Returns
+  // UNAVAILABLE, without keeping 'batch', if the queue is full.
+  Status Schedule(std::function<void()> batch);
+
+  // The thread time the queue's batches have taken so far, in microseconds.
+  int64 busy_micros() const;
+
+ private:
+  friend class FairShareBatchExecutor;
+
+  Queue(std::shared_ptr<FairShareBatchExecutor> executor, QueueState* state);
+
+  const std::shared_ptr<FairShareBatchExecutor> executor_;
+  QueueState* const state_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(Queue);
+};
+
+}  // namespace serving
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_SERVING_BATCHING_FAIR_SHARE_BATCH_EXECUTOR_H_
@@ -0,0 +1,264 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow_serving/batching/fair_share_batch_executor.h"
+
+#include <algorithm>
+
+#include <gtest/gtest.h>
+#include "tensorflow/contrib/batching/test_util/fake_clock_env.h"
+#include "tensorflow/core/lib/core/notification.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/mutex.h"
+
+namespace tensorflow {
+namespace serving {
+namespace {
+
+class FairShareBatchExecutorTest : public ::testing::Test {
+ protected:
+  FairShareBatchExecutorTest() : env_(Env::Default()) {}
+
+  void SetUp() override {
+    FairShareBatchExecutor::Options options;
+    options.num_threads = 1;
+    options.env = &env_;
+    TF_ASSERT_OK(FairShareBatchExecutor::Create(options, &executor_));
+  }
+
+  std::unique_ptr<FairShareBatchExecutor::Queue> AddQueue(
+      const string& name, const double weight, const int priority) {
+    FairShareBatchExecutor::QueueOptions options;
+    options.name = name;
+    options.weight = weight;
+    options.priority = priority;
+    options.max_enqueued_batches = 100;
+    std::unique_ptr<FairShareBatchExecutor::Queue> queue;
+    TF_CHECK_OK(executor_->AddQueue(options, &queue));
+    return queue;
+  }
+
+  // A batch thread that runs a batch of 'queue', which holds it up until the
+  // destructor. It then goes on to run the batches that have been kept in the
+  // meantime, and the destructor waits for it to be done.
+  class BlockedThread {
+   public:
+    explicit BlockedThread(FairShareBatchExecutor::Queue* queue) {
+      Notification started;
+      thread_.reset(Env::Default()->StartThread(
+          {}, "blocked_batch_thread", [this, queue, &started] {
+            TF_CHECK_OK(queue->Schedule([this, &started] {
+              started.Notify();
+              release_.WaitForNotification();
+            }));
+          }));
+      started.WaitForNotification();
+    }
+
+    ~BlockedThread() { release_.Notify(); }
+
+   private:
+    Notification release_;
+    std::unique_ptr<Thread> thread_;
+  };
+
+  // Schedules a batch that takes 'run_micros' and records 'name' when it runs.
+  void ScheduleBatch(FairShareBatchExecutor::Queue* queue, const string& name,
+                     const int64 run_micros) {
+    TF_ASSERT_OK(queue->Schedule([this, name, run_micros] {
+      {
+        mutex_lock l(mu_);
+        run_order_.push_back(name);
+      }
+      env_.AdvanceByMicroseconds(run_micros);
+    }));
+  }
+
+  test_util::FakeClockEnv env_;
+  std::shared_ptr<FairShareBatchExecutor> executor_;
+  mutex mu_;
+  std::vector<string> run_order_ GUARDED_BY(mu_);
+};
+
+TEST_F(FairShareBatchExecutorTest, InvalidOptions) {
+  FairShareBatchExecutor::QueueOptions options;
+  options.weight = 0;
+  std::unique_ptr<FairShareBatchExecutor::Queue> queue;
+  EXPECT_FALSE(executor_->AddQueue(options, &queue).ok());
+  options.weight = 1;
+  options.max_enqueued_batches = 0;
+  EXPECT_FALSE(executor_->AddQueue(options, &queue).ok());
+}
+
+TEST_F(FairShareBatchExecutorTest, RejectsBatchesBeyondMaxEnqueued) {
+  std::unique_ptr<FairShareBatchExecutor::Queue> blocker =
+      AddQueue("blocker", 1, 0);
+  FairShareBatchExecutor::QueueOptions options;
+  options.max_enqueued_batches = 2;
+  std::unique_ptr<FairShareBatchExecutor::Queue> queue;
+  TF_ASSERT_OK(executor_->AddQueue(options, &queue));
+  std::unique_ptr<BlockedThread> blocked(new BlockedThread(blocker.get()));
+  ScheduleBatch(queue.get(), "kept", 1000);
+  ScheduleBatch(queue.get(), "kept", 1000);
+  const Status status = queue->Schedule([] {});
+  EXPECT_EQ(error::UNAVAILABLE, status.code());
+  blocked.reset();
+  queue.reset();
+
+  mutex_lock l(mu_);
+  EXPECT_EQ(std::vector<string>({"kept", "kept"}), run_order_);
+}
+
+TEST_F(FairShareBatchExecutorTest, KeepsBatchesOfQueuesOverTheirShare) {
+  FairShareBatchExecutor::Options options;
+  options.num_threads = 3;
+  options.env = &env_;
+  std::shared_ptr<FairShareBatchExecutor> executor;
+  TF_ASSERT_OK(FairShareBatchExecutor::Create(options, &executor));
+  FairShareBatchExecutor::QueueOptions queue_options;
+  queue_options.weight = 1;
+  std::unique_ptr<FairShareBatchExecutor::Queue> light;
+  TF_ASSERT_OK(executor->AddQueue(queue_options, &light));
+  queue_options.weight = 2;
+  std::unique_ptr<FairShareBatchExecutor::Queue> heavy;
+  TF_ASSERT_OK(executor->AddQueue(queue_options, &heavy));
+
+  // 'light' gets one of the three threads and 'heavy' two. With a batch of
+  // each running, a second batch of 'light' is kept, even though a thread is
+  // free, and the call returns without running it.
+  std::unique_ptr<BlockedThread> light_blocked(new BlockedThread(light.get()));
+  std::unique_ptr<BlockedThread> heavy_blocked(new BlockedThread(heavy.get()));
+  ScheduleBatch(light.get(), "light", 1000);
+  {
+    mutex_lock l(mu_);
+    EXPECT_TRUE(run_order_.empty());
+  }
+  // A second batch of 'heavy' runs right away.
+  ScheduleBatch(heavy.get(), "heavy", 1000);
+  {
+    mutex_lock l(mu_);
+    EXPECT_EQ(std::vector<string>({"heavy"}), run_order_);
+  }
+
+  // Once 'heavy' has nothing left to run, 'light' may have all the threads,
+  // and the batch thread that finished picks up the kept batch.
+  heavy_blocked.reset();
+  {
+    mutex_lock l(mu_);
+    EXPECT_EQ(std::vector<string>({"heavy", "light"}), run_order_);
+  }
+  light_blocked.reset();
+  light.reset();
+  heavy.reset();
+}
+
+TEST_F(FairShareBatchExecutorTest, SharesThreadTimeByWeight) {
+  std::unique_ptr<FairShareBatchExecutor::Queue> blocker =
+      AddQueue("blocker", 1, 0);
+  std::unique_ptr<FairShareBatchExecutor::Queue> heavy =
+      AddQueue("heavy", 3, 0);
+  std::unique_ptr<FairShareBatchExecutor::Queue> light =
+      AddQueue("light", 1, 0);
+  std::unique_ptr<BlockedThread> blocked(new BlockedThread(blocker.get()));
+  for (int i = 0; i < 40; ++i) {
+    ScheduleBatch(heavy.get(), "heavy", 1000);
+    ScheduleBatch(light.get(), "light", 1000);
+  }
+  blocked.reset();
+  heavy.reset();
+  light.reset();
+
+  // While both queues had batches, 'heavy' got three times the thread time of
+  // 'light'.
+  mutex_lock l(mu_);
+  ASSERT_EQ(80, run_order_.size());
+  const int num_heavy = std::count(run_order_.begin(), run_order_.begin() + 40,
+                                   string("heavy"));
+  EXPECT_NEAR(30, num_heavy, 1);
+}
+
+TEST_F(FairShareBatchExecutorTest, ChargesByRunTime) {
+  std::unique_ptr<FairShareBatchExecutor::Queue> blocker =
+      AddQueue("blocker", 1, 0);
+  std::unique_ptr<FairShareBatchExecutor::Queue> slow = AddQueue("slow", 1, 0);
+  std::unique_ptr<FairShareBatchExecutor::Queue> fast = AddQueue("fast", 1, 0);
+  std::unique_ptr<BlockedThread> blocked(new BlockedThread(blocker.get()));
+  for (int i = 0; i < 40; ++i) {
+    ScheduleBatch(slow.get(), "slow", 4000);
+    ScheduleBatch(fast.get(), "fast", 1000);
+  }
+  blocked.reset();
+  slow.reset();
+  fast.reset();
+
+  // Equal weights get equal thread time, not equal numbers of batches.
+  mutex_lock l(mu_);
+  const int num_fast = std::count(run_order_.begin(), run_order_.begin() + 40,
+                                  string("fast"));
+  EXPECT_NEAR(32, num_fast, 1);
+}
+
+TEST_F(FairShareBatchExecutorTest, HigherPriorityFirst) {
+  std::unique_ptr<FairShareBatchExecutor::Queue> blocker =
+      AddQueue("blocker", 1, 0);
+  std::unique_ptr<FairShareBatchExecutor::Queue> low = AddQueue("low", 10, 0);
+  std::unique_ptr<FairShareBatchExecutor::Queue> high = AddQueue("high", 1, 1);
+  std::unique_ptr<BlockedThread> blocked(new BlockedThread(blocker.get()));
+  for (int i = 0; i < 5; ++i) {
+    ScheduleBatch(low.get(), "low", 1000);
+    ScheduleBatch(high.get(), "high", 1000);
+  }
+  blocked.reset();
+  low.reset();
+  high.reset();
+
+  mutex_lock l(mu_);
+  EXPECT_EQ(std::vector<string>({"high", "high", "high", "high", "high", "low",
+                                 "low", "low", "low", "low"}),
+            run_order_);
+}
+
+TEST_F(FairShareBatchExecutorTest, IdleQueueDoesNotSaveUpShare) {
+  std::unique_ptr<FairShareBatchExecutor::Queue> busy = AddQueue("busy", 1, 0);
+  std::unique_ptr<FairShareBatchExecutor::Queue> idle = AddQueue("idle", 1, 0);
+  // With the thread free, the batches run right away, on this thread.
+  for (int i = 0; i < 20; ++i) {
+    ScheduleBatch(busy.get(), "busy", 1000);
+  }
+  EXPECT_EQ(20 * 1000, busy->busy_micros());
+
+  // Had 'idle' kept its virtual time while 'busy' ran alone, it would now get
+  // the thread for twenty batches in a row.
+  std::unique_ptr<BlockedThread> blocked(new BlockedThread(busy.get()));
+  for (int i = 0; i < 5; ++i) {
+    ScheduleBatch(busy.get(), "busy", 1000);
+    ScheduleBatch(idle.get(), "idle", 1000);
+  }
+  {
+    mutex_lock l(mu_);
+    run_order_.clear();
+  }
+  blocked.reset();
+  busy.reset();
+  idle.reset();
+
+  mutex_lock l(mu_);
+  const int num_idle = std::count(run_order_.begin(), run_order_.begin() + 4,
+                                  string("idle"));
+  EXPECT_LE(num_idle, 3);
+}
+
+}  // namespace
+}  // namespace serving
+}  // namespace tensorflow
@@ -0,0 +1,115 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_SERVING_BATCHING_OPEN_BATCH_TASK_FEED_H_
+#define TENSORFLOW_SERVING_BATCHING_OPEN_BATCH_TASK_FEED_H_
+
+#include <unordered_map>
+#include <vector>
+
+#include "tensorflow/contrib/batching/batch_scheduler.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+namespace serving {
+
+// Hands the tasks of open batches over from a batch scheduler to the
+// process-batch callback, for schedulers that give the callback a batch while
+// it is still filling up (such as StreamingBatchScheduler). The callback can't
+// read the tasks of an open batch through Batch::task(), which races with
+// tasks joining the batch; instead, the scheduler passes each task to
+// TaskAdded() as it joins a batch, and the callback takes them from
+// WaitForTask(). Once a batch has closed, its tasks can be read from the batch
+// itself.
+//
+// A feed serves a single scheduler. Thread-safe.
+template <typename TaskType>
+class OpenBatchTaskFeed {
+ public:
+  OpenBatchTaskFeed() = default;
+  ~OpenBatchTaskFeed() = default;
+
+  // Called by the scheduler once 'task' has joined 'batch', before any other
+  // task joins it.
+  void TaskAdded(const Batch<TaskType>& batch, const TaskType& task);
+
+  // Called by the scheduler once 'batch' has closed, before it opens another
+  // batch. Only identifies the batch by its address: the process-batch
+  // callback may be done with the batch, and have destroyed it, by then.
+  void BatchClosed(const Batch<TaskType>* batch);
+
+  // Waits for the task of 'batch' at 'index' (in order of joining) to join
+  // it, and returns it. Returns null if the batch closes first, or has
+  // already closed; the rest of its tasks are then read from the batch.
+  const TaskType* WaitForTask(const Batch<TaskType>& batch, int index);
+
+ private:
+  mutex mu_;
+  // Notified when a task joins an open batch, or a batch closes.
+  condition_variable batch_changed_;
+  // The tasks that have joined each open batch so far.
+  std::unordered_map<const Batch<TaskType>*, std::vector<const TaskType*>>
+      open_batches_ GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(OpenBatchTaskFeed);
+};
+
+//////////
+// Implementation details follow. API users need not read.
+
+template <typename TaskType>
+void OpenBatchTaskFeed<TaskType>::TaskAdded(const Batch<TaskType>& batch,
+                                            const TaskType& task) {
+  {
+    mutex_lock l(mu_);
+    open_batches_[&batch].push_back(&task);
+  }
+  batch_changed_.notify_all();
+}
+
+template <typename TaskType>
+void OpenBatchTaskFeed<TaskType>::BatchClosed(const Batch<TaskType>* batch) {
+  {
+    mutex_lock l(mu_);
+    open_batches_.erase(batch);
+  }
+  batch_changed_.notify_all();
+}
+
+template <typename TaskType>
+const TaskType* OpenBatchTaskFeed<TaskType>::WaitForTask(
+    const Batch<TaskType>& batch, const int index) {
+  mutex_lock l(mu_);
+  for (;;) {
+    // The batch is closed before BatchClosed() is called, which notifies
+    // 'batch_changed_' under 'mu_', so waiting below can't miss the closing.
+    if (batch.IsClosed()) {
+      return nullptr;
+    }
+    auto it = open_batches_.find(&batch);
+    if (it != open_batches_.end() &&
+        index < static_cast<int>(it->second.size())) {
+      return it->second[index];
+    }
+    batch_changed_.wait(l);
+  }
+}
+
+}  // namespace serving
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_SERVING_BATCHING_OPEN_BATCH_TASK_FEED_H_
@@ -0,0 +1,109 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_serving/batching/open_batch_task_feed.h"
+
+#include <memory>
+
+#include <gtest/gtest.h>
+#include "tensorflow/core/lib/core/notification.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/macros.h"
+
+namespace tensorflow {
+namespace serving {
+namespace {
+
+class FakeTask : public BatchTask {
+ public:
+  explicit FakeTask(size_t size) : size_(size) {}
+
+  ~FakeTask() override = default;
+
+  size_t size() const override { return size_; }
+
+ private:
+  const size_t size_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(FakeTask);
+};
+
+// Adds a task of size 'task_size' to 'batch', as a scheduler would, and
+// returns it.
+const FakeTask* AddTask(size_t task_size, Batch<FakeTask>* batch,
+                        OpenBatchTaskFeed<FakeTask>* feed) {
+  std::unique_ptr<FakeTask> task(new FakeTask(task_size));
+  const FakeTask* added_task = task.get();
+  batch->AddTask(std::move(task));
+  feed->TaskAdded(*batch, *added_task);
+  return added_task;
+}
+
+TEST(OpenBatchTaskFeedTest, TakesTasksAsTheyJoin) {
+  OpenBatchTaskFeed<FakeTask> feed;
+  Batch<FakeTask> batch;
+  const FakeTask* first_task = AddTask(3, &batch, &feed);
+  EXPECT_EQ(first_task, feed.WaitForTask(batch, 0));
+
+  Notification second_task_taken;
+  const FakeTask* taken_task = nullptr;
+  std::unique_ptr<Thread> taker(Env::Default()->StartThread(
+      ThreadOptions(), "taker", [&feed, &batch, &second_task_taken,
+                                 &taken_task] {
+        taken_task = feed.WaitForTask(batch, 1);
+        second_task_taken.Notify();
+      }));
+  Env::Default()->SleepForMicroseconds(10 * 1000 /* 10 milliseconds */);
+  EXPECT_FALSE(second_task_taken.HasBeenNotified());
+  const FakeTask* second_task = AddTask(5, &batch, &feed);
+  second_task_taken.WaitForNotification();
+  EXPECT_EQ(second_task, taken_task);
+
+  batch.Close();
+  feed.BatchClosed(&batch);
+  EXPECT_EQ(nullptr, feed.WaitForTask(batch, 2));
+}
+
+TEST(OpenBatchTaskFeedTest, StopsWaitingOnceTheBatchCloses) {
+  OpenBatchTaskFeed<FakeTask> feed;
+  Batch<FakeTask> batch;
+  Notification wait_done;
+  std::unique_ptr<Thread> taker(Env::Default()->StartThread(
+      ThreadOptions(), "taker", [&feed, &batch, &wait_done] {
+        EXPECT_EQ(nullptr, feed.WaitForTask(batch, 0));
+        wait_done.Notify();
+      }));
+  Env::Default()->SleepForMicroseconds(10 * 1000 /* 10 milliseconds */);
+  EXPECT_FALSE(wait_done.HasBeenNotified());
+  batch.Close();
+  feed.BatchClosed(&batch);
+  wait_done.WaitForNotification();
+}
+
+TEST(OpenBatchTaskFeedTest, ClosedBatchesAreReadDirectly) {
+  OpenBatchTaskFeed<FakeTask> feed;
+  Batch<FakeTask> batch;
+  AddTask(3, &batch, &feed);
+  batch.Close();
+  feed.BatchClosed(&batch);
+  // Even the tasks that did join are left to be read from the batch.
+  EXPECT_EQ(nullptr, feed.WaitForTask(batch, 0));
+  ASSERT_EQ(1, batch.num_tasks());
+  EXPECT_EQ(3, batch.task(0).size());
+}
+
+}  // namespace
+}  // namespace serving
+}  // namespace tensorflow
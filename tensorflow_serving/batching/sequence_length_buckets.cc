@@ -0,0 +1,169 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow_serving/batching/sequence_length_buckets.h"
+
+#include <algorithm>
+
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+
+namespace tensorflow {
+namespace serving {
+namespace {
+
+auto* bucket_padding_element_count = monitoring::Counter<3>::New(
+    "/tensorflow/serving/batching/bucket_padding_element_count",
+    "The number of batched input elements that are padding, by model, "
+    "signature and sequence length bucket.",
+    "model", "signature", "bucket");
+
+auto* bucket_input_element_count = monitoring::Counter<3>::New(
+    "/tensorflow/serving/batching/bucket_input_element_count",
+    "The number of batched input elements, padding included, by model, "
+    "signature and sequence length bucket.",
+    "model", "signature", "bucket");
+
+}  // namespace
+
+// static
+Status SequenceLengthBuckets::Create(
+    const Options& options, std::unique_ptr<SequenceLengthBuckets>* buckets) {
+  int num_buckets;
+  if (!options.bucket_boundaries.empty()) {
+    for (int i = 1; i < options.bucket_boundaries.size(); ++i) {
+      if (options.bucket_boundaries[i] <= options.bucket_boundaries[i - 1]) {
+        return errors::InvalidArgument(
+            "bucket_boundaries must be in increasing order");
+      }
+    }
+    num_buckets = options.bucket_boundaries.size() + 1;
+  } else if (options.num_learned_buckets > 0) {
+    if (options.learning_window_size < options.num_learned_buckets) {
+      return errors::InvalidArgument(
+          "learning_window_size must be at least num_learned_buckets; was ",
+          options.learning_window_size);
+    }
+    num_buckets = options.num_learned_buckets;
+  } else {
+    return errors::InvalidArgument(
+        "Either bucket_boundaries or num_learned_buckets must be set");
+  }
+  buckets->reset(new SequenceLengthBuckets(options, num_buckets));
+  return Status::OK();
+}
+
+SequenceLengthBuckets::SequenceLengthBuckets(const Options& options,
+                                             const int num_buckets)
+    : options_(options),
+      num_buckets_(num_buckets),
+      bucket_boundaries_(options.bucket_boundaries),
+      padding_elements_(num_buckets, 0),
+      total_elements_(num_buckets, 0) {
+  for (int bucket = 0; bucket < num_buckets; ++bucket) {
+    const string label = strings::StrCat(bucket);
+    padding_element_cells_.push_back(bucket_padding_element_count->GetCell(
+        options.model_name, options.signature_name, label));
+    input_element_cells_.push_back(bucket_input_element_count->GetCell(
+        options.model_name, options.signature_name, label));
+  }
+}
+
+SequenceLengthBuckets::~SequenceLengthBuckets() { WaitUntilLearned(); }
+
+// static
+int64 SequenceLengthBuckets::TaskLength(
+    const std::vector<std::pair<string, Tensor>>& inputs) {
+  int64 length = 0;
+  for (const auto& entry : inputs) {
+    if (entry.second.dims() >= 2) {
+      length = std::max(length, entry.second.dim_size(1));
+    }
+  }
+  return length;
+}
+
+int SequenceLengthBuckets::Bucket(const int64 length) {
+  std::vector<int64> window;
+  int bucket;
+  {
+    mutex_lock l(mu_);
+    if (options_.bucket_boundaries.empty() && !learning_) {
+      window_lengths_.push_back(length);
+      if (window_lengths_.size() >= options_.learning_window_size) {
+        window.swap(window_lengths_);
+        learning_ = true;
+      }
+    }
+    bucket = std::lower_bound(bucket_boundaries_.begin(),
+                              bucket_boundaries_.end(), length) -
+             bucket_boundaries_.begin();
+  }
+  if (!window.empty()) {
+    // Sorting the window takes a while, which the task shouldn't wait for.
+    std::shared_ptr<std::vector<int64>> shared_window(
+        new std::vector<int64>(std::move(window)));
+    Env::Default()->SchedClosure(
+        [this, shared_window] { Learn(std::move(*shared_window)); });
+  }
+  return bucket;
+}
+
+void SequenceLengthBuckets::Learn(std::vector<int64> window) {
+  // Split the window into equally large buckets. (Boundaries may repeat,
+  // which leaves the buckets between them empty.)
+  std::sort(window.begin(), window.end());
+  std::vector<int64> bucket_boundaries;
+  for (int i = 1; i < num_buckets_; ++i) {
+    bucket_boundaries.push_back(window[i * window.size() / num_buckets_ - 1]);
+  }
+  mutex_lock l(mu_);
+  bucket_boundaries_ = std::move(bucket_boundaries);
+  learning_ = false;
+  learning_done_.notify_all();
+}
+
+void SequenceLengthBuckets::WaitUntilLearned() {
+  mutex_lock l(mu_);
+  while (learning_) {
+    learning_done_.wait(l);
+  }
+}
+
+std::vector<int64> SequenceLengthBuckets::bucket_boundaries() const {
+  mutex_lock l(mu_);
+  return bucket_boundaries_;
+}
+
+void SequenceLengthBuckets::RecordPadding(const int bucket,
+                                          const int64 padding_elements,
+                                          const int64 total_elements) {
+  padding_element_cells_[bucket]->IncrementBy(padding_elements);
+  input_element_cells_[bucket]->IncrementBy(total_elements);
+  mutex_lock l(mu_);
+  padding_elements_[bucket] += padding_elements;
+  total_elements_[bucket] += total_elements;
+}
+
+double SequenceLengthBuckets::PaddingRatio(const int bucket) const {
+  mutex_lock l(mu_);
+  return total_elements_[bucket] == 0
+             ? 0
+             : static_cast<double>(padding_elements_[bucket]) /
+                   total_elements_[bucket];
+}
+
+}  // namespace serving
+}  // namespace tensorflow
@@ -0,0 +1,139 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_SERVING_BATCHING_SEQUENCE_LENGTH_BUCKETS_H_
+#define TENSORFLOW_SERVING_BATCHING_SEQUENCE_LENGTH_BUCKETS_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/monitoring/counter.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace serving {
+
+// Sorts batching tasks into buckets by sequence length, so that batches can be
+// formed from tasks of similar lengths. When variable-length inputs are padded
+// to the longest one in the batch, a single long task otherwise makes every
+// other task in its batch pay for its length.
+//
+// The length of a task is the largest size of the 1st dimension (the one after
+// the batch dimension) among its inputs. Bucket boundaries are either fixed,
+// or learned from the lengths of recent tasks: after every
+// 'learning_window_size' tasks, they are set to the quantiles that split those
+// lengths into equally large buckets. The quantiles are computed in the
+// background, off the callers of Bucket(); tasks that arrive meanwhile are
+// bucketed by the previous boundaries and left out of the next window.
+//
+// Also keeps track of how much of each bucket's batched inputs is padding.
+// The ratio is exported as a pair of monitoring counters, labelled with the
+// model, the signature and the bucket's index.
+//
+// Thread-safe.
+class SequenceLengthBuckets {
+ public:
+  struct Options {
+    // The inclusive upper bounds of the lengths in each bucket but the last,
+    // in increasing order. Longer tasks go into the last bucket.
+    std::vector<int64> bucket_boundaries;
+
+    // If positive and 'bucket_boundaries' is empty, the number of buckets,
+    // whose boundaries are learned. Until they have been learned, all tasks go
+    // into the first bucket.
+    int num_learned_buckets = 0;
+
+    // How many task lengths each round of learning looks at.
+    int learning_window_size = 1000;
+
+    // The model and signature whose tasks are bucketed, which label the
+    // monitoring counters.
+    string model_name;
+    string signature_name;
+  };
+
+  static Status Create(const Options& options,
+                       std::unique_ptr<SequenceLengthBuckets>* buckets);
+
+  // Waits for a round of learning in progress, if any.
+  ~SequenceLengthBuckets();
+
+  // Returns the length of a task with 'inputs'; zero if they all have fewer
+  // than two dimensions.
+  static int64 TaskLength(const std::vector<std::pair<string, Tensor>>& inputs);
+
+  int num_buckets() const { return num_buckets_; }
+
+  // Returns the index of the bucket for a task of 'length', and, if the
+  // boundaries are learned, takes the length into account.
+  int Bucket(int64 length);
+
+  // Blocks until the boundaries learned from the last full window, if any,
+  // are in use.
+  void WaitUntilLearned();
+
+  // The current bucket boundaries.
+  std::vector<int64> bucket_boundaries() const;
+
+  // Records that a batch from 'bucket' was padded to 'total_elements' input
+  // elements, of which 'padding_elements' are padding.
+  void RecordPadding(int bucket, int64 padding_elements, int64 total_elements);
+
+  // The fraction of the input elements of the batches from 'bucket' that has
+  // been padding so far.
+  double PaddingRatio(int bucket) const;
+
+ private:
+  SequenceLengthBuckets(const Options& options, int num_buckets);
+
+  // Sets the boundaries to the quantiles of the lengths in 'window'. Runs in
+  // the background.
+  void Learn(std::vector<int64> window) LOCKS_EXCLUDED(mu_);
+
+  const Options options_;
+  const int num_buckets_;
+
+  // The monitoring counter cells of each bucket.
+  std::vector<monitoring::CounterCell*> padding_element_cells_;
+  std::vector<monitoring::CounterCell*> input_element_cells_;
+
+  mutable mutex mu_;
+
+  std::vector<int64> bucket_boundaries_ GUARDED_BY(mu_);
+
+  // The lengths seen in the current round of learning.
+  std::vector<int64> window_lengths_ GUARDED_BY(mu_);
+
+  // Set while the previous window is being learned from.
+  bool learning_ GUARDED_BY(mu_) = false;
+  condition_variable learning_done_;
+
+  // The number of padding and total input elements of each bucket's batches.
+  std::vector<int64> padding_elements_ GUARDED_BY(mu_);
+  std::vector<int64> total_elements_ GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(SequenceLengthBuckets);
+};
+
+}  // namespace serving
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_SERVING_BATCHING_SEQUENCE_LENGTH_BUCKETS_H_
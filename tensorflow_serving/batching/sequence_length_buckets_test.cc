@@ -0,0 +1,111 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow_serving/batching/sequence_length_buckets.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+
+namespace tensorflow {
+namespace serving {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+TEST(SequenceLengthBucketsTest, InvalidOptions) {
+  std::unique_ptr<SequenceLengthBuckets> buckets;
+  SequenceLengthBuckets::Options options;
+  EXPECT_FALSE(SequenceLengthBuckets::Create(options, &buckets).ok());
+  options.bucket_boundaries = {10, 10};
+  EXPECT_FALSE(SequenceLengthBuckets::Create(options, &buckets).ok());
+  options = SequenceLengthBuckets::Options();
+  options.num_learned_buckets = 4;
+  options.learning_window_size = 3;
+  EXPECT_FALSE(SequenceLengthBuckets::Create(options, &buckets).ok());
+}
+
+TEST(SequenceLengthBucketsTest, TaskLength) {
+  EXPECT_EQ(0, SequenceLengthBuckets::TaskLength(
+                   {{"x", Tensor(DT_FLOAT, TensorShape({3}))}}));
+  EXPECT_EQ(7, SequenceLengthBuckets::TaskLength(
+                   {{"x", Tensor(DT_FLOAT, TensorShape({1, 5, 2}))},
+                    {"y", Tensor(DT_INT32, TensorShape({1, 7}))},
+                    {"z", Tensor(DT_FLOAT, TensorShape({1}))}}));
+}
+
+TEST(SequenceLengthBucketsTest, FixedBoundaries) {
+  SequenceLengthBuckets::Options options;
+  options.bucket_boundaries = {10, 100};
+  std::unique_ptr<SequenceLengthBuckets> buckets;
+  TF_ASSERT_OK(SequenceLengthBuckets::Create(options, &buckets));
+  EXPECT_EQ(3, buckets->num_buckets());
+  EXPECT_EQ(0, buckets->Bucket(0));
+  EXPECT_EQ(0, buckets->Bucket(10));
+  EXPECT_EQ(1, buckets->Bucket(11));
+  EXPECT_EQ(1, buckets->Bucket(100));
+  EXPECT_EQ(2, buckets->Bucket(101));
+}
+
+TEST(SequenceLengthBucketsTest, LearnedBoundaries) {
+  SequenceLengthBuckets::Options options;
+  options.num_learned_buckets = 4;
+  options.learning_window_size = 100;
+  std::unique_ptr<SequenceLengthBuckets> buckets;
+  TF_ASSERT_OK(SequenceLengthBuckets::Create(options, &buckets));
+  EXPECT_EQ(4, buckets->num_buckets());
+
+  // Everything goes into the first bucket until a window has been seen.
+  for (int i = 100; i > 1; --i) {
+    EXPECT_EQ(0, buckets->Bucket(i));
+  }
+  EXPECT_THAT(buckets->bucket_boundaries(), IsEmpty());
+  // The boundaries are learned in the background.
+  buckets->Bucket(1);
+  buckets->WaitUntilLearned();
+  EXPECT_THAT(buckets->bucket_boundaries(), ElementsAre(25, 50, 75));
+  EXPECT_EQ(0, buckets->Bucket(25));
+  EXPECT_EQ(1, buckets->Bucket(26));
+  EXPECT_EQ(3, buckets->Bucket(1000));
+
+  // The next window (which includes the three lengths above) relearns the
+  // boundaries.
+  for (int i = 0; i < 97; ++i) {
+    buckets->Bucket(i % 2 == 0 ? 10 : 20);
+  }
+  buckets->WaitUntilLearned();
+  EXPECT_THAT(buckets->bucket_boundaries(), ElementsAre(10, 20, 20));
+  EXPECT_EQ(0, buckets->Bucket(5));
+  EXPECT_EQ(1, buckets->Bucket(15));
+  EXPECT_EQ(3, buckets->Bucket(21));
+}
+
+TEST(SequenceLengthBucketsTest, PaddingRatio) {
+  SequenceLengthBuckets::Options options;
+  options.bucket_boundaries = {10};
+  std::unique_ptr<SequenceLengthBuckets> buckets;
+  TF_ASSERT_OK(SequenceLengthBuckets::Create(options, &buckets));
+  EXPECT_EQ(0, buckets->PaddingRatio(0));
+  buckets->RecordPadding(0, 10, 40);
+  buckets->RecordPadding(0, 0, 60);
+  buckets->RecordPadding(1, 50, 100);
+  EXPECT_DOUBLE_EQ(0.1, buckets->PaddingRatio(0));
+  EXPECT_DOUBLE_EQ(0.5, buckets->PaddingRatio(1));
+}
+
+}  // namespace
+}  // namespace serving
+}  // namespace tensorflow
@@ -36,6 +36,7 @@ limitations under the License.
 #include "tensorflow/core/platform/thread_annotations.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow_serving/batching/batch_scheduler_retrier.h"
+#include "tensorflow_serving/batching/open_batch_task_feed.h"
 #include "tensorflow_serving/util/optional.h"
 
 namespace tensorflow {
@@ -145,6 +146,12 @@ class StreamingBatchScheduler : public BatchScheduler<TaskType> {
     // Must be >= 1, and should be tuned carefully.
     int num_batch_threads = port::NumSchedulableCPUs();
 
+    // If non-null, each task is passed to the feed as it joins a batch, and
+    // each batch once it closes, so that the process-batch callback can take
+    // the tasks of its batch from the feed while the batch is still open (see
+    // step 3 below). Must outlive the scheduler.
+    OpenBatchTaskFeed<TaskType>* task_feed = nullptr;
+
     // The following options are typically only overridden by test code.
 
     // The environment to use.
@@ -184,6 +191,9 @@ class StreamingBatchScheduler : public BatchScheduler<TaskType> {
   // fresh open batch. Schedules the new batch on 'batch_threads_'.
   void StartNewBatch() EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
+  // Closes 'open_batch_', which must not be nullptr, and sets it to nullptr.
+  void CloseOpenBatch() EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
   // Takes a snapshot of 'open_batch_num_', and schedules an event with
   // 'batch_closer_' to close it at time 'close_time_micros' if it is still open
   // at that time.
@@ -321,8 +331,7 @@ StreamingBatchScheduler<TaskType>::~StreamingBatchScheduler() {
   {
     mutex_lock l(mu_);
     if (open_batch_ != nullptr) {
-      open_batch_->Close();
-      open_batch_ = nullptr;
+      CloseOpenBatch();
       ++open_batch_num_;
     }
   }
@@ -366,7 +375,11 @@ Status StreamingBatchScheduler<TaskType>::Schedule(
       ScheduleCloseOfCurrentOpenBatch(batch_deadline);
     }
 
+    const TaskType& added_task = **task;
     open_batch_->AddTask(std::move(*task));
+    if (options_.task_feed != nullptr) {
+      options_.task_feed->TaskAdded(*open_batch_, added_task);
+    }
 
     // If we've exactly reached the target size, we can close this batch now.
     if (open_batch_->size() == options_.max_batch_size) {
@@ -411,8 +424,7 @@ bool StreamingBatchScheduler<TaskType>::TaskFitsInBatch(
 template <typename TaskType>
 void StreamingBatchScheduler<TaskType>::StartNewBatch() {
   if (open_batch_ != nullptr) {
-    open_batch_->Close();
-    open_batch_ = nullptr;
+    CloseOpenBatch();
   }
 
   Batch<TaskType>* new_open_batch = new Batch<TaskType>;
@@ -429,6 +441,17 @@ void StreamingBatchScheduler<TaskType>::StartNewBatch() {
   ++open_batch_num_;
 }
 
+template <typename TaskType>
+void StreamingBatchScheduler<TaskType>::CloseOpenBatch() {
+  open_batch_->Close();
+  // The batch thread may have deleted the batch by now, but no new batch is
+  // allocated while we hold 'mu_', so its address still identifies it.
+  if (options_.task_feed != nullptr) {
+    options_.task_feed->BatchClosed(open_batch_);
+  }
+  open_batch_ = nullptr;
+}
+
 template <typename TaskType>
 void StreamingBatchScheduler<TaskType>::ScheduleCloseOfCurrentOpenBatch(
     uint64 close_time_micros) {
@@ -79,6 +79,55 @@ TEST(StreamingBatchSchedulerTest, Basic) {
   EXPECT_TRUE(callback_called);
 }
 
+TEST(StreamingBatchSchedulerTest, FeedsTasksOfOpenBatches) {
+  OpenBatchTaskFeed<FakeTask> feed;
+  Notification first_task_taken, second_task_taken;
+  std::vector<size_t> taken_sizes;
+  int num_tasks = 0;
+  auto callback = [&feed, &first_task_taken, &second_task_taken, &taken_sizes,
+                   &num_tasks](std::unique_ptr<Batch<FakeTask>> batch) {
+    for (;;) {
+      const FakeTask* task = feed.WaitForTask(*batch, taken_sizes.size());
+      if (task == nullptr) {
+        break;
+      }
+      taken_sizes.push_back(task->size());
+      if (taken_sizes.size() == 1) {
+        first_task_taken.Notify();
+      } else if (taken_sizes.size() == 2) {
+        second_task_taken.Notify();
+      }
+    }
+    batch->WaitUntilClosed();
+    if (!batch->empty()) {
+      num_tasks = batch->num_tasks();
+    }
+  };
+  {
+    StreamingBatchScheduler<FakeTask>::Options options;
+    options.max_batch_size = 10;
+    options.batch_timeout_micros = -1;
+    options.num_batch_threads = 1;
+    options.task_feed = &feed;
+    std::unique_ptr<StreamingBatchScheduler<FakeTask>> scheduler;
+    TF_ASSERT_OK(StreamingBatchScheduler<FakeTask>::Create(options, callback,
+                                                           &scheduler));
+    TF_ASSERT_OK(ScheduleTask(3, scheduler.get()));
+    first_task_taken.WaitForNotification();
+    TF_ASSERT_OK(ScheduleTask(5, scheduler.get()));
+    second_task_taken.WaitForNotification();
+    // Fills the batch, which closes it.
+    TF_ASSERT_OK(ScheduleTask(2, scheduler.get()));
+  }
+
+  // The batch was still open when the first two tasks were taken; the last
+  // one may only have been read from the closed batch.
+  ASSERT_GE(taken_sizes.size(), 2);
+  EXPECT_EQ(3, taken_sizes[0]);
+  EXPECT_EQ(5, taken_sizes[1]);
+  EXPECT_EQ(3, num_tasks);
+}
+
 TEST(StreamingBatchSchedulerTest, ObeyBatchSizeConstraint) {
   // Set up a callback that captures the batches' task sizes.
   mutex mu;
@@ -214,6 +214,17 @@ AspiredVersionsManager::GetAvailableUntypedServableHandles() const {
   return basic_manager_->GetAvailableUntypedServableHandles();
 }
 
+Status AspiredVersionsManager::GetPinnedServable(
+    const ServableRequest& request, PinnedServable* const pinned) {
+  return basic_manager_->GetPinnedServable(request, pinned);
+}
+
+Status AspiredVersionsManager::GetPinnedServableByNameId(
+    const int32 name_id, const optional<int64>& version,
+    PinnedServable* const pinned) {
+  return basic_manager_->GetPinnedServableByNameId(name_id, version, pinned);
+}
+
 Source<std::unique_ptr<Loader>>::AspiredVersionsCallback
 AspiredVersionsManager::GetAspiredVersionsCallback() {
   return target_impl_->GetAspiredVersionsCallback();
@@ -316,9 +327,12 @@ bool AspiredVersionsManager::ContainsAnyReaspiredVersions(
 }
 
 // We collect the version policy actions for each servable stream first. Then
-// we sort them based on the global policy and pick the first one.
-optional<AspiredVersionPolicy::ServableAction>
-AspiredVersionsManager::GetNextAction() {
+// we sort them based on the global policy.
+std::vector<AspiredVersionPolicy::ServableAction>
+AspiredVersionsManager::GetNextActions(int* const num_ongoing_loads,
+                                       int* const num_ongoing_unloads) {
+  *num_ongoing_loads = 0;
+  *num_ongoing_unloads = 0;
   std::vector<optional<AspiredVersionPolicy::ServableAction>> actions;
   for (const string& servable_name :
        basic_manager_->GetManagedServableNames()) {
@@ -329,18 +343,36 @@ AspiredVersionsManager::GetNextAction() {
       aspired_state_snapshots.push_back(
           {state_snapshot.id, state_snapshot.state,
            state_snapshot.additional_state->is_aspired});
+      switch (state_snapshot.state) {
+        case LoaderHarness::State::kLoadRequested:
+        case LoaderHarness::State::kLoadApproved:
+        case LoaderHarness::State::kLoading:
+          ++*num_ongoing_loads;
+          break;
+        case LoaderHarness::State::kUnloadRequested:
+        case LoaderHarness::State::kQuiescing:
+        case LoaderHarness::State::kQuiesced:
+        case LoaderHarness::State::kUnloading:
+          ++*num_ongoing_unloads;
+          break;
+        default:
+          break;
+      }
     }
     actions.emplace_back(
         aspired_version_policy_->GetNextAction(aspired_state_snapshots));
   }
 
   std::sort(actions.begin(), actions.end(), CompareActions());
-  const optional<AspiredVersionPolicy::ServableAction> next_action =
-      !actions.empty() ? actions[0] : nullopt;
-  if (next_action) {
-    VLOG(1) << "Taking action: " << next_action->DebugString();
+  std::vector<AspiredVersionPolicy::ServableAction> next_actions;
+  for (const optional<AspiredVersionPolicy::ServableAction>& action : actions) {
+    // Streams without an action are sorted last.
+    if (!action) {
+      break;
+    }
+    next_actions.push_back(action.value());
   }
-  return next_action;
+  return next_actions;
 }
 
 void AspiredVersionsManager::PerformAction(
@@ -414,14 +446,44 @@ void AspiredVersionsManager::HandlePendingAspiredVersionsRequests() {
 void AspiredVersionsManager::InvokePolicyAndExecuteAction() {
   mutex_lock l(basic_manager_read_modify_write_mu_);
 
-  const optional<AspiredVersionPolicy::ServableAction> next_action =
-      GetNextAction();
-  if (!next_action) {
-    return;
+  int num_ongoing_loads;
+  int num_ongoing_unloads;
+  const std::vector<AspiredVersionPolicy::ServableAction> next_actions =
+      GetNextActions(&num_ongoing_loads, &num_ongoing_unloads);
+
+  // The actions pertain to different servable streams, so they are independent
+  // of each other. (Actions on the same stream are ordered by the policy, which
+  // suggests the next one once the previous one has been requested.) We
+  // perform as many of them as there are idle threads to execute them, where
+  // executing requests in the calling thread counts as a single thread.
+  int num_idle_unload_threads =
+      std::max<int>(basic_manager_->num_unload_threads(), 1) -
+      num_ongoing_unloads;
+  int num_idle_load_threads =
+      std::max<int>(basic_manager_->num_load_threads(), 1) - num_ongoing_loads;
+  bool performed_unload = false;
+  for (const AspiredVersionPolicy::ServableAction& action : next_actions) {
+    switch (action.action) {
+      case AspiredVersionPolicy::Action::kUnload:
+        if (num_idle_unload_threads <= 0) {
+          continue;
+        }
+        --num_idle_unload_threads;
+        performed_unload = true;
+        break;
+      case AspiredVersionPolicy::Action::kLoad:
+        // Unloads are sorted first. Loads wait for a round in which no unload
+        // is performed, so that the unloads get to free up resources first.
+        if (performed_unload || num_idle_load_threads <= 0) {
+          return;
+        }
+        --num_idle_load_threads;
+        break;
+    }
+    // NOTE: we could do action validation here.
+    VLOG(1) << "Taking action: " << action.DebugString();
+    PerformAction(action);
   }
-  // NOTE: we could do action validation here.
-
-  PerformAction(*next_action);
 }
 
 void AspiredVersionsManager::SetNumLoadThreads(const uint32 num_load_threads) {
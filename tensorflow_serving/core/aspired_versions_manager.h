@@ -36,6 +36,7 @@ limitations under the License.
 #include "tensorflow_serving/core/servable_data.h"
 #include "tensorflow_serving/core/servable_handle.h"
 #include "tensorflow_serving/core/servable_id.h"
+#include "tensorflow_serving/core/servable_name_table.h"
 #include "tensorflow_serving/core/servable_state.h"
 #include "tensorflow_serving/core/target.h"
 #include "tensorflow_serving/util/event_bus.h"
@@ -77,7 +78,9 @@ class AspiredVersionsManagerTestAccess;
 /// This manager makes transitions between versions of a servable stream using a
 /// configured AspiredVersionPolicy. The manager prefers unloading before
 /// loading to free up resources in the server when deciding among transitions
-/// suggested by the policy.
+/// suggested by the policy. Transitions of different servable streams are
+/// independent, so the manager makes as many of them at a time as it has idle
+/// load and unload threads for.
 class AspiredVersionsManager : public Manager,
                                public Target<std::unique_ptr<Loader>> {
  public:
@@ -215,6 +218,17 @@ class AspiredVersionsManager : public Manager,
   std::map<ServableId, std::unique_ptr<UntypedServableHandle>>
   GetAvailableUntypedServableHandles() const override;
 
+  Status GetPinnedServable(const ServableRequest& request,
+                           PinnedServable* pinned) override;
+
+  // See BasicManager::GetPinnedServableByNameId().
+  Status GetPinnedServableByNameId(int32 name_id,
+                                   const optional<int64>& version,
+                                   PinnedServable* pinned);
+
+  // See BasicManager::name_table().
+  ServableNameTable* name_table() { return basic_manager_->name_table(); }
+
   // Enqueues an incoming aspired-versions request to be processed later,
   // asynchronously.
   void EnqueueAspiredVersionsRequest(
@@ -242,9 +256,11 @@ class AspiredVersionsManager : public Manager,
       EXCLUSIVE_LOCKS_REQUIRED(basic_manager_read_modify_write_mu_);
 
   // Goes through the harness map and calls the configured servable_policy with
-  // the state snapshots to get a list of suggested actions. The actions are
-  // then ordered and finally the topmost one is performed.
-  optional<AspiredVersionPolicy::ServableAction> GetNextAction()
+  // the state snapshots to get a list of suggested actions, at most one per
+  // servable stream. The actions are returned ordered, unloads first. Also
+  // counts the loads and unloads that are under way.
+  std::vector<AspiredVersionPolicy::ServableAction> GetNextActions(
+      int* num_ongoing_loads, int* num_ongoing_unloads)
       EXCLUSIVE_LOCKS_REQUIRED(basic_manager_read_modify_write_mu_);
 
   // Checks for servables that are not aspired and at some final state and tells
@@ -259,8 +275,9 @@ class AspiredVersionsManager : public Manager,
       LOCKS_EXCLUDED(basic_manager_read_modify_write_mu_,
                      pending_aspired_versions_requests_mu_);
 
-  // Invokes the aspired-version policy and executes any returned policy action.
-  // This method is intended to be invoked periodically.
+  // Invokes the aspired-version policy and executes the returned policy
+  // actions, as many as there are idle load or unload threads for. This method
+  // is intended to be invoked periodically.
   void InvokePolicyAndExecuteAction()
       LOCKS_EXCLUDED(basic_manager_read_modify_write_mu_);
 
@@ -20,9 +20,13 @@ limitations under the License.
 // For a longer run time and more consistent results, consider a min time
 // e.g.: --benchmark_min_time=60.0
 
+#include <stdint.h>
+#include <stdlib.h>
 #include <algorithm>
+#include <atomic>
 #include <functional>
 #include <memory>
+#include <new>
 #include <string>
 #include <vector>
 
@@ -50,6 +54,25 @@ limitations under the License.
 #include "tensorflow_serving/core/simple_loader.h"
 #include "tensorflow_serving/core/test_util/manager_test_util.h"
 
+namespace {
+
+// The number of heap allocations made by the process so far, counted by the
+// replacement of the global operator new below.
+std::atomic<int64_t> num_allocations{0};
+
+}  // namespace
+
+void* operator new(size_t size) {
+  num_allocations.fetch_add(1, std::memory_order_relaxed);
+  void* const ptr = malloc(size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept { free(ptr); }
+
 namespace tensorflow {
 namespace serving {
 namespace {
@@ -359,12 +382,18 @@ static void BM_GetServableHandle(const int iters) {
 
   ServableHandle<int64> handle;
   testing::ItemsProcessed(iters);
+  const int64 num_allocations_before = num_allocations.load();
   testing::StartTiming();
   for (int i = 0; i < iters; ++i) {
     const Status status =
         manager->GetServableHandle(requests[i % kNumRequests], &handle);
     TF_CHECK_OK(status) << status;
   }
+  // Acquiring a handle shouldn't allocate, so this should read 0.
+  testing::SetLabel(strings::StrCat(
+      static_cast<double>(num_allocations.load() - num_allocations_before) /
+          iters,
+      " allocations per lookup"));
 }
 BENCHMARK(BM_GetServableHandle);
 
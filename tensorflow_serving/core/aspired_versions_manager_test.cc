@@ -608,6 +608,48 @@ TEST_P(AspiredVersionsManagerTest, ManagerPrefersUnloadOverLoad) {
   EXPECT_EQ(2, *found_2_handle);
 }
 
+// The manager performs the actions of different servable streams at the same
+// time, as long as it has idle load threads for them.
+TEST_P(AspiredVersionsManagerTest, LoadsIndependentServablesTogether) {
+  const std::vector<ServableId> ids = {{kServableName, 2},
+                                       {kServableName2, 2}};
+  for (const ServableId& id : ids) {
+    std::vector<ServableData<std::unique_ptr<Loader>>> aspired_versions;
+    for (int i = 0; i <= id.version; ++i) {
+      aspired_versions.push_back(CreateAspiredVersion({id.name, i}));
+    }
+    manager_->GetAspiredVersionsCallback()(id.name,
+                                           std::move(aspired_versions));
+  }
+  HandlePendingAspiredVersionsRequests();
+
+  InvokePolicyAndExecuteAction();
+  if (thread_pool_sizes_.num_load_threads >= ids.size()) {
+    for (const ServableId& id : ids) {
+      WaitUntilServableManagerStateIsOneOf(
+          servable_state_monitor_, id,
+          {ServableState::ManagerState::kAvailable});
+    }
+    return;
+  }
+
+  // Without a load thread-pool, loads happen one at a time in the calling
+  // thread.
+  int num_available = 0;
+  for (const ServableId& id : ids) {
+    if (servable_state_monitor_.GetState(id)->manager_state ==
+        ServableState::ManagerState::kAvailable) {
+      ++num_available;
+    }
+  }
+  EXPECT_EQ(1, num_available);
+  InvokePolicyAndExecuteAction();
+  for (const ServableId& id : ids) {
+    EXPECT_EQ(ServableState::ManagerState::kAvailable,
+              servable_state_monitor_.GetState(id)->manager_state);
+  }
+}
+
 // Test to ensure the manager doesn't try to load or serve an incoming erroneous
 // aspired-version entry.
 TEST_P(AspiredVersionsManagerTest, ErroneousAspiredVersion) {
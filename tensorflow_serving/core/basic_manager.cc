@@ -17,6 +17,7 @@ limitations under the License.
 
 #include <algorithm>
 #include <iterator>
+#include <limits>
 #include <map>
 #include <memory>
 #include <unordered_set>
@@ -28,9 +29,9 @@ limitations under the License.
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow_serving/core/servable_handle.h"
+#include "tensorflow_serving/core/servable_name_table.h"
 #include "tensorflow_serving/core/source.h"
 #include "tensorflow_serving/util/cleanup.h"
-#include "tensorflow_serving/util/hash.h"
 #include "tensorflow_serving/util/inline_executor.h"
 #include "tensorflow_serving/util/retrier.h"
 #include "tensorflow_serving/util/threadpool_executor.h"
@@ -40,6 +41,24 @@ namespace serving {
 
 namespace {
 
+// The number of entries of each node of the serving map's tree of streams.
+constexpr int kStreamNodeFanoutBits = 5;
+constexpr int32 kStreamNodeFanout = 1 << kStreamNodeFanoutBits;
+
+// Returns the index of stream 'name_id' among the entries of the tree node at
+// level 'level' on its path.
+int StreamNodeIndex(const int32 name_id, const int level) {
+  return (name_id >> (kStreamNodeFanoutBits * level)) &
+         (kStreamNodeFanout - 1);
+}
+
+// Returns whether a tree of streams of height 'height' has room for stream
+// 'name_id'.
+bool StreamTreeHolds(const int height, const int32 name_id) {
+  return (static_cast<int64>(name_id) >>
+          (kStreamNodeFanoutBits * (height + 1))) == 0;
+}
+
 std::unique_ptr<Executor> CreateExecutor(Env* const env,
                                          const uint32 num_threads,
                                          const string& threadpool_name) {
@@ -54,152 +73,318 @@ std::unique_ptr<Executor> CreateExecutor(Env* const env,
 
 }  // namespace
 
-struct BasicManager::ServingMap::EqRequest {
-  bool operator()(const ServableRequest& lhs,
-                  const ServableRequest& rhs) const {
-    if (lhs.version != rhs.version) {
-      return false;
-    }
-    // Even if there is a small probability that version checking can eliminate
-    // string checking, we should do that since O(string_equality) >>
-    // O(version_equality)
-    if (lhs.name != rhs.name) {
-      return false;
+BasicManager::ServingMap::ServingMap(ServableNameTable* const name_table)
+    : name_table_(name_table),
+      handles_map_(std::unique_ptr<HandlesMap>(new HandlesMap())) {}
+
+BasicManager::ServingMap::~ServingMap() {
+  // The pins' deleters refer to this object. Drop the map's references to
+  // them, then wait for the handles still holding them.
+  handles_map_.Update(nullptr);
+  std::map<ServableId, std::shared_ptr<const LoaderHarness>> pins;
+  {
+    mutex_lock l(mu_);
+    pins.swap(pins_);
+  }
+  pins.clear();
+  mutex_lock l(mu_);
+  while (!pinned_servables_.empty()) {
+    pin_released_.wait(l);
+  }
+}
+
+// static
+const BasicManager::ServingMap::StreamVersions*
+BasicManager::ServingMap::FindStream(const HandlesMap& handles_map,
+                                     const int32 name_id) {
+  if (name_id < 0 || handles_map.root == nullptr ||
+      !StreamTreeHolds(handles_map.height, name_id)) {
+    return nullptr;
+  }
+  const StreamNode* node = handles_map.root.get();
+  for (int level = handles_map.height; level > 0; --level) {
+    node = node->children[StreamNodeIndex(name_id, level)].get();
+    if (node == nullptr) {
+      return nullptr;
     }
-    return true;
-  }
-};
-
-struct BasicManager::ServingMap::HashRequest {
-  uint64 operator()(const ServableRequest& request) const {
-    // Hash codes for many common types are remarkably bad, often clustering
-    // around the same values of the low and/or high bits for linear
-    // sequences of inputs such as 1, 2, 3; or addresses of consecutively
-    // allocated objects.  For these cases the default hash function is the
-    // identity function on the bit patterns.
-    //
-    // So we apply a one-to-one mapping to the resulting bit patterns to
-    // make the high bits contain more entropy from the entire hash code.
-    // It's based on Fibonacci hashing from Knuth's Art of Computer
-    // Programming volume 3, section 6.4.
-    const uint64 version_hash = [&]() -> uint64 {
-      if (request.version) {
-        return std::hash<int64>()(request.version.value()) *
-               0x9E3779B97F4A7C13;  // (sqrt(5) - 1)/2 as a binary fraction.
-      } else {
-        return 0xDECAFCAFFE;
+  }
+  return node->streams[StreamNodeIndex(name_id, 0)].get();
+}
+
+// static
+std::shared_ptr<const BasicManager::ServingMap::StreamNode>
+BasicManager::ServingMap::SetStream(
+    const StreamNode* const node, const int level, const int32 name_id,
+    std::shared_ptr<const StreamVersions> versions) {
+  std::shared_ptr<StreamNode> new_node(
+      node == nullptr ? new StreamNode() : new StreamNode(*node));
+  const int index = StreamNodeIndex(name_id, level);
+  if (level == 0) {
+    new_node->streams.resize(kStreamNodeFanout);
+    new_node->streams[index] = std::move(versions);
+  } else {
+    new_node->children.resize(kStreamNodeFanout);
+    new_node->children[index] =
+        SetStream(new_node->children[index].get(), level - 1, name_id,
+                  std::move(versions));
+  }
+  return new_node;
+}
+
+// static
+void BasicManager::ServingMap::ForEachStream(
+    const StreamNode* const node, const int level,
+    const std::function<void(const StreamVersions&)>& fn) {
+  if (node == nullptr) {
+    return;
+  }
+  if (level == 0) {
+    for (const auto& versions : node->streams) {
+      if (versions != nullptr) {
+        fn(*versions);
       }
-    }();
-    // Using version_hash as the seed here to combine the hashes.
-    return HashCombine(version_hash, std::hash<string>()(request.name));
+    }
+    return;
+  }
+  for (const auto& child : node->children) {
+    ForEachStream(child.get(), level - 1, fn);
   }
-};
+}
 
-BasicManager::ServingMap::ServingMap()
-    : handles_map_(std::unique_ptr<HandlesMap>(new HandlesMap())) {}
+// static
+const std::shared_ptr<const LoaderHarness>*
+BasicManager::ServingMap::FindHarness(const HandlesMap& handles_map,
+                                      const int32 name_id,
+                                      const optional<int64>& version) {
+  const StreamVersions* const stream = FindStream(handles_map, name_id);
+  if (stream == nullptr) {
+    return nullptr;
+  }
+  const StreamVersions& versions = *stream;
+  if (!version) {
+    return &versions.back();
+  }
+  const auto it = std::lower_bound(
+      versions.begin(), versions.end(), version.value(),
+      [](const std::shared_ptr<const LoaderHarness>& harness,
+         const int64 version) { return harness->id().version < version; });
+  if (it == versions.end() || (*it)->id().version != version.value()) {
+    return nullptr;
+  }
+  return &*it;
+}
+
+const std::shared_ptr<const LoaderHarness>*
+BasicManager::ServingMap::FindHarness(const HandlesMap& handles_map,
+                                      const ServableRequest& request) const {
+  int32 name_id;
+  if (!name_table_->Find(request.name, &name_id)) {
+    return nullptr;
+  }
+  return FindHarness(handles_map, name_id, request.version);
+}
 
 std::vector<ServableId> BasicManager::ServingMap::ListAvailableServableIds()
     const {
   std::vector<ServableId> ids;
-  std::shared_ptr<const HandlesMap> handles_map = handles_map_.get();
-  for (auto iter = handles_map->begin(); iter != handles_map->end();) {
-    // We get the iterator where all the values for a particular key ends.
-    const auto key_end = handles_map->equal_range(iter->first).second;
-
-    for (; iter != key_end; ++iter) {
-      if (iter->first.version) {
-        ids.push_back(iter->second->id());
-      }
-    }
-  }
+  const FastReadDynamicPtr<HandlesMap>::PinnedPtr handles_map =
+      handles_map_.Pin();
+  ForEachStream(handles_map->root.get(), handles_map->height,
+                [&](const StreamVersions& versions) {
+                  for (const auto& harness : versions) {
+                    ids.push_back(harness->id());
+                  }
+                });
   return ids;
 }
 
 Status BasicManager::ServingMap::GetUntypedServableHandle(
     const ServableRequest& request,
     std::unique_ptr<UntypedServableHandle>* const untyped_handle) {
-  std::shared_ptr<const HandlesMap> handles_map = handles_map_.get();
-  const auto found_it = handles_map->find(request);
-  if (found_it == handles_map->end()) {
+  const FastReadDynamicPtr<HandlesMap>::PinnedPtr handles_map =
+      handles_map_.Pin();
+  const std::shared_ptr<const LoaderHarness>* const harness =
+      FindHarness(*handles_map, request);
+  if (harness == nullptr) {
     return errors::NotFound("Servable not found for request: ",
                             request.DebugString());
   }
 
-  const LoaderHarness& harness = *found_it->second;
   // We use the aliasing constructor of shared_ptr here. So even though we are
   // returning a shared_ptr to servable, the ref-counting is happening on the
-  // handles_map. This delays the map destruction till the last handle from the
-  // previous map is freed, when we are doing handles_map updates.
+  // servable's pin. This delays the servable's unload till the last handle to
+  // it is freed.
   untyped_handle->reset(new SharedPtrHandle(
-      harness.id(), std::shared_ptr<Loader>(handles_map, harness.loader())));
+      (*harness)->id(),
+      std::shared_ptr<Loader>(*harness, (*harness)->loader())));
+  return Status::OK();
+}
+
+Status BasicManager::ServingMap::GetPinnedServable(
+    const ServableRequest& request, PinnedServable* const pinned) {
+  const FastReadDynamicPtr<HandlesMap>::PinnedPtr handles_map =
+      handles_map_.Pin();
+  const std::shared_ptr<const LoaderHarness>* const harness =
+      FindHarness(*handles_map, request);
+  if (harness == nullptr) {
+    return errors::NotFound("Servable not found for request: ",
+                            request.DebugString());
+  }
+
+  pinned->id = &(*harness)->id();
+  pinned->servable = (*harness)->loader()->servable();
+  // Like the aliasing shared_ptrs handed out above, this delays the servable's
+  // unload until the pin is dropped.
+  pinned->pin = *harness;
+  return Status::OK();
+}
+
+Status BasicManager::ServingMap::GetPinnedServable(
+    const int32 name_id, const optional<int64>& version,
+    PinnedServable* const pinned) {
+  const FastReadDynamicPtr<HandlesMap>::PinnedPtr handles_map =
+      handles_map_.Pin();
+  const std::shared_ptr<const LoaderHarness>* const harness =
+      FindHarness(*handles_map, name_id, version);
+  if (harness == nullptr) {
+    const string name = name_table_->Name(name_id);
+    return errors::NotFound(
+        "Servable not found for request: ",
+        (version ? ServableRequest::Specific(name, version.value())
+                 : ServableRequest::Latest(name))
+            .DebugString());
+  }
+
+  pinned->id = &(*harness)->id();
+  pinned->servable = (*harness)->loader()->servable();
+  pinned->pin = *harness;
   return Status::OK();
 }
 
 std::map<ServableId, std::unique_ptr<UntypedServableHandle>>
 BasicManager::ServingMap::GetAvailableUntypedServableHandles() const {
   std::map<ServableId, std::unique_ptr<UntypedServableHandle>> result;
-  std::shared_ptr<const HandlesMap> handles_map = handles_map_.get();
-  for (const auto& handle : *handles_map) {
-    const ServableRequest& request = handle.first;
-    // If the entry is the one for the latest request, skip it. We would already
-    // get it from the entry which has the specific request.
-    if (!request.version) {
-      continue;
-    }
-    const LoaderHarness& harness = *handle.second;
-    result.emplace(harness.id(),
-                   std::unique_ptr<UntypedServableHandle>(new SharedPtrHandle(
-                       harness.id(), std::shared_ptr<Loader>(
-                                         handles_map, harness.loader()))));
-  }
+  const FastReadDynamicPtr<HandlesMap>::PinnedPtr handles_map =
+      handles_map_.Pin();
+  ForEachStream(
+      handles_map->root.get(), handles_map->height,
+      [&](const StreamVersions& versions) {
+        for (const auto& harness : versions) {
+          result.emplace(
+              harness->id(),
+              std::unique_ptr<UntypedServableHandle>(new SharedPtrHandle(
+                  harness->id(),
+                  std::shared_ptr<Loader>(harness, harness->loader()))));
+        }
+      });
   return result;
 }
 
-void BasicManager::ServingMap::Update(const ManagedMap& managed_map) {
-  struct CompareRequests {
-    bool operator()(const ServableRequest& lhs,
-                    const ServableRequest& rhs) const {
-      const int strcmp_result = lhs.name.compare(rhs.name);
-      if (strcmp_result != 0) {
-        return strcmp_result < 0;
+void BasicManager::ServingMap::Update(const ManagedMap& managed_map,
+                                     const string& name) {
+  std::vector<std::shared_ptr<const LoaderHarness>> ready_harnesses;
+  const auto range = managed_map.equal_range(name);
+  for (auto iter = range.first; iter != range.second; ++iter) {
+    if (iter->second->state() == LoaderHarness::State::kReady) {
+      ready_harnesses.push_back(iter->second);
+    }
+  }
+  std::sort(ready_harnesses.begin(), ready_harnesses.end(),
+            [](const std::shared_ptr<const LoaderHarness>& lhs,
+               const std::shared_ptr<const LoaderHarness>& rhs) {
+              return lhs->id().version < rhs->id().version;
+            });
+
+  std::shared_ptr<StreamVersions> versions;
+  // The pins of the stream's versions that are no longer served. Dropped
+  // without holding 'mu_', since dropping the last reference takes it.
+  std::vector<std::shared_ptr<const LoaderHarness>> unserved_pins;
+  {
+    mutex_lock l(mu_);
+    if (!ready_harnesses.empty()) {
+      versions = std::make_shared<StreamVersions>();
+      for (const auto& harness : ready_harnesses) {
+        versions->push_back(PinLocked(harness));
       }
-      DCHECK(lhs.version);
-      DCHECK(rhs.version);
-      return lhs.version.value() < rhs.version.value();
     }
-  };
-  std::multimap<ServableRequest, std::shared_ptr<const LoaderHarness>,
-                CompareRequests>
-      sorted_available_map;
-  for (const auto& elem : managed_map) {
-    std::shared_ptr<const LoaderHarness> harness = elem.second;
-    if (harness->state() == LoaderHarness::State::kReady) {
-      sorted_available_map.emplace(ServableRequest::FromId(harness->id()),
-                                   harness);
+    for (auto it = pins_.lower_bound(
+             ServableId{name, std::numeric_limits<int64>::min()});
+         it != pins_.end() && it->first.name == name;) {
+      const bool served =
+          versions != nullptr &&
+          std::any_of(versions->begin(), versions->end(),
+                      [&it](const std::shared_ptr<const LoaderHarness>& pin) {
+                        return pin == it->second;
+                      });
+      if (served) {
+        ++it;
+      } else {
+        unserved_pins.push_back(std::move(it->second));
+        it = pins_.erase(it);
+      }
     }
   }
 
+  // Normally a no-op lookup: ServerCore interns the names of the models it is
+  // configured with up front.
+  const int32 name_id = name_table_->Intern(name);
+
+  // The new generation shares all the tree nodes but the ones on the path to
+  // the stream with the current one, so an update costs O(log(#streams))
+  // rather than O(#streams).
   std::unique_ptr<HandlesMap> new_handles_map(new HandlesMap());
-  for (auto iter = sorted_available_map.begin();
-       iter != sorted_available_map.end(); ++iter) {
-    std::shared_ptr<const LoaderHarness> harness = iter->second;
-    new_handles_map->emplace(ServableRequest::FromId(harness->id()), harness);
-    // If this is the last harness in the stream, add it again to the
-    // handles_map, marking it as the latest for that stream.
-    const auto next_iter = std::next(iter);
-    if (next_iter == sorted_available_map.end() ||
-        next_iter->second->id().name != harness->id().name) {
-      const ServableRequest latest_request =
-          ServableRequest::Latest(harness->id().name);
-      new_handles_map->emplace(latest_request, harness);
+  {
+    const FastReadDynamicPtr<HandlesMap>::PinnedPtr handles_map =
+      handles_map_.Pin();
+    std::shared_ptr<const StreamNode> root = handles_map->root;
+    int height = handles_map->height;
+    while (!StreamTreeHolds(height, name_id)) {
+      if (root != nullptr) {
+        std::shared_ptr<StreamNode> new_root(new StreamNode());
+        new_root->children.resize(kStreamNodeFanout);
+        new_root->children[0] = std::move(root);
+        root = std::move(new_root);
+      }
+      ++height;
     }
+    new_handles_map->root =
+        SetStream(root.get(), height, name_id, std::move(versions));
+    new_handles_map->height = height;
   }
 
-  // This blocks until the last handle given out by the old handles map is
-  // freed.
+  // Lookups hold a generation only while they copy a pin, so this wait is
+  // short. The previous generation is then destroyed here, and with it its
+  // references to the pins of the versions no longer served.
   handles_map_.Update(std::move(new_handles_map));
 }
 
+std::shared_ptr<const LoaderHarness> BasicManager::ServingMap::PinLocked(
+    const std::shared_ptr<const LoaderHarness>& harness) {
+  std::shared_ptr<const LoaderHarness>& pin = pins_[harness->id()];
+  if (pin == nullptr) {
+    // The harness outlives the pin: the servable is unloaded, and then stops
+    // being managed, only once the pin is released.
+    const ServableId id = harness->id();
+    pin = std::shared_ptr<const LoaderHarness>(
+        harness.get(), [this, id](const LoaderHarness*) { OnPinReleased(id); });
+    pinned_servables_.insert(id);
+  }
+  return pin;
+}
+
+void BasicManager::ServingMap::OnPinReleased(const ServableId& id) {
+  mutex_lock l(mu_);
+  pinned_servables_.erase(id);
+  pin_released_.notify_all();
+}
+
+void BasicManager::ServingMap::WaitUntilReleased(const ServableId& id) {
+  mutex_lock l(mu_);
+  while (pinned_servables_.count(id) > 0) {
+    pin_released_.wait(l);
+  }
+}
+
 Status BasicManager::Create(Options options,
                             std::unique_ptr<BasicManager>* manager) {
   manager->reset(new BasicManager(
@@ -218,8 +403,10 @@ BasicManager::BasicManager(Env* const env, const uint32 num_load_threads,
                            EventBus<ServableState>* servable_event_bus,
                            std::function<void(const ServableId&)> pre_load_hook)
     : servable_event_bus_(servable_event_bus),
+      serving_map_(&name_table_),
       env_(env),
       num_load_threads_(num_load_threads),
+      num_unload_threads_(num_unload_threads),
       pre_load_hook_(std::move(pre_load_hook)) {
   harness_options_.max_num_load_retries = max_num_load_retries;
   harness_options_.load_retry_interval_micros = load_retry_interval_micros;
@@ -285,15 +472,24 @@ Status BasicManager::GetUntypedServableHandle(
   return serving_map_.GetUntypedServableHandle(request, untyped_handle);
 }
 
+Status BasicManager::GetPinnedServable(const ServableRequest& request,
+                                       PinnedServable* const pinned) {
+  return serving_map_.GetPinnedServable(request, pinned);
+}
+
+Status BasicManager::GetPinnedServableByNameId(const int32 name_id,
+                                               const optional<int64>& version,
+                                               PinnedServable* const pinned) {
+  return serving_map_.GetPinnedServable(name_id, version, pinned);
+}
+
 std::map<ServableId, std::unique_ptr<UntypedServableHandle>>
 BasicManager::GetAvailableUntypedServableHandles() const {
   return serving_map_.GetAvailableUntypedServableHandles();
 }
 
-void BasicManager::UpdateServingMap() {
-  // This blocks until the last handle given out by the old serving map is
-  // freed.
-  serving_map_.Update(managed_map_);
+void BasicManager::UpdateServingMap(const string& name) {
+  serving_map_.Update(managed_map_, name);
 }
 
 BasicManager::ManagedMap::iterator BasicManager::FindHarnessInMap(
@@ -466,7 +662,7 @@ Status BasicManager::ExecuteLoad(LoaderHarness* harness) {
 
   {
     mutex_lock l(mu_);
-    UpdateServingMap();
+    UpdateServingMap(id.name);
   }
 
   PublishOnEventBus(
@@ -504,7 +700,15 @@ Status BasicManager::ExecuteUnload(LoaderHarness* harness) {
     mutex_lock l(mu_);
     PublishOnEventBus(
         {id, ServableState::ManagerState::kUnloading, harness->status()});
-    UpdateServingMap();
+    UpdateServingMap(id.name);
+  }
+
+  // Wait for the handles to the servable to be freed. We don't hold the lock
+  // while waiting, as it may take as long as the slowest request using it.
+  serving_map_.WaitUntilReleased(id);
+
+  {
+    mutex_lock l(mu_);
     TF_RETURN_IF_ERROR(harness->DoneQuiescing());
   }
 
@@ -16,7 +16,10 @@ limitations under the License.
 #ifndef TENSORFLOW_SERVING_CORE_BASIC_MANAGER_H_
 #define TENSORFLOW_SERVING_CORE_BASIC_MANAGER_H_
 
+#include <functional>
+#include <map>
 #include <memory>
+#include <set>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -34,6 +37,7 @@ limitations under the License.
 #include "tensorflow_serving/core/servable_data.h"
 #include "tensorflow_serving/core/servable_handle.h"
 #include "tensorflow_serving/core/servable_id.h"
+#include "tensorflow_serving/core/servable_name_table.h"
 #include "tensorflow_serving/core/servable_state.h"
 #include "tensorflow_serving/resources/resource_tracker.h"
 #include "tensorflow_serving/util/event_bus.h"
@@ -161,6 +165,24 @@ class BasicManager : public Manager {
   std::map<ServableId, std::unique_ptr<UntypedServableHandle>>
   GetAvailableUntypedServableHandles() const override;
 
+  /// Pins the serving map the servable is found in, rather than allocating a
+  /// handle.
+  Status GetPinnedServable(const ServableRequest& request,
+                           PinnedServable* pinned) override;
+
+  /// Same as GetPinnedServable(), for version 'version' (the latest if unset)
+  /// of the servable stream whose name has id 'name_id' in name_table().
+  /// Lets callers that resolved the name once look the servable up without
+  /// hashing or comparing the name again.
+  Status GetPinnedServableByNameId(int32 name_id,
+                                   const optional<int64>& version,
+                                   PinnedServable* pinned);
+
+  /// The ids of the names of the servable streams this manager has served,
+  /// which index its serving map. Callers may intern names ahead of time, e.g.
+  /// those of the servables they are configured with.
+  ServableNameTable* name_table() { return &name_table_; }
+
   /// Starts managing the servable.
   ///
   /// Returns an error if given a servable that is already being managed.
@@ -369,9 +391,9 @@ class BasicManager : public Manager {
   // Unloads all the managed servables.
   void UnloadAllServables() LOCKS_EXCLUDED(mu_);
 
-  // Updates the serving map by copying servables from the managed map, which
-  // are ready to be served.
-  void UpdateServingMap() EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Updates the serving map entry of servable stream 'name' by copying its
+  // versions from the managed map, which are ready to be served.
+  void UpdateServingMap(const string& name) EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
   // Sets the number of load threads.
   //
@@ -383,6 +405,8 @@ class BasicManager : public Manager {
       LOCKS_EXCLUDED(num_load_threads_mu_);
   uint32 num_load_threads() const LOCKS_EXCLUDED(num_load_threads_mu_);
 
+  uint32 num_unload_threads() const { return num_unload_threads_; }
+
   // Keys are the servable names.
   // Values are the harnesses for each servable version. The values when
   // fetched, are unordered.
@@ -417,10 +441,19 @@ class BasicManager : public Manager {
   // This map is updated occasionally from the main manager loop thread while
   // being accessed from multiple threads to get ServableHandles.
   //
+  // Each servable the map serves has a pin: a reference count, shared by the
+  // generations of the map that serve it and by the handles to it. Lookups
+  // hold the map only while they copy the pin, so a long-running request keeps
+  // just its own servable loaded.
+  //
   // This class is thread-safe.
   class ServingMap {
    public:
-    ServingMap();
+    // Resolves names via 'name_table', which must outlive this object.
+    explicit ServingMap(ServableNameTable* name_table);
+
+    // Blocks until the handles to all servables are released.
+    ~ServingMap();
 
     // Gets a list of all servable ids.
     std::vector<ServableId> ListAvailableServableIds() const;
@@ -432,31 +465,120 @@ class BasicManager : public Manager {
         const ServableRequest& request,
         std::unique_ptr<UntypedServableHandle>* untyped_handle);
 
+    // Same as GetUntypedServableHandle(), but without allocating: 'pinned'
+    // holds a reference to the servable's pin, which keeps the servable loaded
+    // just like a handle does.
+    Status GetPinnedServable(const ServableRequest& request,
+                             PinnedServable* pinned);
+
+    // Same as above, for version 'version' (the latest if unset) of the
+    // servable stream whose name has id 'name_id'.
+    Status GetPinnedServable(int32 name_id, const optional<int64>& version,
+                             PinnedServable* pinned);
+
     // Returns a map of all the currently available servable_ids to their
     // corresponding UntypedServableHandles.
     std::map<ServableId, std::unique_ptr<UntypedServableHandle>>
     GetAvailableUntypedServableHandles() const;
 
-    // Updates the serving map by copying servables from the managed map, which
-    // are ready to be served.
-    void Update(const ManagedMap& managed_map);
+    // Replaces the entry of servable stream 'name' by copying its versions
+    // from the managed map, which are ready to be served. Only the tree nodes
+    // on the path to the stream's entry are copied; everything else is shared
+    // with the previous generation. Drops the pins of the versions that are no
+    // longer served. Calls must be serialized.
+    //
+    // Waits only for the lookups that may still be reading the previous
+    // generation, not for the handles they handed out. Use WaitUntilReleased()
+    // to wait for the handles to a version that is no longer served.
+    void Update(const ManagedMap& managed_map, const string& name);
+
+    // Blocks until no handle to servable 'id' is left. Requires that the map
+    // no longer serves it. Waits for the handles to 'id' only, however long
+    // the requests holding handles to other servables take.
+    void WaitUntilReleased(const ServableId& id);
 
    private:
-    struct EqRequest;
-    // Hash and equality functors for ServableRequest.
-    // Forward-declared here and defined in the cc file.
-    struct HashRequest;
-
-    // Map from ServableRequest to corresponding harness. For the latest version
-    // of a servable stream, we add an extra entry for it, where key is the
-    // ServableRequest without the version set, so that requests for the latest,
-    // can be directly queried on this map.
-    using HandlesMap =
-        std::unordered_multimap<ServableRequest,
-                                std::shared_ptr<const LoaderHarness>,
-                                HashRequest, EqRequest>;
+    // The ready versions of a servable stream, in ascending order of version.
+    // The last one is the latest. Each is held through its pin, which points
+    // to the servable's harness without owning it.
+    using StreamVersions = std::vector<std::shared_ptr<const LoaderHarness>>;
+
+    // A node of a persistent radix tree of servable streams, indexed by the id
+    // that the manager's name table assigned to the stream's name. Leaves
+    // hold the ready versions of consecutive streams, inner nodes hold
+    // subtrees. Streams without ready versions and subtrees without any
+    // streams have a null entry. Nodes are immutable, so that generations can
+    // share them.
+    struct StreamNode {
+      // Set on inner nodes.
+      std::vector<std::shared_ptr<const StreamNode>> children;
+      // Set on leaves.
+      std::vector<std::shared_ptr<const StreamVersions>> streams;
+    };
+
+    // One generation of the map.
+    struct HandlesMap {
+      // The root of the tree of streams, or null if it is empty.
+      std::shared_ptr<const StreamNode> root;
+      // The number of levels of inner nodes. The tree has room for the
+      // streams whose id is below kStreamNodeFanout^(height + 1).
+      int height = 0;
+    };
+
+    // Returns the ready versions of the stream whose name has id 'name_id' in
+    // 'handles_map', or null if there are none.
+    static const StreamVersions* FindStream(const HandlesMap& handles_map,
+                                            int32 name_id);
+
+    // Returns a copy of the subtree 'node' (null if empty), whose root is at
+    // level 'level' (0 for leaves), with the entry of stream 'name_id' set to
+    // 'versions'.
+    static std::shared_ptr<const StreamNode> SetStream(
+        const StreamNode* node, int level, int32 name_id,
+        std::shared_ptr<const StreamVersions> versions);
+
+    // Calls 'fn' on the ready versions of each stream in the subtree 'node'
+    // (null if empty), whose root is at level 'level'.
+    static void ForEachStream(
+        const StreamNode* node, int level,
+        const std::function<void(const StreamVersions&)>& fn);
+
+    // Returns the pin in 'handles_map' of version 'version' (the latest if
+    // unset) of the stream whose name has id 'name_id', or null if there is
+    // none.
+    static const std::shared_ptr<const LoaderHarness>* FindHarness(
+        const HandlesMap& handles_map, int32 name_id,
+        const optional<int64>& version);
+
+    // Same as above, for 'request'.
+    const std::shared_ptr<const LoaderHarness>* FindHarness(
+        const HandlesMap& handles_map, const ServableRequest& request) const;
+
+    // Returns the pin of 'harness', creating it if the servable has none.
+    std::shared_ptr<const LoaderHarness> PinLocked(
+        const std::shared_ptr<const LoaderHarness>& harness)
+        EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+    // Called once the last reference to the pin of servable 'id' is dropped,
+    // on whichever thread drops it. Only records the release; the servable is
+    // unloaded on the manager's thread that waits for it.
+    void OnPinReleased(const ServableId& id) LOCKS_EXCLUDED(mu_);
+
+    ServableNameTable* const name_table_;
+
     FastReadDynamicPtr<HandlesMap> handles_map_;
+
+    mutex mu_;
+    // Notified when the last reference to a pin is dropped.
+    condition_variable pin_released_;
+    // The pins of the servables the current generation serves.
+    std::map<ServableId, std::shared_ptr<const LoaderHarness>> pins_
+        GUARDED_BY(mu_);
+    // The servables whose pin is still referenced: those in 'pins_', and those
+    // no longer served that handles still refer to.
+    std::set<ServableId> pinned_servables_ GUARDED_BY(mu_);
   };
+  ServableNameTable name_table_;
   ServingMap serving_map_;
 
   ////////
@@ -481,8 +603,10 @@ class BasicManager : public Manager {
   // The executor used for executing loads of servables.
   std::unique_ptr<Executor> load_executor_ GUARDED_BY(num_load_threads_mu_);
 
-  // The executor used for executing unloads of servables. (Unlike for loads,
-  // the unload executor is fixed for the lifetime of the manager.)
+  // The number of unload threads and the executor used for executing unloads of
+  // servables. (Unlike for loads, they are fixed for the lifetime of the
+  // manager.)
+  const uint32 num_unload_threads_;
   std::unique_ptr<Executor> unload_executor_;
 
   // Used to serialize the decision phases of the load/unload requests.
@@ -365,6 +365,50 @@ TEST_P(BasicManagerTest, ListAvailableServableIds) {
               UnorderedElementsAreArray(expected_after));
 }
 
+TEST_P(BasicManagerTest, ManyServableStreams) {
+  // Enough streams for the serving map to grow its tree of streams a level.
+  constexpr int kNumStreams = 100;
+  std::vector<ServableId> expected = {{kServableName, 1},
+                                      {kServableName, 2},
+                                      {kServableName2, 1},
+                                      {kServableName2, 2}};
+  for (int i = 0; i < kNumStreams; ++i) {
+    const ServableId id = {strings::StrCat("stream_", i), 1};
+    TF_CHECK_OK(basic_manager_->ManageServable(CreateServable(id)));
+    basic_manager_->LoadServable(
+        id, [](const Status& status) { TF_ASSERT_OK(status); });
+    WaitUntilServableManagerStateIsOneOf(
+        servable_state_monitor_, id, {ServableState::ManagerState::kAvailable});
+    expected.push_back(id);
+  }
+  EXPECT_THAT(basic_manager_->ListAvailableServableIds(),
+              UnorderedElementsAreArray(expected));
+  for (const ServableId& id : expected) {
+    ServableHandle<int64> handle;
+    TF_ASSERT_OK(basic_manager_->GetServableHandle(
+        ServableRequest::Specific(id.name, id.version), &handle));
+    EXPECT_EQ(id.version, *handle);
+  }
+
+  // Unloading a stream leaves the others served.
+  const ServableId unloaded_id = {"stream_50", 1};
+  basic_manager_->UnloadServable(
+      unloaded_id, [](const Status& status) { TF_ASSERT_OK(status); });
+  WaitUntilServableManagerStateIsOneOf(servable_state_monitor_, unloaded_id,
+                                       {ServableState::ManagerState::kEnd});
+  expected.erase(std::find(expected.begin(), expected.end(), unloaded_id));
+  EXPECT_THAT(basic_manager_->ListAvailableServableIds(),
+              UnorderedElementsAreArray(expected));
+  ServableHandle<int64> handle;
+  EXPECT_EQ(error::NOT_FOUND,
+            basic_manager_
+                ->GetServableHandle(ServableRequest::Latest("stream_50"),
+                                    &handle)
+                .code());
+  EXPECT_EQ(basic_manager_->GetAvailableServableHandles<int64>().size(),
+            expected.size());
+}
+
 TEST_P(BasicManagerTest, GetAvailableServableHandles) {
   // Scoped to destruct handles at the end of it.
   {
@@ -554,6 +598,52 @@ TEST_P(BasicManagerTest, DestructOnNonServingThread) {
   ASSERT_FALSE(FakeLoader::was_deleted_in_this_thread());
 }
 
+TEST_P(BasicManagerTest, HandlesOnlyBlockUnloadsOfTheirServable) {
+  const ServableId handle_id = {kServableName2, 1};
+  std::unique_ptr<ServableHandle<int64>> handle(new ServableHandle<int64>());
+  TF_ASSERT_OK(basic_manager_->GetServableHandle(
+      ServableRequest::FromId(handle_id), handle.get()));
+
+  // Neither loads nor unloads of other servables wait for the handle.
+  const ServableId id = {kServableName, 3};
+  TF_CHECK_OK(basic_manager_->ManageServable(CreateServable(id)));
+  basic_manager_->LoadServable(
+      id, [](const Status& status) { TF_ASSERT_OK(status); });
+  WaitUntilServableManagerStateIsOneOf(
+      servable_state_monitor_, id, {ServableState::ManagerState::kAvailable});
+  basic_manager_->UnloadServable(
+      id, [](const Status& status) { TF_ASSERT_OK(status); });
+  WaitUntilServableManagerStateIsOneOf(servable_state_monitor_, id,
+                                       {ServableState::ManagerState::kEnd});
+  // Nor do unloads of other versions of the same stream.
+  const ServableId other_version_id = {kServableName2, 2};
+  basic_manager_->UnloadServable(
+      other_version_id, [](const Status& status) { TF_ASSERT_OK(status); });
+  WaitUntilServableManagerStateIsOneOf(servable_state_monitor_,
+                                       other_version_id,
+                                       {ServableState::ManagerState::kEnd});
+
+  // The servable of the handle can only be unloaded once the handle is
+  // released. (The unload happens in the calling thread if there is no
+  // thread-pool for unloads.)
+  Notification unloaded;
+  std::unique_ptr<Thread> unload_servable(
+      Env::Default()->StartThread({}, "UnloadServable", [&]() {
+        basic_manager_->UnloadServable(
+            handle_id, [](const Status& status) { TF_ASSERT_OK(status); });
+        WaitUntilServableManagerStateIsOneOf(
+            servable_state_monitor_, handle_id,
+            {ServableState::ManagerState::kEnd});
+        unloaded.Notify();
+      }));
+  Env::Default()->SleepForMicroseconds(50 * 1000);
+  EXPECT_FALSE(unloaded.HasBeenNotified());
+  EXPECT_EQ(1, **handle);
+
+  handle.reset();
+  unloaded.WaitForNotification();
+}
+
 TEST_P(BasicManagerTest, AdditionalState) {
   const ServableId id = {kServableName, 3};
   std::unique_ptr<int> state(new int(1));
@@ -62,22 +62,37 @@ CachingManager::~CachingManager() {}
 Status CachingManager::GetUntypedServableHandle(
     const ServableRequest& request,
     std::unique_ptr<UntypedServableHandle>* const handle) {
+  return GetServable(
+      request, [this, handle](const ServableRequest& id_request) {
+        return basic_manager_->GetUntypedServableHandle(id_request, handle);
+      });
+}
+
+Status CachingManager::GetPinnedServable(const ServableRequest& request,
+                                         PinnedServable* const pinned) {
+  return GetServable(
+      request, [this, pinned](const ServableRequest& id_request) {
+        return basic_manager_->GetPinnedServable(id_request, pinned);
+      });
+}
+
+Status CachingManager::GetServable(
+    const ServableRequest& request,
+    const std::function<Status(const ServableRequest&)>& get) {
   if (request.version) {
-    return GetUntypedServableHandleForId({request.name, *request.version},
-                                         handle);
+    return GetServableForId({request.name, *request.version}, get);
   }
   // Since there is no explicit version in the request, get the latest from the
   // loader-factory.
   const int64 latest_version = loader_factory_->GetLatestVersion(request.name);
-  return GetUntypedServableHandleForId({request.name, latest_version}, handle);
+  return GetServableForId({request.name, latest_version}, get);
 }
 
-Status CachingManager::GetUntypedServableHandleForId(
+Status CachingManager::GetServableForId(
     const ServableId& servable_id,
-    std::unique_ptr<UntypedServableHandle>* handle) {
+    const std::function<Status(const ServableRequest&)>& get) {
   // Check if the underlying basic manager can already serve this request.
-  const Status handle_status = basic_manager_->GetUntypedServableHandle(
-      ServableRequest::FromId(servable_id), handle);
+  const Status handle_status = get(ServableRequest::FromId(servable_id));
 
   // If the servable is already managed and loaded by the basic manager, serve
   // it.
@@ -96,8 +111,7 @@ Status CachingManager::GetUntypedServableHandleForId(
   TF_RETURN_IF_ERROR(LoadServable(std::move(loader_data)));
 
   // Return the handle using the loaded servable data now.
-  return basic_manager_->GetUntypedServableHandle(
-      ServableRequest::FromId(servable_id), handle);
+  return get(ServableRequest::FromId(servable_id));
 }
 
 Status CachingManager::LoadServable(
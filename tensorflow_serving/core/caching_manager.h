@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef TENSORFLOW_SERVING_CORE_CACHING_MANAGER_H_
 #define TENSORFLOW_SERVING_CORE_CACHING_MANAGER_H_
 
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
@@ -121,10 +122,21 @@ class CachingManager : public Manager {
       const ServableRequest& request,
       std::unique_ptr<UntypedServableHandle>* handle) override;
 
-  // Returns the untyped handle for a servable-id.
-  Status GetUntypedServableHandleForId(
+  // Same as GetUntypedServableHandle(), but without allocating a handle once
+  // the servable is loaded.
+  Status GetPinnedServable(const ServableRequest& request,
+                           PinnedServable* pinned) override;
+
+  // Resolves 'request' to a servable-id as described above, and gets the
+  // servable from 'basic_manager_' by calling 'get' with a request for that
+  // id, after loading it if need be.
+  Status GetServable(const ServableRequest& request,
+                     const std::function<Status(const ServableRequest&)>& get);
+
+  // Same as above, for a servable-id.
+  Status GetServableForId(
       const ServableId& servable_id,
-      std::unique_ptr<UntypedServableHandle>* handle);
+      const std::function<Status(const ServableRequest&)>& get);
 
   // Transfer the given servable to 'basic_manager_', and ask it to load it. For
   // multiple concurrent requests for the same servable-id, enforces that
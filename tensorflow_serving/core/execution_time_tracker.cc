@@ -0,0 +1,113 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_serving/core/execution_time_tracker.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace tensorflow {
+namespace serving {
+namespace {
+
+// The weights of each new sample in the moving averages of the run time and
+// of its deviation, as divisors. RFC 6298 uses the same.
+constexpr int64 kAverageSmoothing = 8;
+constexpr int64 kDeviationSmoothing = 4;
+
+// How many deviations above the average the estimate is.
+constexpr int64 kDeviationMargin = 4;
+
+}  // namespace
+
+constexpr int ExecutionTimeTracker::kChunkSize;
+constexpr int ExecutionTimeTracker::kMaxChunks;
+
+ExecutionTimeTracker::ExecutionTimeTracker() {
+  for (std::atomic<Stats*>& chunk : chunks_) {
+    chunk.store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+ExecutionTimeTracker::~ExecutionTimeTracker() {
+  for (std::atomic<Stats*>& chunk : chunks_) {
+    delete[] chunk.load(std::memory_order_relaxed);
+  }
+}
+
+ExecutionTimeTracker::Stats* ExecutionTimeTracker::GetStats(
+    const int32 name_id, const bool create) const {
+  if (name_id < 0 || name_id / kChunkSize >= kMaxChunks) {
+    return nullptr;
+  }
+  std::atomic<Stats*>& chunk = chunks_[name_id / kChunkSize];
+  Stats* stats = chunk.load(std::memory_order_acquire);
+  if (stats == nullptr) {
+    if (!create) {
+      return nullptr;
+    }
+    Stats* const new_stats = new Stats[kChunkSize];
+    if (chunk.compare_exchange_strong(stats, new_stats,
+                                      std::memory_order_acq_rel)) {
+      stats = new_stats;
+    } else {
+      // Another thread allocated the chunk first; 'stats' now points to it.
+      delete[] new_stats;
+    }
+  }
+  return &stats[name_id % kChunkSize];
+}
+
+void ExecutionTimeTracker::Record(const int32 name_id,
+                                  const int64 execution_micros) {
+  Stats* const stats = GetStats(name_id, true /* create */);
+  if (stats == nullptr) {
+    return;
+  }
+  const int64 average =
+      stats->average_micros.load(std::memory_order_relaxed);
+  if (average == 0) {
+    stats->average_micros.store(std::max<int64>(1, execution_micros),
+                                std::memory_order_relaxed);
+    stats->deviation_micros.store(execution_micros / 2,
+                                  std::memory_order_relaxed);
+    return;
+  }
+  const int64 deviation =
+      stats->deviation_micros.load(std::memory_order_relaxed);
+  stats->deviation_micros.store(
+      deviation +
+          (std::abs(execution_micros - average) - deviation) /
+              kDeviationSmoothing,
+      std::memory_order_relaxed);
+  // Never back to 0, which would mean that there are no samples.
+  stats->average_micros.store(
+      std::max<int64>(
+          1, average + (execution_micros - average) / kAverageSmoothing),
+      std::memory_order_relaxed);
+}
+
+int64 ExecutionTimeTracker::EstimateMicros(const int32 name_id) const {
+  const Stats* const stats = GetStats(name_id, false /* create */);
+  if (stats == nullptr) {
+    return 0;
+  }
+  return stats->average_micros.load(std::memory_order_relaxed) +
+         kDeviationMargin *
+             stats->deviation_micros.load(std::memory_order_relaxed);
+}
+
+}  // namespace serving
+}  // namespace tensorflow
@@ -0,0 +1,81 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_SERVING_CORE_EXECUTION_TIME_TRACKER_H_
+#define TENSORFLOW_SERVING_CORE_EXECUTION_TIME_TRACKER_H_
+
+#include <atomic>
+
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace serving {
+
+// Keeps track of how long running each model's session takes, so that
+// requests whose deadline can't be met are rejected before any work is done
+// on them. Models are identified by the id that the manager's
+// ServableNameTable assigned to their name.
+//
+// For each model, keeps a moving average of the run time and of its absolute
+// deviation from that average, like TCP's retransmission timer does for round
+// trip times (RFC 6298). The estimate is the average plus a multiple of the
+// deviation, so that it approximates a high percentile of the run time rather
+// than its mean: a request is only rejected if it would be late even if its
+// run were among the slow ones.
+//
+// Thread-safe, and lock-free: the statistics of a model are updated without
+// synchronizing concurrent updates, so that one of two racing samples may be
+// lost, which the moving averages shrug off.
+class ExecutionTimeTracker {
+ public:
+  ExecutionTimeTracker();
+  ~ExecutionTimeTracker();
+
+  // Records that a session run of the model with name id 'name_id' took
+  // 'execution_micros'. Ignores negative ids.
+  void Record(int32 name_id, int64 execution_micros);
+
+  // Returns the time a session run of the model with name id 'name_id' is
+  // expected to stay under, in microseconds, or 0 if none has been recorded
+  // yet (or 'name_id' is negative).
+  int64 EstimateMicros(int32 name_id) const;
+
+ private:
+  struct Stats {
+    // Both 0 until the first sample.
+    std::atomic<int64> average_micros{0};
+    std::atomic<int64> deviation_micros{0};
+  };
+
+  // The statistics are kept in chunks that are allocated on first use and
+  // never freed or moved, so that lookups need no lock.
+  static constexpr int kChunkSize = 1024;
+  static constexpr int kMaxChunks = 1024;
+
+  // Returns the statistics of 'name_id', or null if there are none. If
+  // 'create' is true, allocates them if need be, and only returns null for
+  // ids beyond kChunkSize * kMaxChunks.
+  Stats* GetStats(int32 name_id, bool create) const;
+
+  mutable std::atomic<Stats*> chunks_[kMaxChunks];
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ExecutionTimeTracker);
+};
+
+}  // namespace serving
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_SERVING_CORE_EXECUTION_TIME_TRACKER_H_
@@ -0,0 +1,94 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_serving/core/execution_time_tracker.h"
+
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+
+namespace tensorflow {
+namespace serving {
+namespace {
+
+TEST(ExecutionTimeTrackerTest, Basic) {
+  ExecutionTimeTracker tracker;
+  EXPECT_EQ(0, tracker.EstimateMicros(0));
+
+  // The first sample sets the average, and half of it the deviation.
+  tracker.Record(0, 800);
+  EXPECT_EQ(800 + 4 * 400, tracker.EstimateMicros(0));
+  EXPECT_EQ(0, tracker.EstimateMicros(1));
+
+  // Moves towards new samples gradually.
+  tracker.Record(0, 1600);
+  EXPECT_EQ(900 + 4 * 500, tracker.EstimateMicros(0));
+  for (int i = 0; i < 100; ++i) {
+    tracker.Record(0, 1600);
+  }
+  // The deviation has all but vanished.
+  EXPECT_NEAR(1600, tracker.EstimateMicros(0), 50);
+}
+
+TEST(ExecutionTimeTrackerTest, EstimateCoversVariance) {
+  ExecutionTimeTracker tracker;
+  for (int i = 0; i < 100; ++i) {
+    tracker.Record(0, i % 2 == 0 ? 1000 : 2000);
+  }
+  // Above even the slow runs, not around the mean of 1500.
+  EXPECT_GT(tracker.EstimateMicros(0), 2000);
+}
+
+TEST(ExecutionTimeTrackerTest, IgnoresIdsOutOfRange) {
+  ExecutionTimeTracker tracker;
+  tracker.Record(-1, 800);
+  EXPECT_EQ(0, tracker.EstimateMicros(-1));
+  tracker.Record(std::numeric_limits<int32>::max(), 800);
+  EXPECT_EQ(0, tracker.EstimateMicros(std::numeric_limits<int32>::max()));
+
+  // Ids in chunks other than the first work too.
+  tracker.Record(5000, 800);
+  EXPECT_EQ(800 + 4 * 400, tracker.EstimateMicros(5000));
+  EXPECT_EQ(0, tracker.EstimateMicros(5001));
+}
+
+TEST(ExecutionTimeTrackerTest, ConcurrentRecords) {
+  ExecutionTimeTracker tracker;
+  {
+    std::vector<std::unique_ptr<Thread>> threads;
+    for (int t = 0; t < 4; ++t) {
+      threads.emplace_back(Env::Default()->StartThread(
+          {}, strings::StrCat("recorder", t), [&tracker]() {
+            for (int i = 0; i < 10000; ++i) {
+              tracker.Record(i % 2000, 1000);
+              tracker.EstimateMicros(i % 2000);
+            }
+          }));
+    }
+  }
+  // Racing samples may be lost, but every id got some.
+  for (int id = 0; id < 2000; ++id) {
+    EXPECT_GE(tracker.EstimateMicros(id), 1000) << id;
+    EXPECT_LE(tracker.EstimateMicros(id), 3000) << id;
+  }
+}
+
+}  // namespace
+}  // namespace serving
+}  // namespace tensorflow
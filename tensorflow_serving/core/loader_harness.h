@@ -127,7 +127,7 @@ class LoaderHarness final {
   ~LoaderHarness();
 
   /// Returns the identifier of underlying Servable.
-  ServableId id() const { return id_; }
+  const ServableId& id() const { return id_; }
 
   /// Returns the current state of underlying Servable.
   State state() const LOCKS_EXCLUDED(mu_);
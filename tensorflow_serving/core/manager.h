@@ -80,6 +80,15 @@ class Manager {
   Status GetServableHandle(const ServableRequest& request,
                            ServableHandle<T>* const handle);
 
+ protected:
+  // Points '*handle' at the servable in 'pinned', as returned by
+  // GetPinnedServable(). Fails if nothing was pinned, or if the servable isn't
+  // a T. For managers that find servables by other means than a
+  // ServableRequest.
+  template <typename T>
+  static Status HandleFromPinnedServable(PinnedServable pinned,
+                                         ServableHandle<T>* handle);
+
  private:
   friend class ManagerWrapper;
 
@@ -94,6 +103,14 @@ class Manager {
   // UntypedServableHandles.
   virtual std::map<ServableId, std::unique_ptr<UntypedServableHandle>>
   GetAvailableUntypedServableHandles() const = 0;
+
+  // Same as GetUntypedServableHandle(), but returns the parts of the handle
+  // rather than a heap-allocated UntypedServableHandle. This is what
+  // GetServableHandle() calls; managers override it to hand out handles
+  // without allocating. The default implementation pins the handle returned by
+  // GetUntypedServableHandle().
+  virtual Status GetPinnedServable(const ServableRequest& request,
+                                   PinnedServable* pinned);
 };
 
 //
@@ -122,15 +139,33 @@ inline string ServableRequest::DebugString() const {
   }
 }
 
+inline Status Manager::GetPinnedServable(const ServableRequest& request,
+                                         PinnedServable* const pinned) {
+  std::unique_ptr<UntypedServableHandle> untyped_handle;
+  TF_RETURN_IF_ERROR(GetUntypedServableHandle(request, &untyped_handle));
+  if (untyped_handle != nullptr) {
+    pinned->id = &untyped_handle->id();
+    pinned->servable = untyped_handle->servable();
+    pinned->pin = std::move(untyped_handle);
+  }
+  return Status::OK();
+}
+
 template <typename T>
 Status Manager::GetServableHandle(const ServableRequest& request,
                                   ServableHandle<T>* const handle) {
-  std::unique_ptr<UntypedServableHandle> untyped_handle;
-  TF_RETURN_IF_ERROR(GetUntypedServableHandle(request, &untyped_handle));
-  if (untyped_handle == nullptr) {
+  PinnedServable pinned;
+  TF_RETURN_IF_ERROR(GetPinnedServable(request, &pinned));
+  return HandleFromPinnedServable(std::move(pinned), handle);
+}
+
+template <typename T>
+Status Manager::HandleFromPinnedServable(PinnedServable pinned,
+                                         ServableHandle<T>* const handle) {
+  if (pinned.id == nullptr) {
     return errors::Internal("Manager returned a null handle with OK status.");
   }
-  *handle = ServableHandle<T>(std::move(untyped_handle));
+  *handle = ServableHandle<T>(std::move(pinned));
   if (handle->get() == nullptr) {
     return errors::InvalidArgument(
         "Servable type doesn't match the asked for type.");
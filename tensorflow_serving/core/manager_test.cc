@@ -15,6 +15,8 @@ limitations under the License.
 
 #include "tensorflow_serving/core/manager.h"
 
+#include <memory>
+
 #include <gtest/gtest.h>
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow_serving/core/test_util/servable_handle_test_util.h"
@@ -133,6 +135,41 @@ TEST(ManagerTest, ErrorReturnsNullHandle) {
   EXPECT_EQ(nullptr, handle.get());
 }
 
+// A manager that hands out handles by pinning a servable it shares with them.
+class PinningManager : public TestManager {
+ public:
+  std::weak_ptr<const void> pin() const { return servable_; }
+
+ private:
+  Status GetPinnedServable(const ServableRequest& request,
+                           PinnedServable* pinned) override {
+    pinned->id = &id_;
+    pinned->servable = servable_.get();
+    pinned->pin = servable_;
+    return Status::OK();
+  }
+
+  const ServableId id_ = {"pinned", 3};
+  const std::shared_ptr<TestServable> servable_{new TestServable};
+};
+
+TEST(ManagerTest, PinnedServable) {
+  PinningManager manager;
+  {
+    ServableHandle<TestServable> handle;
+    ASSERT_TRUE(manager.GetServableHandle({"Foo", 2}, &handle).ok());
+    EXPECT_EQ((ServableId{"pinned", 3}), handle.id());
+    EXPECT_EQ(7, handle->member);
+    // Held by the manager and the handle.
+    EXPECT_EQ(2, manager.pin().use_count());
+  }
+  EXPECT_EQ(1, manager.pin().use_count());
+
+  ServableHandle<int> handle;
+  EXPECT_FALSE(manager.GetServableHandle({"Foo", 2}, &handle).ok());
+  EXPECT_EQ(nullptr, handle.get());
+}
+
 TEST(ServableHandleTest, PointerOps) {
   TestServable servables[2];
   ServableHandle<TestServable> handles[2];
@@ -36,5 +36,10 @@ ManagerWrapper::GetAvailableUntypedServableHandles() const {
   return wrapped_->GetAvailableUntypedServableHandles();
 }
 
+Status ManagerWrapper::GetPinnedServable(const ServableRequest& request,
+                                         PinnedServable* const pinned) {
+  return wrapped_->GetPinnedServable(request, pinned);
+}
+
 }  // namespace serving
 }  // namespace tensorflow
@@ -46,6 +46,9 @@ class ManagerWrapper : public Manager {
   std::map<ServableId, std::unique_ptr<UntypedServableHandle>>
   GetAvailableUntypedServableHandles() const override;
 
+  Status GetPinnedServable(const ServableRequest& request,
+                           PinnedServable* pinned) override;
+
   const UniquePtrWithDeps<Manager> wrapped_;
 };
 
@@ -0,0 +1,264 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_serving/core/response_cache.h"
+
+#include <utility>
+
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/monitoring/counter.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow_serving/util/hash.h"
+
+namespace tensorflow {
+namespace serving {
+namespace {
+
+constexpr int kDefaultNumShards = 16;
+
+auto* response_cache_hit_count = monitoring::Counter<1>::New(
+    "/tensorflow/serving/response_cache/hit_count",
+    "The number of requests served from the response cache, by model.",
+    "model_name");
+
+auto* response_cache_miss_count = monitoring::Counter<1>::New(
+    "/tensorflow/serving/response_cache/miss_count",
+    "The number of requests not found in the response cache, by model.",
+    "model_name");
+
+auto* response_cache_eviction_count = monitoring::Counter<1>::New(
+    "/tensorflow/serving/response_cache/eviction_count",
+    "The number of responses evicted from the response cache to make room "
+    "for others, by model.",
+    "model_name");
+
+}  // namespace
+
+// static
+Status ResponseCache::Create(const string& model_name,
+                             const ResponseCacheConfig& config,
+                             std::unique_ptr<ResponseCache>* cache) {
+  if (config.max_bytes() == 0) {
+    return errors::InvalidArgument(
+        "ResponseCacheConfig.max_bytes must be > 0 for model ", model_name);
+  }
+  if (config.num_shards() > config.max_bytes()) {
+    return errors::InvalidArgument(
+        "ResponseCacheConfig.num_shards must not exceed max_bytes for model ",
+        model_name);
+  }
+  cache->reset(new ResponseCache(model_name, config));
+  return Status::OK();
+}
+
+ResponseCache::ResponseCache(const string& model_name,
+                             const ResponseCacheConfig& config)
+    : model_name_(model_name),
+      config_(config),
+      max_bytes_per_shard_(
+          config.max_bytes() /
+          (config.num_shards() > 0 ? config.num_shards() : kDefaultNumShards)) {
+  const int num_shards =
+      config.num_shards() > 0 ? config.num_shards() : kDefaultNumShards;
+  for (int i = 0; i < num_shards; ++i) {
+    shards_.emplace_back(new Shard);
+  }
+}
+
+// static
+uint64 ResponseCache::Fingerprint(const StringPiece method,
+                                  const google::protobuf::Message& request) {
+  string serialized_request;
+  {
+    google::protobuf::io::StringOutputStream output_stream(&serialized_request);
+    google::protobuf::io::CodedOutputStream coded_stream(&output_stream);
+    // Orders map entries by key.
+    coded_stream.SetSerializationDeterministic(true);
+    request.ByteSizeLong();
+    request.SerializeWithCachedSizes(&coded_stream);
+  }
+  return FingerprintCat64(Fingerprint64(method),
+                          Fingerprint64(serialized_request));
+}
+
+uint64 ResponseCache::HashKey::operator()(const Key& key) const {
+  return HashCombine(key.fingerprint, HashServableId()(key.servable_id));
+}
+
+ResponseCache::Shard* ResponseCache::GetShard(const Key& key) {
+  // The low bits pick the bucket within the shard's index, so use the high
+  // bits to pick the shard.
+  return shards_[(HashKey()(key) >> 32) % shards_.size()].get();
+}
+
+// static
+int64 ResponseCache::EntryBytes(const Entry& entry) {
+  return sizeof(Entry) + entry.key.servable_id.name.size() +
+         entry.serialized_response->size();
+}
+
+// static
+void ResponseCache::EraseLocked(const std::list<Entry>::iterator iter,
+                                Shard* const shard) {
+  shard->bytes -= EntryBytes(*iter);
+  shard->index.erase(iter->key);
+  shard->entries.erase(iter);
+}
+
+bool ResponseCache::Lookup(const ServableId& servable_id,
+                           const uint64 fingerprint,
+                           google::protobuf::Message* const response) {
+  const Key key = {servable_id, fingerprint};
+  Shard* const shard = GetShard(key);
+  std::shared_ptr<const string> serialized_response;
+  {
+    mutex_lock l(shard->mu);
+    auto found = shard->index.find(key);
+    if (found == shard->index.end()) {
+      ++shard->misses;
+    } else {
+      // Move to the front of the LRU list.
+      shard->entries.splice(shard->entries.begin(), shard->entries,
+                            found->second);
+      serialized_response = found->second->serialized_response;
+      ++shard->hits;
+    }
+  }
+  if (serialized_response == nullptr) {
+    response_cache_miss_count->GetCell(model_name_)->IncrementBy(1);
+    return false;
+  }
+  // Parse outside the lock; the entry may be evicted meanwhile, but
+  // 'serialized_response' keeps its bytes alive.
+  if (!response->ParseFromString(*serialized_response)) {
+    LOG(ERROR) << "Failed to parse a cached response of "
+               << servable_id.DebugString();
+    response->Clear();
+    return false;
+  }
+  response_cache_hit_count->GetCell(model_name_)->IncrementBy(1);
+  return true;
+}
+
+void ResponseCache::Insert(const ServableId& servable_id,
+                           const uint64 fingerprint,
+                           const google::protobuf::Message& response) {
+  // Serialize outside the lock.
+  std::shared_ptr<string> serialized_response(new string);
+  if (!response.SerializeToString(serialized_response.get())) {
+    return;
+  }
+  Entry entry = {{servable_id, fingerprint}, std::move(serialized_response)};
+  const int64 entry_bytes = EntryBytes(entry);
+  if (entry_bytes > max_bytes_per_shard_) {
+    return;
+  }
+
+  Shard* const shard = GetShard(entry.key);
+  int64 num_evicted = 0;
+  {
+    mutex_lock l(shard->mu);
+    auto found = shard->index.find(entry.key);
+    if (found != shard->index.end()) {
+      // Another request computed the same response concurrently.
+      EraseLocked(found->second, shard);
+    }
+    while (shard->bytes + entry_bytes > max_bytes_per_shard_) {
+      EraseLocked(std::prev(shard->entries.end()), shard);
+      ++num_evicted;
+    }
+    shard->evictions += num_evicted;
+    shard->bytes += entry_bytes;
+    shard->entries.push_front(std::move(entry));
+    shard->index.emplace(shard->entries.front().key, shard->entries.begin());
+  }
+  if (num_evicted > 0) {
+    response_cache_eviction_count->GetCell(model_name_)->IncrementBy(
+        num_evicted);
+  }
+}
+
+void ResponseCache::EraseServable(const ServableId& servable_id) {
+  for (const auto& shard : shards_) {
+    mutex_lock l(shard->mu);
+    for (auto iter = shard->entries.begin(); iter != shard->entries.end();) {
+      auto next = std::next(iter);
+      if (iter->key.servable_id == servable_id) {
+        EraseLocked(iter, shard.get());
+      }
+      iter = next;
+    }
+  }
+}
+
+ResponseCache::Stats ResponseCache::GetStats() const {
+  Stats stats;
+  for (const auto& shard : shards_) {
+    mutex_lock l(shard->mu);
+    stats.hits += shard->hits;
+    stats.misses += shard->misses;
+    stats.evictions += shard->evictions;
+    stats.num_entries += shard->entries.size();
+    stats.bytes += shard->bytes;
+  }
+  return stats;
+}
+
+Status LookupOrComputeResponse(ResponseCache* const cache,
+                               const ServableId& servable_id,
+                               const StringPiece method,
+                               const google::protobuf::Message& request,
+                               google::protobuf::Message* const response,
+                               const std::function<Status()>& compute) {
+  if (cache == nullptr) {
+    return compute();
+  }
+  const uint64 fingerprint = ResponseCache::Fingerprint(method, request);
+  if (cache->Lookup(servable_id, fingerprint, response)) {
+    return Status::OK();
+  }
+  TF_RETURN_IF_ERROR(compute());
+  cache->Insert(servable_id, fingerprint, *response);
+  return Status::OK();
+}
+
+void LookupOrComputeResponseAsync(
+    std::shared_ptr<ResponseCache> cache, const ServableId& servable_id,
+    const StringPiece method, const google::protobuf::Message& request,
+    google::protobuf::Message* const response,
+    const std::function<void(std::function<void(const Status&)>)>& compute,
+    std::function<void(const Status&)> done) {
+  if (cache == nullptr) {
+    compute(std::move(done));
+    return;
+  }
+  const uint64 fingerprint = ResponseCache::Fingerprint(method, request);
+  if (cache->Lookup(servable_id, fingerprint, response)) {
+    done(Status::OK());
+    return;
+  }
+  compute([cache, servable_id, fingerprint, response,
+           done](const Status& status) {
+    if (status.ok()) {
+      cache->Insert(servable_id, fingerprint, *response);
+    }
+    done(status);
+  });
+}
+
+}  // namespace serving
+}  // namespace tensorflow
@@ -0,0 +1,165 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_SERVING_CORE_RESPONSE_CACHE_H_
+#define TENSORFLOW_SERVING_CORE_RESPONSE_CACHE_H_
+
+#include <functional>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "google/protobuf/message.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow_serving/config/response_cache_config.pb.h"
+#include "tensorflow_serving/core/servable_id.h"
+
+namespace tensorflow {
+namespace serving {
+
+// A size-bounded cache of the responses of one model, keyed by the ServableId
+// of the version that computed a response and a fingerprint of the request.
+//
+// The cache is split into shards, each with its own lock and LRU list, so that
+// concurrent requests rarely contend. Responses are stored serialized, which
+// makes their size easy to account for and lets a hit be parsed straight into
+// the caller's (possibly arena-allocated) response.
+//
+// Hits, misses and evictions are exported as monitoring counters labelled with
+// the model name, and are also available per cache via GetStats().
+//
+// Thread-safe.
+class ResponseCache {
+ public:
+  struct Stats {
+    int64 hits = 0;
+    int64 misses = 0;
+    int64 evictions = 0;
+    int64 num_entries = 0;
+    int64 bytes = 0;
+  };
+
+  // Creates a cache for the responses of 'model_name'.
+  static Status Create(const string& model_name,
+                       const ResponseCacheConfig& config,
+                       std::unique_ptr<ResponseCache>* cache);
+
+  ~ResponseCache() = default;
+
+  // Returns a fingerprint of 'request' to be sent to 'method' (e.g.
+  // "Predict"). Map fields are serialized in a canonical order, so requests
+  // that are equal compare equal regardless of how they were built.
+  static uint64 Fingerprint(StringPiece method,
+                            const google::protobuf::Message& request);
+
+  // Looks up the response to the request with 'fingerprint' computed by
+  // 'servable_id'. On a hit, parses it into 'response' and returns true.
+  bool Lookup(const ServableId& servable_id, uint64 fingerprint,
+              google::protobuf::Message* response);
+
+  // Caches 'response' as the response to the request with 'fingerprint'
+  // computed by 'servable_id', evicting the least recently used responses of
+  // the shard as needed. Responses larger than a shard are not cached.
+  void Insert(const ServableId& servable_id, uint64 fingerprint,
+              const google::protobuf::Message& response);
+
+  // Drops all responses computed by 'servable_id', e.g. once it is unloaded.
+  void EraseServable(const ServableId& servable_id);
+
+  Stats GetStats() const;
+
+  const ResponseCacheConfig& config() const { return config_; }
+
+ private:
+  struct Key {
+    ServableId servable_id;
+    uint64 fingerprint;
+  };
+  struct HashKey {
+    uint64 operator()(const Key& key) const;
+  };
+  struct EqKey {
+    bool operator()(const Key& a, const Key& b) const {
+      return a.fingerprint == b.fingerprint && a.servable_id == b.servable_id;
+    }
+  };
+
+  struct Entry {
+    Key key;
+    // Shared with in-progress lookups, which parse it outside the lock.
+    std::shared_ptr<const string> serialized_response;
+  };
+
+  struct Shard {
+    mutable mutex mu;
+    // Most recently used first.
+    std::list<Entry> entries GUARDED_BY(mu);
+    std::unordered_map<Key, std::list<Entry>::iterator, HashKey, EqKey> index
+        GUARDED_BY(mu);
+    int64 bytes GUARDED_BY(mu) = 0;
+    int64 hits GUARDED_BY(mu) = 0;
+    int64 misses GUARDED_BY(mu) = 0;
+    int64 evictions GUARDED_BY(mu) = 0;
+  };
+
+  ResponseCache(const string& model_name, const ResponseCacheConfig& config);
+
+  Shard* GetShard(const Key& key);
+
+  // The size charged to the cache for 'entry'.
+  static int64 EntryBytes(const Entry& entry);
+
+  // Removes 'iter' from 'shard'.
+  static void EraseLocked(std::list<Entry>::iterator iter, Shard* shard)
+      EXCLUSIVE_LOCKS_REQUIRED(shard->mu);
+
+  const string model_name_;
+  const ResponseCacheConfig config_;
+  const int64 max_bytes_per_shard_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ResponseCache);
+};
+
+// Serves 'request' to 'method' from 'cache', or runs 'compute' to fill in
+// 'response' and caches the result if it succeeded. 'servable_id' identifies
+// the version 'compute' runs against. If 'cache' is null, just runs 'compute'.
+Status LookupOrComputeResponse(ResponseCache* cache,
+                               const ServableId& servable_id,
+                               StringPiece method,
+                               const google::protobuf::Message& request,
+                               google::protobuf::Message* response,
+                               const std::function<Status()>& compute);
+
+// Like LookupOrComputeResponse(), for a 'compute' that may finish on another
+// thread, by calling the callback it is passed. Calls 'done' with the outcome.
+// 'request' and 'response' must stay alive until then; 'cache' is kept alive.
+void LookupOrComputeResponseAsync(
+    std::shared_ptr<ResponseCache> cache, const ServableId& servable_id,
+    StringPiece method, const google::protobuf::Message& request,
+    google::protobuf::Message* response,
+    const std::function<void(std::function<void(const Status&)>)>& compute,
+    std::function<void(const Status&)> done);
+
+}  // namespace serving
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_SERVING_CORE_RESPONSE_CACHE_H_
@@ -0,0 +1,244 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_serving/core/response_cache.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow_serving/apis/predict.pb.h"
+#include "tensorflow_serving/test_util/test_util.h"
+
+namespace tensorflow {
+namespace serving {
+namespace {
+
+using test_util::EqualsProto;
+
+PredictRequest CreateRequest(const string& input_name, const float value) {
+  PredictRequest request;
+  request.mutable_model_spec()->set_name("model");
+  TensorProto& tensor = (*request.mutable_inputs())[input_name];
+  tensor.set_dtype(DT_FLOAT);
+  tensor.add_float_val(value);
+  return request;
+}
+
+PredictResponse CreateResponse(const float value) {
+  PredictResponse response;
+  TensorProto& tensor = (*response.mutable_outputs())["output"];
+  tensor.set_dtype(DT_FLOAT);
+  tensor.add_float_val(value);
+  return response;
+}
+
+std::unique_ptr<ResponseCache> CreateCache(const uint64 max_bytes,
+                                           const int num_shards) {
+  ResponseCacheConfig config;
+  config.set_max_bytes(max_bytes);
+  config.set_num_shards(num_shards);
+  std::unique_ptr<ResponseCache> cache;
+  TF_CHECK_OK(ResponseCache::Create("model", config, &cache));
+  return cache;
+}
+
+TEST(ResponseCacheTest, CreateValidatesConfig) {
+  std::unique_ptr<ResponseCache> cache;
+  EXPECT_FALSE(
+      ResponseCache::Create("model", ResponseCacheConfig(), &cache).ok());
+
+  ResponseCacheConfig config;
+  config.set_max_bytes(4);
+  config.set_num_shards(8);
+  EXPECT_FALSE(ResponseCache::Create("model", config, &cache).ok());
+
+  config.set_num_shards(0);
+  TF_EXPECT_OK(ResponseCache::Create("model", config, &cache));
+}
+
+TEST(ResponseCacheTest, Fingerprint) {
+  PredictRequest request_a = CreateRequest("a", 1);
+  (*request_a.mutable_inputs())["b"] = request_a.inputs().at("a");
+  PredictRequest request_b = CreateRequest("b", 1);
+  (*request_b.mutable_inputs())["a"] = request_b.inputs().at("b");
+  // Same contents, built in a different order.
+  EXPECT_EQ(ResponseCache::Fingerprint("Predict", request_a),
+            ResponseCache::Fingerprint("Predict", request_b));
+
+  EXPECT_NE(ResponseCache::Fingerprint("Predict", request_a),
+            ResponseCache::Fingerprint("Classify", request_a));
+  EXPECT_NE(ResponseCache::Fingerprint("Predict", CreateRequest("a", 1)),
+            ResponseCache::Fingerprint("Predict", CreateRequest("a", 2)));
+}
+
+TEST(ResponseCacheTest, LookupAndInsert) {
+  auto cache = CreateCache(1 << 20, 4);
+  const ServableId id = {"model", 1};
+  const uint64 fingerprint =
+      ResponseCache::Fingerprint("Predict", CreateRequest("a", 1));
+
+  PredictResponse response;
+  EXPECT_FALSE(cache->Lookup(id, fingerprint, &response));
+  cache->Insert(id, fingerprint, CreateResponse(42));
+  ASSERT_TRUE(cache->Lookup(id, fingerprint, &response));
+  EXPECT_THAT(response, EqualsProto(CreateResponse(42)));
+
+  // Responses are keyed by version as well.
+  EXPECT_FALSE(cache->Lookup({"model", 2}, fingerprint, &response));
+
+  const ResponseCache::Stats stats = cache->GetStats();
+  EXPECT_EQ(1, stats.hits);
+  EXPECT_EQ(2, stats.misses);
+  EXPECT_EQ(0, stats.evictions);
+  EXPECT_EQ(1, stats.num_entries);
+  EXPECT_GT(stats.bytes, 0);
+}
+
+TEST(ResponseCacheTest, EvictsLeastRecentlyUsed) {
+  const ServableId id = {"model", 1};
+  const PredictResponse response = CreateResponse(42);
+  // Measure the size of one entry using a large cache.
+  int64 entry_bytes;
+  {
+    auto cache = CreateCache(1 << 20, 1);
+    cache->Insert(id, 0, response);
+    entry_bytes = cache->GetStats().bytes;
+  }
+
+  // A single shard with room for two entries.
+  auto cache = CreateCache(2 * entry_bytes, 1);
+  cache->Insert(id, 0, response);
+  cache->Insert(id, 1, response);
+  PredictResponse actual;
+  // Makes 1 the least recently used entry.
+  ASSERT_TRUE(cache->Lookup(id, 0, &actual));
+  cache->Insert(id, 2, response);
+
+  EXPECT_TRUE(cache->Lookup(id, 0, &actual));
+  EXPECT_FALSE(cache->Lookup(id, 1, &actual));
+  EXPECT_TRUE(cache->Lookup(id, 2, &actual));
+  const ResponseCache::Stats stats = cache->GetStats();
+  EXPECT_EQ(1, stats.evictions);
+  EXPECT_EQ(2, stats.num_entries);
+  EXPECT_EQ(2 * entry_bytes, stats.bytes);
+}
+
+TEST(ResponseCacheTest, DoesNotCacheOversizedResponses) {
+  auto cache = CreateCache(64, 1);
+  PredictResponse response = CreateResponse(42);
+  (*response.mutable_outputs())["output"].mutable_float_val()->Resize(1024, 0);
+  cache->Insert({"model", 1}, 0, response);
+  EXPECT_EQ(0, cache->GetStats().num_entries);
+}
+
+TEST(ResponseCacheTest, EraseServable) {
+  auto cache = CreateCache(1 << 20, 4);
+  for (uint64 fingerprint = 0; fingerprint < 10; ++fingerprint) {
+    cache->Insert({"model", 1}, fingerprint, CreateResponse(1));
+    cache->Insert({"model", 2}, fingerprint, CreateResponse(2));
+  }
+  EXPECT_EQ(20, cache->GetStats().num_entries);
+
+  cache->EraseServable({"model", 1});
+  EXPECT_EQ(10, cache->GetStats().num_entries);
+  PredictResponse response;
+  for (uint64 fingerprint = 0; fingerprint < 10; ++fingerprint) {
+    EXPECT_FALSE(cache->Lookup({"model", 1}, fingerprint, &response));
+    EXPECT_TRUE(cache->Lookup({"model", 2}, fingerprint, &response));
+  }
+}
+
+TEST(ResponseCacheTest, LookupOrComputeResponse) {
+  auto cache = CreateCache(1 << 20, 4);
+  const ServableId id = {"model", 1};
+  const PredictRequest request = CreateRequest("a", 1);
+  int num_computes = 0;
+  auto compute = [&](PredictResponse* response) {
+    ++num_computes;
+    *response = CreateResponse(42);
+    return Status::OK();
+  };
+
+  for (int i = 0; i < 2; ++i) {
+    PredictResponse response;
+    TF_ASSERT_OK(LookupOrComputeResponse(
+        cache.get(), id, "Predict", request, &response,
+        [&]() { return compute(&response); }));
+    EXPECT_THAT(response, EqualsProto(CreateResponse(42)));
+  }
+  EXPECT_EQ(1, num_computes);
+
+  // Failures are not cached.
+  const PredictRequest other_request = CreateRequest("a", 2);
+  for (int i = 0; i < 2; ++i) {
+    PredictResponse response;
+    EXPECT_FALSE(LookupOrComputeResponse(
+                     cache.get(), id, "Predict", other_request, &response,
+                     [&]() {
+                       ++num_computes;
+                       return errors::Internal("failed");
+                     })
+                     .ok());
+  }
+  EXPECT_EQ(3, num_computes);
+
+  // Without a cache, always computes.
+  PredictResponse response;
+  TF_ASSERT_OK(LookupOrComputeResponse(nullptr, id, "Predict", request,
+                                       &response,
+                                       [&]() { return compute(&response); }));
+  EXPECT_EQ(4, num_computes);
+}
+
+TEST(ResponseCacheTest, LookupOrComputeResponseAsync) {
+  std::shared_ptr<ResponseCache> cache = CreateCache(1 << 20, 4);
+  const ServableId id = {"model", 1};
+  const PredictRequest request = CreateRequest("a", 1);
+
+  // The computation finishes after LookupOrComputeResponseAsync() returns, as
+  // it would on a batch thread.
+  PredictResponse response;
+  std::function<void(const Status&)> compute_done;
+  Status status = errors::Unknown("not done");
+  LookupOrComputeResponseAsync(
+      cache, id, "Predict", request, &response,
+      [&](std::function<void(const Status&)> done) {
+        compute_done = std::move(done);
+      },
+      [&](const Status& done_status) { status = done_status; });
+  ASSERT_NE(nullptr, compute_done);
+  EXPECT_EQ(error::UNKNOWN, status.code());
+  response = CreateResponse(42);
+  compute_done(Status::OK());
+  TF_ASSERT_OK(status);
+
+  // The response was cached once it was computed.
+  PredictResponse cached_response;
+  status = errors::Unknown("not done");
+  LookupOrComputeResponseAsync(
+      cache, id, "Predict", request, &cached_response,
+      [&](std::function<void(const Status&)> done) {
+        ADD_FAILURE() << "Response not cached";
+        done(errors::Internal("failed"));
+      },
+      [&](const Status& done_status) { status = done_status; });
+  TF_ASSERT_OK(status);
+  EXPECT_THAT(cached_response, EqualsProto(CreateResponse(42)));
+}
+
+}  // namespace
+}  // namespace serving
+}  // namespace tensorflow
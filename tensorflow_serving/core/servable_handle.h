@@ -41,6 +41,21 @@ class UntypedServableHandle {
   virtual AnyPtr servable() = 0;
 };
 
+/// The parts of a handle to a servable, as handed out internally by Managers
+/// that can do so without a heap allocation per handle: the servable's id and
+/// object, and a reference that keeps both alive, e.g. on the generation of
+/// the manager's serving map they were found in. Like UntypedServableHandle,
+/// it should not be held onto for a long time.
+struct PinnedServable {
+  /// Keeps '*id' and 'servable' alive.
+  std::shared_ptr<const void> pin;
+
+  /// Null iff nothing was found.
+  const ServableId* id = nullptr;
+
+  AnyPtr servable;
+};
+
 /// A smart pointer to the underlying servable object T retrieved from the
 /// Loader. Frontend code gets these handles from the ServableManager. The
 /// handle keeps the underlying object alive as long as the handle is alive. The
@@ -81,7 +96,7 @@ class ServableHandle {
   /// ServableHandle is null by default.
   ServableHandle() = default;
 
-  const ServableId& id() const { return untyped_handle_->id(); }
+  const ServableId& id() const { return *id_; }
 
   // Smart pointer operations.
 
@@ -99,13 +114,24 @@ class ServableHandle {
  private:
   friend class Manager;
 
+  explicit ServableHandle(PinnedServable pinned)
+      : pin_(std::move(pinned.pin)),
+        id_(pinned.id),
+        servable_(pinned.servable.get<T>()) {}
+
   explicit ServableHandle(std::unique_ptr<UntypedServableHandle> untyped_handle)
-      : untyped_handle_(std::move(untyped_handle)),
-        servable_(untyped_handle_ == nullptr
+      : id_(untyped_handle == nullptr ? nullptr : &untyped_handle->id()),
+        servable_(untyped_handle == nullptr
                       ? nullptr
-                      : untyped_handle_->servable().get<T>()) {}
-
-  std::unique_ptr<UntypedServableHandle> untyped_handle_;
+                      : untyped_handle->servable().get<T>()) {
+    pin_ = std::move(untyped_handle);
+  }
+
+  // Keeps '*id_' and '*servable_' alive. Handles handed out by the managers in
+  // this library pin the serving map they were found in, so that acquiring a
+  // handle doesn't allocate.
+  std::shared_ptr<const void> pin_;
+  const ServableId* id_ = nullptr;
   T* servable_ = nullptr;
 };
 
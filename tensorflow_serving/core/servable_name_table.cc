@@ -0,0 +1,124 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_serving/core/servable_name_table.h"
+
+#include "tensorflow/core/lib/hash/hash.h"
+
+namespace tensorflow {
+namespace serving {
+
+namespace {
+
+// The number of slots of an empty table.
+constexpr size_t kInitialCapacity = 16;
+
+}  // namespace
+
+ServableNameTable::Slots::Slots(const size_t capacity)
+    : mask(capacity - 1), entries(new std::atomic<const Entry*>[capacity]) {
+  for (size_t i = 0; i < capacity; ++i) {
+    entries[i].store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+ServableNameTable::ServableNameTable() {
+  all_slots_.emplace_back(new Slots(kInitialCapacity));
+  slots_.store(all_slots_.back().get(), std::memory_order_release);
+}
+
+ServableNameTable::~ServableNameTable() = default;
+
+// static
+const ServableNameTable::Entry* ServableNameTable::Lookup(
+    const Slots& slots, const StringPiece name, const uint64 hash) {
+  for (size_t i = hash & slots.mask;; i = (i + 1) & slots.mask) {
+    const Entry* const entry =
+        slots.entries[i].load(std::memory_order_acquire);
+    if (entry == nullptr) {
+      return nullptr;
+    }
+    if (entry->hash == hash && entry->name == name) {
+      return entry;
+    }
+  }
+}
+
+// static
+void ServableNameTable::Insert(const Entry* const entry, Slots* const slots) {
+  size_t i = entry->hash & slots->mask;
+  while (slots->entries[i].load(std::memory_order_relaxed) != nullptr) {
+    i = (i + 1) & slots->mask;
+  }
+  slots->entries[i].store(entry, std::memory_order_release);
+}
+
+int32 ServableNameTable::Intern(const StringPiece name) {
+  int32 id;
+  if (Find(name, &id)) {
+    return id;
+  }
+
+  mutex_lock l(intern_mu_);
+  const uint64 hash = Hash64(name.data(), name.size());
+  // Another thread may have interned 'name' meanwhile.
+  const Entry* const existing = Lookup(*all_slots_.back(), name, hash);
+  if (existing != nullptr) {
+    return existing->id;
+  }
+
+  Slots* slots = all_slots_.back().get();
+  if (2 * (entries_.size() + 1) > slots->mask + 1) {
+    // Grow. The new slots are filled before they are published, and the old
+    // ones stay valid for the lookups still probing them.
+    all_slots_.emplace_back(new Slots(2 * (slots->mask + 1)));
+    slots = all_slots_.back().get();
+    for (const std::unique_ptr<const Entry>& entry : entries_) {
+      Insert(entry.get(), slots);
+    }
+    slots_.store(slots, std::memory_order_release);
+  }
+
+  std::unique_ptr<Entry> entry(new Entry);
+  entry->name = name.ToString();
+  entry->hash = hash;
+  entry->id = entries_.size();
+  id = entry->id;
+  Insert(entry.get(), slots);
+  entries_.push_back(std::move(entry));
+  return id;
+}
+
+bool ServableNameTable::Find(const StringPiece name, int32* const id) const {
+  const Entry* const entry =
+      Lookup(*slots_.load(std::memory_order_acquire), name,
+             Hash64(name.data(), name.size()));
+  if (entry == nullptr) {
+    return false;
+  }
+  *id = entry->id;
+  return true;
+}
+
+string ServableNameTable::Name(const int32 id) const {
+  mutex_lock l(intern_mu_);
+  if (id < 0 || static_cast<size_t>(id) >= entries_.size()) {
+    return "";
+  }
+  return entries_[id]->name;
+}
+
+}  // namespace serving
+}  // namespace tensorflow
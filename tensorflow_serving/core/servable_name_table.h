@@ -0,0 +1,109 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_SERVING_CORE_SERVABLE_NAME_TABLE_H_
+#define TENSORFLOW_SERVING_CORE_SERVABLE_NAME_TABLE_H_
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace serving {
+
+// Interns servable names: maps each name to a small integer id, assigned
+// densely from 0 in the order names are first seen and never reused. Lets the
+// serving path resolve a name once and then look servables up by id, rather
+// than hashing and comparing the name at every step. Each BasicManager owns a
+// table and indexes its serving map by its ids.
+//
+// The table is append-only: names are never removed, and interning one takes
+// amortized constant time, so registering N names takes O(N).
+//
+// Thread-safe. Lookups take no locks and write no shared memory, so they don't
+// block on, or contend with, each other or with Intern().
+class ServableNameTable {
+ public:
+  ServableNameTable();
+  ~ServableNameTable();
+
+  // Returns the id of 'name', assigning it the next unused id first if 'name'
+  // hasn't been interned yet.
+  int32 Intern(StringPiece name) LOCKS_EXCLUDED(intern_mu_);
+
+  // Sets '*id' to the id of 'name' and returns true, or returns false if
+  // 'name' has never been interned. Doesn't allocate.
+  bool Find(StringPiece name, int32* id) const;
+
+  // Returns the name with id 'id', or the empty string if there is none. Meant
+  // for error messages; takes a lock.
+  string Name(int32 id) const LOCKS_EXCLUDED(intern_mu_);
+
+ private:
+  // An interned name. Immutable once added to the slots.
+  struct Entry {
+    string name;
+    uint64 hash;
+    int32 id;
+  };
+
+  // An open-addressing hash table of entries, with linear probing. Slots are
+  // only ever filled, never cleared or overwritten, so readers can probe them
+  // while Intern() fills a free one.
+  struct Slots {
+    explicit Slots(size_t capacity);
+
+    // The capacity, a power of two, minus one.
+    const size_t mask;
+    std::unique_ptr<std::atomic<const Entry*>[]> entries;
+  };
+
+  // Returns the entry of 'name' in 'slots', or null if there is none.
+  static const Entry* Lookup(const Slots& slots, StringPiece name,
+                             uint64 hash);
+
+  // Puts 'entry' in the first free slot of its probe sequence in 'slots',
+  // which must have one.
+  static void Insert(const Entry* entry, Slots* slots);
+
+  // Serializes Intern() calls that add names.
+  mutable mutex intern_mu_;
+
+  // The interned names, by id.
+  std::vector<std::unique_ptr<const Entry>> entries_ GUARDED_BY(intern_mu_);
+
+  // The slots that lookups probe. Replaced by a copy twice the size whenever
+  // they get half full.
+  std::atomic<const Slots*> slots_;
+
+  // All the slots 'slots_' has pointed to, the current ones last. The earlier
+  // ones are kept because lookups may still be probing them. Since each is half
+  // the size of the next, together they take less memory than the current one.
+  std::vector<std::unique_ptr<Slots>> all_slots_ GUARDED_BY(intern_mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ServableNameTable);
+};
+
+}  // namespace serving
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_SERVING_CORE_SERVABLE_NAME_TABLE_H_
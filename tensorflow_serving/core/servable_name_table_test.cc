@@ -0,0 +1,98 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_serving/core/servable_name_table.h"
+
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+
+namespace tensorflow {
+namespace serving {
+namespace {
+
+TEST(ServableNameTableTest, InternAndFind) {
+  ServableNameTable table;
+  int32 id;
+  EXPECT_FALSE(table.Find("foo", &id));
+
+  EXPECT_EQ(0, table.Intern("foo"));
+  EXPECT_EQ(1, table.Intern("bar"));
+  // Interning a name again returns the same id.
+  EXPECT_EQ(0, table.Intern("foo"));
+
+  ASSERT_TRUE(table.Find("foo", &id));
+  EXPECT_EQ(0, id);
+  ASSERT_TRUE(table.Find("bar", &id));
+  EXPECT_EQ(1, id);
+  EXPECT_FALSE(table.Find("baz", &id));
+
+  EXPECT_EQ("foo", table.Name(0));
+  EXPECT_EQ("bar", table.Name(1));
+  EXPECT_EQ("", table.Name(2));
+}
+
+TEST(ServableNameTableTest, ManyNames) {
+  constexpr int kNumNames = 10000;
+  ServableNameTable table;
+  for (int i = 0; i < kNumNames; ++i) {
+    ASSERT_EQ(i, table.Intern(strings::StrCat("name", i)));
+  }
+  for (int i = 0; i < kNumNames; ++i) {
+    int32 id;
+    ASSERT_TRUE(table.Find(strings::StrCat("name", i), &id));
+    EXPECT_EQ(i, id);
+    EXPECT_EQ(strings::StrCat("name", i), table.Name(i));
+  }
+  int32 id;
+  EXPECT_FALSE(table.Find(strings::StrCat("name", kNumNames), &id));
+}
+
+TEST(ServableNameTableTest, ConcurrentIntern) {
+  constexpr int kNumThreads = 4;
+  constexpr int kNumNames = 500;
+  ServableNameTable table;
+  std::vector<std::vector<int32>> ids(kNumThreads);
+  {
+    std::vector<std::unique_ptr<Thread>> threads;
+    for (int i = 0; i < kNumThreads; ++i) {
+      threads.emplace_back(
+          Env::Default()->StartThread({}, "Intern", [&table, &ids, i]() {
+            for (int j = 0; j < kNumNames; ++j) {
+              ids[i].push_back(table.Intern(strings::StrCat("name", j)));
+            }
+          }));
+    }
+  }
+
+  // All threads agree on the ids, which are dense.
+  std::vector<bool> seen(kNumNames, false);
+  for (int j = 0; j < kNumNames; ++j) {
+    for (int i = 1; i < kNumThreads; ++i) {
+      EXPECT_EQ(ids[0][j], ids[i][j]);
+    }
+    ASSERT_GE(ids[0][j], 0);
+    ASSERT_LT(ids[0][j], kNumNames);
+    EXPECT_FALSE(seen[ids[0][j]]);
+    seen[ids[0][j]] = true;
+  }
+}
+
+}  // namespace
+}  // namespace serving
+}  // namespace tensorflow
@@ -73,7 +73,7 @@ Status ServerRequestLogger::Log(const google::protobuf::Message& request,
                                 const google::protobuf::Message& response,
                                 const LogMetadata& log_metadata) {
   const string& model_name = log_metadata.model_spec().name();
-  auto request_logger_map = request_logger_map_.get();
+  auto request_logger_map = request_logger_map_.Pin();
   if (request_logger_map->empty()) {
     VLOG(2) << "Request logger map is empty.";
     return Status::OK();
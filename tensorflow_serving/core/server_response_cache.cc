@@ -0,0 +1,88 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_serving/core/server_response_cache.h"
+
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace serving {
+
+// static
+Status ServerResponseCache::Create(
+    EventBus<ServableState>* const servable_event_bus,
+    std::unique_ptr<ServerResponseCache>* const cache) {
+  cache->reset(new ServerResponseCache());
+  ServerResponseCache* const raw_cache = cache->get();
+  (*cache)->servable_event_subscription_ = servable_event_bus->Subscribe(
+      [raw_cache](const EventBus<ServableState>::EventAndTime& event) {
+        raw_cache->HandleEvent(event);
+      });
+  return Status::OK();
+}
+
+ServerResponseCache::ServerResponseCache()
+    : response_cache_map_(
+          std::unique_ptr<ResponseCacheMap>(new ResponseCacheMap())) {}
+
+Status ServerResponseCache::Update(
+    const std::map<string, ResponseCacheConfig>& config_map) {
+  auto old_map = response_cache_map_.Pin();
+  std::unique_ptr<ResponseCacheMap> new_map(new ResponseCacheMap());
+  for (const auto& model_and_config : config_map) {
+    const string& model_name = model_and_config.first;
+    const ResponseCacheConfig& config = model_and_config.second;
+    auto found = old_map->find(model_name);
+    if (found != old_map->end() &&
+        found->second->config().SerializeAsString() ==
+            config.SerializeAsString()) {
+      (*new_map)[model_name] = found->second;
+      continue;
+    }
+    std::unique_ptr<ResponseCache> cache;
+    TF_RETURN_IF_ERROR(ResponseCache::Create(model_name, config, &cache));
+    (*new_map)[model_name] = std::move(cache);
+  }
+  // Release our reference, or Update() would wait on it forever.
+  old_map.reset();
+  response_cache_map_.Update(std::move(new_map));
+  return Status::OK();
+}
+
+std::shared_ptr<ResponseCache> ServerResponseCache::Get(
+    const string& model_name) const {
+  auto response_cache_map = response_cache_map_.Pin();
+  auto found = response_cache_map->find(model_name);
+  if (found == response_cache_map->end()) {
+    return nullptr;
+  }
+  return found->second;
+}
+
+void ServerResponseCache::HandleEvent(
+    const EventBus<ServableState>::EventAndTime& event_and_time) {
+  const ServableState& state = event_and_time.event;
+  if (state.manager_state != ServableState::ManagerState::kEnd) {
+    return;
+  }
+  std::shared_ptr<ResponseCache> cache = Get(state.id.name);
+  if (cache != nullptr) {
+    VLOG(1) << "Dropping the cached responses of " << state.id.DebugString();
+    cache->EraseServable(state.id);
+  }
+}
+
+}  // namespace serving
+}  // namespace tensorflow
@@ -0,0 +1,76 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_SERVING_CORE_SERVER_RESPONSE_CACHE_H_
+#define TENSORFLOW_SERVING_CORE_SERVER_RESPONSE_CACHE_H_
+
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow_serving/config/response_cache_config.pb.h"
+#include "tensorflow_serving/core/response_cache.h"
+#include "tensorflow_serving/core/servable_state.h"
+#include "tensorflow_serving/util/event_bus.h"
+#include "tensorflow_serving/util/fast_read_dynamic_ptr.h"
+
+namespace tensorflow {
+namespace serving {
+
+// The response caches of all the models in the server that have one
+// configured.
+//
+// Listens to the servable event bus, and drops the cached responses of a
+// servable once it has been unloaded, so that a version which is later loaded
+// again starts with an empty cache.
+class ServerResponseCache {
+ public:
+  static Status Create(EventBus<ServableState>* servable_event_bus,
+                       std::unique_ptr<ServerResponseCache>* cache);
+
+  ~ServerResponseCache() = default;
+
+  // Updates the caches with the new 'config_map', keyed by model name. The
+  // cache of a model whose config is unchanged is kept along with its
+  // contents; all other caches start empty.
+  Status Update(const std::map<string, ResponseCacheConfig>& config_map);
+
+  // Returns the cache of 'model_name', or null if it has none. The cache
+  // stays usable after a subsequent Update() drops it.
+  std::shared_ptr<ResponseCache> Get(const string& model_name) const;
+
+ private:
+  ServerResponseCache();
+
+  void HandleEvent(const EventBus<ServableState>::EventAndTime& event_and_time);
+
+  // A map from model_name to its corresponding ResponseCache.
+  using ResponseCacheMap =
+      std::unordered_map<string, std::shared_ptr<ResponseCache>>;
+  FastReadDynamicPtr<ResponseCacheMap> response_cache_map_;
+
+  std::unique_ptr<EventBus<ServableState>::Subscription>
+      servable_event_subscription_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ServerResponseCache);
+};
+
+}  // namespace serving
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_SERVING_CORE_SERVER_RESPONSE_CACHE_H_
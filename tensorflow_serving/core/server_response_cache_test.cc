@@ -0,0 +1,88 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_serving/core/server_response_cache.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow_serving/apis/predict.pb.h"
+
+namespace tensorflow {
+namespace serving {
+namespace {
+
+ResponseCacheConfig CreateConfig(const uint64 max_bytes) {
+  ResponseCacheConfig config;
+  config.set_max_bytes(max_bytes);
+  return config;
+}
+
+class ServerResponseCacheTest : public ::testing::Test {
+ protected:
+  ServerResponseCacheTest()
+      : servable_event_bus_(EventBus<ServableState>::CreateEventBus()) {
+    TF_CHECK_OK(
+        ServerResponseCache::Create(servable_event_bus_.get(), &cache_));
+  }
+
+  std::shared_ptr<EventBus<ServableState>> servable_event_bus_;
+  std::unique_ptr<ServerResponseCache> cache_;
+};
+
+TEST_F(ServerResponseCacheTest, Update) {
+  EXPECT_EQ(nullptr, cache_->Get("model"));
+
+  TF_ASSERT_OK(cache_->Update({{"model", CreateConfig(1 << 20)}}));
+  std::shared_ptr<ResponseCache> model_cache = cache_->Get("model");
+  ASSERT_NE(nullptr, model_cache);
+  EXPECT_EQ(nullptr, cache_->Get("other_model"));
+
+  // Unchanged configs keep their cache.
+  TF_ASSERT_OK(cache_->Update({{"model", CreateConfig(1 << 20)},
+                               {"other_model", CreateConfig(1 << 20)}}));
+  EXPECT_EQ(model_cache, cache_->Get("model"));
+  EXPECT_NE(nullptr, cache_->Get("other_model"));
+
+  // Changed configs get a new one.
+  TF_ASSERT_OK(cache_->Update({{"model", CreateConfig(1 << 10)}}));
+  EXPECT_NE(model_cache, cache_->Get("model"));
+  EXPECT_EQ(nullptr, cache_->Get("other_model"));
+
+  EXPECT_FALSE(cache_->Update({{"model", CreateConfig(0)}}).ok());
+}
+
+TEST_F(ServerResponseCacheTest, DropsResponsesOfUnloadedServables) {
+  TF_ASSERT_OK(cache_->Update({{"model", CreateConfig(1 << 20)}}));
+  std::shared_ptr<ResponseCache> model_cache = cache_->Get("model");
+  model_cache->Insert({"model", 1}, 0, PredictResponse());
+  model_cache->Insert({"model", 2}, 0, PredictResponse());
+
+  servable_event_bus_->Publish({ServableId{"model", 1},
+                                ServableState::ManagerState::kUnloading,
+                                Status::OK()});
+  EXPECT_EQ(2, model_cache->GetStats().num_entries);
+
+  servable_event_bus_->Publish({ServableId{"model", 1},
+                                ServableState::ManagerState::kEnd,
+                                Status::OK()});
+  PredictResponse response;
+  EXPECT_FALSE(model_cache->Lookup({"model", 1}, 0, &response));
+  EXPECT_TRUE(model_cache->Lookup({"model", 2}, 0, &response));
+}
+
+}  // namespace
+}  // namespace serving
+}  // namespace tensorflow
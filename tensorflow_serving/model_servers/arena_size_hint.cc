@@ -0,0 +1,62 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_serving/model_servers/arena_size_hint.h"
+
+#include <algorithm>
+
+namespace tensorflow {
+namespace serving {
+
+namespace {
+
+// The weight of a new sample in the moving average is 1/2^kDecayShift.
+constexpr int kDecayShift = 3;
+
+// Headroom added on top of the average, so that a typical RPC fits into the
+// start block rather than spilling into a second one. Expressed as a right
+// shift: 1/4.
+constexpr int kHeadroomShift = 2;
+
+}  // namespace
+
+ArenaSizeHint::ArenaSizeHint(const Options& options)
+    : options_(options),
+      average_space_used_(options.initial_space_used) {}
+
+google::protobuf::ArenaOptions ArenaSizeHint::GetArenaOptions() const {
+  google::protobuf::ArenaOptions arena_options;
+  arena_options.start_block_size = start_block_size();
+  arena_options.max_block_size = options_.max_block_size;
+  return arena_options;
+}
+
+void ArenaSizeHint::Record(const int64 space_used) {
+  const int64 average = average_space_used_.load(std::memory_order_relaxed);
+  average_space_used_.store(
+      average + ((space_used - average) >> kDecayShift),
+      std::memory_order_relaxed);
+}
+
+int64 ArenaSizeHint::start_block_size() const {
+  const int64 average = average_space_used_.load(std::memory_order_relaxed);
+  return std::min(
+      options_.max_block_size,
+      std::max(options_.min_start_block_size,
+               average + (average >> kHeadroomShift)));
+}
+
+}  // namespace serving
+}  // namespace tensorflow
@@ -0,0 +1,78 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_SERVING_MODEL_SERVERS_ARENA_SIZE_HINT_H_
+#define TENSORFLOW_SERVING_MODEL_SERVERS_ARENA_SIZE_HINT_H_
+
+#include <atomic>
+
+#include "google/protobuf/arena.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace serving {
+
+// Sizes the protobuf arenas that hold the request and response of one RPC
+// method.
+//
+// An arena starts with a block of 'start_block_size' bytes and allocates
+// further, geometrically growing blocks as needed. A well-chosen start size
+// means a typical RPC costs a single block allocation; one that is too small
+// costs several, one that is too large wastes memory per in-flight RPC. Each
+// method has its own ArenaSizeHint, seeded with a guess for that method, which
+// then tracks the space the method's arenas actually end up using.
+//
+// Thread-safe.
+class ArenaSizeHint {
+ public:
+  struct Options {
+    // The expected space used per RPC, before any RPC has been recorded.
+    int64 initial_space_used = 4 << 10;
+
+    // Bounds on the start block size. The upper bound also caps the size of
+    // the blocks that follow, so a single huge RPC can't inflate every later
+    // arena.
+    int64 min_start_block_size = 1 << 10;
+    int64 max_block_size = 1 << 20;
+  };
+
+  explicit ArenaSizeHint(const Options& options);
+  ~ArenaSizeHint() = default;
+
+  // Returns the options to construct the arena of a new RPC with.
+  google::protobuf::ArenaOptions GetArenaOptions() const;
+
+  // Records the space used by the arena of a finished RPC.
+  void Record(int64 space_used);
+
+  // Returns the current start block size. Exposed for testing.
+  int64 start_block_size() const;
+
+ private:
+  const Options options_;
+
+  // An exponentially weighted moving average of the space used by recent
+  // arenas, plus some headroom when handed out. Updates race benignly: a lost
+  // update merely delays convergence.
+  std::atomic<int64> average_space_used_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ArenaSizeHint);
+};
+
+}  // namespace serving
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_SERVING_MODEL_SERVERS_ARENA_SIZE_HINT_H_
@@ -0,0 +1,69 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_serving/model_servers/arena_size_hint.h"
+
+#include <gtest/gtest.h>
+
+namespace tensorflow {
+namespace serving {
+namespace {
+
+ArenaSizeHint::Options TestOptions() {
+  ArenaSizeHint::Options options;
+  options.initial_space_used = 4 << 10;
+  options.min_start_block_size = 1 << 10;
+  options.max_block_size = 64 << 10;
+  return options;
+}
+
+TEST(ArenaSizeHintTest, StartsFromInitialSpaceUsed) {
+  ArenaSizeHint hint(TestOptions());
+  // The initial guess plus 25% headroom.
+  EXPECT_EQ(5 << 10, hint.start_block_size());
+  const google::protobuf::ArenaOptions arena_options = hint.GetArenaOptions();
+  EXPECT_EQ(5 << 10, arena_options.start_block_size);
+  EXPECT_EQ(64 << 10, arena_options.max_block_size);
+}
+
+TEST(ArenaSizeHintTest, TracksSpaceUsed) {
+  ArenaSizeHint hint(TestOptions());
+  for (int i = 0; i < 100; ++i) {
+    hint.Record(8 << 10);
+  }
+  EXPECT_NEAR(10 << 10, hint.start_block_size(), 16);
+
+  for (int i = 0; i < 100; ++i) {
+    hint.Record(2 << 10);
+  }
+  EXPECT_EQ(2560, hint.start_block_size());
+}
+
+TEST(ArenaSizeHintTest, StaysWithinBounds) {
+  ArenaSizeHint hint(TestOptions());
+  for (int i = 0; i < 200; ++i) {
+    hint.Record(1 << 30);
+  }
+  EXPECT_EQ(64 << 10, hint.start_block_size());
+
+  for (int i = 0; i < 1000; ++i) {
+    hint.Record(0);
+  }
+  EXPECT_EQ(1 << 10, hint.start_block_size());
+}
+
+}  // namespace
+}  // namespace serving
+}  // namespace tensorflow
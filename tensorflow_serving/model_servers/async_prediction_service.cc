@@ -0,0 +1,699 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_serving/model_servers/async_prediction_service.h"
+
+#include <chrono>
+#include <deque>
+#include <utility>
+
+#include "google/protobuf/arena.h"
+#include "grpc++/security/server_credentials.h"
+#include "grpc++/support/async_stream.h"
+#include "grpc++/support/async_unary_call.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/protobuf/config.pb.h"
+#include "tensorflow_serving/model_servers/grpc_util.h"
+#include "tensorflow_serving/servables/tensorflow/classification_service.h"
+#include "tensorflow_serving/servables/tensorflow/get_model_metadata_impl.h"
+#include "tensorflow_serving/servables/tensorflow/multi_inference.h"
+#include "tensorflow_serving/servables/tensorflow/regression_service.h"
+
+namespace tensorflow {
+namespace serving {
+
+namespace {
+
+// How long Shutdown() lets in-flight RPCs finish before cancelling them.
+constexpr int kShutdownGracePeriodSeconds = 5;
+
+// Builds the RunOptions for an RPC, carrying over the client's deadline. By
+// default the deadline is infinite, which maps to the same "no timeout"
+// default as RunOptions.
+RunOptions RunOptionsFromContext(const ::grpc::ServerContext& context) {
+  RunOptions run_options;
+  run_options.set_timeout_in_ms(
+      DeadlineToTimeoutMillis(context.raw_deadline()));
+  return run_options;
+}
+
+// Creates the ArenaSizeHint for a method that is expected to use
+// 'initial_space_used' bytes of arena per RPC.
+std::unique_ptr<ArenaSizeHint> NewArenaSizeHint(
+    const AsyncPredictionServer::Options& options,
+    const int64 initial_space_used) {
+  ArenaSizeHint::Options hint_options;
+  hint_options.initial_space_used = initial_space_used;
+  hint_options.max_block_size = options.max_arena_block_size;
+  return std::unique_ptr<ArenaSizeHint>(new ArenaSizeHint(hint_options));
+}
+
+// Logs a failed RPC and forwards its status to 'done'.
+void FinishRpc(const char* method, const Status& status,
+               const AsyncPredictionServer::DoneCallback& done) {
+  if (!status.ok()) {
+    VLOG(1) << method << " failed: " << status.error_message();
+  }
+  done(ToGRPCStatus(status));
+}
+
+}  // namespace
+
+// A tag placed on a completion queue. Each in-flight RPC owns exactly one Call,
+// which deletes itself once the RPC is finished (or was never started because
+// the server shut down).
+class AsyncPredictionServer::Call {
+ public:
+  virtual ~Call() = default;
+
+  // Advances the state machine after the completion queue returned this tag.
+  // 'ok' is the completion queue's status bit for the finished operation.
+  virtual void Proceed(bool ok) = 0;
+};
+
+// The state machine for one unary RPC of type Request -> Response.
+template <typename Request, typename Response>
+class AsyncPredictionServer::UnaryCall : public AsyncPredictionServer::Call {
+ public:
+  // The AsyncService method that asks gRPC for the next RPC of this type, e.g.
+  // &PredictionService::AsyncService::RequestPredict.
+  using RequestMethod = void (PredictionService::AsyncService::*)(
+      ::grpc::ServerContext*, Request*,
+      ::grpc::ServerAsyncResponseWriter<Response>*, ::grpc::CompletionQueue*,
+      ::grpc::ServerCompletionQueue*, void*);
+
+  // Processes the request into the response, then invokes the DoneCallback.
+  // The request is shared with the handler, which may keep it (and thereby
+  // the call's arena) alive past the call, e.g. in tensors borrowing its
+  // bytes.
+  using Handler =
+      std::function<void(::grpc::ServerContext*, std::shared_ptr<const Request>,
+                         Response*, DoneCallback)>;
+
+  // Creates a call that waits for the next RPC of this type to arrive on 'cq'.
+  // The call's arena is sized by, and reports back to, 'arena_size_hint'.
+  static void Start(PredictionService::AsyncService* service,
+                    RequestMethod request_method, Handler handler,
+                    ArenaSizeHint* arena_size_hint,
+                    ::grpc::ServerCompletionQueue* cq) {
+    new UnaryCall(service, request_method, std::move(handler), arena_size_hint,
+                  cq);
+  }
+
+  void Proceed(const bool ok) override {
+    switch (state_) {
+      case State::kRequested: {
+        if (!ok) {
+          // The server is shutting down; no RPC was bound to this call.
+          delete this;
+          return;
+        }
+        // Keep one call waiting for the next RPC of this type on 'cq_' before
+        // processing this one.
+        Start(service_, request_method_, handler_, arena_size_hint_, cq_);
+        state_ = State::kProcessing;
+        handler_(&context_, std::shared_ptr<const Request>(arena_, request_),
+                 response_,
+                 [this](const ::grpc::Status& status) {
+                   state_ = State::kFinished;
+                   if (status.ok()) {
+                     responder_.Finish(*response_, status, this);
+                   } else {
+                     responder_.FinishWithError(status, this);
+                   }
+                 });
+        return;
+      }
+      case State::kProcessing:
+        LOG(DFATAL) << "Completion queue event for a call that is still being "
+                       "processed";
+        return;
+      case State::kFinished:
+        // The response has been sent (or the client went away).
+        arena_size_hint_->Record(arena_->SpaceUsed());
+        delete this;
+        return;
+    }
+  }
+
+ private:
+  enum class State { kRequested, kProcessing, kFinished };
+
+  UnaryCall(PredictionService::AsyncService* service,
+            RequestMethod request_method, Handler handler,
+            ArenaSizeHint* arena_size_hint, ::grpc::ServerCompletionQueue* cq)
+      : service_(service),
+        request_method_(request_method),
+        handler_(std::move(handler)),
+        arena_size_hint_(arena_size_hint),
+        cq_(cq),
+        arena_(std::make_shared<google::protobuf::Arena>(
+            arena_size_hint->GetArenaOptions())),
+        request_(
+            google::protobuf::Arena::CreateMessage<Request>(arena_.get())),
+        response_(
+            google::protobuf::Arena::CreateMessage<Response>(arena_.get())),
+        responder_(&context_) {
+    (service_->*request_method_)(&context_, request_, &responder_, cq_, cq_,
+                                 this);
+  }
+
+  PredictionService::AsyncService* const service_;
+  const RequestMethod request_method_;
+  const Handler handler_;
+  ArenaSizeHint* const arena_size_hint_;
+  ::grpc::ServerCompletionQueue* const cq_;
+
+  State state_ = State::kRequested;
+  ::grpc::ServerContext context_;
+  // The request, the response and all their submessages (e.g. the per-example
+  // results of a Classify) live on 'arena_', which releases them in one go
+  // once the call is deleted and the handler has let go of the request.
+  const std::shared_ptr<google::protobuf::Arena> arena_;
+  Request* const request_;
+  Response* const response_;
+  ::grpc::ServerAsyncResponseWriter<Response> responder_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(UnaryCall);
+};
+
+// The state machine for one StreamPredict stream.
+//
+// Requests are read one at a time and each is issued with PredictAsync() as
+// soon as it arrives, so that up to 'max_in_flight_requests_per_stream'
+// requests of a stream are processed concurrently (and, with batching enabled,
+// coalesce with each other and with unary traffic) without holding a thread
+// each. Responses are queued and
+// written in completion order, one write at a time as gRPC requires. The
+// stream is finished once the client has half-closed it and every response has
+// been written.
+//
+// Completion queue events for a stream can be processed concurrently by
+// several polling threads, and requests complete on whichever thread runs their
+// callback, so all state is guarded by 'mu_'.
+class AsyncPredictionServer::StreamPredictCall {
+ public:
+  // Creates a call that waits for the next stream to be opened on 'cq'.
+  static void Start(AsyncPredictionServer* server,
+                    ::grpc::ServerCompletionQueue* cq) {
+    new StreamPredictCall(server, cq);
+  }
+
+ private:
+  // One request read off the stream, together with its response, on an arena
+  // of their own.
+  struct Item {
+    explicit Item(const google::protobuf::ArenaOptions& arena_options)
+        : arena(arena_options),
+          request(google::protobuf::Arena::CreateMessage<StreamPredictRequest>(
+              &arena)),
+          response(
+              google::protobuf::Arena::CreateMessage<StreamPredictResponse>(
+                  &arena)) {}
+
+    google::protobuf::Arena arena;
+    StreamPredictRequest* const request;
+    StreamPredictResponse* const response;
+  };
+
+  // A completion queue tag that forwards to a method of the call. A stream
+  // has several kinds of operations outstanding at once, each with its own
+  // tag.
+  class Tag : public Call {
+   public:
+    Tag(StreamPredictCall* call, void (StreamPredictCall::*on_done)(bool))
+        : call_(call), on_done_(on_done) {}
+
+    void Proceed(const bool ok) override { (call_->*on_done_)(ok); }
+
+   private:
+    StreamPredictCall* const call_;
+    void (StreamPredictCall::*const on_done_)(bool);
+  };
+
+  StreamPredictCall(AsyncPredictionServer* server,
+                    ::grpc::ServerCompletionQueue* cq)
+      : server_(server),
+        cq_(cq),
+        stream_(&context_),
+        accept_tag_(this, &StreamPredictCall::OnAccepted),
+        read_tag_(this, &StreamPredictCall::OnRead),
+        write_tag_(this, &StreamPredictCall::OnWritten),
+        finish_tag_(this, &StreamPredictCall::OnFinished) {
+    server_->service_.RequestStreamPredict(&context_, &stream_, cq_, cq_,
+                                           &accept_tag_);
+  }
+
+  void OnAccepted(const bool ok) {
+    if (!ok) {
+      // The server is shutting down; no stream was bound to this call.
+      delete this;
+      return;
+    }
+    // Keep one call waiting for the next stream on 'cq_'.
+    Start(server_, cq_);
+    mutex_lock l(mu_);
+    ReadLocked();
+  }
+
+  // Issues a read of the next request into 'read_item_'.
+  void ReadLocked() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    read_item_.reset(
+        new Item(server_->predict_arena_size_hint_->GetArenaOptions()));
+    read_pending_ = true;
+    stream_.Read(read_item_->request, &read_tag_);
+  }
+
+  void OnRead(const bool ok) {
+    std::shared_ptr<Item> item;
+    // Requests of a stream nearly always name the same model, so its id is
+    // remembered across them. The next read can complete while this one is
+    // still being issued, in which case that one does without the cache.
+    ServerCore::ModelNameIdCache name_id_cache;
+    {
+      mutex_lock l(mu_);
+      read_pending_ = false;
+      if (!ok) {
+        // The client half-closed the stream, or it was cancelled.
+        read_item_.reset();
+        reads_done_ = true;
+        MaybeFinishLocked();
+        return;
+      }
+      item.reset(read_item_.release());
+      std::swap(name_id_cache, name_id_cache_);
+      ++num_issuing_;
+      ++num_in_flight_;
+      // Otherwise reading resumes once a request completes.
+      if (num_in_flight_ < server_->options_.max_in_flight_requests_per_stream) {
+        ReadLocked();
+      }
+    }
+    // Shutdown() waits for the callback, which writes to the stream.
+    server_->IncrementPendingCallbacks();
+    // The request is shared with the input tensors, which may borrow its
+    // bytes.
+    const std::shared_ptr<const PredictRequest> request(
+        item, &item->request->request());
+    PredictResponse* const response = item->response->mutable_response();
+    server_->predictor_->PredictAsync(
+        RunOptionsFromContext(context_), server_->core_.get(), request,
+        &name_id_cache, response, [this, item](const Status& status) {
+          OnProcessed(item, status);
+          server_->DecrementPendingCallbacks();
+        });
+    mutex_lock l(mu_);
+    std::swap(name_id_cache, name_id_cache_);
+    --num_issuing_;
+    MaybeFinishLocked();
+  }
+
+  void OnProcessed(std::shared_ptr<Item> item, const Status& status) {
+    item->response->set_request_id(item->request->request_id());
+    if (!status.ok()) {
+      VLOG(1) << "StreamPredict request " << item->request->request_id()
+              << " failed: " << status.error_message();
+      item->response->clear_response();
+      item->response->set_error_code(status.code());
+      item->response->set_error_message(status.error_message());
+    }
+
+    mutex_lock l(mu_);
+    --num_in_flight_;
+    if (!write_failed_) {
+      write_queue_.push_back(std::move(item));
+      if (write_item_ == nullptr) {
+        WriteLocked();
+      }
+    }
+    if (!read_pending_ && !reads_done_) {
+      ReadLocked();
+    }
+    MaybeFinishLocked();
+  }
+
+  // Writes the response at the front of 'write_queue_'.
+  void WriteLocked() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    write_item_ = std::move(write_queue_.front());
+    write_queue_.pop_front();
+    stream_.Write(*write_item_->response, &write_tag_);
+  }
+
+  void OnWritten(const bool ok) {
+    mutex_lock l(mu_);
+    server_->predict_arena_size_hint_->Record(write_item_->arena.SpaceUsed());
+    write_item_.reset();
+    if (!ok) {
+      // The stream is broken; responses to requests still being processed
+      // are dropped.
+      write_failed_ = true;
+      write_queue_.clear();
+    }
+    if (!write_queue_.empty()) {
+      WriteLocked();
+    }
+    MaybeFinishLocked();
+  }
+
+  // Finishes the stream if there is nothing left to read, process or write.
+  void MaybeFinishLocked() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    if (finishing_ || !reads_done_ || num_issuing_ > 0 || num_in_flight_ > 0 ||
+        write_item_ != nullptr || !write_queue_.empty()) {
+      return;
+    }
+    finishing_ = true;
+    stream_.Finish(::grpc::Status::OK, &finish_tag_);
+  }
+
+  void OnFinished(const bool ok) {
+    {
+      // Wait for the thread that called Finish() to release 'mu_'.
+      mutex_lock l(mu_);
+    }
+    delete this;
+  }
+
+  AsyncPredictionServer* const server_;
+  ::grpc::ServerCompletionQueue* const cq_;
+  ::grpc::ServerContext context_;
+  ::grpc::ServerAsyncReaderWriter<StreamPredictResponse, StreamPredictRequest>
+      stream_;
+
+  Tag accept_tag_;
+  Tag read_tag_;
+  Tag write_tag_;
+  Tag finish_tag_;
+
+  mutex mu_;
+  // The target of the outstanding read, if any.
+  std::unique_ptr<Item> read_item_ GUARDED_BY(mu_);
+  bool read_pending_ GUARDED_BY(mu_) = false;
+  // Set once a read failed; no further reads are issued.
+  bool reads_done_ GUARDED_BY(mu_) = false;
+  // The number of requests issued but not yet processed.
+  int num_in_flight_ GUARDED_BY(mu_) = 0;
+  // The number of OnRead() calls still issuing their request, which the
+  // stream must outlive even if the request has already been processed.
+  int num_issuing_ GUARDED_BY(mu_) = 0;
+  // Lent to one OnRead() at a time.
+  ServerCore::ModelNameIdCache name_id_cache_ GUARDED_BY(mu_);
+  // The response being written, if any, and the ones waiting their turn.
+  std::shared_ptr<Item> write_item_ GUARDED_BY(mu_);
+  std::deque<std::shared_ptr<Item>> write_queue_ GUARDED_BY(mu_);
+  // Set once a write failed; no further writes are issued.
+  bool write_failed_ GUARDED_BY(mu_) = false;
+  bool finishing_ GUARDED_BY(mu_) = false;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(StreamPredictCall);
+};
+
+Status AsyncPredictionServer::Create(
+    const Options& options, std::unique_ptr<ServerCore> core,
+    std::unique_ptr<AsyncPredictionServer>* server) {
+  if (options.num_completion_queues < 1) {
+    return errors::InvalidArgument("num_completion_queues must be >= 1; was ",
+                                   options.num_completion_queues);
+  }
+  if (options.num_polling_threads_per_queue < 1) {
+    return errors::InvalidArgument(
+        "num_polling_threads_per_queue must be >= 1; was ",
+        options.num_polling_threads_per_queue);
+  }
+  if (options.max_in_flight_requests_per_stream < 1) {
+    return errors::InvalidArgument(
+        "max_in_flight_requests_per_stream must be >= 1; was ",
+        options.max_in_flight_requests_per_stream);
+  }
+  if (options.num_worker_threads < 1) {
+    return errors::InvalidArgument("num_worker_threads must be >= 1; was ",
+                                   options.num_worker_threads);
+  }
+  std::unique_ptr<AsyncPredictionServer> result(
+      new AsyncPredictionServer(options, std::move(core)));
+
+  ::grpc::ServerBuilder builder;
+  builder.AddListeningPort(options.server_address,
+                           ::grpc::InsecureServerCredentials());
+  builder.RegisterService(&result->service_);
+  builder.SetMaxMessageSize(kint32max);
+  for (int i = 0; i < options.num_completion_queues; ++i) {
+    result->cqs_.push_back(builder.AddCompletionQueue());
+  }
+  result->server_ = builder.BuildAndStart();
+  if (result->server_ == nullptr) {
+    return errors::Internal("Failed to start gRPC server at ",
+                            options.server_address);
+  }
+
+  for (int i = 0; i < result->cqs_.size(); ++i) {
+    ::grpc::ServerCompletionQueue* const cq = result->cqs_[i].get();
+    result->RequestCalls(cq);
+    for (int j = 0; j < options.num_polling_threads_per_queue; ++j) {
+      result->polling_threads_.emplace_back(options.env->StartThread(
+          ThreadOptions(),
+          strings::StrCat("AsyncPredictionServer_Poller_", i, "_", j),
+          [cq] { PollCompletionQueue(cq); }));
+    }
+  }
+  *server = std::move(result);
+  return Status::OK();
+}
+
+AsyncPredictionServer::AsyncPredictionServer(const Options& options,
+                                             std::unique_ptr<ServerCore> core)
+    : options_(options),
+      core_(std::move(core)),
+      predictor_(new TensorflowPredictor(
+          options.use_saved_model, options.default_predict_output_encoding)),
+      worker_threads_(new thread::ThreadPool(options.env,
+                                             "AsyncPredictionServer_Worker",
+                                             options.num_worker_threads)),
+      // Initial guesses of the arena space used per method. Predict and
+      // Regress typically carry a handful of small tensors or scores, while
+      // Classify and MultiInference responses hold a message per example and
+      // class, BatchPredict carries several Predicts and model metadata holds
+      // whole SignatureDefs.
+      predict_arena_size_hint_(NewArenaSizeHint(options, 4 << 10)),
+      get_model_metadata_arena_size_hint_(NewArenaSizeHint(options, 16 << 10)),
+      classify_arena_size_hint_(NewArenaSizeHint(options, 16 << 10)),
+      regress_arena_size_hint_(NewArenaSizeHint(options, 4 << 10)),
+      multi_inference_arena_size_hint_(NewArenaSizeHint(options, 16 << 10)),
+      batch_predict_arena_size_hint_(NewArenaSizeHint(options, 16 << 10)) {}
+
+AsyncPredictionServer::~AsyncPredictionServer() {
+  Shutdown();
+  // Joins the polling threads, which exit once their queues are drained.
+  polling_threads_.clear();
+}
+
+void AsyncPredictionServer::Wait() { server_->Wait(); }
+
+void AsyncPredictionServer::Shutdown() {
+  {
+    mutex_lock l(shutdown_mu_);
+    if (shut_down_) {
+      return;
+    }
+    shut_down_ = true;
+  }
+  // The server must be shut down before its completion queues. This waits
+  // for all in-flight RPCs to finish, which needs the polling threads. Open
+  // streams only finish once their clients half-close them, so after a grace
+  // period all remaining RPCs are cancelled.
+  if (server_ != nullptr) {
+    server_->Shutdown(std::chrono::system_clock::now() +
+                      std::chrono::seconds(kShutdownGracePeriodSeconds));
+  }
+  // Requests may still be waiting for their batch, and their callbacks write
+  // to the completion queues, so the queues can only be shut down once the
+  // callbacks have run.
+  {
+    mutex_lock l(pending_callbacks_mu_);
+    while (num_pending_callbacks_ > 0) {
+      pending_callbacks_done_.wait(l);
+    }
+  }
+  for (const auto& cq : cqs_) {
+    cq->Shutdown();
+  }
+}
+
+void AsyncPredictionServer::IncrementPendingCallbacks() {
+  mutex_lock l(pending_callbacks_mu_);
+  ++num_pending_callbacks_;
+}
+
+void AsyncPredictionServer::DecrementPendingCallbacks() {
+  mutex_lock l(pending_callbacks_mu_);
+  if (--num_pending_callbacks_ == 0) {
+    pending_callbacks_done_.notify_all();
+  }
+}
+
+AsyncPredictionServer::DoneCallback AsyncPredictionServer::TrackPending(
+    DoneCallback done) {
+  IncrementPendingCallbacks();
+  return [this, done](const ::grpc::Status& status) {
+    done(status);
+    DecrementPendingCallbacks();
+  };
+}
+
+void AsyncPredictionServer::RequestCalls(::grpc::ServerCompletionQueue* cq) {
+  using AsyncService = PredictionService::AsyncService;
+  UnaryCall<PredictRequest, PredictResponse>::Start(
+      &service_, &AsyncService::RequestPredict,
+      [this](::grpc::ServerContext* context,
+             std::shared_ptr<const PredictRequest> request,
+             PredictResponse* response, DoneCallback done) {
+        HandlePredict(context, std::move(request), response,
+                      TrackPending(std::move(done)));
+      },
+      predict_arena_size_hint_.get(), cq);
+  UnaryCall<GetModelMetadataRequest, GetModelMetadataResponse>::Start(
+      &service_, &AsyncService::RequestGetModelMetadata,
+      [this](::grpc::ServerContext* context,
+             std::shared_ptr<const GetModelMetadataRequest> request,
+             GetModelMetadataResponse* response, DoneCallback done) {
+        HandleGetModelMetadata(context, *request, response,
+                               TrackPending(std::move(done)));
+      },
+      get_model_metadata_arena_size_hint_.get(), cq);
+  UnaryCall<ClassificationRequest, ClassificationResponse>::Start(
+      &service_, &AsyncService::RequestClassify,
+      [this](::grpc::ServerContext* context,
+             std::shared_ptr<const ClassificationRequest> request,
+             ClassificationResponse* response, DoneCallback done) {
+        HandleClassify(context, *request, response,
+                       TrackPending(std::move(done)));
+      },
+      classify_arena_size_hint_.get(), cq);
+  UnaryCall<RegressionRequest, RegressionResponse>::Start(
+      &service_, &AsyncService::RequestRegress,
+      [this](::grpc::ServerContext* context,
+             std::shared_ptr<const RegressionRequest> request,
+             RegressionResponse* response, DoneCallback done) {
+        HandleRegress(context, *request, response,
+                      TrackPending(std::move(done)));
+      },
+      regress_arena_size_hint_.get(), cq);
+  UnaryCall<MultiInferenceRequest, MultiInferenceResponse>::Start(
+      &service_, &AsyncService::RequestMultiInference,
+      [this](::grpc::ServerContext* context,
+             std::shared_ptr<const MultiInferenceRequest> request,
+             MultiInferenceResponse* response, DoneCallback done) {
+        HandleMultiInference(context, *request, response,
+                             TrackPending(std::move(done)));
+      },
+      multi_inference_arena_size_hint_.get(), cq);
+  UnaryCall<BatchPredictRequest, BatchPredictResponse>::Start(
+      &service_, &AsyncService::RequestBatchPredict,
+      [this](::grpc::ServerContext* context,
+             std::shared_ptr<const BatchPredictRequest> request,
+             BatchPredictResponse* response, DoneCallback done) {
+        HandleBatchPredict(context, std::move(request), response,
+                           TrackPending(std::move(done)));
+      },
+      batch_predict_arena_size_hint_.get(), cq);
+  StreamPredictCall::Start(this, cq);
+}
+
+void AsyncPredictionServer::PollCompletionQueue(
+    ::grpc::ServerCompletionQueue* cq) {
+  void* tag;
+  bool ok;
+  // Next() returns false only once the queue is shut down and fully drained.
+  while (cq->Next(&tag, &ok)) {
+    static_cast<Call*>(tag)->Proceed(ok);
+  }
+}
+
+void AsyncPredictionServer::HandlePredict(
+    ::grpc::ServerContext* context,
+    std::shared_ptr<const PredictRequest> request, PredictResponse* response,
+    DoneCallback done) {
+  // The RPC completes from the session's callback, so no thread is held while
+  // the request waits for its batch.
+  predictor_->PredictAsync(
+      RunOptionsFromContext(*context), core_.get(), std::move(request),
+      nullptr, response,
+      [done](const Status& status) { FinishRpc("Predict", status, done); });
+}
+
+void AsyncPredictionServer::HandleGetModelMetadata(
+    ::grpc::ServerContext* context, const GetModelMetadataRequest& request,
+    GetModelMetadataResponse* response, DoneCallback done) {
+  if (!options_.use_saved_model) {
+    done(ToGRPCStatus(
+        errors::InvalidArgument("GetModelMetadata API is only available when "
+                                "use_saved_model is set to true")));
+    return;
+  }
+  // Serializing SignatureDefs can take a while for large graphs. 'request'
+  // and 'response' are owned by the RPC, which lives until 'done' is called.
+  worker_threads_->Schedule([this, &request, response, done] {
+    FinishRpc(
+        "GetModelMetadata",
+        GetModelMetadataImpl::GetModelMetadata(core_.get(), request, response),
+        done);
+  });
+}
+
+void AsyncPredictionServer::HandleClassify(::grpc::ServerContext* context,
+                                           const ClassificationRequest& request,
+                                           ClassificationResponse* response,
+                                           DoneCallback done) {
+  TensorflowClassificationServiceImpl::ClassifyAsync(
+      RunOptionsFromContext(*context), core_.get(), request, response,
+      [done](const Status& status) { FinishRpc("Classify", status, done); });
+}
+
+void AsyncPredictionServer::HandleRegress(::grpc::ServerContext* context,
+                                          const RegressionRequest& request,
+                                          RegressionResponse* response,
+                                          DoneCallback done) {
+  TensorflowRegressionServiceImpl::RegressAsync(
+      RunOptionsFromContext(*context), core_.get(), request, response,
+      [done](const Status& status) { FinishRpc("Regress", status, done); });
+}
+
+void AsyncPredictionServer::HandleBatchPredict(
+    ::grpc::ServerContext* context,
+    std::shared_ptr<const BatchPredictRequest> request,
+    BatchPredictResponse* response, DoneCallback done) {
+  // Like Predict, the items complete from the sessions' callbacks rather
+  // than holding this polling thread until all of them are done.
+  predictor_->BatchPredictAsync(
+      RunOptionsFromContext(*context), core_.get(), std::move(request),
+      response, [done](const Status& status) {
+        FinishRpc("BatchPredict", status, done);
+      });
+}
+
+void AsyncPredictionServer::HandleMultiInference(
+    ::grpc::ServerContext* context, const MultiInferenceRequest& request,
+    MultiInferenceResponse* response, DoneCallback done) {
+  // Runs the session asynchronously, like Classify and Regress, rather than
+  // holding this polling thread until the inference is done.
+  RunMultiInferenceAsync(RunOptionsFromContext(*context), core_.get(), request,
+                         response, [done](const Status& status) {
+                           FinishRpc("MultiInference", status, done);
+                         });
+}
+
+}  // namespace serving
+}  // namespace tensorflow
@@ -0,0 +1,223 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Asynchronous gRPC implementation of
+// tensorflow_serving/apis/prediction_service.proto.
+//
+// This is the model server's default. The synchronous server in main.cc
+// (--enable_async_server=false) dedicates one gRPC thread to each in-flight
+// RPC for its whole lifetime. AsyncPredictionServer instead drives
+// every RPC through a small state machine (requested -> processing ->
+// finishing) on a set of grpc::ServerCompletionQueues, each polled by a
+// configurable number of threads. A polling thread is only occupied while it
+// advances a state machine; the handler for an RPC reports its outcome via a
+// callback, after which the response is written back from whichever thread
+// runs the callback. Handlers that run sessions do so asynchronously; the
+// remaining work that has no asynchronous path (GetModelMetadata) runs on a
+// small pool of worker threads, so it never occupies a polling thread either.
+//
+// Besides the unary methods, the server implements the bidirectional
+// StreamPredict RPC, which pipelines many Predict calls over one stream (see
+// StreamPredictCall in the .cc file). The synchronous server serves it too,
+// but holds a reading and a writing thread for each open stream.
+//
+// The request and response of each RPC are allocated on a protobuf arena owned
+// by the RPC; the synchronous server can't do so, since gRPC allocates them.
+// Arenas are sized per method based on the space recent RPCs of that method
+// used (see ArenaSizeHint), so that serving an RPC typically costs one or two
+// block allocations instead of one per message, string and repeated field.
+
+#ifndef TENSORFLOW_SERVING_MODEL_SERVERS_ASYNC_PREDICTION_SERVICE_H_
+#define TENSORFLOW_SERVING_MODEL_SERVERS_ASYNC_PREDICTION_SERVICE_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "grpc++/server.h"
+#include "grpc++/server_builder.h"
+#include "grpc++/server_context.h"
+#include "grpc++/support/status.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow_serving/apis/prediction_service.grpc.pb.h"
+#include "tensorflow_serving/model_servers/arena_size_hint.h"
+#include "tensorflow_serving/model_servers/server_core.h"
+#include "tensorflow_serving/servables/tensorflow/predict_impl.h"
+
+namespace tensorflow {
+namespace serving {
+
+class AsyncPredictionServer {
+ public:
+  struct Options {
+    // The address to listen on, e.g. "0.0.0.0:8500".
+    string server_address;
+
+    // The number of completion queues to create. RPCs are spread across the
+    // queues, which lets polling threads on different queues proceed without
+    // contending on a single queue.
+    //
+    // Must be >= 1.
+    int num_completion_queues = 1;
+
+    // The number of threads polling each completion queue.
+    //
+    // Must be >= 1.
+    int num_polling_threads_per_queue = 1;
+
+    // If true, servables are looked up as SavedModelBundles, otherwise as
+    // SessionBundles. See TensorflowPredictor.
+    bool use_saved_model = true;
+
+    // The encoding of Predict outputs for requests that leave
+    // PredictRequest.output_encoding unset.
+    PredictRequest::OutputEncoding default_predict_output_encoding =
+        PredictRequest::REPEATED_FIELD;
+
+    // The largest block a per-RPC arena allocates at once. Larger messages
+    // are spread across several blocks.
+    int64 max_arena_block_size = 1 << 20;
+
+    // The maximum number of requests of a single StreamPredict stream that are
+    // processed concurrently. Once reached, the server stops reading from the
+    // stream until one of them completes, which pushes back on the client.
+    //
+    // Must be >= 1.
+    int max_in_flight_requests_per_stream = 64;
+
+    // The number of worker threads serving GetModelMetadata, which runs
+    // synchronously and is kept off the polling threads.
+    //
+    // Must be >= 1.
+    int num_worker_threads = 1;
+
+    // The environment to use for starting the polling and worker threads.
+    Env* env = Env::Default();
+  };
+
+  // Reports the final status of an RPC. Must be called exactly once per RPC,
+  // from any thread.
+  using DoneCallback = std::function<void(const ::grpc::Status& status)>;
+
+  // Builds and starts a server that serves the models in 'core'. The server
+  // is listening and all polling threads are running upon return.
+  static Status Create(const Options& options,
+                       std::unique_ptr<ServerCore> core,
+                       std::unique_ptr<AsyncPredictionServer>* server);
+
+  // Shuts down the server (if not done already) and waits for the polling
+  // threads to drain their completion queues.
+  ~AsyncPredictionServer();
+
+  // Blocks until the server is shut down.
+  void Wait();
+
+  // Stops accepting new RPCs, gives the outstanding ones a few seconds to
+  // finish before cancelling them, waits for the requests still being
+  // processed, and drains the completion queues. Idempotent.
+  void Shutdown() LOCKS_EXCLUDED(shutdown_mu_);
+
+ private:
+  class Call;
+  template <typename Request, typename Response>
+  class UnaryCall;
+  class StreamPredictCall;
+
+  explicit AsyncPredictionServer(const Options& options,
+                                 std::unique_ptr<ServerCore> core);
+
+  // Registers one outstanding call for every method on 'cq'.
+  void RequestCalls(::grpc::ServerCompletionQueue* cq);
+
+  // Count the callbacks of requests still being processed, which Shutdown()
+  // waits for before shutting the completion queues down.
+  void IncrementPendingCallbacks() LOCKS_EXCLUDED(pending_callbacks_mu_);
+  void DecrementPendingCallbacks() LOCKS_EXCLUDED(pending_callbacks_mu_);
+
+  // Returns a callback that invokes 'done' and is counted as pending until it
+  // has.
+  DoneCallback TrackPending(DoneCallback done);
+
+  // Pulls tags off 'cq' and advances their state machines until the queue is
+  // shut down and drained.
+  static void PollCompletionQueue(::grpc::ServerCompletionQueue* cq);
+
+  // Per-method handlers. Each one eventually invokes 'done' exactly once.
+  // The handlers that run sessions asynchronously share ownership of their
+  // request, which the input tensors may borrow bytes from.
+  void HandlePredict(::grpc::ServerContext* context,
+                     std::shared_ptr<const PredictRequest> request,
+                     PredictResponse* response, DoneCallback done);
+  void HandleGetModelMetadata(::grpc::ServerContext* context,
+                              const GetModelMetadataRequest& request,
+                              GetModelMetadataResponse* response,
+                              DoneCallback done);
+  void HandleClassify(::grpc::ServerContext* context,
+                      const ClassificationRequest& request,
+                      ClassificationResponse* response, DoneCallback done);
+  void HandleRegress(::grpc::ServerContext* context,
+                     const RegressionRequest& request,
+                     RegressionResponse* response, DoneCallback done);
+  void HandleBatchPredict(::grpc::ServerContext* context,
+                          std::shared_ptr<const BatchPredictRequest> request,
+                          BatchPredictResponse* response, DoneCallback done);
+  void HandleMultiInference(::grpc::ServerContext* context,
+                            const MultiInferenceRequest& request,
+                            MultiInferenceResponse* response,
+                            DoneCallback done);
+
+  const Options options_;
+  std::unique_ptr<ServerCore> core_;
+  std::unique_ptr<TensorflowPredictor> predictor_;
+
+  // Runs the handlers' synchronous work. Declared after 'core_', so that it
+  // is destroyed, and its threads joined, before the core.
+  std::unique_ptr<thread::ThreadPool> worker_threads_;
+
+  // Per-method sizing of the per-RPC arenas.
+  std::unique_ptr<ArenaSizeHint> predict_arena_size_hint_;
+  std::unique_ptr<ArenaSizeHint> get_model_metadata_arena_size_hint_;
+  std::unique_ptr<ArenaSizeHint> classify_arena_size_hint_;
+  std::unique_ptr<ArenaSizeHint> regress_arena_size_hint_;
+  std::unique_ptr<ArenaSizeHint> multi_inference_arena_size_hint_;
+  std::unique_ptr<ArenaSizeHint> batch_predict_arena_size_hint_;
+
+  PredictionService::AsyncService service_;
+  std::vector<std::unique_ptr<::grpc::ServerCompletionQueue>> cqs_;
+  std::unique_ptr<::grpc::Server> server_;
+
+  // The polling threads; 'num_polling_threads_per_queue' per entry in 'cqs_'.
+  std::vector<std::unique_ptr<Thread>> polling_threads_;
+
+  mutex pending_callbacks_mu_;
+  int num_pending_callbacks_ GUARDED_BY(pending_callbacks_mu_) = 0;
+  condition_variable pending_callbacks_done_;
+
+  mutex shutdown_mu_;
+  bool shut_down_ GUARDED_BY(shutdown_mu_) = false;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(AsyncPredictionServer);
+};
+
+}  // namespace serving
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_SERVING_MODEL_SERVERS_ASYNC_PREDICTION_SERVICE_H_
@@ -0,0 +1,49 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_serving/model_servers/grpc_util.h"
+
+#include <algorithm>
+
+#include "grpc++/support/status_code_enum.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace serving {
+
+::grpc::Status ToGRPCStatus(const Status& status) {
+  const int kErrorMessageLimit = 1024;
+  string error_message;
+  if (status.error_message().length() > kErrorMessageLimit) {
+    error_message =
+        status.error_message().substr(0, kErrorMessageLimit) + "...TRUNCATED";
+  } else {
+    error_message = status.error_message();
+  }
+  return ::grpc::Status(static_cast<::grpc::StatusCode>(status.code()),
+                        error_message);
+}
+
+int DeadlineToTimeoutMillis(const gpr_timespec deadline) {
+  const int timeout_millis = gpr_time_to_millis(
+      gpr_time_sub(gpr_convert_clock_type(deadline, GPR_CLOCK_MONOTONIC),
+                   gpr_now(GPR_CLOCK_MONOTONIC)));
+  // RunOptions treats a non-positive timeout as "no timeout", which is the
+  // opposite of what an expired deadline means.
+  return std::max(timeout_millis, 1);
+}
+
+}  // namespace serving
+}  // namespace tensorflow
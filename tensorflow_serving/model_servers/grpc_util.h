@@ -0,0 +1,41 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Helpers shared by the synchronous and asynchronous gRPC front ends of the
+// ModelServer.
+
+#ifndef TENSORFLOW_SERVING_MODEL_SERVERS_GRPC_UTIL_H_
+#define TENSORFLOW_SERVING_MODEL_SERVERS_GRPC_UTIL_H_
+
+#include "grpc++/support/status.h"
+#include "grpc/support/time.h"
+#include "tensorflow/core/lib/core/status.h"
+
+namespace tensorflow {
+namespace serving {
+
+// Converts a tensorflow::Status into a grpc::Status. Error messages longer
+// than 1024 characters are truncated.
+::grpc::Status ToGRPCStatus(const Status& status);
+
+// Returns the number of milliseconds left until 'deadline', and at least 1 so
+// that an expired deadline is not mistaken for "no timeout". Used to translate
+// an RPC deadline into RunOptions::timeout_in_ms.
+int DeadlineToTimeoutMillis(const gpr_timespec deadline);
+
+}  // namespace serving
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_SERVING_MODEL_SERVERS_GRPC_UTIL_H_
@@ -42,8 +42,20 @@ limitations under the License.
 // To specify port (default 8500): --port=my_port
 // To enable batching (default disabled): --enable_batching
 // To override the default batching parameters: --batching_parameters_file
+// By default, requests are served from completion queues, with the request and
+// response of each RPC allocated on a per-RPC arena. To tune the queues:
+//     [--num_completion_queues=N] [--num_polling_threads_per_queue=M]
+// To dedicate a gRPC thread to each in-flight request instead, without arenas:
+//     --enable_async_server=false
+// The items of BatchPredict calls on the synchronous server are issued
+// asynchronously, except for SessionBundle models (--use_saved_model=false),
+// whose items are processed on a pool of --num_sub_request_threads threads.
+// To return Predict outputs as packed tensor_content by default (requests can
+// still pick an encoding via PredictRequest.output_encoding):
+//     --predict_outputs_as_tensor_content
 
 #include <unistd.h>
+#include <deque>
 #include <iostream>
 #include <memory>
 #include <utility>
@@ -56,11 +68,16 @@ limitations under the License.
 #include "grpc++/server_context.h"
 #include "grpc++/support/status.h"
 #include "grpc++/support/status_code_enum.h"
+#include "grpc++/support/sync_stream.h"
 #include "grpc/grpc.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/init_main.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/protobuf.h"
+#include "tensorflow/core/platform/thread_annotations.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/protobuf/config.pb.h"
 #include "tensorflow/core/util/command_line_flags.h"
@@ -68,6 +85,8 @@ limitations under the License.
 #include "tensorflow_serving/apis/prediction_service.pb.h"
 #include "tensorflow_serving/config/model_server_config.pb.h"
 #include "tensorflow_serving/core/availability_preserving_policy.h"
+#include "tensorflow_serving/model_servers/async_prediction_service.h"
+#include "tensorflow_serving/model_servers/grpc_util.h"
 #include "tensorflow_serving/model_servers/model_platform_types.h"
 #include "tensorflow_serving/model_servers/platform_config_util.h"
 #include "tensorflow_serving/model_servers/server_core.h"
@@ -84,8 +103,10 @@ class ServerCompletionQueue;
 namespace tf = tensorflow;
 using tf::serving::AspiredVersionsManager;
 using tf::serving::AspiredVersionPolicy;
+using tf::serving::AsyncPredictionServer;
 using tf::serving::AvailabilityPreservingPolicy;
 using tf::serving::BatchingParameters;
+using tf::serving::DeadlineToTimeoutMillis;
 using tf::serving::EventBus;
 using tf::serving::FileSystemStoragePathSourceConfig;
 using tf::serving::GetModelMetadataImpl;
@@ -96,6 +117,7 @@ using tf::serving::SessionBundleConfig;
 using tf::serving::TensorflowClassificationServiceImpl;
 using tf::serving::TensorflowRegressionServiceImpl;
 using tf::serving::TensorflowPredictor;
+using tf::serving::ToGRPCStatus;
 using tf::serving::UniquePtrWithDeps;
 using tf::string;
 
@@ -103,6 +125,8 @@ using grpc::InsecureServerCredentials;
 using grpc::Server;
 using grpc::ServerBuilder;
 using grpc::ServerContext;
+using tf::serving::BatchPredictRequest;
+using tf::serving::BatchPredictResponse;
 using tf::serving::ClassificationRequest;
 using tf::serving::ClassificationResponse;
 using tf::serving::GetModelMetadataRequest;
@@ -114,9 +138,16 @@ using tf::serving::PredictResponse;
 using tf::serving::RegressionRequest;
 using tf::serving::RegressionResponse;
 using tf::serving::PredictionService;
+using tf::serving::StreamPredictRequest;
+using tf::serving::StreamPredictResponse;
 
 namespace {
 
+// The maximum number of requests of a single StreamPredict stream that the
+// synchronous server processes concurrently, as the asynchronous server does by
+// default.
+constexpr int kMaxInFlightRequestsPerStream = 64;
+
 tf::Status ParseProtoTextFile(const string &file, google::protobuf::Message *message) {
     std::unique_ptr<tf::ReadOnlyMemoryRegion> file_data;
     TF_RETURN_IF_ERROR(tf::Env::Default()->NewReadOnlyMemoryRegionFromFile(file, &file_data));
@@ -147,28 +178,19 @@ ModelServerConfig BuildSingleModelConfig(const string &model_name, const string
     return config;
 }
 
-int DeadlineToTimeoutMillis(const gpr_timespec deadline) {
-    return gpr_time_to_millis(gpr_time_sub(gpr_convert_clock_type(deadline, GPR_CLOCK_MONOTONIC),
-                                           gpr_now(GPR_CLOCK_MONOTONIC)));
-}
-
-grpc::Status ToGRPCStatus(const tf::Status &status) {
-    const int kErrorMessageLimit = 1024;
-    string error_message;
-    if (status.error_message().length() > kErrorMessageLimit) {
-        error_message = status.error_message().substr(0, kErrorMessageLimit) + "...TRUNCATED";
-    } else {
-        error_message = status.error_message();
-    }
-    return grpc::Status(static_cast<grpc::StatusCode>(status.code()), error_message);
-}
-
 class PredictionServiceImpl : public PredictionService::Service {
    public:
-    explicit PredictionServiceImpl(std::unique_ptr<ServerCore> core, bool use_saved_model)
+    explicit PredictionServiceImpl(std::unique_ptr<ServerCore> core, bool use_saved_model,
+                                   PredictRequest::OutputEncoding default_predict_output_encoding,
+                                   int num_sub_request_threads)
         : core_(std::move(core)),
-          predictor_(new TensorflowPredictor(use_saved_model)),
-          use_saved_model_(use_saved_model) {}
+          predictor_(new TensorflowPredictor(use_saved_model, default_predict_output_encoding)),
+          use_saved_model_(use_saved_model),
+          sub_request_thread_pool_(use_saved_model ? nullptr
+                                                   : new tf::thread::ThreadPool(
+                                                         tf::Env::Default(),
+                                                         "PredictionServiceImpl_SubRequest",
+                                                         num_sub_request_threads)) {}
 
     grpc::Status Predict(ServerContext *context, const PredictRequest *request,
                          PredictResponse *response) override {
@@ -184,6 +206,88 @@ class PredictionServiceImpl : public PredictionService::Service {
         return status;
     }
 
+    grpc::Status BatchPredict(ServerContext *context, const BatchPredictRequest *request,
+                              BatchPredictResponse *response) override {
+        tf::RunOptions run_options = tf::RunOptions();
+        // By default, this is infinite which is the same default as
+        // RunOptions.
+        run_options.set_timeout_in_ms(DeadlineToTimeoutMillis(context->raw_deadline()));
+        const grpc::Status status = ToGRPCStatus(predictor_->BatchPredict(
+            run_options, core_.get(), *request, sub_request_thread_pool_.get(), response));
+        if (!status.ok()) {
+            VLOG(1) << "BatchPredict failed: " << status.error_message();
+        }
+        return status;
+    }
+
+    // Issues each request with PredictAsync() as soon as it is read, so that up to
+    // kMaxInFlightRequestsPerStream requests of a stream are processed concurrently (and,
+    // with batching enabled, coalesce with each other and with unary traffic). A writer
+    // thread writes the responses in completion order while this thread keeps reading.
+    // Returns once the client has half-closed the stream and every response has been
+    // written, or dropped because the stream broke.
+    grpc::Status StreamPredict(
+        ServerContext *context,
+        grpc::ServerReaderWriter<StreamPredictResponse, StreamPredictRequest> *stream) override {
+        tf::RunOptions run_options = tf::RunOptions();
+        // By default, this is infinite which is the same default as
+        // RunOptions.
+        run_options.set_timeout_in_ms(DeadlineToTimeoutMillis(context->raw_deadline()));
+        StreamState state;
+        std::unique_ptr<tf::Thread> writer(tf::Env::Default()->StartThread(
+            tf::ThreadOptions(), "PredictionServiceImpl_StreamWriter",
+            [&state, context, stream] { WriteStreamResponses(context, stream, &state); }));
+        // Requests of a stream nearly always name the same model.
+        ServerCore::ModelNameIdCache name_id_cache;
+        for (;;) {
+            {
+                tf::mutex_lock l(state.mu);
+                while (state.num_in_flight >= kMaxInFlightRequestsPerStream &&
+                       !state.write_failed) {
+                    state.changed.wait(l);
+                }
+                if (state.write_failed) {
+                    break;
+                }
+            }
+            std::shared_ptr<StreamItem> item(new StreamItem);
+            if (!stream->Read(&item->request)) {
+                // The client half-closed the stream, or it was cancelled.
+                break;
+            }
+            {
+                tf::mutex_lock l(state.mu);
+                ++state.num_in_flight;
+            }
+            // The request is shared with the input tensors, which may borrow its bytes.
+            const std::shared_ptr<const PredictRequest> request(item, &item->request.request());
+            predictor_->PredictAsync(
+                run_options, core_.get(), request, &name_id_cache,
+                item->response.mutable_response(), [&state, item](const tf::Status &status) {
+                    item->response.set_request_id(item->request.request_id());
+                    if (!status.ok()) {
+                        VLOG(1) << "StreamPredict request " << item->request.request_id()
+                                << " failed: " << status.error_message();
+                        item->response.clear_response();
+                        item->response.set_error_code(status.code());
+                        item->response.set_error_message(status.error_message());
+                    }
+                    tf::mutex_lock l(state.mu);
+                    --state.num_in_flight;
+                    state.write_queue.push_back(item);
+                    state.changed.notify_all();
+                });
+        }
+        {
+            tf::mutex_lock l(state.mu);
+            state.reads_done = true;
+            state.changed.notify_all();
+        }
+        // Joins the writer, which exits once no request is left in flight.
+        writer.reset();
+        return grpc::Status::OK;
+    }
+
     grpc::Status GetModelMetadata(ServerContext *context, const GetModelMetadataRequest *request,
                                   GetModelMetadataResponse *response) override {
         if (!use_saved_model_) {
@@ -241,15 +345,75 @@ class PredictionServiceImpl : public PredictionService::Service {
     }
 
    private:
+    // One request read off a StreamPredict stream, together with its response.
+    struct StreamItem {
+        StreamPredictRequest request;
+        StreamPredictResponse response;
+    };
+
+    // Shared by the reading and writing threads of a StreamPredict stream, and the callbacks
+    // of its requests.
+    struct StreamState {
+        tf::mutex mu;
+        // Notified whenever any of the fields below changes.
+        tf::condition_variable changed;
+        // The number of requests issued but not yet processed.
+        int num_in_flight GUARDED_BY(mu) = 0;
+        // The processed requests whose responses wait to be written.
+        std::deque<std::shared_ptr<StreamItem>> write_queue GUARDED_BY(mu);
+        // Set once no further requests are read.
+        bool reads_done GUARDED_BY(mu) = false;
+        // Set once a write failed; the remaining responses are dropped.
+        bool write_failed GUARDED_BY(mu) = false;
+    };
+
+    // Writes the responses of 'state' to 'stream' as they are queued, until no more can come.
+    static void WriteStreamResponses(
+        ServerContext *context,
+        grpc::ServerReaderWriter<StreamPredictResponse, StreamPredictRequest> *stream,
+        StreamState *state) {
+        for (;;) {
+            std::shared_ptr<StreamItem> item;
+            {
+                tf::mutex_lock l(state->mu);
+                while (state->write_queue.empty() &&
+                       !(state->reads_done && state->num_in_flight == 0)) {
+                    state->changed.wait(l);
+                }
+                if (state->write_queue.empty()) {
+                    return;
+                }
+                item = std::move(state->write_queue.front());
+                state->write_queue.pop_front();
+                if (state->write_failed) {
+                    continue;
+                }
+            }
+            if (!stream->Write(item->response)) {
+                // The stream is broken. Cancelling it unblocks the reading thread.
+                context->TryCancel();
+                tf::mutex_lock l(state->mu);
+                state->write_failed = true;
+                state->changed.notify_all();
+            }
+        }
+    }
+
     std::unique_ptr<ServerCore> core_;
     std::unique_ptr<TensorflowPredictor> predictor_;
     bool use_saved_model_;
+    // Runs the items of BatchPredict calls for SessionBundle models, which
+    // can't be issued asynchronously. Null when serving SavedModels.
+    std::unique_ptr<tf::thread::ThreadPool> sub_request_thread_pool_;
 };
 
 class BrandonPredictionService : public PredictionServiceImpl {
    public:
-    explicit BrandonPredictionService(std::unique_ptr<ServerCore> core, bool use_saved_model)
-        : PredictionServiceImpl(std::move(core), use_saved_model) {}
+    explicit BrandonPredictionService(std::unique_ptr<ServerCore> core, bool use_saved_model,
+                                      PredictRequest::OutputEncoding default_predict_output_encoding,
+                                      int num_sub_request_threads)
+        : PredictionServiceImpl(std::move(core), use_saved_model,
+                                default_predict_output_encoding, num_sub_request_threads) {}
 
     grpc::Status Predict(ServerContext *context, const PredictRequest *request,
                          PredictResponse *response) override {
@@ -266,10 +430,13 @@ class BrandonPredictionService : public PredictionServiceImpl {
     }
 };
 
-void RunServer(int port, std::unique_ptr<ServerCore> core, bool use_saved_model) {
+void RunServer(int port, std::unique_ptr<ServerCore> core, bool use_saved_model,
+               PredictRequest::OutputEncoding default_predict_output_encoding,
+               int num_sub_request_threads) {
     // "0.0.0.0" is the way to listen on localhost in gRPC.
     const string server_address = "0.0.0.0:" + std::to_string(port);
-    BrandonPredictionService service(std::move(core), use_saved_model);
+    BrandonPredictionService service(std::move(core), use_saved_model,
+                                     default_predict_output_encoding, num_sub_request_threads);
     ServerBuilder builder;
     std::shared_ptr<grpc::ServerCredentials> creds = InsecureServerCredentials();
     builder.AddListeningPort(server_address, creds);
@@ -280,6 +447,24 @@ void RunServer(int port, std::unique_ptr<ServerCore> core, bool use_saved_model)
     server->Wait();
 }
 
+void RunAsyncServer(int port, std::unique_ptr<ServerCore> core, bool use_saved_model,
+                    PredictRequest::OutputEncoding default_predict_output_encoding,
+                    int num_completion_queues, int num_polling_threads_per_queue) {
+    AsyncPredictionServer::Options options;
+    // "0.0.0.0" is the way to listen on localhost in gRPC.
+    options.server_address = "0.0.0.0:" + std::to_string(port);
+    options.num_completion_queues = num_completion_queues;
+    options.num_polling_threads_per_queue = num_polling_threads_per_queue;
+    options.use_saved_model = use_saved_model;
+    options.default_predict_output_encoding = default_predict_output_encoding;
+    std::unique_ptr<AsyncPredictionServer> server;
+    TF_CHECK_OK(AsyncPredictionServer::Create(options, std::move(core), &server));
+    LOG(INFO) << "Running asynchronous ModelServer at " << options.server_address << " with "
+              << num_completion_queues << " completion queue(s) and "
+              << num_polling_threads_per_queue << " polling thread(s) per queue ...";
+    server->Wait();
+}
+
 }  // namespace
 
 int main(int argc, char **argv) {
@@ -294,6 +479,11 @@ int main(int argc, char **argv) {
     // Tensorflow session parallelism of zero means that both inter and intra op
     // thread pools will be auto configured.
     tf::int64 tensorflow_session_parallelism = 0;
+    bool enable_async_server = true;
+    tf::int32 num_completion_queues = 1;
+    tf::int32 num_polling_threads_per_queue = tf::port::NumSchedulableCPUs();
+    bool predict_outputs_as_tensor_content = false;
+    tf::int32 num_sub_request_threads = tf::port::NumSchedulableCPUs();
 
     std::vector<tf::Flag> flag_list = {
         tf::Flag("port", &port, "port to listen on"),
@@ -320,7 +510,29 @@ int main(int argc, char **argv) {
                  "system for new model version"),
         tf::Flag("tensorflow_session_parallelism", &tensorflow_session_parallelism,
                  "Number of threads to use for running a "
-                 "Tensorflow session. Auto-configured by default.")};
+                 "Tensorflow session. Auto-configured by default."),
+        tf::Flag("enable_async_server", &enable_async_server,
+                 "Serve with an asynchronous gRPC server driven by completion "
+                 "queues, which allocates the messages of each RPC on a "
+                 "per-RPC arena. If false, a synchronous gRPC server "
+                 "dedicates a gRPC thread to each in-flight request, and "
+                 "allocates messages individually."),
+        tf::Flag("num_completion_queues", &num_completion_queues,
+                 "Number of gRPC completion queues used by the asynchronous "
+                 "server (ignored if --enable_async_server=false)."),
+        tf::Flag("num_polling_threads_per_queue", &num_polling_threads_per_queue,
+                 "Number of threads polling each completion queue of the "
+                 "asynchronous server (ignored if "
+                 "--enable_async_server=false)."),
+        tf::Flag("num_sub_request_threads", &num_sub_request_threads,
+                 "Number of threads processing the items of BatchPredict "
+                 "calls for SessionBundle models on the synchronous server "
+                 "(ignored unless --use_saved_model=false and "
+                 "--enable_async_server=false)."),
+        tf::Flag("predict_outputs_as_tensor_content", &predict_outputs_as_tensor_content,
+                 "Encode Predict outputs as packed tensor_content instead of "
+                 "repeated *_val fields, unless a request asks otherwise via "
+                 "PredictRequest.output_encoding.")};
 
     string usage = tf::Flags::Usage(argv[0], flag_list);
     const bool parse_result = tf::Flags::Parse(&argc, argv, flag_list);
@@ -373,7 +585,16 @@ int main(int argc, char **argv) {
 
     std::unique_ptr<ServerCore> core;
     TF_CHECK_OK(ServerCore::Create(std::move(options), &core));
-    RunServer(port, std::move(core), use_saved_model);
+    const PredictRequest::OutputEncoding default_predict_output_encoding =
+        predict_outputs_as_tensor_content ? PredictRequest::TENSOR_CONTENT
+                                          : PredictRequest::REPEATED_FIELD;
+    if (enable_async_server) {
+        RunAsyncServer(port, std::move(core), use_saved_model, default_predict_output_encoding,
+                       num_completion_queues, num_polling_threads_per_queue);
+    } else {
+        RunServer(port, std::move(core), use_saved_model, default_predict_output_encoding,
+                  num_sub_request_threads);
+    }
 
     return 0;
 }
@@ -23,6 +23,7 @@ limitations under the License.
 #include "tensorflow/core/lib/io/path.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow_serving/core/load_servables_fast.h"
+#include "tensorflow_serving/core/servable_name_table.h"
 #include "tensorflow_serving/model_servers/model_platform_types.h"
 #include "tensorflow_serving/resources/resource_values.h"
 #include "tensorflow_serving/servables/tensorflow/saved_model_bundle_source_adapter.h"
@@ -263,6 +264,10 @@ ServerCore::ServerCore(Options options)
     const string& platform = entry.first;
     platform_to_router_port_[platform] = port_num++;
   }
+  TF_CHECK_OK(ServerResponseCache::Create(servable_event_bus_.get(),
+                                          &server_response_cache_));
+  TF_CHECK_OK(SignaturePlanCache::Create(servable_event_bus_.get(),
+                                         &signature_plan_cache_));
 }
 
 Status ServerCore::Initialize(std::unique_ptr<AspiredVersionPolicy> policy) {
@@ -406,6 +411,30 @@ Status ServerCore::MaybeUpdateServerRequestLogger() {
   return options_.server_request_logger->Update(logging_config_map);
 }
 
+Status ServerCore::UpdateServerResponseCache() {
+  std::map<string, ResponseCacheConfig> response_cache_config_map;
+  for (const auto& model_config : config_.model_config_list().config()) {
+    if (model_config.has_response_cache_config()) {
+      response_cache_config_map.insert(
+          {model_config.name(), model_config.response_cache_config()});
+    }
+  }
+  return server_response_cache_->Update(response_cache_config_map);
+}
+
+void ServerCore::UpdateModelBatchShares() {
+  std::map<string, ModelBatchShares::Share> shares;
+  for (const auto& model_config : config_.model_config_list().config()) {
+    ModelBatchShares::Share share;
+    if (model_config.batch_weight() > 0) {
+      share.weight = model_config.batch_weight();
+    }
+    share.priority = model_config.batch_priority();
+    shares[model_config.name()] = share;
+  }
+  model_batch_shares_->Update(std::move(shares));
+}
+
 Status ServerCore::ReloadConfig(const ModelServerConfig& new_config) {
   mutex_lock l(config_mu_);
 
@@ -446,6 +475,13 @@ Status ServerCore::ReloadConfig(const ModelServerConfig& new_config) {
             *options_.model_config_list_root_dir,
             config_.mutable_model_config_list()));
       }
+      // Before any new versions start loading.
+      UpdateModelBatchShares();
+      // Give the models their name ids up front, so that the ids of configured
+      // models are dense.
+      for (const ModelConfig& model : config_.model_config_list().config()) {
+        manager_->name_table()->Intern(model.name());
+      }
       TF_RETURN_IF_ERROR(AddModelsViaModelConfigList());
       break;
     }
@@ -460,6 +496,7 @@ Status ServerCore::ReloadConfig(const ModelServerConfig& new_config) {
       return errors::InvalidArgument("Invalid ServerModelConfig");
   }
   TF_RETURN_IF_ERROR(MaybeUpdateServerRequestLogger());
+  TF_RETURN_IF_ERROR(UpdateServerResponseCache());
 
   return Status::OK();
 }
@@ -479,8 +516,13 @@ Status ServerCore::CreateAdapter(
       StoragePathSourceAdapterRegistry::CreateFromAny(adapter_config, adapter);
   if (!status.ok()) {
     VLOG(1) << "Source adapter creation failed: " << status;
+    return status;
   }
-  return status;
+  if (auto* batch_shares_user =
+          dynamic_cast<ModelBatchSharesUser*>(adapter->get())) {
+    batch_shares_user->SetModelBatchShares(model_batch_shares_);
+  }
+  return Status::OK();
 }
 
 FileSystemStoragePathSourceConfig ServerCore::CreateStoragePathSourceConfig(
@@ -679,5 +721,45 @@ Status ServerCore::ServableRequestFromModelSpec(
   return Status::OK();
 }
 
+Status ServerCore::GetPinnedServableForModelSpec(
+    const ModelSpec& model_spec, ModelNameIdCache* name_id_cache,
+    PinnedServable* pinned) {
+  if (model_spec.name().empty()) {
+    return errors::InvalidArgument("ModelSpec has no name specified.");
+  }
+  optional<int64> version;
+  if (model_spec.has_version()) {
+    version = model_spec.version().value();
+  }
+  const int32 name_id = GetModelNameId(model_spec.name(), name_id_cache);
+  if (name_id < 0) {
+    // No version of the model has ever been ready.
+    ServableRequest servable_request;
+    TF_RETURN_IF_ERROR(
+        ServableRequestFromModelSpec(model_spec, &servable_request));
+    return errors::NotFound("Servable not found for request: ",
+                            servable_request.DebugString());
+  }
+  return manager_->GetPinnedServableByNameId(name_id, version, pinned);
+}
+
+int32 ServerCore::GetModelNameId(const string& model_name,
+                                 ModelNameIdCache* name_id_cache) {
+  if (name_id_cache != nullptr && name_id_cache->name_id >= 0 &&
+      name_id_cache->name == model_name) {
+    return name_id_cache->name_id;
+  }
+  int32 name_id;
+  if (!manager_->name_table()->Find(model_name, &name_id)) {
+    return -1;
+  }
+  // Ids are never reused, so the cached one stays valid.
+  if (name_id_cache != nullptr) {
+    name_id_cache->name = model_name;
+    name_id_cache->name_id = name_id;
+  }
+  return name_id;
+}
+
 }  //  namespace serving
 }  //  namespace tensorflow
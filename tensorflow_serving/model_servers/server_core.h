@@ -33,11 +33,16 @@ limitations under the License.
 #include "tensorflow_serving/config/platform_config.pb.h"
 #include "tensorflow_serving/core/aspired_versions_manager.h"
 #include "tensorflow_serving/core/dynamic_source_router.h"
+#include "tensorflow_serving/core/execution_time_tracker.h"
+#include "tensorflow_serving/core/response_cache.h"
 #include "tensorflow_serving/core/servable_state_monitor.h"
 #include "tensorflow_serving/core/server_request_logger.h"
+#include "tensorflow_serving/core/server_response_cache.h"
 #include "tensorflow_serving/core/source.h"
 #include "tensorflow_serving/core/source_adapter.h"
 #include "tensorflow_serving/core/storage_path.h"
+#include "tensorflow_serving/servables/tensorflow/model_batch_shares.h"
+#include "tensorflow_serving/servables/tensorflow/signature_plans.h"
 #include "tensorflow_serving/sources/storage_path/file_system_storage_path_source.h"
 #include "tensorflow_serving/util/event_bus.h"
 #include "tensorflow_serving/util/optional.h"
@@ -168,6 +173,16 @@ class ServerCore : public Manager {
         return servable_state_monitor_.get();
     }
 
+    /// Remembers the id that the manager's name table assigned to the model
+    /// name of the last lookup made through it, for a series of lookups that
+    /// mostly ask for the same model, e.g. the requests of one stream. Not
+    /// thread-safe.
+    struct ModelNameIdCache {
+        string name;
+        // Negative if 'name' has no id yet.
+        int32 name_id = -1;
+    };
+
     /// Returns a ServableHandle given a ServableRequest. Returns error if no such
     /// Servable is available -- e.g. not yet loaded, has been quiesced/unloaded,
     /// etc. Callers may assume that an OK status indicates a non-null handle.
@@ -177,13 +192,20 @@ class ServerCore : public Manager {
     /// long period of time will prevent servable loading and unloading.
     template <typename T>
     Status GetServableHandle(const ModelSpec& model_spec, ServableHandle<T>* const handle) {
-        ServableRequest servable_request;
-        tensorflow::Status status = ServableRequestFromModelSpec(model_spec, &servable_request);
-        if (!status.ok()) {
-            VLOG(1) << "Unable to get servable handle due to: " << status;
-            return status;
+        return GetServableHandle(model_spec, nullptr, handle);
+    }
+
+    /// Same as above, but only resolves the model name to its id if it differs
+    /// from the one in 'name_id_cache' (if non-null), and caches the result.
+    template <typename T>
+    Status GetServableHandle(const ModelSpec& model_spec, ModelNameIdCache* name_id_cache,
+                             ServableHandle<T>* const handle) {
+        PinnedServable pinned;
+        tensorflow::Status status =
+            GetPinnedServableForModelSpec(model_spec, name_id_cache, &pinned);
+        if (status.ok()) {
+            status = HandleFromPinnedServable(std::move(pinned), handle);
         }
-        status = manager_->GetServableHandle(servable_request, handle);
         if (!status.ok()) {
             VLOG(1) << "Unable to get servable handle due to: " << status;
             return status;
@@ -199,6 +221,25 @@ class ServerCore : public Manager {
         return options_.server_request_logger->Log(request, response, log_metadata);
     }
 
+    /// Returns the response cache of 'model_name', or null if response caching
+    /// is not configured for it.
+    std::shared_ptr<ResponseCache> GetResponseCache(const string& model_name) const {
+        return server_response_cache_->Get(model_name);
+    }
+
+    /// Returns the id that the manager's name table assigned to 'model_name', or -1 if no
+    /// version of the model has ever been ready. The id is taken from, or else stored in,
+    /// 'name_id_cache' if non-null.
+    int32 GetModelNameId(const string& model_name, ModelNameIdCache* name_id_cache);
+
+    /// Returns how long the session runs of each model, keyed by its name id, have recently
+    /// been taking, used to reject requests that can't meet their deadline early.
+    ExecutionTimeTracker* execution_time_tracker() { return &execution_time_tracker_; }
+
+    /// Returns the resolved signatures of the SavedModel servables, which
+    /// spare requests from looking them up in their SignatureDefs.
+    SignaturePlanCache* signature_plan_cache() { return signature_plan_cache_.get(); }
+
    protected:
     ServerCore(Options options);
 
@@ -289,6 +330,13 @@ class ServerCore : public Manager {
     // Updates the ServerRequestLogger based on the ModelConfigList.
     Status MaybeUpdateServerRequestLogger() EXCLUSIVE_LOCKS_REQUIRED(config_mu_);
 
+    // Updates the ServerResponseCache based on the ModelConfigList.
+    Status UpdateServerResponseCache() EXCLUSIVE_LOCKS_REQUIRED(config_mu_);
+
+    // Publishes the batch thread shares of the models in the ModelConfigList,
+    // for the bundle factories to pick up as the models' versions load.
+    void UpdateModelBatchShares() EXCLUSIVE_LOCKS_REQUIRED(config_mu_);
+
     // ************************************************************************
     // Request Processing.
     // ************************************************************************
@@ -297,6 +345,11 @@ class ServerCore : public Manager {
     Status ServableRequestFromModelSpec(const ModelSpec& model_spec,
                                         ServableRequest* servable_request) const;
 
+    // Looks up the servable 'model_spec' asks for, by the id of its model name (see
+    // GetModelNameId()).
+    Status GetPinnedServableForModelSpec(const ModelSpec& model_spec,
+                                         ModelNameIdCache* name_id_cache, PinnedServable* pinned);
+
     Status GetUntypedServableHandle(
         const ServableRequest& request,
         std::unique_ptr<UntypedServableHandle>* untyped_handle) override {
@@ -308,6 +361,10 @@ class ServerCore : public Manager {
         return manager_->GetAvailableUntypedServableHandles();
     }
 
+    Status GetPinnedServable(const ServableRequest& request, PinnedServable* pinned) override {
+        return manager_->GetPinnedServable(request, pinned);
+    }
+
     // The options passed to the ctor, minus the AspiredVersionPolicy.
     Options options_;
 
@@ -318,6 +375,15 @@ class ServerCore : public Manager {
 
     std::shared_ptr<EventBus<ServableState>> servable_event_bus_;
     std::shared_ptr<ServableStateMonitor> servable_state_monitor_;
+    // Declared before 'manager_' so that they outlive the events published
+    // while the manager unloads its servables.
+    std::unique_ptr<ServerResponseCache> server_response_cache_;
+    std::unique_ptr<SignaturePlanCache> signature_plan_cache_;
+    ExecutionTimeTracker execution_time_tracker_;
+    // The batch shares of the configured models, handed to the source adapters
+    // that apply them.
+    const std::shared_ptr<ModelBatchShares> model_batch_shares_ =
+        std::make_shared<ModelBatchShares>();
     UniquePtrWithDeps<AspiredVersionsManager> manager_;
 
     // The most recent config supplied to ReloadConfig().
@@ -80,6 +80,42 @@ TEST_P(ServerCoreTest, CreateWaitsTillModelsAvailable) {
   EXPECT_EQ(servable_handle.id(), expected_id);
 }
 
+TEST_P(ServerCoreTest, GetServableHandleWithNameIdCache) {
+  std::unique_ptr<ServerCore> server_core;
+  TF_ASSERT_OK(CreateServerCore(GetTestModelServerConfigForFakePlatform(),
+                                &server_core));
+  const ServableId expected_id = {test_util::kTestModelName,
+                                  test_util::kTestModelVersion};
+
+  ModelSpec model_spec;
+  model_spec.set_name(test_util::kTestModelName);
+  model_spec.mutable_version()->set_value(test_util::kTestModelVersion);
+  ServerCore::ModelNameIdCache name_id_cache;
+  ServableHandle<string> servable_handle;
+  TF_ASSERT_OK(server_core->GetServableHandle<string>(
+      model_spec, &name_id_cache, &servable_handle));
+  EXPECT_EQ(servable_handle.id(), expected_id);
+  EXPECT_EQ(test_util::kTestModelName, name_id_cache.name);
+  const int32 name_id = name_id_cache.name_id;
+  EXPECT_GE(name_id, 0);
+
+  // Served by the cached id.
+  TF_ASSERT_OK(server_core->GetServableHandle<string>(
+      model_spec, &name_id_cache, &servable_handle));
+  EXPECT_EQ(servable_handle.id(), expected_id);
+  EXPECT_EQ(name_id, name_id_cache.name_id);
+
+  // A name that was never served is looked up, and not cached.
+  model_spec.set_name("unknown_model");
+  EXPECT_EQ(error::NOT_FOUND,
+            server_core
+                ->GetServableHandle<string>(model_spec, &name_id_cache,
+                                            &servable_handle)
+                .code());
+  EXPECT_EQ(test_util::kTestModelName, name_id_cache.name);
+  EXPECT_EQ(name_id, name_id_cache.name_id);
+}
+
 TEST_P(ServerCoreTest, ReloadConfigWaitsTillModelsAvailable) {
   // Create a server with no models, initially.
   std::unique_ptr<ServerCore> server_core;
@@ -116,6 +152,35 @@ TEST_P(ServerCoreTest, ReloadConfigUnloadsModels) {
       {ServableState::ManagerState::kEnd});
 }
 
+TEST_P(ServerCoreTest, ResponseCache) {
+  ModelServerConfig config = GetTestModelServerConfigForFakePlatform();
+  config.mutable_model_config_list()
+      ->mutable_config(0)
+      ->mutable_response_cache_config()
+      ->set_max_bytes(1 << 20);
+  const ServableId servable_id = {test_util::kTestModelName,
+                                  test_util::kTestModelVersion};
+
+  std::unique_ptr<ServerCore> server_core;
+  TF_ASSERT_OK(CreateServerCore(config, &server_core));
+  std::shared_ptr<ResponseCache> cache =
+      server_core->GetResponseCache(test_util::kTestModelName);
+  ASSERT_NE(nullptr, cache);
+  EXPECT_EQ(nullptr, server_core->GetResponseCache("other_model"));
+  cache->Insert(servable_id, 0, ModelSpec());
+  EXPECT_EQ(1, cache->GetStats().num_entries);
+
+  // Unloading the model drops its cache, and the responses it computed.
+  ModelServerConfig empty_config;
+  empty_config.mutable_model_config_list();
+  TF_ASSERT_OK(server_core->ReloadConfig(empty_config));
+  EXPECT_EQ(nullptr, server_core->GetResponseCache(test_util::kTestModelName));
+  test_util::WaitUntilServableManagerStateIsOneOf(
+      *server_core->servable_state_monitor(), servable_id,
+      {ServableState::ManagerState::kEnd});
+  EXPECT_EQ(0, cache->GetStats().num_entries);
+}
+
 TEST_P(ServerCoreTest, ReloadConfigHandlesLoadingAPreviouslyUnloadedModel) {
   ModelServerConfig empty_config;
   empty_config.mutable_model_config_list();
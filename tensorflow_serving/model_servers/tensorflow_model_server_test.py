@@ -118,7 +118,8 @@ class TensorflowModelServerTest(tf.test.TestCase):
                 model_name,
                 model_path,
                 batching_parameters_file='',
-                wait_for_server_ready=True):
+                wait_for_server_ready=True,
+                enable_async_server=False):
     """Run tensorflow_model_server using test config."""
     print 'Starting test server...'
     command = os.path.join(self.binary_dir, 'tensorflow_model_server')
@@ -128,6 +129,11 @@ class TensorflowModelServerTest(tf.test.TestCase):
     if batching_parameters_file:
       command += ' --enable_batching'
       command += ' --batching_parameters_file=' + batching_parameters_file
+    if enable_async_server:
+      command += ' --num_completion_queues=2'
+      command += ' --num_polling_threads_per_queue=2'
+    else:
+      command += ' --enable_async_server=false'
     print command
     self.server_proc = subprocess.Popen(shlex.split(command))
     print 'Server started'
@@ -157,7 +163,8 @@ class TensorflowModelServerTest(tf.test.TestCase):
                            model_server_address,
                            expected_output,
                            model_name='default',
-                           specify_output=True):
+                           specify_output=True,
+                           output_encoding=None):
     """Send PredictionService.Predict request and verify output."""
     print 'Sending Predict request...'
     # Prepare request
@@ -170,6 +177,8 @@ class TensorflowModelServerTest(tf.test.TestCase):
 
     if specify_output:
       request.output_filter.append('y')
+    if output_encoding is not None:
+      request.output_encoding = output_encoding
     # Send request
     host, port = model_server_address.split(':')
     channel = implementations.insecure_channel(host, int(port))
@@ -178,8 +187,70 @@ class TensorflowModelServerTest(tf.test.TestCase):
     # Verify response
     self.assertTrue('y' in result.outputs)
     self.assertIs(types_pb2.DT_FLOAT, result.outputs['y'].dtype)
-    self.assertEquals(1, len(result.outputs['y'].float_val))
-    self.assertEquals(expected_output, result.outputs['y'].float_val[0])
+    if output_encoding == predict_pb2.PredictRequest.TENSOR_CONTENT:
+      self.assertEquals(0, len(result.outputs['y'].float_val))
+      self.assertEquals([expected_output],
+                        tf.contrib.util.make_ndarray(result.outputs['y']))
+    else:
+      self.assertEquals(1, len(result.outputs['y'].float_val))
+      self.assertEquals(expected_output, result.outputs['y'].float_val[0])
+
+  def VerifyStreamPredictRequests(self, model_server_address, expected_output):
+    """Send PredictionService.StreamPredict requests and verify outputs."""
+    print 'Sending StreamPredict requests...'
+    # Prepare requests; the last one asks for a missing model.
+    requests = []
+    for request_id in range(5):
+      stream_request = predict_pb2.StreamPredictRequest()
+      stream_request.request_id = request_id
+      request = stream_request.request
+      request.model_spec.name = 'default' if request_id < 4 else 'missing'
+      request.inputs['x'].dtype = types_pb2.DT_FLOAT
+      request.inputs['x'].float_val.append(2.0)
+      dim = request.inputs['x'].tensor_shape.dim.add()
+      dim.size = 1
+      requests.append(stream_request)
+    # Send requests
+    host, port = model_server_address.split(':')
+    channel = implementations.insecure_channel(host, int(port))
+    stub = prediction_service_pb2.beta_create_PredictionService_stub(channel)
+    results = list(stub.StreamPredict(iter(requests), RPC_TIMEOUT))
+    # Verify responses, which may arrive in any order
+    self.assertEquals(range(5), sorted(r.request_id for r in results))
+    for result in results:
+      if result.request_id < 4:
+        self.assertEquals(0, result.error_code)
+        self.assertEquals(expected_output,
+                          result.response.outputs['y'].float_val[0])
+      else:
+        self.assertNotEquals(0, result.error_code)
+        self.assertTrue(result.error_message)
+
+  def VerifyBatchPredictRequest(self, model_server_address, expected_output):
+    """Send PredictionService.BatchPredict request and verify output."""
+    print 'Sending BatchPredict request...'
+    # Prepare request; the last item asks for a missing model.
+    batch_request = predict_pb2.BatchPredictRequest()
+    for model_name in ['default', 'default', 'missing']:
+      request = batch_request.requests.add()
+      request.model_spec.name = model_name
+      request.inputs['x'].dtype = types_pb2.DT_FLOAT
+      request.inputs['x'].float_val.append(2.0)
+      dim = request.inputs['x'].tensor_shape.dim.add()
+      dim.size = 1
+    # Send request
+    host, port = model_server_address.split(':')
+    channel = implementations.insecure_channel(host, int(port))
+    stub = prediction_service_pb2.beta_create_PredictionService_stub(channel)
+    result = stub.BatchPredict(batch_request, RPC_TIMEOUT)  # 5 secs timeout
+    # Verify response
+    self.assertEquals(3, len(result.results))
+    for item in result.results[:2]:
+      self.assertEquals(0, item.error_code)
+      self.assertEquals(expected_output,
+                        item.response.outputs['y'].float_val[0])
+    self.assertNotEquals(0, result.results[2].error_code)
+    self.assertTrue(result.results[2].error_message)
 
   def _GetSavedModelBundlePath(self):
     """Returns a path to a model in SavedModel format."""
@@ -305,17 +376,23 @@ class TensorflowModelServerTest(tf.test.TestCase):
 
   def _TestPredict(self,
                    model_path,
-                   batching_parameters_file=''):
+                   batching_parameters_file='',
+                   enable_async_server=False):
     """Helper method to test prediction.
 
     Args:
       model_path:      Path to the model on disk.
       batching_parameters_file: Batching parameters file to use (if left empty,
                                 batching is not enabled).
+      enable_async_server: Whether to serve with the completion-queue server.
     """
     atexit.register(self.TerminateProcs)
-    model_server_address = self.RunServer(PickUnusedPort(), 'default',
-                                          model_path, batching_parameters_file)
+    model_server_address = self.RunServer(
+        PickUnusedPort(),
+        'default',
+        model_path,
+        batching_parameters_file,
+        enable_async_server=enable_async_server)
     self.VerifyPredictRequest(model_server_address, expected_output=3.0)
     self.VerifyPredictRequest(
         model_server_address, expected_output=3.0, specify_output=False)
@@ -330,6 +407,55 @@ class TensorflowModelServerTest(tf.test.TestCase):
     """Test PredictionService.Predict implementation with SavedModel."""
     self._TestPredict(self._GetSavedModelBundlePath())
 
+  def testPredictAsyncServer(self):
+    """Test PredictionService.Predict served by the asynchronous server."""
+    self._TestPredict(
+        self._GetSavedModelBundlePath(),
+        batching_parameters_file=self._GetBatchingParametersFile(),
+        enable_async_server=True)
+
+  def testPredictTensorContentEncoding(self):
+    """Test Predict outputs encoded as tensor_content, on both servers."""
+    atexit.register(self.TerminateProcs)
+    for enable_async_server in [False, True]:
+      model_server_address = self.RunServer(
+          PickUnusedPort(),
+          'default',
+          self._GetSavedModelBundlePath(),
+          enable_async_server=enable_async_server)
+      self.VerifyPredictRequest(
+          model_server_address,
+          expected_output=3.0,
+          output_encoding=predict_pb2.PredictRequest.TENSOR_CONTENT)
+      self.TerminateProcs()
+
+  def testStreamPredict(self):
+    """Test PredictionService.StreamPredict, on both servers."""
+    atexit.register(self.TerminateProcs)
+    for enable_async_server in [False, True]:
+      model_server_address = self.RunServer(
+          PickUnusedPort(),
+          'default',
+          self._GetSavedModelBundlePath(),
+          batching_parameters_file=self._GetBatchingParametersFile(),
+          enable_async_server=enable_async_server)
+      self.VerifyStreamPredictRequests(model_server_address,
+                                       expected_output=3.0)
+      self.TerminateProcs()
+
+  def testBatchPredict(self):
+    """Test PredictionService.BatchPredict, on both servers."""
+    atexit.register(self.TerminateProcs)
+    for enable_async_server in [False, True]:
+      model_server_address = self.RunServer(
+          PickUnusedPort(),
+          'default',
+          self._GetSavedModelBundlePath(),
+          batching_parameters_file=self._GetBatchingParametersFile(),
+          enable_async_server=enable_async_server)
+      self.VerifyBatchPredictRequest(model_server_address, expected_output=3.0)
+      self.TerminateProcs()
+
   def testPredictUpconvertedSavedModel(self):
     """Test PredictionService.Predict implementation.
 
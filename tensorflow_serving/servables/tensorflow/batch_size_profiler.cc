@@ -0,0 +1,214 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow_serving/servables/tensorflow/batch_size_profiler.h"
+
+#include <string.h>
+#include <algorithm>
+#include <limits>
+
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace serving {
+namespace {
+
+// How many times each batch size is timed, after a warm-up run.
+constexpr int kProfileRunsPerBatchSize = 5;
+
+// The default batch size of SharedBatchScheduler queues.
+constexpr int kDefaultMaxBatchSize = 1000;
+
+// Returns the median of how long 'session' takes to run 'inputs' 'num_runs'
+// times, in microseconds.
+Status TimeRuns(Session* session,
+                const std::vector<std::pair<string, Tensor>>& inputs,
+                const std::vector<string>& output_tensor_names,
+                const int num_runs, int64* latency_micros) {
+  std::vector<Tensor> outputs;
+  // Warm up.
+  TF_RETURN_IF_ERROR(session->Run(inputs, output_tensor_names, {}, &outputs));
+  std::vector<int64> run_micros;
+  for (int i = 0; i < num_runs; ++i) {
+    const uint64 start_micros = Env::Default()->NowMicros();
+    TF_RETURN_IF_ERROR(
+        session->Run(inputs, output_tensor_names, {}, &outputs));
+    run_micros.push_back(Env::Default()->NowMicros() - start_micros);
+  }
+  std::nth_element(run_micros.begin(), run_micros.begin() + num_runs / 2,
+                   run_micros.end());
+  *latency_micros = run_micros[num_runs / 2];
+  return Status::OK();
+}
+
+}  // namespace
+
+std::vector<int> ProfiledBatchSizes(const int max_batch_size) {
+  std::vector<int> batch_sizes;
+  for (int power_of_two = 1; power_of_two < max_batch_size;
+       power_of_two *= 2) {
+    batch_sizes.push_back(power_of_two);
+    const int midpoint = power_of_two + power_of_two / 2;
+    if (midpoint > power_of_two && midpoint < max_batch_size) {
+      batch_sizes.push_back(midpoint);
+    }
+  }
+  batch_sizes.push_back(max_batch_size);
+  return batch_sizes;
+}
+
+Status SynthesizeSignatureInputs(
+    const SignatureDef& signature, const int batch_size,
+    std::vector<std::pair<string, Tensor>>* inputs) {
+  for (const auto& entry : signature.inputs()) {
+    const TensorInfo& tensor_info = entry.second;
+    TensorShape shape({batch_size});
+    const TensorShapeProto& shape_proto = tensor_info.tensor_shape();
+    if (!shape_proto.unknown_rank()) {
+      for (int i = 1; i < shape_proto.dim_size(); ++i) {
+        shape.AddDim(std::max<int64>(1, shape_proto.dim(i).size()));
+      }
+    }
+    const DataType dtype = tensor_info.dtype();
+    Tensor tensor(dtype, shape);
+    if (DataTypeCanUseMemcpy(dtype)) {
+      memset(const_cast<char*>(tensor.tensor_data().data()), 0,
+             tensor.tensor_data().size());
+    } else if (dtype != DT_STRING) {
+      return errors::Unimplemented("Cannot synthesize input '", entry.first,
+                                   "' of type ", DataTypeString(dtype));
+    }
+    inputs->push_back({tensor_info.name(), tensor});
+  }
+  return Status::OK();
+}
+
+Status ProfileBatchLatencies(Session* session,
+                             const std::vector<SignatureDef>& signatures,
+                             const std::vector<int>& batch_sizes,
+                             const int num_runs,
+                             std::vector<int64>* latencies_micros) {
+  if (num_runs < 1) {
+    return errors::InvalidArgument("num_runs must be positive; was ",
+                                   num_runs);
+  }
+  latencies_micros->assign(batch_sizes.size(), 0);
+  bool profiled_any = false;
+  for (const SignatureDef& signature : signatures) {
+    std::vector<string> output_tensor_names;
+    for (const auto& entry : signature.outputs()) {
+      output_tensor_names.push_back(entry.second.name());
+    }
+    std::vector<int64> signature_latencies_micros;
+    Status status;
+    for (const int batch_size : batch_sizes) {
+      std::vector<std::pair<string, Tensor>> inputs;
+      status = SynthesizeSignatureInputs(signature, batch_size, &inputs);
+      int64 latency_micros = 0;
+      if (status.ok()) {
+        status = TimeRuns(session, inputs, output_tensor_names, num_runs,
+                          &latency_micros);
+      }
+      if (!status.ok()) {
+        break;
+      }
+      signature_latencies_micros.push_back(latency_micros);
+    }
+    if (!status.ok()) {
+      LOG(WARNING) << "Not profiling batch sizes for signature with method "
+                   << signature.method_name() << ": " << status;
+      continue;
+    }
+    profiled_any = true;
+    for (int i = 0; i < batch_sizes.size(); ++i) {
+      (*latencies_micros)[i] =
+          std::max((*latencies_micros)[i], signature_latencies_micros[i]);
+    }
+  }
+  if (!profiled_any) {
+    return errors::FailedPrecondition(
+        "None of the signatures could be run on synthetic inputs");
+  }
+  return Status::OK();
+}
+
+std::vector<int> ChooseAllowedBatchSizes(
+    const std::vector<int>& batch_sizes,
+    const std::vector<int64>& latencies_micros,
+    const int64 per_size_overhead_micros) {
+  const int num_sizes = batch_sizes.size();
+  if (num_sizes == 0) {
+    return {};
+  }
+  const double max_batch_size = batch_sizes.back();
+  // cost[j] is the least cost of covering the sizes up to batch_sizes[j] with
+  // allowed sizes that end with batch_sizes[j], and previous[j] the index of
+  // the allowed size before it (-1 for none).
+  std::vector<double> cost(num_sizes, std::numeric_limits<double>::max());
+  std::vector<int> previous(num_sizes, -1);
+  for (int j = 0; j < num_sizes; ++j) {
+    // Each size in (batch_sizes[i], batch_sizes[j]] is padded to
+    // batch_sizes[j].
+    for (int i = -1; i < j; ++i) {
+      const int covered_from = i < 0 ? 0 : batch_sizes[i];
+      const double candidate_cost =
+          (i < 0 ? 0 : cost[i]) + per_size_overhead_micros +
+          (batch_sizes[j] - covered_from) / max_batch_size *
+              latencies_micros[j];
+      if (candidate_cost < cost[j]) {
+        cost[j] = candidate_cost;
+        previous[j] = i;
+      }
+    }
+  }
+  std::vector<int> allowed_batch_sizes;
+  for (int j = num_sizes - 1; j >= 0; j = previous[j]) {
+    allowed_batch_sizes.push_back(batch_sizes[j]);
+  }
+  std::reverse(allowed_batch_sizes.begin(), allowed_batch_sizes.end());
+  return allowed_batch_sizes;
+}
+
+Status ProfileBatchingParameters(const BatchingParameters& batching_config,
+                                 Session* session,
+                                 const std::vector<SignatureDef>& signatures,
+                                 BatchingParameters* profiled_config) {
+  const int max_batch_size = batching_config.has_max_batch_size()
+                                 ? batching_config.max_batch_size().value()
+                                 : kDefaultMaxBatchSize;
+  const std::vector<int> batch_sizes = ProfiledBatchSizes(max_batch_size);
+  std::vector<int64> latencies_micros;
+  TF_RETURN_IF_ERROR(ProfileBatchLatencies(session, signatures, batch_sizes,
+                                           kProfileRunsPerBatchSize,
+                                           &latencies_micros));
+  const int64 per_size_overhead_micros =
+      batching_config.has_allowed_batch_size_overhead_micros()
+          ? batching_config.allowed_batch_size_overhead_micros().value()
+          : latencies_micros.back() / 100;
+
+  *profiled_config = batching_config;
+  profiled_config->clear_allowed_batch_sizes();
+  for (const int allowed_batch_size : ChooseAllowedBatchSizes(
+           batch_sizes, latencies_micros, per_size_overhead_micros)) {
+    profiled_config->add_allowed_batch_sizes(allowed_batch_size);
+  }
+  return Status::OK();
+}
+
+}  // namespace serving
+}  // namespace tensorflow
@@ -0,0 +1,84 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_SERVING_SERVABLES_TENSORFLOW_BATCH_SIZE_PROFILER_H_
+#define TENSORFLOW_SERVING_SERVABLES_TENSORFLOW_BATCH_SIZE_PROFILER_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/protobuf/meta_graph.pb.h"
+#include "tensorflow/core/public/session.h"
+#include "tensorflow_serving/servables/tensorflow/session_bundle_config.pb.h"
+
+namespace tensorflow {
+namespace serving {
+
+// Tools to derive BatchingParameters::allowed_batch_sizes from how long a
+// model actually takes to run batches of various sizes, rather than tuning
+// them by hand.
+
+// Returns the batch sizes worth profiling for a queue whose largest batch is
+// 'max_batch_size': 1, 2, 3, 4, 6, 8, 12, 16, ... (powers of two and the
+// midpoints between them), up to and including 'max_batch_size'.
+std::vector<int> ProfiledBatchSizes(int max_batch_size);
+
+// Creates zero-valued inputs (empty strings for DT_STRING) for a batch of
+// 'batch_size' to 'signature', with the shapes its TensorInfos declare. The
+// 0th dimension is the batch size, and other dimensions of unknown size are 1.
+Status SynthesizeSignatureInputs(
+    const SignatureDef& signature, int batch_size,
+    std::vector<std::pair<string, Tensor>>* inputs);
+
+// Measures how long 'session' takes to run a batch of each of 'batch_sizes',
+// in microseconds, on inputs from SynthesizeSignatureInputs(). Each batch size
+// is run 'num_runs' times, after a warm-up run, and the median is kept. With
+// several signatures, the slowest one counts. Signatures that fail to run on
+// synthetic inputs are skipped; it is an error if all of them do.
+Status ProfileBatchLatencies(Session* session,
+                             const std::vector<SignatureDef>& signatures,
+                             const std::vector<int>& batch_sizes, int num_runs,
+                             std::vector<int64>* latencies_micros);
+
+// Chooses the allowed batch sizes among 'batch_sizes', which must be in
+// increasing order, given how long batches of each size take to run. Each
+// batch is padded up to the next allowed size, and so runs as long as a batch
+// of that size; the choice minimizes the expected run time of a batch, with
+// every size up to the largest one equally likely, plus
+// 'per_size_overhead_micros' for each allowed size (e.g. to account for the
+// memory and warm-up that each distinct size costs). The largest of
+// 'batch_sizes' is always allowed.
+std::vector<int> ChooseAllowedBatchSizes(
+    const std::vector<int>& batch_sizes,
+    const std::vector<int64>& latencies_micros, int64 per_size_overhead_micros);
+
+// Profiles 'session' on 'signatures' for batch sizes up to
+// 'batching_config.max_batch_size()', and sets 'profiled_config' to
+// 'batching_config' with the allowed batch sizes chosen by
+// ChooseAllowedBatchSizes(). The per-size overhead is
+// 'batching_config.allowed_batch_size_overhead_micros()' if set, and 1% of
+// the run time of the largest batch otherwise.
+Status ProfileBatchingParameters(const BatchingParameters& batching_config,
+                                 Session* session,
+                                 const std::vector<SignatureDef>& signatures,
+                                 BatchingParameters* profiled_config);
+
+}  // namespace serving
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_SERVING_SERVABLES_TENSORFLOW_BATCH_SIZE_PROFILER_H_
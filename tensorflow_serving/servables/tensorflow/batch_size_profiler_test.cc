@@ -0,0 +1,140 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow_serving/servables/tensorflow/batch_size_profiler.h"
+
+#include <algorithm>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "tensorflow/cc/saved_model/loader.h"
+#include "tensorflow/cc/saved_model/tag_constants.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow_serving/test_util/test_util.h"
+
+namespace tensorflow {
+namespace serving {
+namespace {
+
+using ::testing::ElementsAre;
+
+// A signature that feeds half_plus_two's 'x' directly, rather than parsing
+// tf.Examples.
+SignatureDef HalfPlusTwoSignature() {
+  SignatureDef signature;
+  TensorInfo* input = &(*signature.mutable_inputs())["x"];
+  input->set_name("x:0");
+  input->set_dtype(DT_FLOAT);
+  input->mutable_tensor_shape()->add_dim()->set_size(-1);
+  TensorInfo* output = &(*signature.mutable_outputs())["y"];
+  output->set_name("y:0");
+  output->set_dtype(DT_FLOAT);
+  return signature;
+}
+
+TEST(BatchSizeProfilerTest, ProfiledBatchSizes) {
+  EXPECT_THAT(ProfiledBatchSizes(1), ElementsAre(1));
+  EXPECT_THAT(ProfiledBatchSizes(16), ElementsAre(1, 2, 3, 4, 6, 8, 12, 16));
+  EXPECT_THAT(ProfiledBatchSizes(20),
+              ElementsAre(1, 2, 3, 4, 6, 8, 12, 16, 20));
+}
+
+TEST(BatchSizeProfilerTest, SynthesizeSignatureInputs) {
+  SignatureDef signature;
+  TensorInfo* floats = &(*signature.mutable_inputs())["floats"];
+  floats->set_name("floats:0");
+  floats->set_dtype(DT_FLOAT);
+  floats->mutable_tensor_shape()->add_dim()->set_size(-1);
+  floats->mutable_tensor_shape()->add_dim()->set_size(2);
+  floats->mutable_tensor_shape()->add_dim()->set_size(-1);
+  TensorInfo* strings = &(*signature.mutable_inputs())["strings"];
+  strings->set_name("strings:0");
+  strings->set_dtype(DT_STRING);
+  strings->mutable_tensor_shape()->set_unknown_rank(true);
+
+  std::vector<std::pair<string, Tensor>> inputs;
+  TF_ASSERT_OK(SynthesizeSignatureInputs(signature, 3, &inputs));
+  ASSERT_EQ(2, inputs.size());
+  std::sort(inputs.begin(), inputs.end(),
+            [](const std::pair<string, Tensor>& a,
+               const std::pair<string, Tensor>& b) {
+              return a.first < b.first;
+            });
+  EXPECT_EQ("floats:0", inputs[0].first);
+  test::ExpectTensorEqual<float>(test::AsTensor<float>({0, 0, 0, 0, 0, 0},
+                                                       {3, 2, 1}),
+                                 inputs[0].second);
+  EXPECT_EQ("strings:0", inputs[1].first);
+  test::ExpectTensorEqual<string>(test::AsTensor<string>({"", "", ""}, {3}),
+                                  inputs[1].second);
+}
+
+TEST(BatchSizeProfilerTest, ChooseAllowedBatchSizes) {
+  const std::vector<int> batch_sizes = {1, 2, 4, 8};
+  // When batches take as long no matter their size, padding is free.
+  EXPECT_THAT(ChooseAllowedBatchSizes(batch_sizes, {100, 100, 100, 100}, 1),
+              ElementsAre(8));
+  // When they take time in proportion to their size, padding is not, and
+  // every size is worth its small overhead.
+  EXPECT_THAT(ChooseAllowedBatchSizes(batch_sizes, {100, 200, 400, 800}, 1),
+              ElementsAre(1, 2, 4, 8));
+  // With a large overhead, only the biggest savings are worth it.
+  EXPECT_THAT(ChooseAllowedBatchSizes(batch_sizes, {100, 200, 400, 800}, 150),
+              ElementsAre(4, 8));
+}
+
+TEST(BatchSizeProfilerTest, ProfileBatchingParameters) {
+  SavedModelBundle bundle;
+  TF_ASSERT_OK(LoadSavedModel(
+      SessionOptions(), RunOptions(),
+      test_util::TensorflowTestSrcDirPath("cc/saved_model/testdata/"
+                                          "half_plus_two/00000123"),
+      {kSavedModelTagServe}, &bundle));
+
+  std::vector<int64> latencies_micros;
+  TF_ASSERT_OK(ProfileBatchLatencies(bundle.session.get(),
+                                     {HalfPlusTwoSignature()}, {1, 2, 4}, 3,
+                                     &latencies_micros));
+  EXPECT_EQ(3, latencies_micros.size());
+
+  BatchingParameters batching_config;
+  batching_config.mutable_max_batch_size()->set_value(8);
+  batching_config.add_allowed_batch_sizes(5);
+  batching_config.add_allowed_batch_sizes(8);
+  batching_config.set_profile_allowed_batch_sizes(true);
+  BatchingParameters profiled_config;
+  TF_ASSERT_OK(ProfileBatchingParameters(batching_config,
+                                         bundle.session.get(),
+                                         {HalfPlusTwoSignature()},
+                                         &profiled_config));
+  EXPECT_EQ(8, profiled_config.max_batch_size().value());
+  ASSERT_GE(profiled_config.allowed_batch_sizes_size(), 1);
+  EXPECT_EQ(8, *profiled_config.allowed_batch_sizes().rbegin());
+  EXPECT_NE(5, profiled_config.allowed_batch_sizes(0));
+
+  // Signatures that can't run on synthetic inputs are skipped.
+  SignatureDef bad_signature = HalfPlusTwoSignature();
+  (*bad_signature.mutable_inputs())["x"].set_name("no_such_tensor:0");
+  TF_EXPECT_OK(ProfileBatchLatencies(bundle.session.get(),
+                                     {bad_signature, HalfPlusTwoSignature()},
+                                     {1, 2}, 1, &latencies_micros));
+  EXPECT_FALSE(ProfileBatchLatencies(bundle.session.get(), {bad_signature},
+                                     {1, 2}, 1, &latencies_micros)
+                   .ok());
+}
+
+}  // namespace
+}  // namespace serving
+}  // namespace tensorflow
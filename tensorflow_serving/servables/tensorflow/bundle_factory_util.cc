@@ -111,6 +111,33 @@ Status CreateBatchScheduler(const BatchingParameters& batching_config,
   return Batcher::Create(options, batch_scheduler);
 }
 
+Status CreateBatchExecutor(
+    const BatchingParameters& batching_config,
+    std::shared_ptr<FairShareBatchExecutor>* batch_executor) {
+  if (!batching_config.fair_share_batch_threads()) {
+    batch_executor->reset();
+    return Status::OK();
+  }
+  // The executor shares out the batch threads of the batch scheduler.
+  FairShareBatchExecutor::Options options;
+  if (batching_config.has_num_batch_threads()) {
+    options.num_threads = batching_config.num_batch_threads().value();
+  }
+  return FairShareBatchExecutor::Create(options, batch_executor);
+}
+
+FairShareBatchExecutor::QueueOptions GetExecutorQueueOptions(
+    const string& model_name, const ModelBatchShares* shares) {
+  const ModelBatchShares::Share share = shares == nullptr
+                                            ? ModelBatchShares::Share()
+                                            : shares->Lookup(model_name);
+  FairShareBatchExecutor::QueueOptions options;
+  options.name = model_name;
+  options.weight = share.weight;
+  options.priority = share.priority;
+  return options;
+}
+
 Status EstimateResourceFromPath(const string& path,
                                 ResourceAllocation* estimate) {
   TensorflowFileProbingEnv env(Env::Default());
@@ -150,6 +177,18 @@ Status WrapSessionForBatching(const BatchingParameters& batching_config,
                               std::shared_ptr<Batcher> batch_scheduler,
                               const std::vector<SignatureDef>& signatures,
                               std::unique_ptr<Session>* session) {
+  return WrapSessionForBatching(batching_config, std::move(batch_scheduler),
+                                nullptr, FairShareBatchExecutor::QueueOptions(),
+                                signatures, session);
+}
+
+Status WrapSessionForBatching(
+    const BatchingParameters& batching_config,
+    std::shared_ptr<Batcher> batch_scheduler,
+    std::shared_ptr<FairShareBatchExecutor> batch_executor,
+    const FairShareBatchExecutor::QueueOptions& executor_queue_options,
+    const std::vector<SignatureDef>& signatures,
+    std::unique_ptr<Session>* session) {
   LOG(INFO) << "Wrapping session to perform batch processing";
 
   if (batch_scheduler == nullptr) {
@@ -179,21 +218,132 @@ Status WrapSessionForBatching(const BatchingParameters& batching_config,
 
   batching_session_options.pad_variable_length_inputs = batching_config.pad_variable_length_inputs();
 
-  auto create_queue = [batch_scheduler, queue_options](
+  // Rather than rejecting requests larger than a batch, run them as several.
+  batching_session_options.max_task_size = queue_options.max_batch_size;
+
+  if (batching_config.has_target_queue_delay_micros()) {
+    AdmissionController::Options admission_control_options;
+    admission_control_options.target_queue_delay_micros =
+        batching_config.target_queue_delay_micros().value();
+    if (batching_config.has_queue_delay_interval_micros()) {
+      admission_control_options.interval_micros =
+          batching_config.queue_delay_interval_micros().value();
+    }
+    // Every task spends up to the batch timeout in an open batch, even when
+    // the queue is idle.
+    if (admission_control_options.target_queue_delay_micros <=
+        queue_options.batch_timeout_micros) {
+      return errors::InvalidArgument(
+          "target_queue_delay_micros must be greater than "
+          "batch_timeout_micros; was ",
+          admission_control_options.target_queue_delay_micros, " vs. ",
+          queue_options.batch_timeout_micros);
+    }
+    batching_session_options.admission_control_options =
+        admission_control_options;
+  }
+
+  if (batching_config.adaptive_batch_timeout()) {
+    BatchTimeoutController::Options batch_timeout_controller_options;
+    batch_timeout_controller_options.max_batch_size =
+        queue_options.max_batch_size;
+    batch_timeout_controller_options.max_batch_timeout_micros =
+        queue_options.batch_timeout_micros;
+    if (batching_config.has_min_batch_timeout_micros()) {
+      batch_timeout_controller_options.min_batch_timeout_micros =
+          batching_config.min_batch_timeout_micros().value();
+    }
+    if (batching_config.has_target_batch_latency_micros()) {
+      batch_timeout_controller_options.target_latency_micros =
+          batching_config.target_batch_latency_micros().value();
+    }
+    batching_session_options.batch_timeout_controller_options =
+        batch_timeout_controller_options;
+  }
+
+  if (batching_config.sequence_length_bucket_boundaries_size() > 0 ||
+      batching_config.num_learned_sequence_length_buckets() > 0) {
+    SequenceLengthBuckets::Options sequence_length_bucketing_options;
+    for (const int64 boundary :
+         batching_config.sequence_length_bucket_boundaries()) {
+      sequence_length_bucketing_options.bucket_boundaries.push_back(boundary);
+    }
+    sequence_length_bucketing_options.num_learned_buckets =
+        batching_config.num_learned_sequence_length_buckets();
+    sequence_length_bucketing_options.model_name = executor_queue_options.name;
+    batching_session_options.sequence_length_bucketing_options =
+        sequence_length_bucketing_options;
+  }
+
+  batching_session_options.earliest_deadline_first =
+      batching_config.earliest_deadline_first();
+
+  // With an executor, each batch scheduler queue gets an executor queue, and
+  // the batch threads run batches through it, which may keep a batch for a
+  // later batch thread to run, or reject it.
+  FairShareBatchExecutor::QueueOptions full_executor_queue_options =
+      executor_queue_options;
+  full_executor_queue_options.max_enqueued_batches =
+      queue_options.max_enqueued_batches;
+  auto run_on_executor = [batch_executor, full_executor_queue_options](
+      std::function<void(std::unique_ptr<Batch<BatchingSessionTask>>)>*
+          process_batch_callback) {
+    if (batch_executor == nullptr) {
+      return Status::OK();
+    }
+    std::unique_ptr<FairShareBatchExecutor::Queue> unique_executor_queue;
+    TF_RETURN_IF_ERROR(batch_executor->AddQueue(full_executor_queue_options,
+                                                &unique_executor_queue));
+    std::shared_ptr<FairShareBatchExecutor::Queue> executor_queue =
+        std::move(unique_executor_queue);
+    auto process_batch = *process_batch_callback;
+    *process_batch_callback = [executor_queue, process_batch](
+        std::unique_ptr<Batch<BatchingSessionTask>> batch) {
+      Batch<BatchingSessionTask>* raw_batch = batch.release();
+      const Status status = executor_queue->Schedule([process_batch,
+                                                      raw_batch] {
+        process_batch(std::unique_ptr<Batch<BatchingSessionTask>>(raw_batch));
+      });
+      if (!status.ok()) {
+        // The model has used up its share of the batch threads, and has as
+        // many batches kept as it may.
+        std::unique_ptr<Batch<BatchingSessionTask>> rejected(raw_batch);
+        rejected->WaitUntilClosed();
+        for (int i = 0; i < rejected->num_tasks(); ++i) {
+          rejected->mutable_task(i)->done(status);
+        }
+      }
+    };
+    return Status::OK();
+  };
+  auto create_queue = [batch_scheduler, queue_options, run_on_executor](
       std::function<void(std::unique_ptr<Batch<BatchingSessionTask>>)>
           process_batch_callback,
       std::unique_ptr<BatchScheduler<BatchingSessionTask>>* queue) {
+    TF_RETURN_IF_ERROR(run_on_executor(&process_batch_callback));
     TF_RETURN_IF_ERROR(batch_scheduler->AddQueue(
         queue_options, process_batch_callback, queue));
     return Status::OK();
   };
+  auto create_tuned_queue = [batch_scheduler, queue_options, run_on_executor](
+      const int64 batch_timeout_micros,
+      std::function<void(std::unique_ptr<Batch<BatchingSessionTask>>)>
+          process_batch_callback,
+      std::unique_ptr<BatchScheduler<BatchingSessionTask>>* queue) {
+    TF_RETURN_IF_ERROR(run_on_executor(&process_batch_callback));
+    Batcher::QueueOptions tuned_queue_options = queue_options;
+    tuned_queue_options.batch_timeout_micros = batch_timeout_micros;
+    TF_RETURN_IF_ERROR(batch_scheduler->AddQueue(
+        tuned_queue_options, process_batch_callback, queue));
+    return Status::OK();
+  };
   std::vector<SignatureWithBatchingSessionSchedulerCreator>
       signatures_with_scheduler_creators;
   for (const SignatureDef& signature : signatures) {
     const TensorSignature tensor_signature =
         TensorSignatureFromSignatureDef(signature);
     signatures_with_scheduler_creators.push_back(
-        {tensor_signature, create_queue});
+        {tensor_signature, create_queue, create_tuned_queue});
   }
 
   return CreateBatchingSession(batching_session_options,
@@ -22,7 +22,9 @@ limitations under the License.
 #include "tensorflow/core/public/session.h"
 #include "tensorflow/core/public/session_options.h"
 #include "tensorflow_serving/batching/batching_session.h"
+#include "tensorflow_serving/batching/fair_share_batch_executor.h"
 #include "tensorflow_serving/resources/resources.pb.h"
+#include "tensorflow_serving/servables/tensorflow/model_batch_shares.h"
 #include "tensorflow_serving/servables/tensorflow/session_bundle_config.pb.h"
 #include "tensorflow_serving/util/file_probing_env.h"
 
@@ -45,6 +47,19 @@ Status CreateBatchScheduler(
     std::shared_ptr<SharedBatchScheduler<BatchingSessionTask>>*
         batch_scheduler);
 
+// Creates the FairShareBatchExecutor that shares the batch threads out among
+// models, if the batching configuration enables 'fair_share_batch_threads'.
+// Otherwise leaves 'batch_executor' null.
+Status CreateBatchExecutor(
+    const BatchingParameters& batching_config,
+    std::shared_ptr<FairShareBatchExecutor>* batch_executor);
+
+// Returns the options of the FairShareBatchExecutor queue for the batches of
+// a version of the model named 'model_name', from the model's share in
+// 'shares', or the default share if 'shares' is null.
+FairShareBatchExecutor::QueueOptions GetExecutorQueueOptions(
+    const string& model_name, const ModelBatchShares* shares);
+
 // Estimates the resources a session bundle or saved model bundle will use once
 // loaded, from its export or saved model path. tensorflow::Env::Default() will
 // be used to access the file system.
@@ -72,6 +87,19 @@ Status WrapSessionForBatching(
     const std::vector<SignatureDef>& signatures,
     std::unique_ptr<Session>* session);
 
+// Same as above, but if 'batch_executor' is non-null, the batch threads of
+// 'batch_scheduler' run the batches through a queue of 'batch_executor' (with
+// 'executor_queue_options'). The maximum number of batches the queue keeps is
+// that of the batch scheduler queues; the tasks of batches beyond that fail
+// with UNAVAILABLE.
+Status WrapSessionForBatching(
+    const BatchingParameters& batching_config,
+    std::shared_ptr<SharedBatchScheduler<BatchingSessionTask>> batch_scheduler,
+    std::shared_ptr<FairShareBatchExecutor> batch_executor,
+    const FairShareBatchExecutor::QueueOptions& executor_queue_options,
+    const std::vector<SignatureDef>& signatures,
+    std::unique_ptr<Session>* session);
+
 // Wraps a session in a new session that only supports Run() without batching.
 Status WrapSession(std::unique_ptr<Session>* session);
 
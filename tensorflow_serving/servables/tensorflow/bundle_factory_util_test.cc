@@ -33,6 +33,7 @@ limitations under the License.
 #include "tensorflow/core/public/session_options.h"
 #include "tensorflow/core/public/version.h"
 #include "tensorflow_serving/batching/batching_session.h"
+#include "tensorflow_serving/batching/fair_share_batch_executor.h"
 #include "tensorflow_serving/resources/resources.pb.h"
 #include "tensorflow_serving/servables/tensorflow/bundle_factory_test_util.h"
 #include "tensorflow_serving/servables/tensorflow/session_bundle_config.pb.h"
@@ -120,6 +121,71 @@ TEST_F(BundleFactoryUtilTest, WrapSessionForBatching) {
   test_util::TestMultipleRequests(10, bundle.session.get());
 }
 
+TEST_F(BundleFactoryUtilTest, WrapSessionForBatchingWithAdaptiveTimeout) {
+  SessionBundle bundle;
+  TF_ASSERT_OK(LoadSessionBundleFromPathUsingRunOptions(
+      SessionOptions(), RunOptions(), export_dir_, &bundle));
+
+  BatchingParameters batching_params;
+  batching_params.mutable_max_batch_size()->set_value(2);
+  batching_params.mutable_batch_timeout_micros()->set_value(1000);
+  batching_params.mutable_max_enqueued_batches()->set_value(INT_MAX);
+  batching_params.set_adaptive_batch_timeout(true);
+  batching_params.mutable_target_batch_latency_micros()->set_value(100000);
+
+  std::shared_ptr<Batcher> batcher;
+  TF_ASSERT_OK(CreateBatchScheduler(batching_params, &batcher));
+  TF_ASSERT_OK(WrapSessionForBatching(batching_params, batcher,
+                                      {test_util::GetTestSessionSignature()},
+                                      &bundle.session));
+  test_util::TestMultipleRequests(10, bundle.session.get());
+}
+
+TEST_F(BundleFactoryUtilTest, WrapSessionForBatchingWithSequenceLengthBuckets) {
+  SessionBundle bundle;
+  TF_ASSERT_OK(LoadSessionBundleFromPathUsingRunOptions(
+      SessionOptions(), RunOptions(), export_dir_, &bundle));
+
+  BatchingParameters batching_params;
+  batching_params.mutable_max_batch_size()->set_value(2);
+  batching_params.mutable_max_enqueued_batches()->set_value(INT_MAX);
+  batching_params.set_pad_variable_length_inputs(true);
+  batching_params.add_sequence_length_bucket_boundaries(4);
+  batching_params.add_sequence_length_bucket_boundaries(16);
+
+  std::shared_ptr<Batcher> batcher;
+  TF_ASSERT_OK(CreateBatchScheduler(batching_params, &batcher));
+  TF_ASSERT_OK(WrapSessionForBatching(batching_params, batcher,
+                                      {test_util::GetTestSessionSignature()},
+                                      &bundle.session));
+  test_util::TestMultipleRequests(10, bundle.session.get());
+}
+
+TEST_F(BundleFactoryUtilTest, WrapSessionForBatchingOnFairShareExecutor) {
+  SessionBundle bundle;
+  TF_ASSERT_OK(LoadSessionBundleFromPathUsingRunOptions(
+      SessionOptions(), RunOptions(), export_dir_, &bundle));
+
+  BatchingParameters batching_params;
+  batching_params.mutable_max_batch_size()->set_value(2);
+  batching_params.mutable_max_enqueued_batches()->set_value(INT_MAX);
+  batching_params.set_fair_share_batch_threads(true);
+
+  std::shared_ptr<Batcher> batcher;
+  TF_ASSERT_OK(CreateBatchScheduler(batching_params, &batcher));
+  std::shared_ptr<FairShareBatchExecutor> batch_executor;
+  TF_ASSERT_OK(CreateBatchExecutor(batching_params, &batch_executor));
+  ASSERT_NE(nullptr, batch_executor);
+  FairShareBatchExecutor::QueueOptions executor_queue_options =
+      GetExecutorQueueOptions("model", nullptr /* shares */);
+  executor_queue_options.weight = 2;
+  TF_ASSERT_OK(WrapSessionForBatching(batching_params, batcher, batch_executor,
+                                      executor_queue_options,
+                                      {test_util::GetTestSessionSignature()},
+                                      &bundle.session));
+  test_util::TestMultipleRequests(10, bundle.session.get());
+}
+
 TEST_F(BundleFactoryUtilTest, BatchingConfigError) {
   BatchingParameters batching_params;
   batching_params.mutable_max_batch_size()->set_value(2);
@@ -131,6 +197,23 @@ TEST_F(BundleFactoryUtilTest, BatchingConfigError) {
   EXPECT_FALSE(CreateBatchScheduler(batching_params, &batch_scheduler).ok());
 }
 
+TEST_F(BundleFactoryUtilTest, AdmissionControlConfigError) {
+  SessionBundle bundle;
+  TF_ASSERT_OK(LoadSessionBundleFromPathUsingRunOptions(
+      SessionOptions(), RunOptions(), export_dir_, &bundle));
+  BatchingParameters batching_params;
+  batching_params.mutable_batch_timeout_micros()->set_value(1000);
+  // Tasks wait up to the batch timeout even when the queue is idle, so a
+  // lower target would shed load all the time.
+  batching_params.mutable_target_queue_delay_micros()->set_value(500);
+  std::shared_ptr<Batcher> batcher;
+  TF_ASSERT_OK(CreateBatchScheduler(batching_params, &batcher));
+  EXPECT_FALSE(WrapSessionForBatching(batching_params, batcher,
+                                      {test_util::GetTestSessionSignature()},
+                                      &bundle.session)
+                   .ok());
+}
+
 TEST_F(BundleFactoryUtilTest, EstimateResourceFromPathWithBadExport) {
   ResourceAllocation resource_requirement;
   const Status status =
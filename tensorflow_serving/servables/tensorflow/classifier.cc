@@ -155,10 +155,14 @@ class TensorFlowClassifier : public ClassifierInterface {
 // Implementation of the ClassifierInterface using SavedModel.
 class SavedModelTensorFlowClassifier : public ClassifierInterface {
  public:
-  explicit SavedModelTensorFlowClassifier(const RunOptions& run_options,
-                                          Session* session,
-                                          const SignatureDef* const signature)
-      : run_options_(run_options), session_(session), signature_(signature) {}
+  SavedModelTensorFlowClassifier(const RunOptions& run_options,
+                                 Session* session,
+                                 const SignatureDef* const signature,
+                                 RunMetadata* run_metadata)
+      : run_options_(run_options),
+        session_(session),
+        signature_(signature),
+        run_metadata_(run_metadata) {}
 
   ~SavedModelTensorFlowClassifier() override = default;
 
@@ -175,7 +179,7 @@ class SavedModelTensorFlowClassifier : public ClassifierInterface {
     int num_examples;
     TF_RETURN_IF_ERROR(PerformOneShotTensorComputation(
         run_options_, request.input(), input_tensor_name, output_tensor_names,
-        session_, &outputs, &num_examples));
+        session_, &outputs, &num_examples, run_metadata_));
 
     TRACELITERAL("ConvertToClassificationResult");
     return PostProcessClassificationResult(
@@ -186,6 +190,8 @@ class SavedModelTensorFlowClassifier : public ClassifierInterface {
   const RunOptions run_options_;
   Session* const session_;
   const SignatureDef* const signature_;
+  // Filled in by the session run, unless null.
+  RunMetadata* const run_metadata_;
 
   TF_DISALLOW_COPY_AND_ASSIGN(SavedModelTensorFlowClassifier);
 };
@@ -235,8 +241,9 @@ class SavedModelClassifier : public ClassifierInterface {
     SignatureDef signature;
     TF_RETURN_IF_ERROR(GetClassificationSignatureDef(
         request.model_spec(), bundle_->meta_graph_def, &signature));
-    SavedModelTensorFlowClassifier classifier(
-        run_options_, bundle_->session.get(), &signature);
+    SavedModelTensorFlowClassifier classifier(run_options_,
+                                              bundle_->session.get(),
+                                              &signature, nullptr);
     return classifier.Classify(request, result);
   }
 
@@ -272,13 +279,48 @@ Status CreateFlyweightTensorFlowClassifier(
 
 Status CreateFlyweightTensorFlowClassifier(
     const RunOptions& run_options, Session* session,
-    const SignatureDef* signature,
+    const SignatureDef* signature, RunMetadata* run_metadata,
     std::unique_ptr<ClassifierInterface>* service) {
-  service->reset(
-      new SavedModelTensorFlowClassifier(run_options, session, signature));
+  service->reset(new SavedModelTensorFlowClassifier(run_options, session,
+                                                    signature, run_metadata));
   return Status::OK();
 }
 
+void RunClassificationAsync(const RunOptions& run_options, Session* session,
+                            const SignatureDef* signature,
+                            RunMetadata* run_metadata,
+                            const ClassificationRequest& request,
+                            ClassificationResult* result,
+                            std::function<void(const Status&)> done) {
+  // What the run fills in, and post-processing reads.
+  struct RunState {
+    std::vector<string> output_tensor_names;
+    std::vector<Tensor> outputs;
+    int num_examples = 0;
+  };
+  std::shared_ptr<RunState> state(new RunState);
+  string input_tensor_name;
+  const Status status = PreProcessClassification(*signature, &input_tensor_name,
+                                                 &state->output_tensor_names);
+  if (!status.ok()) {
+    done(status);
+    return;
+  }
+  PerformOneShotTensorComputationAsync(
+      run_options, request.input(), input_tensor_name,
+      state->output_tensor_names, session, &state->outputs,
+      &state->num_examples, run_metadata,
+      [state, signature, result, done](const Status& run_status) {
+        if (!run_status.ok()) {
+          done(run_status);
+          return;
+        }
+        done(PostProcessClassificationResult(*signature, state->num_examples,
+                                             state->output_tensor_names,
+                                             state->outputs, result));
+      });
+}
+
 Status GetClassificationSignatureDef(const ModelSpec& model_spec,
                                      const MetaGraphDef& meta_graph_def,
                                      SignatureDef* signature) {
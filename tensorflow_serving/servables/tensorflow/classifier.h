@@ -18,6 +18,7 @@ limitations under the License.
 #ifndef TENSORFLOW_SERVING_SERVABLES_TENSORFLOW_CLASSIFIER_H_
 #define TENSORFLOW_SERVING_SERVABLES_TENSORFLOW_CLASSIFIER_H_
 
+#include <functional>
 #include <memory>
 
 #include "tensorflow/cc/saved_model/loader.h"
@@ -54,12 +55,24 @@ Status CreateFlyweightTensorFlowClassifier(
 // specified SignatureDef. Does not take ownership of the Session.
 // Useful in contexts where we need to avoid copying, e.g. if created per
 // request. The caller must ensure that the session and signature live at least
-// as long as the service.
+// as long as the service. If 'run_metadata' is non-null, the session run fills
+// it in, and it must live as long as well.
 Status CreateFlyweightTensorFlowClassifier(
     const RunOptions& run_options, Session* session,
-    const SignatureDef* signature,
+    const SignatureDef* signature, RunMetadata* run_metadata,
     std::unique_ptr<ClassifierInterface>* service);
 
+// Does what Classify() of a flyweight classifier from the above does, but runs
+// 'session' with RunSessionAsync() and calls 'done' with the outcome once
+// 'result' is filled in. 'session', 'signature', 'request', 'result' and
+// 'run_metadata' (unless null) must stay alive until then.
+void RunClassificationAsync(const RunOptions& run_options, Session* session,
+                            const SignatureDef* signature,
+                            RunMetadata* run_metadata,
+                            const ClassificationRequest& request,
+                            ClassificationResult* result,
+                            std::function<void(const Status&)> done);
+
 // Get a classification signature from the meta_graph_def that's either:
 // 1) The signature that model_spec explicitly specifies to use.
 // 2) The default serving signature.
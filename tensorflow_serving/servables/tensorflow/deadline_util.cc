@@ -0,0 +1,154 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_serving/servables/tensorflow/deadline_util.h"
+
+#include <algorithm>
+#include <memory>
+
+#include "tensorflow/core/framework/step_stats.pb.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/platform/env.h"
+
+namespace tensorflow {
+namespace serving {
+namespace {
+
+// The device and node under which SetSessionRunMicros() records the run time
+// in the step stats.
+constexpr char kSessionRunDevice[] = "/tensorflow_serving:session_run";
+constexpr char kSessionRunNode[] = "session_run";
+
+// Returns the time a successful 'fn' of RunWithDeadline() that was called at
+// 'start_micros' spent in its session run.
+int64 SessionRunMicros(const uint64 start_micros,
+                       const RunMetadata& run_metadata) {
+  const int64 run_micros = GetSessionRunMicros(run_metadata);
+  return run_micros >= 0 ? run_micros
+                         : Env::Default()->NowMicros() - start_micros;
+}
+
+}  // namespace
+
+uint64 DeadlineMicrosFromRunOptions(const RunOptions& run_options,
+                                    const uint64 now_micros) {
+  if (run_options.timeout_in_ms() <= 0) {
+    return kInfiniteDeadlineMicros;
+  }
+  return now_micros + run_options.timeout_in_ms() * 1000;
+}
+
+void SetRunOptionsTimeout(const uint64 deadline_micros,
+                          const uint64 now_micros, RunOptions* run_options) {
+  if (deadline_micros == kInfiniteDeadlineMicros) {
+    run_options->set_timeout_in_ms(0);
+    return;
+  }
+  const int64 remaining_micros =
+      deadline_micros > now_micros ? deadline_micros - now_micros : 0;
+  run_options->set_timeout_in_ms(
+      std::max<int64>(1, (remaining_micros + 999) / 1000));
+}
+
+Status CheckDeadline(const uint64 deadline_micros, const uint64 now_micros,
+                     const int64 estimated_micros, const StringPiece stage) {
+  if (deadline_micros == kInfiniteDeadlineMicros) {
+    return Status::OK();
+  }
+  if (deadline_micros <= now_micros) {
+    return errors::DeadlineExceeded("Deadline exceeded ", stage);
+  }
+  const uint64 remaining_micros = deadline_micros - now_micros;
+  if (estimated_micros > 0 &&
+      remaining_micros < static_cast<uint64>(estimated_micros)) {
+    return errors::DeadlineExceeded(
+        "Deadline can't be met ", stage, ": ", remaining_micros,
+        " microseconds left, but the work is expected to take ",
+        estimated_micros);
+  }
+  return Status::OK();
+}
+
+void SetSessionRunMicros(const uint64 start_micros, const int64 run_micros,
+                         RunMetadata* const run_metadata) {
+  DeviceStepStats* const device_stats =
+      run_metadata->mutable_step_stats()->add_dev_stats();
+  device_stats->set_device(kSessionRunDevice);
+  NodeExecStats* const node_stats = device_stats->add_node_stats();
+  node_stats->set_node_name(kSessionRunNode);
+  node_stats->set_all_start_micros(start_micros);
+  node_stats->set_all_end_rel_micros(run_micros);
+}
+
+int64 GetSessionRunMicros(const RunMetadata& run_metadata) {
+  for (const DeviceStepStats& device_stats :
+       run_metadata.step_stats().dev_stats()) {
+    if (device_stats.device() == kSessionRunDevice &&
+        device_stats.node_stats_size() > 0) {
+      return device_stats.node_stats(0).all_end_rel_micros();
+    }
+  }
+  return -1;
+}
+
+Status RunWithDeadline(
+    const RunOptions& run_options, const uint64 deadline_micros,
+    const int32 name_id, ExecutionTimeTracker* const tracker,
+    const std::function<Status(const RunOptions&, RunMetadata*)>& fn) {
+  const uint64 start_micros = Env::Default()->NowMicros();
+  TF_RETURN_IF_ERROR(CheckDeadline(deadline_micros, start_micros,
+                                   tracker->EstimateMicros(name_id),
+                                   "before running the model"));
+  RunOptions run_options_with_deadline = run_options;
+  SetRunOptionsTimeout(deadline_micros, start_micros,
+                       &run_options_with_deadline);
+  RunMetadata run_metadata;
+  TF_RETURN_IF_ERROR(fn(run_options_with_deadline, &run_metadata));
+  tracker->Record(name_id, SessionRunMicros(start_micros, run_metadata));
+  return Status::OK();
+}
+
+void RunWithDeadlineAsync(
+    const RunOptions& run_options, const uint64 deadline_micros,
+    const int32 name_id, ExecutionTimeTracker* const tracker,
+    const std::function<void(const RunOptions&, RunMetadata*,
+                             std::function<void(const Status&)>)>& fn,
+    std::function<void(const Status&)> done) {
+  const uint64 start_micros = Env::Default()->NowMicros();
+  const Status status =
+      CheckDeadline(deadline_micros, start_micros,
+                    tracker->EstimateMicros(name_id),
+                    "before running the model");
+  if (!status.ok()) {
+    done(status);
+    return;
+  }
+  RunOptions run_options_with_deadline = run_options;
+  SetRunOptionsTimeout(deadline_micros, start_micros,
+                       &run_options_with_deadline);
+  std::shared_ptr<RunMetadata> run_metadata(new RunMetadata);
+  fn(run_options_with_deadline, run_metadata.get(),
+     [start_micros, name_id, tracker, run_metadata,
+      done](const Status& fn_status) {
+       if (fn_status.ok()) {
+         tracker->Record(name_id,
+                         SessionRunMicros(start_micros, *run_metadata));
+       }
+       done(fn_status);
+     });
+}
+
+}  // namespace serving
+}  // namespace tensorflow
@@ -0,0 +1,94 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_SERVING_SERVABLES_TENSORFLOW_DEADLINE_UTIL_H_
+#define TENSORFLOW_SERVING_SERVABLES_TENSORFLOW_DEADLINE_UTIL_H_
+
+#include <functional>
+#include <limits>
+
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/stringpiece.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/protobuf/config.pb.h"
+#include "tensorflow_serving/core/execution_time_tracker.h"
+
+namespace tensorflow {
+namespace serving {
+
+// Requests carry their deadline as an absolute time in microseconds, on the
+// clock of Env::NowMicros(). Session::Run() only takes a relative timeout, so
+// the deadline is converted back to one just before each call.
+
+// The deadline of requests that have none.
+constexpr uint64 kInfiniteDeadlineMicros = std::numeric_limits<uint64>::max();
+
+// Returns the deadline implied by the timeout in 'run_options' for a call that
+// started at 'now_micros'. A timeout <= 0 means there is none.
+uint64 DeadlineMicrosFromRunOptions(const RunOptions& run_options,
+                                    uint64 now_micros);
+
+// Sets the timeout in 'run_options' to the time left until 'deadline_micros'.
+// Rounds up to whole milliseconds, and to at least one, since a timeout of 0
+// would mean there is none.
+void SetRunOptionsTimeout(uint64 deadline_micros, uint64 now_micros,
+                          RunOptions* run_options);
+
+// Returns DEADLINE_EXCEEDED if 'deadline_micros' is less than
+// 'estimated_micros' away from 'now_micros', i.e. if work that is expected to
+// take 'estimated_micros' can't finish in time. 'stage' names the point of
+// the check in the error message.
+Status CheckDeadline(uint64 deadline_micros, uint64 now_micros,
+                     int64 estimated_micros, StringPiece stage);
+
+// A session whose Run() calls wait before they are run, like a
+// BatchingSession, reports how long the run that served a call took in the
+// call's RunMetadata, so that the waiting can be told apart.
+
+// Records in 'run_metadata' that the run serving a call started at
+// 'start_micros' and took 'run_micros'.
+void SetSessionRunMicros(uint64 start_micros, int64 run_micros,
+                         RunMetadata* run_metadata);
+
+// Returns the run time recorded in 'run_metadata' by SetSessionRunMicros(),
+// or -1 if there is none.
+int64 GetSessionRunMicros(const RunMetadata& run_metadata);
+
+// Runs 'fn' on a copy of 'run_options' whose timeout is the time left until
+// 'deadline_micros', unless that is less than 'tracker' expects a session run
+// of the model with name id 'name_id' to take, in which case returns
+// DEADLINE_EXCEEDED without running it. 'fn' passes the RunMetadata it is
+// given on to its session run. If 'fn' succeeds, records in 'tracker' how long
+// the session run took: the time the session reported with
+// SetSessionRunMicros() if it did, or else the time 'fn' took.
+Status RunWithDeadline(
+    const RunOptions& run_options, uint64 deadline_micros, int32 name_id,
+    ExecutionTimeTracker* tracker,
+    const std::function<Status(const RunOptions&, RunMetadata*)>& fn);
+
+// Like RunWithDeadline(), for an 'fn' that may finish on another thread, by
+// calling the callback it is passed. The RunMetadata stays alive until then.
+// Calls 'done' with the outcome.
+void RunWithDeadlineAsync(
+    const RunOptions& run_options, uint64 deadline_micros, int32 name_id,
+    ExecutionTimeTracker* tracker,
+    const std::function<void(const RunOptions&, RunMetadata*,
+                             std::function<void(const Status&)>)>& fn,
+    std::function<void(const Status&)> done);
+
+}  // namespace serving
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_SERVING_SERVABLES_TENSORFLOW_DEADLINE_UTIL_H_
@@ -0,0 +1,158 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_serving/servables/tensorflow/deadline_util.h"
+
+#include <functional>
+#include <utility>
+
+#include <gtest/gtest.h>
+#include "tensorflow/core/framework/step_stats.pb.h"
+#include "tensorflow/core/lib/core/error_codes.pb.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+
+namespace tensorflow {
+namespace serving {
+namespace {
+
+TEST(DeadlineUtilTest, DeadlineMicrosFromRunOptions) {
+  RunOptions run_options;
+  EXPECT_EQ(kInfiniteDeadlineMicros,
+            DeadlineMicrosFromRunOptions(run_options, 1000));
+  run_options.set_timeout_in_ms(-1);
+  EXPECT_EQ(kInfiniteDeadlineMicros,
+            DeadlineMicrosFromRunOptions(run_options, 1000));
+  run_options.set_timeout_in_ms(5);
+  EXPECT_EQ(6000, DeadlineMicrosFromRunOptions(run_options, 1000));
+}
+
+TEST(DeadlineUtilTest, SetRunOptionsTimeout) {
+  RunOptions run_options;
+  SetRunOptionsTimeout(kInfiniteDeadlineMicros, 1000, &run_options);
+  EXPECT_EQ(0, run_options.timeout_in_ms());
+  SetRunOptionsTimeout(6000, 1000, &run_options);
+  EXPECT_EQ(5, run_options.timeout_in_ms());
+  SetRunOptionsTimeout(6000, 1500, &run_options);
+  EXPECT_EQ(5, run_options.timeout_in_ms());
+  // Never 0, which would mean no timeout.
+  SetRunOptionsTimeout(6000, 6000, &run_options);
+  EXPECT_EQ(1, run_options.timeout_in_ms());
+  SetRunOptionsTimeout(6000, 7000, &run_options);
+  EXPECT_EQ(1, run_options.timeout_in_ms());
+}
+
+TEST(DeadlineUtilTest, CheckDeadline) {
+  TF_EXPECT_OK(CheckDeadline(kInfiniteDeadlineMicros, 1000, 1000000, "now"));
+  TF_EXPECT_OK(CheckDeadline(2000, 1000, 0, "now"));
+  TF_EXPECT_OK(CheckDeadline(2000, 1000, 1000, "now"));
+  EXPECT_EQ(error::DEADLINE_EXCEEDED,
+            CheckDeadline(2000, 1000, 1001, "now").code());
+  EXPECT_EQ(error::DEADLINE_EXCEEDED,
+            CheckDeadline(2000, 2000, 0, "now").code());
+}
+
+TEST(DeadlineUtilTest, SessionRunMicros) {
+  RunMetadata run_metadata;
+  EXPECT_EQ(-1, GetSessionRunMicros(run_metadata));
+  run_metadata.mutable_step_stats()->add_dev_stats()->set_device("/cpu:0");
+  EXPECT_EQ(-1, GetSessionRunMicros(run_metadata));
+  SetSessionRunMicros(1000, 250, &run_metadata);
+  EXPECT_EQ(250, GetSessionRunMicros(run_metadata));
+}
+
+// The name ids of the models in the tests below.
+constexpr int32 kModel = 0;
+constexpr int32 kSlowModel = 1;
+
+TEST(DeadlineUtilTest, RunWithDeadline) {
+  ExecutionTimeTracker tracker;
+  const uint64 deadline_micros = Env::Default()->NowMicros() + 60 * 1000000;
+  int num_runs = 0;
+  auto fn = [&](const RunOptions& run_options, RunMetadata* run_metadata) {
+    ++num_runs;
+    EXPECT_GT(run_options.timeout_in_ms(), 0);
+    EXPECT_LE(run_options.timeout_in_ms(), 60 * 1000);
+    EXPECT_NE(nullptr, run_metadata);
+    return Status::OK();
+  };
+  TF_EXPECT_OK(
+      RunWithDeadline(RunOptions(), deadline_micros, kModel, &tracker, fn));
+  EXPECT_EQ(1, num_runs);
+
+  // A model that is expected to take longer than the time left isn't run.
+  tracker.Record(kSlowModel, 3600 * 1000000LL);
+  EXPECT_EQ(error::DEADLINE_EXCEEDED,
+            RunWithDeadline(RunOptions(), deadline_micros, kSlowModel,
+                            &tracker, fn)
+                .code());
+  EXPECT_EQ(1, num_runs);
+}
+
+TEST(DeadlineUtilTest, RunWithDeadlineRecordsReportedSessionRunTime) {
+  ExecutionTimeTracker tracker;
+  // Reports a run much longer than the call could have taken, e.g. a batch
+  // that the call waited for and that took long.
+  auto fn = [](const RunOptions& run_options, RunMetadata* run_metadata) {
+    SetSessionRunMicros(Env::Default()->NowMicros(), 3600 * 1000000LL,
+                        run_metadata);
+    return Status::OK();
+  };
+  TF_EXPECT_OK(RunWithDeadline(RunOptions(), kInfiniteDeadlineMicros, kModel,
+                               &tracker, fn));
+  EXPECT_LE(3600 * 1000000LL, tracker.EstimateMicros(kModel));
+}
+
+TEST(DeadlineUtilTest, RunWithDeadlineAsync) {
+  ExecutionTimeTracker tracker;
+  const uint64 deadline_micros = Env::Default()->NowMicros() + 60 * 1000000;
+  int num_runs = 0;
+  std::function<void(const Status&)> fn_done;
+  auto fn = [&](const RunOptions& run_options, RunMetadata* run_metadata,
+                std::function<void(const Status&)> done) {
+    ++num_runs;
+    EXPECT_GT(run_options.timeout_in_ms(), 0);
+    EXPECT_LE(run_options.timeout_in_ms(), 60 * 1000);
+    // Filled in after this returns, like a session run would.
+    fn_done = [run_metadata, done](const Status& status) {
+      SetSessionRunMicros(Env::Default()->NowMicros(), 1000, run_metadata);
+      done(status);
+    };
+  };
+  Status status = errors::Unknown("not done");
+  auto record_status = [&](const Status& done_status) {
+    status = done_status;
+  };
+  RunWithDeadlineAsync(RunOptions(), deadline_micros, kModel, &tracker, fn,
+                       record_status);
+  EXPECT_EQ(1, num_runs);
+  EXPECT_EQ(error::UNKNOWN, status.code());
+  fn_done(Status::OK());
+  TF_EXPECT_OK(status);
+  // The reported session run time was recorded.
+  EXPECT_EQ(1000 + 4 * 500, tracker.EstimateMicros(kModel));
+
+  // A model that is expected to take longer than the time left isn't run.
+  tracker.Record(kSlowModel, 3600 * 1000000LL);
+  RunWithDeadlineAsync(RunOptions(), deadline_micros, kSlowModel, &tracker,
+                       fn, record_status);
+  EXPECT_EQ(error::DEADLINE_EXCEEDED, status.code());
+  EXPECT_EQ(1, num_runs);
+}
+
+}  // namespace
+}  // namespace serving
+}  // namespace tensorflow
@@ -0,0 +1,35 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow_serving/servables/tensorflow/model_batch_shares.h"
+
+#include <utility>
+
+namespace tensorflow {
+namespace serving {
+
+void ModelBatchShares::Update(std::map<string, Share> shares) {
+  mutex_lock l(mu_);
+  shares_ = std::move(shares);
+}
+
+ModelBatchShares::Share ModelBatchShares::Lookup(
+    const string& model_name) const {
+  mutex_lock l(mu_);
+  auto it = shares_.find(model_name);
+  return it == shares_.end() ? Share() : it->second;
+}
+
+}  // namespace serving
+}  // namespace tensorflow
@@ -0,0 +1,77 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_SERVING_SERVABLES_TENSORFLOW_MODEL_BATCH_SHARES_H_
+#define TENSORFLOW_SERVING_SERVABLES_TENSORFLOW_MODEL_BATCH_SHARES_H_
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+namespace serving {
+
+// The batch thread shares configured for the models being served (see
+// ModelConfig::batch_weight and batch_priority), keyed by model name, for the
+// bundle factories to look up when they load a model version. ServerCore owns
+// an instance, keeps it up to date with its model configs, and hands it to the
+// source adapters that implement ModelBatchSharesUser.
+//
+// Thread-safe.
+class ModelBatchShares {
+ public:
+  struct Share {
+    // See FairShareBatchExecutor::QueueOptions.
+    double weight = 1.0;
+    int priority = 0;
+  };
+
+  ModelBatchShares() = default;
+  ~ModelBatchShares() = default;
+
+  // Replaces all shares with 'shares', keyed by model name.
+  void Update(std::map<string, Share> shares);
+
+  // Returns the share of the model named 'model_name'. A model without one
+  // gets the default weight and priority.
+  Share Lookup(const string& model_name) const;
+
+ private:
+  mutable mutex mu_;
+  std::map<string, Share> shares_ GUARDED_BY(mu_);
+
+  TF_DISALLOW_COPY_AND_ASSIGN(ModelBatchShares);
+};
+
+// Implemented by the source adapters whose bundle factories apply the batch
+// shares of the models they load, so that ServerCore can hand them its
+// ModelBatchShares.
+class ModelBatchSharesUser {
+ public:
+  virtual ~ModelBatchSharesUser() = default;
+
+  // Makes the versions loaded from now on look their model's share up in
+  // 'shares'. Until this is called, all models get the default share.
+  virtual void SetModelBatchShares(
+      std::shared_ptr<const ModelBatchShares> shares) = 0;
+};
+
+}  // namespace serving
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_SERVING_SERVABLES_TENSORFLOW_MODEL_BATCH_SHARES_H_
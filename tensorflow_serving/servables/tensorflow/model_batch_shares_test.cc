@@ -0,0 +1,50 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow_serving/servables/tensorflow/model_batch_shares.h"
+
+#include <gtest/gtest.h>
+
+namespace tensorflow {
+namespace serving {
+namespace {
+
+TEST(ModelBatchSharesTest, LooksUpByModelName) {
+  ModelBatchShares shares;
+  ModelBatchShares::Share share;
+  share.weight = 3;
+  share.priority = 1;
+  // Models are told apart by name even if they share a base path.
+  shares.Update({{"heavy", share}, {"light", ModelBatchShares::Share()}});
+
+  const ModelBatchShares::Share heavy = shares.Lookup("heavy");
+  EXPECT_EQ(3, heavy.weight);
+  EXPECT_EQ(1, heavy.priority);
+
+  const ModelBatchShares::Share light = shares.Lookup("light");
+  EXPECT_EQ(1, light.weight);
+  EXPECT_EQ(0, light.priority);
+
+  const ModelBatchShares::Share other = shares.Lookup("other");
+  EXPECT_EQ(1, other.weight);
+  EXPECT_EQ(0, other.priority);
+
+  // Updates replace all shares.
+  shares.Update({});
+  EXPECT_EQ(1, shares.Lookup("heavy").weight);
+}
+
+}  // namespace
+}  // namespace serving
+}  // namespace tensorflow
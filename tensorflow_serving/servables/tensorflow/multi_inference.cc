@@ -15,6 +15,8 @@ limitations under the License.
 
 #include "tensorflow_serving/servables/tensorflow/multi_inference.h"
 
+#include <memory>
+
 #include "tensorflow/cc/saved_model/signature_constants.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/platform/tracing.h"
@@ -31,10 +33,55 @@ Status TensorFlowMultiInferenceRunner::Infer(
     const RunOptions& run_options, const MultiInferenceRequest& request,
     MultiInferenceResponse* response) {
   TRACELITERAL("TensorFlowMultiInferenceRunner::Infer");
+  InferencePlan plan;
+  TF_RETURN_IF_ERROR(PlanInference(request, &plan));
 
+  std::vector<Tensor> outputs;
+  int num_examples;
+  TF_RETURN_IF_ERROR(PerformOneShotTensorComputation(
+      run_options, request.input(), plan.input_tensor_name,
+      plan.output_tensor_names, session_, &outputs, &num_examples,
+      nullptr /* run_metadata */));
+  return PostProcessResults(request, plan, num_examples, outputs, response);
+}
+
+void TensorFlowMultiInferenceRunner::InferAsync(
+    const RunOptions& run_options, const MultiInferenceRequest& request,
+    MultiInferenceResponse* response, std::function<void(const Status&)> done) {
+  TRACELITERAL("TensorFlowMultiInferenceRunner::InferAsync");
+  // What the run fills in, and post-processing reads.
+  struct RunState {
+    InferencePlan plan;
+    std::vector<Tensor> outputs;
+    int num_examples = 0;
+  };
+  std::shared_ptr<RunState> state(new RunState);
+  const Status status = PlanInference(request, &state->plan);
+  if (!status.ok()) {
+    done(status);
+    return;
+  }
+  PerformOneShotTensorComputationAsync(
+      run_options, request.input(), state->plan.input_tensor_name,
+      state->plan.output_tensor_names, session_, &state->outputs,
+      &state->num_examples, nullptr /* run_metadata */,
+      [state, &request, response, done](const Status& run_status) {
+        if (!run_status.ok()) {
+          done(run_status);
+          return;
+        }
+        done(PostProcessResults(request, state->plan, state->num_examples,
+                                state->outputs, response));
+      });
+}
+
+Status TensorFlowMultiInferenceRunner::PlanInference(
+    const MultiInferenceRequest& request, InferencePlan* plan) const {
   string model_name = "";
   string input_tensor_name = "";
   std::set<string> signature_names;
+  std::vector<const SignatureDef*>& signatures = plan->signatures;
+  signatures.reserve(request.tasks_size());
   std::set<string> output_tensor_name_set;
   for (const auto& task : request.tasks()) {
     if (task.model_spec().name().empty()) {
@@ -59,20 +106,21 @@ Status TensorFlowMultiInferenceRunner::Infer(
     }
     signature_names.insert(signature_name);
 
-    auto iter = meta_graph_def_->signature_def().find(signature_name);
-    if (iter == meta_graph_def_->signature_def().end()) {
+    const SignatureDef* signature = FindSignatureDef(signature_name);
+    if (signature == nullptr) {
       return errors::InvalidArgument(strings::StrCat(
           "Requested signature not found in model graph: ", signature_name));
     }
+    signatures.push_back(signature);
     string input_name;
     std::vector<string> output_names;
 
     if (task.method_name() == kClassifyMethodName) {
       TF_RETURN_IF_ERROR(
-          PreProcessClassification(iter->second, &input_name, &output_names));
+          PreProcessClassification(*signature, &input_name, &output_names));
     } else if (task.method_name() == kRegressMethodName) {
       TF_RETURN_IF_ERROR(
-          PreProcessRegression(iter->second, &input_name, &output_names));
+          PreProcessRegression(*signature, &input_name, &output_names));
     } else {
       return errors::Unimplemented("Unsupported signature method_name: ",
                                    task.method_name());
@@ -89,32 +137,26 @@ Status TensorFlowMultiInferenceRunner::Infer(
     }
   }
 
-  const std::vector<string> output_tensor_names(output_tensor_name_set.begin(),
-                                                output_tensor_name_set.end());
-
-  std::vector<Tensor> outputs;
-  int num_examples;
-  TF_RETURN_IF_ERROR(PerformOneShotTensorComputation(
-      run_options, request.input(), input_tensor_name, output_tensor_names,
-      session_, &outputs, &num_examples));
+  plan->input_tensor_name = input_tensor_name;
+  plan->output_tensor_names.assign(output_tensor_name_set.begin(),
+                                   output_tensor_name_set.end());
+  return Status::OK();
+}
 
+Status TensorFlowMultiInferenceRunner::PostProcessResults(
+    const MultiInferenceRequest& request, const InferencePlan& plan,
+    const int num_examples, const std::vector<Tensor>& outputs,
+    MultiInferenceResponse* response) {
   TRACELITERAL("PostProcessResults");
-  for (const auto& task : request.tasks()) {
-    const string signature_name = task.model_spec().signature_name().empty()
-                                      ? kDefaultServingSignatureDefKey
-                                      : task.model_spec().signature_name();
-    auto iter = meta_graph_def_->signature_def().find(signature_name);
-    if (iter == meta_graph_def_->signature_def().end()) {
-      return errors::InvalidArgument(strings::StrCat(
-          "Requested signature not found in model graph: ", signature_name));
-    }
+  for (int i = 0; i < request.tasks_size(); ++i) {
+    const InferenceTask& task = request.tasks(i);
     if (task.method_name() == kClassifyMethodName) {
       TF_RETURN_IF_ERROR(PostProcessClassificationResult(
-          iter->second, num_examples, output_tensor_names, outputs,
+          *plan.signatures[i], num_examples, plan.output_tensor_names, outputs,
           response->add_results()->mutable_classification_result()));
     } else if (task.method_name() == kRegressMethodName) {
       TF_RETURN_IF_ERROR(PostProcessRegressionResult(
-          iter->second, num_examples, output_tensor_names, outputs,
+          *plan.signatures[i], num_examples, plan.output_tensor_names, outputs,
           response->add_results()->mutable_regression_result()));
     } else {
       return errors::InvalidArgument("Unrecognized signature method_name: ",
@@ -124,6 +166,19 @@ Status TensorFlowMultiInferenceRunner::Infer(
   return Status::OK();
 }
 
+const SignatureDef* TensorFlowMultiInferenceRunner::FindSignatureDef(
+    const string& signature_name) const {
+  if (signature_plans_ != nullptr) {
+    const SignaturePlan* plan = signature_plans_->Find(signature_name);
+    return plan == nullptr ? nullptr : plan->signature_def;
+  }
+  auto iter = meta_graph_def_->signature_def().find(signature_name);
+  if (iter == meta_graph_def_->signature_def().end()) {
+    return nullptr;
+  }
+  return &iter->second;
+}
+
 namespace {
 
 const ModelSpec& GetModelSpecFromRequest(const MultiInferenceRequest& request) {
@@ -143,10 +198,45 @@ Status RunMultiInference(const RunOptions& run_options, ServerCore* core,
   TF_RETURN_IF_ERROR(
       core->GetServableHandle(GetModelSpecFromRequest(request), &bundle));
 
-  TensorFlowMultiInferenceRunner inference_runner(bundle->session.get(),
-                                                  &bundle->meta_graph_def);
+  std::shared_ptr<const SignaturePlans> signature_plans;
+  TF_RETURN_IF_ERROR(core->signature_plan_cache()->Get(
+      bundle.id(), bundle->meta_graph_def, &signature_plans));
+
+  TensorFlowMultiInferenceRunner inference_runner(
+      bundle->session.get(), &bundle->meta_graph_def, signature_plans.get());
   return inference_runner.Infer(run_options, request, response);
 }
 
+void RunMultiInferenceAsync(const RunOptions& run_options, ServerCore* core,
+                            const MultiInferenceRequest& request,
+                            MultiInferenceResponse* response,
+                            std::function<void(const Status&)> done) {
+  TRACELITERAL("RunMultiInferenceAsync");
+  // Shared with the callback below, so that the version stays loaded until
+  // the request is done.
+  std::shared_ptr<ServableHandle<SavedModelBundle>> bundle(
+      new ServableHandle<SavedModelBundle>);
+  Status status =
+      core->GetServableHandle(GetModelSpecFromRequest(request), bundle.get());
+  std::shared_ptr<const SignaturePlans> signature_plans;
+  if (status.ok()) {
+    status = core->signature_plan_cache()->Get(
+        bundle->id(), (*bundle)->meta_graph_def, &signature_plans);
+  }
+  if (!status.ok()) {
+    done(status);
+    return;
+  }
+
+  TensorFlowMultiInferenceRunner inference_runner(
+      (*bundle)->session.get(), &(*bundle)->meta_graph_def,
+      signature_plans.get());
+  inference_runner.InferAsync(
+      run_options, request, response,
+      [bundle, signature_plans, done](const Status& infer_status) {
+        done(infer_status);
+      });
+}
+
 }  // namespace serving
 }  // namespace tensorflow
@@ -16,10 +16,16 @@ limitations under the License.
 #ifndef LEARNING_SERVING_SERVABLES_TENSORFLOW_MULTI_INFERENCE_H_
 #define LEARNING_SERVING_SERVABLES_TENSORFLOW_MULTI_INFERENCE_H_
 
+#include <functional>
+#include <string>
+#include <vector>
+
 #include "tensorflow/contrib/session_bundle/session_bundle.h"
+#include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow_serving/apis/inference.pb.h"
 #include "tensorflow_serving/model_servers/server_core.h"
+#include "tensorflow_serving/servables/tensorflow/signature_plans.h"
 
 namespace tensorflow {
 namespace serving {
@@ -30,7 +36,17 @@ class TensorFlowMultiInferenceRunner {
  public:
   TensorFlowMultiInferenceRunner(Session* session,
                                  const MetaGraphDef* meta_graph_def)
-      : session_(session), meta_graph_def_(meta_graph_def) {}
+      : TensorFlowMultiInferenceRunner(session, meta_graph_def, nullptr) {}
+
+  // Looks signatures up in 'signature_plans', if non-null, rather than in
+  // 'meta_graph_def'. 'signature_plans' must have been built from
+  // 'meta_graph_def'.
+  TensorFlowMultiInferenceRunner(Session* session,
+                                 const MetaGraphDef* meta_graph_def,
+                                 const SignaturePlans* signature_plans)
+      : session_(session),
+        meta_graph_def_(meta_graph_def),
+        signature_plans_(signature_plans) {}
 
   // Run inference and return the inference results in the same order as the
   // InferenceTasks in the request.
@@ -38,17 +54,58 @@ class TensorFlowMultiInferenceRunner {
                const MultiInferenceRequest& request,
                MultiInferenceResponse* response);
 
+  // Like Infer(), but runs the session with RunSessionAsync() and calls 'done'
+  // with the outcome. 'request' and 'response', as well as the session and
+  // signatures this runner uses, must stay alive until then; the runner itself
+  // need not.
+  void InferAsync(const RunOptions& run_options,
+                  const MultiInferenceRequest& request,
+                  MultiInferenceResponse* response,
+                  std::function<void(const Status&)> done);
+
   virtual ~TensorFlowMultiInferenceRunner() = default;
 
  private:
+  // What a request runs through the session.
+  struct InferencePlan {
+    // The signature of each task, in the order of the tasks.
+    std::vector<const SignatureDef*> signatures;
+    string input_tensor_name;
+    std::vector<string> output_tensor_names;
+  };
+
+  // Validates the tasks of 'request' and plans their run.
+  Status PlanInference(const MultiInferenceRequest& request,
+                       InferencePlan* plan) const;
+
+  // Fills in a result of 'response' for each task of 'request' from the
+  // 'outputs' of running 'plan'.
+  static Status PostProcessResults(const MultiInferenceRequest& request,
+                                   const InferencePlan& plan, int num_examples,
+                                   const std::vector<Tensor>& outputs,
+                                   MultiInferenceResponse* response);
+
+  // Returns the signature called 'signature_name', or null if there is none.
+  const SignatureDef* FindSignatureDef(const string& signature_name) const;
+
   Session* const session_;
   const MetaGraphDef* const meta_graph_def_;
+  const SignaturePlans* const signature_plans_;
 };
 
 Status RunMultiInference(const RunOptions& run_options, ServerCore* core,
                          const MultiInferenceRequest& request,
                          MultiInferenceResponse* response);
 
+// Like RunMultiInference(), but runs the session with RunSessionAsync() and
+// calls 'done' with the outcome, which may be on another thread. Keeps the
+// servable version loaded until then. 'request' and 'response' must stay alive
+// until 'done' is called.
+void RunMultiInferenceAsync(const RunOptions& run_options, ServerCore* core,
+                            const MultiInferenceRequest& request,
+                            MultiInferenceResponse* response,
+                            std::function<void(const Status&)> done);
+
 }  // namespace serving
 }  // namespace tensorflow
 
@@ -21,6 +21,7 @@ limitations under the License.
 #include "tensorflow/cc/saved_model/signature_constants.h"
 #include "tensorflow/core/example/example.pb.h"
 #include "tensorflow/core/example/feature.pb.h"
+#include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow_serving/apis/input.pb.h"
 #include "tensorflow_serving/apis/regression.pb.h"
@@ -279,6 +280,44 @@ TEST_F(MultiInferenceTest, RegressAndClassifySignaturesTest) {
   EXPECT_THAT(response, test_util::EqualsProto(expected_response));
 }
 
+TEST_F(MultiInferenceTest, RunMultiInferenceAsyncTest) {
+  MultiInferenceRequest request;
+  AddInput({{"x", 2}}, &request);
+  PopulateTask("regress_x_to_y", kRegressMethodName, request.add_tasks());
+  PopulateTask("classify_x_to_y", kClassifyMethodName, request.add_tasks());
+
+  MultiInferenceResponse expected_response;
+  auto* regression_result =
+      expected_response.add_results()->mutable_regression_result();
+  regression_result->add_regressions()->set_value(3.0);
+  auto* classification_result =
+      expected_response.add_results()->mutable_classification_result();
+  classification_result->add_classifications()->add_classes()->set_score(3.0);
+
+  auto run_multi_inference_async = [&](const MultiInferenceRequest& request,
+                                       MultiInferenceResponse* response) {
+    Notification done;
+    Status status;
+    RunMultiInferenceAsync(RunOptions(), GetServerCore(), request, response,
+                           [&](const Status& run_status) {
+                             status = run_status;
+                             done.Notify();
+                           });
+    done.WaitForNotification();
+    return status;
+  };
+  MultiInferenceResponse response;
+  TF_ASSERT_OK(run_multi_inference_async(request, &response));
+  EXPECT_THAT(response, test_util::EqualsProto(expected_response));
+
+  // Invalid tasks fail through the callback as well.
+  PopulateTask("regress_x_to_y", kRegressMethodName, request.add_tasks());
+  MultiInferenceResponse duplicate_response;
+  ExpectStatusError(run_multi_inference_async(request, &duplicate_response),
+                    tensorflow::error::INVALID_ARGUMENT,
+                    "Duplicate evaluation of signature: regress_x_to_y");
+}
+
 }  // namespace
 }  // namespace serving
 }  // namespace tensorflow
@@ -15,6 +15,8 @@ limitations under the License.
 
 #include "tensorflow_serving/servables/tensorflow/predict_impl.h"
 
+#include <algorithm>
+#include <atomic>
 #include <map>
 #include <memory>
 #include <string>
@@ -26,24 +28,49 @@ limitations under the License.
 #include "tensorflow/contrib/session_bundle/session_bundle.h"
 #include "tensorflow/contrib/session_bundle/signature.h"
 #include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/notification.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/protobuf/named_tensor.pb.h"
+#include "tensorflow_serving/core/response_cache.h"
 #include "tensorflow_serving/core/servable_handle.h"
+#include "tensorflow_serving/servables/tensorflow/deadline_util.h"
+#include "tensorflow_serving/servables/tensorflow/serving_session.h"
+#include "tensorflow_serving/servables/tensorflow/signature_plans.h"
+#include "tensorflow_serving/servables/tensorflow/tensor_proto_util.h"
 
 namespace tensorflow {
 namespace serving {
 namespace {
 
+// Writes an output tensor into 'proto' using 'encoding', which must not be
+// SERVER_DEFAULT.
+void EncodeOutputTensor(const Tensor& tensor,
+                        const PredictRequest::OutputEncoding encoding,
+                        TensorProto* proto) {
+  if (encoding == PredictRequest::TENSOR_CONTENT) {
+    EncodeTensorProtoContent(tensor, proto);
+  } else {
+    tensor.AsProtoField(proto);
+  }
+}
+
 // Implementation of Predict using the legacy SessionBundle GenericSignature.
-Status SessionBundlePredict(const RunOptions& run_options, ServerCore* core,
+// The input tensors may borrow the bytes of 'request', and hold on to
+// 'request_owner' (if non-null) for as long as they do. The session run fills
+// in 'run_metadata'.
+Status SessionBundlePredict(const RunOptions& run_options,
+                            const SessionBundle& bundle,
                             const PredictRequest& request,
+                            std::shared_ptr<const void> request_owner,
+                            const PredictRequest::OutputEncoding encoding,
+                            RunMetadata* run_metadata,
                             PredictResponse* response) {
   // Validate signatures.
-  ServableHandle<SessionBundle> bundle;
-  TF_RETURN_IF_ERROR(core->GetServableHandle(request.model_spec(), &bundle));
   Signature signature;
   TF_RETURN_IF_ERROR(
-      GetNamedSignature("inputs", bundle->meta_graph_def, &signature));
+      GetNamedSignature("inputs", bundle.meta_graph_def, &signature));
   if (!signature.has_generic_signature()) {
     return tensorflow::Status(
         tensorflow::error::INVALID_ARGUMENT,
@@ -51,7 +78,7 @@ Status SessionBundlePredict(const RunOptions& run_options, ServerCore* core,
   }
   GenericSignature input_signature = signature.generic_signature();
   TF_RETURN_IF_ERROR(
-      GetNamedSignature("outputs", bundle->meta_graph_def, &signature));
+      GetNamedSignature("outputs", bundle.meta_graph_def, &signature));
   if (!signature.has_generic_signature()) {
     return tensorflow::Status(
         tensorflow::error::INVALID_ARGUMENT,
@@ -74,7 +101,7 @@ Status SessionBundlePredict(const RunOptions& run_options, ServerCore* core,
           "input tensor alias not found in signature: " + alias);
     }
     Tensor tensor;
-    if (!tensor.FromProto(input.second)) {
+    if (!DecodeTensorProto(input.second, request_owner, &tensor)) {
       return tensorflow::Status(tensorflow::error::INVALID_ARGUMENT,
                                 "tensor parsing error: " + alias);
     }
@@ -113,9 +140,8 @@ Status SessionBundlePredict(const RunOptions& run_options, ServerCore* core,
 
   // Run session.
   std::vector<Tensor> outputs;
-  RunMetadata run_metadata;
-  TF_RETURN_IF_ERROR(bundle->session->Run(
-      run_options, inputs, output_tensor_names, {}, &outputs, &run_metadata));
+  TF_RETURN_IF_ERROR(bundle.session->Run(
+      run_options, inputs, output_tensor_names, {}, &outputs, run_metadata));
 
   // Validate and return output.
   if (outputs.size() != output_tensor_names.size()) {
@@ -123,35 +149,27 @@ Status SessionBundlePredict(const RunOptions& run_options, ServerCore* core,
                               "Predict internal error");
   }
   for (int i = 0; i < outputs.size(); i++) {
-    outputs[i].AsProtoField(
-        &((*response->mutable_outputs())[output_aliases[i]]));
+    EncodeOutputTensor(outputs[i], encoding,
+                       &((*response->mutable_outputs())[output_aliases[i]]));
   }
 
   return Status::OK();
 }
 
-// Returns the keys in the map as a comma delimited string. Useful for debugging
-// or when returning error messages.
-// e.g. returns "key1, key2, key3".
-string MapKeysToString(const google::protobuf::Map<string, tensorflow::TensorInfo>& map) {
-  string result = "";
-  for (const auto& i : map) {
-    if (result.empty()) {
-      result += i.first;
-    } else {
-      result += ", " + i.first;
-    }
-  }
-  return result;
-}
-
-// Validate a SignatureDef to make sure it's compatible with prediction, and
-// if so, populate the input and output tensor names.
-Status PreProcessPrediction(const SignatureDef& signature,
-                            const PredictRequest& request,
-                            std::vector<std::pair<string, Tensor>>* inputs,
-                            std::vector<string>* output_tensor_names,
-                            std::vector<string>* output_tensor_aliases) {
+// Validate a signature to make sure it's compatible with prediction, and
+// if so, populate the input tensors and point 'output_tensor_names' and
+// 'output_tensor_aliases' at what to fetch. Unless the request filters its
+// outputs, those are the plan's own lists; otherwise they are the 'filtered_'
+// ones.
+Status PreProcessPrediction(
+    const SignaturePlan& plan, const PredictRequest& request,
+    const std::shared_ptr<const void>& request_owner,
+    std::vector<std::pair<string, Tensor>>* inputs,
+    std::vector<string>* filtered_output_tensor_names,
+    std::vector<string>* filtered_output_tensor_aliases,
+    const std::vector<string>** output_tensor_names,
+    const std::vector<string>** output_tensor_aliases) {
+  const SignatureDef& signature = *plan.signature_def;
   if (signature.method_name() != kPredictMethodName &&
       signature.method_name() != kClassifyMethodName &&
       signature.method_name() != kRegressMethodName) {
@@ -160,135 +178,619 @@ Status PreProcessPrediction(const SignatureDef& signature,
         kPredictMethodName, ", ", kClassifyMethodName, ", ", kRegressMethodName,
         "}. Was: ", signature.method_name()));
   }
-  if (signature.inputs().empty()) {
+  if (plan.inputs.empty()) {
     return errors::Internal(strings::StrCat(
         "Expected at least one input Tensor in prediction signature."));
   }
-  if (signature.outputs().empty()) {
+  if (plan.outputs.empty()) {
     return errors::Internal(strings::StrCat(
         "Expected at least one output Tensor in prediction signature."));
   }
 
   // Verify and prepare input.
-  if (request.inputs().size() != signature.inputs().size()) {
+  if (request.inputs().size() != plan.inputs.size()) {
     return tensorflow::Status(tensorflow::error::INVALID_ARGUMENT,
                               "input size does not match signature");
   }
+  inputs->reserve(request.inputs().size());
   for (auto& input : request.inputs()) {
     const string& alias = input.first;
-    auto iter = signature.inputs().find(alias);
-    if (iter == signature.inputs().end()) {
+    auto iter = plan.inputs.find(alias);
+    if (iter == plan.inputs.end()) {
       return tensorflow::Status(
           tensorflow::error::INVALID_ARGUMENT,
           strings::StrCat("input tensor alias not found in signature: ", alias,
                           ". Inputs expected to be in the set {",
-                          MapKeysToString(signature.inputs()), "}."));
+                          plan.input_aliases, "}."));
     }
     Tensor tensor;
-    if (!tensor.FromProto(input.second)) {
+    if (!DecodeTensorProto(input.second, request_owner, &tensor)) {
       return tensorflow::Status(tensorflow::error::INVALID_ARGUMENT,
                                 "tensor parsing error: " + alias);
     }
-    inputs->emplace_back(std::make_pair(iter->second.name(), tensor));
+    TF_RETURN_IF_ERROR(ValidateInputTensor(alias, iter->second, tensor));
+    inputs->emplace_back(iter->second.name, std::move(tensor));
+  }
+
+  // When no output is specified, fetch all output tensors specified in
+  // the signature.
+  if (request.output_filter().empty()) {
+    *output_tensor_names = &plan.default_output_tensor_names;
+    *output_tensor_aliases = &plan.default_output_aliases;
+    return Status::OK();
   }
 
   // Prepare run target.
-  std::set<string> seen_outputs;
-  std::vector<string> output_filter(request.output_filter().begin(),
-                                    request.output_filter().end());
-  for (auto& alias : output_filter) {
-    auto iter = signature.outputs().find(alias);
-    if (iter == signature.outputs().end()) {
+  filtered_output_tensor_names->reserve(request.output_filter().size());
+  filtered_output_tensor_aliases->reserve(request.output_filter().size());
+  for (const string& alias : request.output_filter()) {
+    auto iter = plan.outputs.find(alias);
+    if (iter == plan.outputs.end()) {
       return tensorflow::Status(
           tensorflow::error::INVALID_ARGUMENT,
           strings::StrCat("output tensor alias not found in signature: ", alias,
                           " Outputs expected to be in the set {",
-                          MapKeysToString(signature.outputs()), "}."));
+                          plan.output_aliases, "}."));
     }
-    if (seen_outputs.find(alias) != seen_outputs.end()) {
+    // Filters are short, so a linear scan beats building a set.
+    if (std::find(filtered_output_tensor_aliases->begin(),
+                  filtered_output_tensor_aliases->end(),
+                  alias) != filtered_output_tensor_aliases->end()) {
       return tensorflow::Status(tensorflow::error::INVALID_ARGUMENT,
                                 "duplicate output tensor alias: " + alias);
     }
-    seen_outputs.insert(alias);
-    output_tensor_names->emplace_back(iter->second.name());
-    output_tensor_aliases->emplace_back(alias);
-  }
-  // When no output is specified, fetch all output tensors specified in
-  // the signature.
-  if (output_tensor_names->empty()) {
-    for (auto& iter : signature.outputs()) {
-      output_tensor_names->emplace_back(iter.second.name());
-      output_tensor_aliases->emplace_back(iter.first);
-    }
+    filtered_output_tensor_names->push_back(iter->second.name);
+    filtered_output_tensor_aliases->push_back(alias);
   }
+  *output_tensor_names = filtered_output_tensor_names;
+  *output_tensor_aliases = filtered_output_tensor_aliases;
   return Status::OK();
 }
 
 // Validate results and populate a PredictResponse.
 Status PostProcessPredictionResult(
-    const SignatureDef& signature,
     const std::vector<string>& output_tensor_aliases,
-    const std::vector<Tensor>& output_tensors, PredictResponse* response) {
+    const std::vector<Tensor>& output_tensors,
+    const PredictRequest::OutputEncoding encoding, PredictResponse* response) {
   // Validate and return output.
   if (output_tensors.size() != output_tensor_aliases.size()) {
     return tensorflow::Status(tensorflow::error::UNKNOWN,
                               "Predict internal error");
   }
   for (int i = 0; i < output_tensors.size(); i++) {
-    output_tensors[i].AsProtoField(
+    EncodeOutputTensor(
+        output_tensors[i], encoding,
         &((*response->mutable_outputs())[output_tensor_aliases[i]]));
   }
   return Status::OK();
 }
 
-// Implementation of Predict using the SavedModel SignatureDef format.
-Status SavedModelPredict(const RunOptions& run_options, ServerCore* core,
-                         const PredictRequest& request,
-                         PredictResponse* response) {
-  // Validate signatures.
-  ServableHandle<SavedModelBundle> bundle;
-  TF_RETURN_IF_ERROR(core->GetServableHandle(request.model_spec(), &bundle));
-
-  const string signature_name = request.model_spec().signature_name().empty()
-                                    ? kDefaultServingSignatureDefKey
-                                    : request.model_spec().signature_name();
-  auto iter = bundle->meta_graph_def.signature_def().find(signature_name);
-  if (iter == bundle->meta_graph_def.signature_def().end()) {
+// Looks up the plan of the signature 'request' asks for.
+Status FindPredictPlan(const SignaturePlans& plans,
+                       const PredictRequest& request,
+                       const SignaturePlan** plan) {
+  *plan = plans.Find(request.model_spec().signature_name());
+  if (*plan == nullptr) {
+    const string signature_name =
+        request.model_spec().signature_name().empty()
+            ? kDefaultServingSignatureDefKey
+            : request.model_spec().signature_name();
     return errors::FailedPrecondition(strings::StrCat(
         "Serving signature key \"", signature_name, "\" not found."));
   }
-  SignatureDef signature = iter->second;
+  return Status::OK();
+}
+
+// Implementation of Predict using the SavedModel SignatureDef format, as
+// resolved ahead of time in 'plans'.
+Status SavedModelPredict(const RunOptions& run_options,
+                         const SavedModelBundle& bundle,
+                         const SignaturePlans& plans,
+                         const PredictRequest& request,
+                         std::shared_ptr<const void> request_owner,
+                         const PredictRequest::OutputEncoding encoding,
+                         RunMetadata* run_metadata,
+                         PredictResponse* response) {
+  // Validate signatures.
+  const SignaturePlan* plan;
+  TF_RETURN_IF_ERROR(FindPredictPlan(plans, request, &plan));
 
   std::vector<std::pair<string, Tensor>> input_tensors;
-  std::vector<string> output_tensor_names;
-  std::vector<string> output_tensor_aliases;
-  TF_RETURN_IF_ERROR(PreProcessPrediction(signature, request, &input_tensors,
-                                          &output_tensor_names,
-                                          &output_tensor_aliases));
+  std::vector<string> filtered_output_tensor_names;
+  std::vector<string> filtered_output_tensor_aliases;
+  const std::vector<string>* output_tensor_names;
+  const std::vector<string>* output_tensor_aliases;
+  TF_RETURN_IF_ERROR(PreProcessPrediction(
+      *plan, request, request_owner, &input_tensors,
+      &filtered_output_tensor_names, &filtered_output_tensor_aliases,
+      &output_tensor_names, &output_tensor_aliases));
   std::vector<Tensor> outputs;
-  RunMetadata run_metadata;
-  TF_RETURN_IF_ERROR(bundle->session->Run(run_options, input_tensors,
-                                          output_tensor_names, {}, &outputs,
-                                          &run_metadata));
+  TF_RETURN_IF_ERROR(bundle.session->Run(run_options, input_tensors,
+                                          *output_tensor_names, {}, &outputs,
+                                          run_metadata));
 
-  return PostProcessPredictionResult(signature, output_tensor_aliases, outputs,
+  return PostProcessPredictionResult(*output_tensor_aliases, outputs, encoding,
                                      response);
 }
 
+// The state of a SavedModelPredictAsync() call that has to outlive it.
+struct PredictCall {
+  // Keep the version and its plans alive until the session run is done.
+  std::shared_ptr<ServableHandle<SavedModelBundle>> bundle;
+  std::shared_ptr<const SignaturePlans> plans;
+
+  std::vector<std::pair<string, Tensor>> input_tensors;
+  std::vector<string> filtered_output_tensor_names;
+  std::vector<string> filtered_output_tensor_aliases;
+  const std::vector<string>* output_tensor_names;
+  const std::vector<string>* output_tensor_aliases;
+  std::vector<Tensor> outputs;
+};
+
+// Asynchronous counterpart of SavedModelPredict(). 'call->bundle' and
+// 'call->plans' must be set. 'run_metadata' must stay alive until 'done' is
+// called.
+void SavedModelPredictAsync(const RunOptions& run_options,
+                            std::shared_ptr<PredictCall> call,
+                            const PredictRequest& request,
+                            std::shared_ptr<const void> request_owner,
+                            const PredictRequest::OutputEncoding encoding,
+                            RunMetadata* run_metadata,
+                            PredictResponse* response,
+                            std::function<void(const Status&)> done) {
+  const SignaturePlan* plan;
+  Status status = FindPredictPlan(*call->plans, request, &plan);
+  if (status.ok()) {
+    status = PreProcessPrediction(
+        *plan, request, request_owner, &call->input_tensors,
+        &call->filtered_output_tensor_names,
+        &call->filtered_output_tensor_aliases, &call->output_tensor_names,
+        &call->output_tensor_aliases);
+  }
+  if (!status.ok()) {
+    done(status);
+    return;
+  }
+  Session* const session = (*call->bundle)->session.get();
+  RunSessionAsync(session, run_options, call->input_tensors,
+                  *call->output_tensor_names, &call->outputs, run_metadata,
+                  [call, encoding, response, done](const Status& run_status) {
+                    if (!run_status.ok()) {
+                      done(run_status);
+                      return;
+                    }
+                    done(PostProcessPredictionResult(
+                        *call->output_tensor_aliases, call->outputs, encoding,
+                        response));
+                  });
+}
+
+Status RunPredict(const RunOptions& run_options, ServerCore* core,
+                  const ServableHandle<SessionBundle>& bundle,
+                  const PredictRequest& request,
+                  std::shared_ptr<const void> request_owner,
+                  const PredictRequest::OutputEncoding encoding,
+                  RunMetadata* run_metadata, PredictResponse* response) {
+  return SessionBundlePredict(run_options, *bundle, request,
+                              std::move(request_owner), encoding, run_metadata,
+                              response);
+}
+
+Status RunPredict(const RunOptions& run_options, ServerCore* core,
+                  const ServableHandle<SavedModelBundle>& bundle,
+                  const PredictRequest& request,
+                  std::shared_ptr<const void> request_owner,
+                  const PredictRequest::OutputEncoding encoding,
+                  RunMetadata* run_metadata, PredictResponse* response) {
+  std::shared_ptr<const SignaturePlans> plans;
+  TF_RETURN_IF_ERROR(core->signature_plan_cache()->Get(
+      bundle.id(), bundle->meta_graph_def, &plans));
+  return SavedModelPredict(run_options, *bundle, *plans, request,
+                           std::move(request_owner), encoding, run_metadata,
+                           response);
+}
+
+void RunPredictAsync(const RunOptions& run_options, ServerCore* core,
+                     std::shared_ptr<ServableHandle<SavedModelBundle>> bundle,
+                     const PredictRequest& request,
+                     std::shared_ptr<const void> request_owner,
+                     const PredictRequest::OutputEncoding encoding,
+                     RunMetadata* run_metadata, PredictResponse* response,
+                     std::function<void(const Status&)> done) {
+  std::shared_ptr<PredictCall> call(new PredictCall);
+  const Status status = core->signature_plan_cache()->Get(
+      bundle->id(), (*bundle)->meta_graph_def, &call->plans);
+  if (!status.ok()) {
+    done(status);
+    return;
+  }
+  call->bundle = std::move(bundle);
+  SavedModelPredictAsync(run_options, std::move(call), request,
+                         std::move(request_owner), encoding, run_metadata,
+                         response, std::move(done));
+}
+
+// Checks the parts of 'request' that don't depend on the model, and resolves
+// the encoding of its outputs.
+Status ValidatePredictRequest(
+    const PredictRequest& request,
+    const PredictRequest::OutputEncoding default_encoding,
+    PredictRequest::OutputEncoding* encoding) {
+  if (!request.has_model_spec()) {
+    return tensorflow::Status(tensorflow::error::INVALID_ARGUMENT,
+                              "Missing ModelSpec");
+  }
+  if (!PredictRequest::OutputEncoding_IsValid(request.output_encoding())) {
+    return errors::InvalidArgument("Unknown output_encoding: ",
+                                   request.output_encoding());
+  }
+  *encoding = request.output_encoding() == PredictRequest::SERVER_DEFAULT
+                  ? default_encoding
+                  : request.output_encoding();
+  return Status::OK();
+}
+
+// Returns DEADLINE_EXCEEDED if a request to the model with name id 'name_id'
+// can't be served by 'deadline_micros', before any work is done on it.
+Status CheckPredictDeadline(ServerCore* core, const int32 name_id,
+                            const uint64 deadline_micros) {
+  return CheckDeadline(deadline_micros, Env::Default()->NowMicros(),
+                       core->execution_time_tracker()->EstimateMicros(name_id),
+                       "before acquiring the servable handle");
+}
+
+// Runs 'request' against 'bundle' unless it can't be done by
+// 'deadline_micros', or serves it from the model's response cache if it has
+// one. 'name_id' is the id of the model's name.
+template <typename Bundle>
+Status RunPredictWithCache(const RunOptions& run_options,
+                           const uint64 deadline_micros, ServerCore* core,
+                           const int32 name_id,
+                           const ServableHandle<Bundle>& bundle,
+                           const PredictRequest& request,
+                           const std::shared_ptr<const void>& request_owner,
+                           const PredictRequest::OutputEncoding encoding,
+                           PredictResponse* response) {
+  const std::shared_ptr<ResponseCache> cache =
+      core->GetResponseCache(bundle.id().name);
+  return LookupOrComputeResponse(
+      cache.get(), bundle.id(), "Predict", request, response, [&]() {
+        return RunWithDeadline(
+            run_options, deadline_micros, name_id,
+            core->execution_time_tracker(),
+            [&](const RunOptions& run_options_with_deadline,
+                RunMetadata* run_metadata) {
+              return RunPredict(run_options_with_deadline, core, bundle,
+                                request, request_owner, encoding, run_metadata,
+                                response);
+            });
+      });
+}
+
+// Asynchronous counterpart of RunPredictWithCache(), for SavedModelBundles.
+// 'bundle' is shared with the callbacks, so that the version stays loaded
+// until the request is done.
+void RunPredictWithCacheAsync(
+    const RunOptions& run_options, const uint64 deadline_micros,
+    ServerCore* core, const int32 name_id,
+    std::shared_ptr<ServableHandle<SavedModelBundle>> bundle,
+    const PredictRequest& request,
+    const std::shared_ptr<const void>& request_owner,
+    const PredictRequest::OutputEncoding encoding, PredictResponse* response,
+    std::function<void(const Status&)> done) {
+  // The lambdas passed in here run before the calls they are passed to
+  // return; only the callbacks they pass on outlive this function.
+  LookupOrComputeResponseAsync(
+      core->GetResponseCache(bundle->id().name), bundle->id(), "Predict",
+      request, response,
+      [&](std::function<void(const Status&)> compute_done) {
+        RunWithDeadlineAsync(
+            run_options, deadline_micros, name_id,
+            core->execution_time_tracker(),
+            [&](const RunOptions& run_options_with_deadline,
+                RunMetadata* run_metadata,
+                std::function<void(const Status&)> run_done) {
+              RunPredictAsync(run_options_with_deadline, core, bundle, request,
+                              request_owner, encoding, run_metadata, response,
+                              std::move(run_done));
+            },
+            std::move(compute_done));
+      },
+      std::move(done));
+}
+
+template <typename Bundle>
+Status PredictWithBundle(const RunOptions& run_options,
+                         const uint64 deadline_micros, ServerCore* core,
+                         const PredictRequest& request,
+                         const std::shared_ptr<const void>& request_owner,
+                         const PredictRequest::OutputEncoding encoding,
+                         PredictResponse* response) {
+  // Resolves the model name once, for both the deadline check and the lookup.
+  ServerCore::ModelNameIdCache name_id_cache;
+  const int32 name_id =
+      core->GetModelNameId(request.model_spec().name(), &name_id_cache);
+  TF_RETURN_IF_ERROR(CheckPredictDeadline(core, name_id, deadline_micros));
+  ServableHandle<Bundle> bundle;
+  TF_RETURN_IF_ERROR(
+      core->GetServableHandle(request.model_spec(), &name_id_cache, &bundle));
+  return RunPredictWithCache(run_options, deadline_micros, core, name_id,
+                             bundle, request, request_owner, encoding,
+                             response);
+}
+
+// Returns a key identifying the servable 'model_spec' asks for. BatchPredict
+// items with equal keys share a ServableHandle.
+string ServableKey(const ModelSpec& model_spec) {
+  if (model_spec.has_version()) {
+    return strings::StrCat(model_spec.name(), ":",
+                           model_spec.version().value());
+  }
+  return strings::StrCat(model_spec.name(), ":latest");
+}
+
+// Records the outcome of one BatchPredict item.
+void SetBatchPredictResult(const Status& status,
+                           BatchPredictResponse::Result* result) {
+  if (!status.ok()) {
+    result->clear_response();
+    result->set_error_code(status.code());
+    result->set_error_message(status.error_message());
+  }
+}
+
+// Adds a result to 'response' for each item of 'request', and fails those
+// that can't be run. Sets 'bundles' to the handle to run each item against,
+// or null for the failed ones, 'encodings' to the encoding of each item's
+// outputs, and 'name_ids' to the id of each item's model name.
+template <typename Bundle>
+void PrepareBatchPredict(
+    const uint64 deadline_micros, ServerCore* core,
+    const BatchPredictRequest& request,
+    const PredictRequest::OutputEncoding default_encoding,
+    BatchPredictResponse* response,
+    std::vector<std::shared_ptr<ServableHandle<Bundle>>>* bundles,
+    std::vector<PredictRequest::OutputEncoding>* encodings,
+    std::vector<int32>* name_ids) {
+  const int num_items = request.requests_size();
+  for (int i = 0; i < num_items; ++i) {
+    response->add_results();
+  }
+  bundles->assign(num_items, nullptr);
+  encodings->resize(num_items);
+  name_ids->assign(num_items, -1);
+  // Items mostly ask for the same few models.
+  ServerCore::ModelNameIdCache name_id_cache;
+
+  // Acquire one handle per distinct servable up front. Besides saving the
+  // lookups, this guarantees that all items for the same model are served by
+  // the same version, even if a new one becomes available meanwhile.
+  std::map<string, std::pair<Status, std::shared_ptr<ServableHandle<Bundle>>>>
+      handles;
+  for (int i = 0; i < num_items; ++i) {
+    const PredictRequest& item = request.requests(i);
+    Status status =
+        ValidatePredictRequest(item, default_encoding, &(*encodings)[i]);
+    if (status.ok()) {
+      (*name_ids)[i] =
+          core->GetModelNameId(item.model_spec().name(), &name_id_cache);
+      status = CheckPredictDeadline(core, (*name_ids)[i], deadline_micros);
+    }
+    if (status.ok()) {
+      const string key = ServableKey(item.model_spec());
+      auto iter = handles.find(key);
+      if (iter == handles.end()) {
+        std::shared_ptr<ServableHandle<Bundle>> handle(
+            new ServableHandle<Bundle>);
+        const Status handle_status = core->GetServableHandle(
+            item.model_spec(), &name_id_cache, handle.get());
+        iter = handles.emplace(key, std::make_pair(handle_status, handle))
+                   .first;
+      }
+      status = iter->second.first;
+      if (status.ok()) {
+        (*bundles)[i] = iter->second.second;
+      }
+    }
+    SetBatchPredictResult(status, response->mutable_results(i));
+  }
+}
+
+template <typename Bundle>
+void BatchPredictWithBundles(
+    const RunOptions& run_options, const uint64 deadline_micros,
+    ServerCore* core, const BatchPredictRequest& request,
+    const std::shared_ptr<const void>& request_owner,
+    const PredictRequest::OutputEncoding default_encoding,
+    thread::ThreadPool* thread_pool, BatchPredictResponse* response) {
+  std::vector<std::shared_ptr<ServableHandle<Bundle>>> bundles;
+  std::vector<PredictRequest::OutputEncoding> encodings;
+  std::vector<int32> name_ids;
+  PrepareBatchPredict(deadline_micros, core, request, default_encoding,
+                      response, &bundles, &encodings, &name_ids);
+
+  // Run the items concurrently, so that items for the same model can be
+  // merged into one session run when batching is enabled.
+  const int num_items = request.requests_size();
+  const int num_runnable =
+      num_items - std::count(bundles.begin(), bundles.end(), nullptr);
+  BlockingCounter counter(num_runnable);
+  for (int i = 0; i < num_items; ++i) {
+    if (bundles[i] == nullptr) {
+      continue;
+    }
+    BatchPredictResponse::Result* const result = response->mutable_results(i);
+    auto run_item = [&, i, result] {
+      SetBatchPredictResult(
+          RunPredictWithCache(run_options, deadline_micros, core, name_ids[i],
+                              *bundles[i], request.requests(i), request_owner,
+                              encodings[i], result->mutable_response()),
+          result);
+      counter.DecrementCount();
+    };
+    if (thread_pool != nullptr) {
+      thread_pool->Schedule(run_item);
+    } else {
+      run_item();
+    }
+  }
+  counter.Wait();
+}
+
+// Issues every item of 'request' as PredictAsync() would, and calls 'done'
+// once all of them are done and 'response' is filled in. The input tensors of
+// the items hold on to 'request_owner' as in RunPredictWithCacheAsync().
+void IssueBatchPredictItems(
+    const RunOptions& run_options, const uint64 deadline_micros,
+    ServerCore* core, const BatchPredictRequest& request,
+    const std::shared_ptr<const void>& request_owner,
+    const PredictRequest::OutputEncoding default_encoding,
+    BatchPredictResponse* response, std::function<void(const Status&)> done) {
+  std::vector<std::shared_ptr<ServableHandle<SavedModelBundle>>> bundles;
+  std::vector<PredictRequest::OutputEncoding> encodings;
+  std::vector<int32> name_ids;
+  PrepareBatchPredict(deadline_micros, core, request, default_encoding,
+                      response, &bundles, &encodings, &name_ids);
+
+  // Issue all items before waiting on any, so that items for the same model
+  // can be merged into one session run when batching is enabled. The count
+  // starts one above the number of items, so that 'done' isn't called before
+  // they have all been issued.
+  const int num_items = request.requests_size();
+  const int num_runnable =
+      num_items - std::count(bundles.begin(), bundles.end(), nullptr);
+  std::shared_ptr<std::atomic<int>> num_pending(
+      new std::atomic<int>(num_runnable + 1));
+  auto item_done = [num_pending, done]() {
+    if (num_pending->fetch_sub(1) == 1) {
+      done(Status::OK());
+    }
+  };
+  for (int i = 0; i < num_items; ++i) {
+    if (bundles[i] == nullptr) {
+      continue;
+    }
+    BatchPredictResponse::Result* const result = response->mutable_results(i);
+    RunPredictWithCacheAsync(run_options, deadline_micros, core, name_ids[i],
+                             bundles[i], request.requests(i), request_owner,
+                             encodings[i], result->mutable_response(),
+                             [result, item_done](const Status& status) {
+                               SetBatchPredictResult(status, result);
+                               item_done();
+                             });
+  }
+  item_done();
+}
+
 }  // namespace
 
 Status TensorflowPredictor::Predict(const RunOptions& run_options,
                                     ServerCore* core,
                                     const PredictRequest& request,
                                     PredictResponse* response) {
-  if (!request.has_model_spec()) {
-    return tensorflow::Status(tensorflow::error::INVALID_ARGUMENT,
-                              "Missing ModelSpec");
-  }
+  const uint64 deadline_micros =
+      DeadlineMicrosFromRunOptions(run_options, Env::Default()->NowMicros());
+  PredictRequest::OutputEncoding encoding;
+  TF_RETURN_IF_ERROR(
+      ValidatePredictRequest(request, default_output_encoding_, &encoding));
+  // No owner is needed: this doesn't return before the session is done with
+  // the input tensors, and 'request' outlives this call.
   if (use_saved_model_) {
-    return SavedModelPredict(run_options, core, request, response);
+    return PredictWithBundle<SavedModelBundle>(run_options, deadline_micros,
+                                               core, request, nullptr,
+                                               encoding, response);
+  }
+  return PredictWithBundle<SessionBundle>(run_options, deadline_micros, core,
+                                          request, nullptr, encoding,
+                                          response);
+}
+
+void TensorflowPredictor::PredictAsync(
+    const RunOptions& run_options, ServerCore* core,
+    std::shared_ptr<const PredictRequest> request_ptr,
+    ServerCore::ModelNameIdCache* name_id_cache, PredictResponse* response,
+    std::function<void(const Status&)> done) {
+  const PredictRequest& request = *request_ptr;
+  const uint64 deadline_micros =
+      DeadlineMicrosFromRunOptions(run_options, Env::Default()->NowMicros());
+  PredictRequest::OutputEncoding encoding;
+  Status status =
+      ValidatePredictRequest(request, default_output_encoding_, &encoding);
+  if (!status.ok()) {
+    done(status);
+    return;
+  }
+  if (!use_saved_model_) {
+    done(PredictWithBundle<SessionBundle>(run_options, deadline_micros, core,
+                                          request, request_ptr, encoding,
+                                          response));
+    return;
+  }
+
+  const int32 name_id =
+      core->GetModelNameId(request.model_spec().name(), name_id_cache);
+  status = CheckPredictDeadline(core, name_id, deadline_micros);
+  std::shared_ptr<ServableHandle<SavedModelBundle>> bundle(
+      new ServableHandle<SavedModelBundle>);
+  if (status.ok()) {
+    status = core->GetServableHandle(request.model_spec(), name_id_cache,
+                                     bundle.get());
+  }
+  if (!status.ok()) {
+    done(status);
+    return;
+  }
+  RunPredictWithCacheAsync(run_options, deadline_micros, core, name_id,
+                           std::move(bundle), request, request_ptr, encoding,
+                           response, std::move(done));
+}
+
+Status TensorflowPredictor::BatchPredict(const RunOptions& run_options,
+                                         ServerCore* core,
+                                         const BatchPredictRequest& request,
+                                         thread::ThreadPool* thread_pool,
+                                         BatchPredictResponse* response) {
+  response->Clear();
+  const uint64 deadline_micros =
+      DeadlineMicrosFromRunOptions(run_options, Env::Default()->NowMicros());
+  // As in Predict(), no owner is needed.
+  if (!use_saved_model_) {
+    BatchPredictWithBundles<SessionBundle>(
+        run_options, deadline_micros, core, request, nullptr,
+        default_output_encoding_, thread_pool, response);
+    return Status::OK();
+  }
+  // Rather than holding a thread per item while it waits for its batch, which
+  // can exhaust a shared pool with items whose batches need more items to
+  // fill up, issue all items asynchronously and wait for them once.
+  Notification items_done;
+  IssueBatchPredictItems(run_options, deadline_micros, core, request, nullptr,
+                         default_output_encoding_, response,
+                         [&items_done](const Status& status) {
+                           items_done.Notify();
+                         });
+  items_done.WaitForNotification();
+  return Status::OK();
+}
+
+void TensorflowPredictor::BatchPredictAsync(
+    const RunOptions& run_options, ServerCore* core,
+    std::shared_ptr<const BatchPredictRequest> request_ptr,
+    BatchPredictResponse* response, std::function<void(const Status&)> done) {
+  const BatchPredictRequest& request = *request_ptr;
+  response->Clear();
+  const uint64 deadline_micros =
+      DeadlineMicrosFromRunOptions(run_options, Env::Default()->NowMicros());
+  if (!use_saved_model_) {
+    BatchPredictWithBundles<SessionBundle>(
+        run_options, deadline_micros, core, request, request_ptr,
+        default_output_encoding_, nullptr, response);
+    done(Status::OK());
+    return;
   }
-  return SessionBundlePredict(run_options, core, request, response);
+  IssueBatchPredictItems(run_options, deadline_micros, core, request,
+                         request_ptr, default_output_encoding_, response,
+                         std::move(done));
 }
 
 }  // namespace serving
@@ -16,7 +16,11 @@ limitations under the License.
 #ifndef TENSORFLOW_SERVING_SERVABLES_TENSORFLOW_PREDICT_IMPL_H_
 #define TENSORFLOW_SERVING_SERVABLES_TENSORFLOW_PREDICT_IMPL_H_
 
+#include <functional>
+#include <memory>
+
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/protobuf/config.pb.h"
 #include "tensorflow_serving/apis/predict.pb.h"
 #include "tensorflow_serving/model_servers/server_core.h"
@@ -28,16 +32,78 @@ namespace serving {
 class TensorflowPredictor {
  public:
   explicit TensorflowPredictor(bool use_saved_model)
-      : use_saved_model_(use_saved_model) {}
+      : TensorflowPredictor(use_saved_model, PredictRequest::REPEATED_FIELD) {}
+
+  // 'default_output_encoding' is used for requests that leave
+  // PredictRequest.output_encoding unset. Must not be SERVER_DEFAULT.
+  TensorflowPredictor(bool use_saved_model,
+                      PredictRequest::OutputEncoding default_output_encoding)
+      : use_saved_model_(use_saved_model),
+        default_output_encoding_(default_output_encoding) {}
 
   Status Predict(const RunOptions& run_options, ServerCore* core,
                  const PredictRequest& request, PredictResponse* response);
 
+  // Same as Predict(), but returns as soon as the session run has been handed
+  // off, and calls 'done' with the outcome once 'response' is filled in. With
+  // a batching session, 'done' runs on the batch thread that ran the request.
+  // 'response' must stay alive until 'done' is called. Input tensors may
+  // borrow the bytes of 'request', which they keep alive for as long as they
+  // do, so callers should share the request's arena or enclosing message
+  // (e.g. via an aliasing shared_ptr) rather than copy it.
+  //
+  // If 'name_id_cache' is non-null, the model name is resolved through it (see
+  // ServerCore::ModelNameIdCache); it is no longer used once this returns.
+  //
+  // Requests for SessionBundle models are run synchronously, before this
+  // returns.
+  void PredictAsync(const RunOptions& run_options, ServerCore* core,
+                    std::shared_ptr<const PredictRequest> request,
+                    ServerCore::ModelNameIdCache* name_id_cache,
+                    PredictResponse* response,
+                    std::function<void(const Status&)> done);
+
+  // Evaluates every PredictRequest in 'request' as Predict() would, and
+  // reports the outcome of each in the matching entry of 'response->results'.
+  // Items asking for the same model and version share one ServableHandle.
+  // Blocks until all items are done.
+  //
+  // SavedModel items are all issued as BatchPredictAsync() would, so items for
+  // the same model can share a session run when batching is enabled, and only
+  // the calling thread waits for them. SessionBundle models have no
+  // asynchronous path: if 'thread_pool' is non-null, their items run
+  // concurrently on it; otherwise they run one after the other on the calling
+  // thread.
+  //
+  // Per-item failures are reported in 'response' only, so the returned status
+  // is OK unless the request as a whole can't be processed.
+  Status BatchPredict(const RunOptions& run_options, ServerCore* core,
+                      const BatchPredictRequest& request,
+                      thread::ThreadPool* thread_pool,
+                      BatchPredictResponse* response);
+
+  // Same as BatchPredict(), but issues every item as PredictAsync() would and
+  // returns without waiting for them, then calls 'done' once all of them are
+  // done and 'response' is filled in. Items for the same model are thus all
+  // queued for batching at once, without holding a thread each. 'response'
+  // must stay alive until 'done' is called; 'request' is kept alive as in
+  // PredictAsync().
+  //
+  // Requests for SessionBundle models are run synchronously, one after the
+  // other, before this returns.
+  void BatchPredictAsync(const RunOptions& run_options, ServerCore* core,
+                         std::shared_ptr<const BatchPredictRequest> request,
+                         BatchPredictResponse* response,
+                         std::function<void(const Status&)> done);
+
  private:
   // If use_saved_model_ is true, a SavedModelBundle handle will be retrieved
   // from the ServerCore and the new SavedModel SignatureDef format will be
   // used.
   bool use_saved_model_;
+
+  // The encoding of output tensors for requests that don't pick one.
+  PredictRequest::OutputEncoding default_output_encoding_;
 };
 
 }  // namespace serving
@@ -15,11 +15,16 @@ limitations under the License.
 
 #include "tensorflow_serving/servables/tensorflow/predict_impl.h"
 
+#include <memory>
+
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include "tensorflow/cc/saved_model/signature_constants.h"
 #include "tensorflow/contrib/session_bundle/session_bundle.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/notification.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow_serving/core/availability_preserving_policy.h"
 #include "tensorflow_serving/model_servers/model_platform_types.h"
 #include "tensorflow_serving/model_servers/platform_config_util.h"
@@ -283,6 +288,188 @@ TEST_P(PredictImplTest, PredictionSuccess) {
   EXPECT_THAT(response, test_util::EqualsProto(expected_response));
 }
 
+TEST_P(PredictImplTest, PredictAsync) {
+  // Shared with the input tensors, which may borrow its bytes.
+  std::shared_ptr<PredictRequest> request(new PredictRequest);
+  PredictResponse response;
+
+  ModelSpec* model_spec = request->mutable_model_spec();
+  model_spec->set_name(kTestModelName);
+  model_spec->mutable_version()->set_value(kTestModelVersion);
+
+  TensorProto tensor_proto;
+  tensor_proto.add_float_val(2.0);
+  tensor_proto.set_dtype(tensorflow::DT_FLOAT);
+  (*request->mutable_inputs())[kInputTensorKey] = tensor_proto;
+
+  TensorflowPredictor predictor(GetParam());
+  // Carried across calls, as StreamPredict does.
+  ServerCore::ModelNameIdCache name_id_cache;
+  auto predict_async = [&]() {
+    Notification done;
+    Status status;
+    predictor.PredictAsync(GetRunOptions(), GetServerCore(), request,
+                           &name_id_cache, &response,
+                           [&](const Status& run_status) {
+                             status = run_status;
+                             done.Notify();
+                           });
+    done.WaitForNotification();
+    return status;
+  };
+  TF_EXPECT_OK(predict_async());
+  TensorProto output_tensor_proto;
+  output_tensor_proto.add_float_val(3);
+  output_tensor_proto.set_dtype(tensorflow::DT_FLOAT);
+  output_tensor_proto.mutable_tensor_shape();
+  PredictResponse expected_response;
+  (*expected_response.mutable_outputs())[kOutputTensorKey] =
+      output_tensor_proto;
+  EXPECT_THAT(response, test_util::EqualsProto(expected_response));
+  // Served again, by the cached name id if the predictor used it.
+  TF_EXPECT_OK(predict_async());
+  EXPECT_THAT(response, test_util::EqualsProto(expected_response));
+
+  // Errors are reported through the callback too, and a changed model name is
+  // resolved anew.
+  request->mutable_model_spec()->set_name("unknown_model");
+  EXPECT_EQ(tensorflow::error::NOT_FOUND, predict_async().code());
+}
+
+TEST_P(PredictImplTest, PredictionSuccessWithTensorContentEncoding) {
+  PredictRequest request;
+  ModelSpec* model_spec = request.mutable_model_spec();
+  model_spec->set_name(kTestModelName);
+  model_spec->mutable_version()->set_value(kTestModelVersion);
+
+  TensorProto tensor_proto;
+  tensor_proto.add_float_val(2.0);
+  tensor_proto.set_dtype(tensorflow::DT_FLOAT);
+  (*request.mutable_inputs())[kInputTensorKey] = tensor_proto;
+
+  TensorProto output_tensor_proto;
+  test::AsTensor<float>({3}, TensorShape({}))
+      .AsProtoTensorContent(&output_tensor_proto);
+  PredictResponse expected_response;
+  (*expected_response.mutable_outputs())[kOutputTensorKey] =
+      output_tensor_proto;
+
+  // Selected by the request.
+  {
+    request.set_output_encoding(PredictRequest::TENSOR_CONTENT);
+    TensorflowPredictor predictor(GetParam());
+    PredictResponse response;
+    TF_EXPECT_OK(predictor.Predict(GetRunOptions(), GetServerCore(), request,
+                                   &response));
+    EXPECT_THAT(response, test_util::EqualsProto(expected_response));
+  }
+
+  // Selected by the server.
+  {
+    request.set_output_encoding(PredictRequest::SERVER_DEFAULT);
+    TensorflowPredictor predictor(GetParam(), PredictRequest::TENSOR_CONTENT);
+    PredictResponse response;
+    TF_EXPECT_OK(predictor.Predict(GetRunOptions(), GetServerCore(), request,
+                                   &response));
+    EXPECT_THAT(response, test_util::EqualsProto(expected_response));
+  }
+
+  // The request overrides the server.
+  {
+    request.set_output_encoding(PredictRequest::REPEATED_FIELD);
+    TensorflowPredictor predictor(GetParam(), PredictRequest::TENSOR_CONTENT);
+    PredictResponse response;
+    TF_EXPECT_OK(predictor.Predict(GetRunOptions(), GetServerCore(), request,
+                                   &response));
+    EXPECT_EQ(1, response.outputs().at(kOutputTensorKey).float_val_size());
+    EXPECT_TRUE(
+        response.outputs().at(kOutputTensorKey).tensor_content().empty());
+  }
+}
+
+TEST_P(PredictImplTest, BatchPredict) {
+  PredictRequest good_request;
+  ModelSpec* model_spec = good_request.mutable_model_spec();
+  model_spec->set_name(kTestModelName);
+  model_spec->mutable_version()->set_value(kTestModelVersion);
+  TensorProto tensor_proto;
+  tensor_proto.add_float_val(2.0);
+  tensor_proto.set_dtype(tensorflow::DT_FLOAT);
+  (*good_request.mutable_inputs())[kInputTensorKey] = tensor_proto;
+
+  PredictRequest missing_model_spec_request = good_request;
+  missing_model_spec_request.clear_model_spec();
+
+  PredictRequest missing_model_request = good_request;
+  missing_model_request.mutable_model_spec()->set_name("missing");
+
+  PredictRequest missing_input_request = good_request;
+  missing_input_request.clear_inputs();
+
+  BatchPredictRequest request;
+  *request.add_requests() = good_request;
+  *request.add_requests() = missing_model_spec_request;
+  *request.add_requests() = missing_model_request;
+  *request.add_requests() = missing_input_request;
+  *request.add_requests() = good_request;
+
+  TensorProto output_tensor_proto;
+  output_tensor_proto.add_float_val(3);
+  output_tensor_proto.set_dtype(tensorflow::DT_FLOAT);
+  output_tensor_proto.mutable_tensor_shape();
+  PredictResponse expected_response;
+  (*expected_response.mutable_outputs())[kOutputTensorKey] =
+      output_tensor_proto;
+
+  auto expect_results = [&](const BatchPredictResponse& response) {
+    ASSERT_EQ(5, response.results_size());
+    for (const int i : {0, 4}) {
+      EXPECT_EQ(tensorflow::error::OK, response.results(i).error_code());
+      EXPECT_THAT(response.results(i).response(),
+                  test_util::EqualsProto(expected_response));
+    }
+    EXPECT_EQ(tensorflow::error::INVALID_ARGUMENT,
+              response.results(1).error_code());
+    EXPECT_EQ(tensorflow::error::NOT_FOUND, response.results(2).error_code());
+    EXPECT_EQ(tensorflow::error::INVALID_ARGUMENT,
+              response.results(3).error_code());
+    for (const int i : {1, 2, 3}) {
+      EXPECT_FALSE(response.results(i).error_message().empty());
+      EXPECT_FALSE(response.results(i).has_response());
+    }
+  };
+
+  // Run the items concurrently, and one after the other. SavedModel items are
+  // issued without a thread each either way, and the pool goes unused.
+  thread::ThreadPool thread_pool(Env::Default(), "BatchPredictTest", 2);
+  const std::vector<thread::ThreadPool*> pools = {&thread_pool, nullptr};
+  for (thread::ThreadPool* pool : pools) {
+    TensorflowPredictor predictor(GetParam());
+    BatchPredictResponse response;
+    TF_ASSERT_OK(predictor.BatchPredict(GetRunOptions(), GetServerCore(),
+                                        request, pool, &response));
+    expect_results(response);
+  }
+
+  // Issue the items without waiting for them.
+  {
+    TensorflowPredictor predictor(GetParam());
+    BatchPredictResponse response;
+    Notification done;
+    Status status;
+    predictor.BatchPredictAsync(
+        GetRunOptions(), GetServerCore(),
+        std::make_shared<const BatchPredictRequest>(request), &response,
+        [&](const Status& run_status) {
+          status = run_status;
+          done.Notify();
+        });
+    done.WaitForNotification();
+    TF_ASSERT_OK(status);
+    expect_results(response);
+  }
+}
+
 // Test querying a model with a named regression signature (not default). This
 // will work with SavedModel but not supported in the legacy SessionBundle.
 TEST_P(PredictImplTest, PredictionWithNamedRegressionSignature) {
@@ -15,13 +15,21 @@ limitations under the License.
 
 #include "tensorflow_serving/servables/tensorflow/regression_service.h"
 
+#include <memory>
+#include <utility>
+
+#include "tensorflow/cc/saved_model/signature_constants.h"
 #include "tensorflow/contrib/session_bundle/session_bundle.h"
 #include "tensorflow/contrib/session_bundle/signature.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/tracing.h"
 #include "tensorflow_serving/apis/regressor.h"
+#include "tensorflow_serving/core/response_cache.h"
 #include "tensorflow_serving/core/servable_handle.h"
+#include "tensorflow_serving/servables/tensorflow/deadline_util.h"
 #include "tensorflow_serving/servables/tensorflow/regressor.h"
+#include "tensorflow_serving/servables/tensorflow/signature_plans.h"
 
 namespace tensorflow {
 namespace serving {
@@ -36,19 +44,135 @@ Status TensorflowRegressionServiceImpl::Regress(
                               "Missing ModelSpec");
   }
 
-  ServableHandle<SavedModelBundle> saved_model_bundle;
+  // Reject requests that can't meet their deadline before doing any work.
+  const uint64 now_micros = Env::Default()->NowMicros();
+  const uint64 deadline_micros =
+      DeadlineMicrosFromRunOptions(run_options, now_micros);
+  // Resolves the model name once, for both the deadline check and the lookup.
+  ServerCore::ModelNameIdCache name_id_cache;
+  const int32 name_id =
+      core->GetModelNameId(request.model_spec().name(), &name_id_cache);
   TF_RETURN_IF_ERROR(
-      core->GetServableHandle(request.model_spec(), &saved_model_bundle));
-  SignatureDef signature;
-  TF_RETURN_IF_ERROR(GetRegressionSignatureDef(
-      request.model_spec(), saved_model_bundle->meta_graph_def, &signature));
-
-  std::unique_ptr<RegressorInterface> regressor_interface;
-  TF_RETURN_IF_ERROR(CreateFlyweightTensorFlowRegressor(
-      run_options, saved_model_bundle->session.get(), &signature,
-      &regressor_interface));
-  // Run regression
-  return regressor_interface->Regress(request, response->mutable_result());
+      CheckDeadline(deadline_micros, now_micros,
+                    core->execution_time_tracker()->EstimateMicros(name_id),
+                    "before acquiring the servable handle"));
+
+  ServableHandle<SavedModelBundle> saved_model_bundle;
+  TF_RETURN_IF_ERROR(core->GetServableHandle(
+      request.model_spec(), &name_id_cache, &saved_model_bundle));
+  const std::shared_ptr<ResponseCache> cache =
+      core->GetResponseCache(request.model_spec().name());
+  return LookupOrComputeResponse(
+      cache.get(), saved_model_bundle.id(), "Regress", request, response,
+      [&]() {
+        return RunWithDeadline(
+            run_options, deadline_micros, name_id,
+            core->execution_time_tracker(),
+            [&](const RunOptions& run_options_with_deadline,
+                RunMetadata* run_metadata) -> Status {
+              // The signature's method_name is checked along with the rest of
+              // it when the request is pre-processed.
+              std::shared_ptr<const SignaturePlans> plans;
+              TF_RETURN_IF_ERROR(core->signature_plan_cache()->Get(
+                  saved_model_bundle.id(), saved_model_bundle->meta_graph_def,
+                  &plans));
+              const SignaturePlan* plan =
+                  plans->Find(request.model_spec().signature_name());
+              if (plan == nullptr) {
+                return errors::InvalidArgument(
+                    "No signature was found with the name: ",
+                    request.model_spec().signature_name().empty()
+                        ? kDefaultServingSignatureDefKey
+                        : request.model_spec().signature_name());
+              }
+
+              std::unique_ptr<RegressorInterface> regressor_interface;
+              TF_RETURN_IF_ERROR(CreateFlyweightTensorFlowRegressor(
+                  run_options_with_deadline, saved_model_bundle->session.get(),
+                  plan->signature_def, run_metadata, &regressor_interface));
+              // Run regression
+              return regressor_interface->Regress(
+                  request, response->mutable_result());
+            });
+      });
+}
+
+void TensorflowRegressionServiceImpl::RegressAsync(
+    const RunOptions& run_options, ServerCore* core,
+    const RegressionRequest& request, RegressionResponse* response,
+    std::function<void(const Status&)> done) {
+  TRACELITERAL("TensorflowRegressionServiceImpl::RegressAsync");
+  if (!request.has_model_spec()) {
+    done(errors::InvalidArgument("Missing ModelSpec"));
+    return;
+  }
+
+  // Reject requests that can't meet their deadline before doing any work.
+  const uint64 now_micros = Env::Default()->NowMicros();
+  const uint64 deadline_micros =
+      DeadlineMicrosFromRunOptions(run_options, now_micros);
+  ServerCore::ModelNameIdCache name_id_cache;
+  const int32 name_id =
+      core->GetModelNameId(request.model_spec().name(), &name_id_cache);
+  Status status =
+      CheckDeadline(deadline_micros, now_micros,
+                    core->execution_time_tracker()->EstimateMicros(name_id),
+                    "before acquiring the servable handle");
+
+  // Shared with the callbacks below, so that the version stays loaded until
+  // the request is done.
+  std::shared_ptr<ServableHandle<SavedModelBundle>> saved_model_bundle(
+      new ServableHandle<SavedModelBundle>);
+  if (status.ok()) {
+    status = core->GetServableHandle(request.model_spec(), &name_id_cache,
+                                     saved_model_bundle.get());
+  }
+  if (!status.ok()) {
+    done(status);
+    return;
+  }
+  // The lambdas passed in here run before the calls they are passed to
+  // return; only the callbacks they pass on outlive this function.
+  LookupOrComputeResponseAsync(
+      core->GetResponseCache(request.model_spec().name()),
+      saved_model_bundle->id(), "Regress", request, response,
+      [&](std::function<void(const Status&)> compute_done) {
+        RunWithDeadlineAsync(
+            run_options, deadline_micros, name_id,
+            core->execution_time_tracker(),
+            [&](const RunOptions& run_options_with_deadline,
+                RunMetadata* run_metadata,
+                std::function<void(const Status&)> run_done) {
+              std::shared_ptr<const SignaturePlans> plans;
+              const Status plans_status = core->signature_plan_cache()->Get(
+                  saved_model_bundle->id(),
+                  (*saved_model_bundle)->meta_graph_def, &plans);
+              if (!plans_status.ok()) {
+                run_done(plans_status);
+                return;
+              }
+              const SignaturePlan* plan =
+                  plans->Find(request.model_spec().signature_name());
+              if (plan == nullptr) {
+                run_done(errors::InvalidArgument(
+                    "No signature was found with the name: ",
+                    request.model_spec().signature_name().empty()
+                        ? kDefaultServingSignatureDefKey
+                        : request.model_spec().signature_name()));
+                return;
+              }
+              RunRegressionAsync(
+                  run_options_with_deadline,
+                  (*saved_model_bundle)->session.get(), plan->signature_def,
+                  run_metadata, request, response->mutable_result(),
+                  [saved_model_bundle, plans,
+                   run_done](const Status& run_status) {
+                    run_done(run_status);
+                  });
+            },
+            std::move(compute_done));
+      },
+      std::move(done));
 }
 
 }  // namespace serving
@@ -16,6 +16,8 @@ limitations under the License.
 #ifndef TENSORFLOW_SERVING_SERVABLES_TENSORFLOW_REGRESSION_SERVICE_H_
 #define TENSORFLOW_SERVING_SERVABLES_TENSORFLOW_REGRESSION_SERVICE_H_
 
+#include <functional>
+
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/protobuf/config.pb.h"
 #include "tensorflow_serving/apis/regression.pb.h"
@@ -31,6 +33,15 @@ class TensorflowRegressionServiceImpl final {
   static Status Regress(const RunOptions& run_options, ServerCore* core,
                         const RegressionRequest& request,
                         RegressionResponse* response);
+
+  // Like Regress(), but may return before the regression is done, and
+  // calls 'done' with its outcome once it is. 'request' and 'response' must
+  // stay alive until then. With batching, no thread waits for the request's
+  // batch; 'done' is called on the batch thread.
+  static void RegressAsync(const RunOptions& run_options, ServerCore* core,
+                           const RegressionRequest& request,
+                           RegressionResponse* response,
+                           std::function<void(const Status&)> done);
 };
 
 }  // namespace serving
@@ -98,10 +98,14 @@ class TensorFlowRegressor : public RegressorInterface {
 // Implementation of the RegressorInterface using SavedModel.
 class SavedModelTensorFlowRegressor : public RegressorInterface {
  public:
-  explicit SavedModelTensorFlowRegressor(const RunOptions& run_options,
-                                         Session* session,
-                                         const SignatureDef* const signature)
-      : run_options_(run_options), session_(session), signature_(signature) {}
+  SavedModelTensorFlowRegressor(const RunOptions& run_options,
+                                Session* session,
+                                const SignatureDef* const signature,
+                                RunMetadata* run_metadata)
+      : run_options_(run_options),
+        session_(session),
+        signature_(signature),
+        run_metadata_(run_metadata) {}
 
   ~SavedModelTensorFlowRegressor() override = default;
 
@@ -118,7 +122,7 @@ class SavedModelTensorFlowRegressor : public RegressorInterface {
     int num_examples;
     TF_RETURN_IF_ERROR(PerformOneShotTensorComputation(
         run_options_, request.input(), input_tensor_name, output_tensor_names,
-        session_, &outputs, &num_examples));
+        session_, &outputs, &num_examples, run_metadata_));
 
     TRACELITERAL("ConvertToRegressionResult");
     return PostProcessRegressionResult(*signature_, num_examples,
@@ -129,6 +133,8 @@ class SavedModelTensorFlowRegressor : public RegressorInterface {
   const RunOptions run_options_;
   Session* const session_;
   const SignatureDef* const signature_;
+  // Filled in by the session run, unless null.
+  RunMetadata* const run_metadata_;
 
   TF_DISALLOW_COPY_AND_ASSIGN(SavedModelTensorFlowRegressor);
 };
@@ -170,8 +176,8 @@ class SavedModelRegressor : public RegressorInterface {
     SignatureDef signature;
     TF_RETURN_IF_ERROR(GetRegressionSignatureDef(
         request.model_spec(), bundle_->meta_graph_def, &signature));
-    SavedModelTensorFlowRegressor regressor(run_options_,
-                                            bundle_->session.get(), &signature);
+    SavedModelTensorFlowRegressor regressor(
+        run_options_, bundle_->session.get(), &signature, nullptr);
     return regressor.Regress(request, result);
   }
 
@@ -206,13 +212,48 @@ Status CreateFlyweightTensorFlowRegressor(
 
 Status CreateFlyweightTensorFlowRegressor(
     const RunOptions& run_options, Session* session,
-    const SignatureDef* signature,
+    const SignatureDef* signature, RunMetadata* run_metadata,
     std::unique_ptr<RegressorInterface>* service) {
-  service->reset(
-      new SavedModelTensorFlowRegressor(run_options, session, signature));
+  service->reset(new SavedModelTensorFlowRegressor(run_options, session,
+                                                   signature, run_metadata));
   return Status::OK();
 }
 
+void RunRegressionAsync(const RunOptions& run_options, Session* session,
+                        const SignatureDef* signature,
+                        RunMetadata* run_metadata,
+                        const RegressionRequest& request,
+                        RegressionResult* result,
+                        std::function<void(const Status&)> done) {
+  // What the run fills in, and post-processing reads.
+  struct RunState {
+    std::vector<string> output_tensor_names;
+    std::vector<Tensor> outputs;
+    int num_examples = 0;
+  };
+  std::shared_ptr<RunState> state(new RunState);
+  string input_tensor_name;
+  const Status status = PreProcessRegression(*signature, &input_tensor_name,
+                                             &state->output_tensor_names);
+  if (!status.ok()) {
+    done(status);
+    return;
+  }
+  PerformOneShotTensorComputationAsync(
+      run_options, request.input(), input_tensor_name,
+      state->output_tensor_names, session, &state->outputs,
+      &state->num_examples, run_metadata,
+      [state, signature, result, done](const Status& run_status) {
+        if (!run_status.ok()) {
+          done(run_status);
+          return;
+        }
+        done(PostProcessRegressionResult(*signature, state->num_examples,
+                                         state->output_tensor_names,
+                                         state->outputs, result));
+      });
+}
+
 Status GetRegressionSignatureDef(const ModelSpec& model_spec,
                                  const MetaGraphDef& meta_graph_def,
                                  SignatureDef* signature) {
@@ -15,13 +15,19 @@ limitations under the License.
 
 #include "tensorflow_serving/servables/tensorflow/saved_model_bundle_factory.h"
 
+#include <utility>
+
 #include "tensorflow/cc/saved_model/tag_constants.h"
 #include "tensorflow/contrib/session_bundle/bundle_shim.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/protobuf/config.pb.h"
 #include "tensorflow/core/protobuf/named_tensor.pb.h"
 #include "tensorflow/core/public/session_options.h"
+#include "tensorflow_serving/servables/tensorflow/batch_size_profiler.h"
 #include "tensorflow_serving/servables/tensorflow/bundle_factory_util.h"
 #include "tensorflow_serving/servables/tensorflow/curried_session.h"
 
@@ -56,17 +62,60 @@ Status ParseFixedInputTensors(
   return Status::OK();
 }
 
+// Sets the allowed batch sizes in 'batching_config' to ones profiled on
+// 'bundle', which was loaded from 'path', and writes the result out if
+// configured to. Leaves 'batching_config' unchanged if profiling fails.
+void ProfileAllowedBatchSizes(const string& path,
+                              const SavedModelBundle& bundle,
+                              const std::vector<SignatureDef>& signatures,
+                              BatchingParameters* batching_config) {
+  LOG(INFO) << "Profiling batch sizes for model at " << path;
+  BatchingParameters profiled_config;
+  const Status status = ProfileBatchingParameters(
+      *batching_config, bundle.session.get(), signatures, &profiled_config);
+  if (!status.ok()) {
+    LOG(WARNING) << "Failed to profile batch sizes for model at " << path
+                 << "; batching without allowed batch sizes: " << status;
+    return;
+  }
+  *batching_config = profiled_config;
+  LOG(INFO) << "Profiled batching parameters for model at " << path << ": "
+            << batching_config->ShortDebugString();
+
+  if (!batching_config->has_profiled_batching_parameters_dir()) {
+    return;
+  }
+  // Written out so that it can be reused as is, without profiling again.
+  BatchingParameters reusable_config = *batching_config;
+  reusable_config.clear_profile_allowed_batch_sizes();
+  reusable_config.clear_allowed_batch_size_overhead_micros();
+  reusable_config.clear_profiled_batching_parameters_dir();
+  const string file_path = io::JoinPath(
+      batching_config->profiled_batching_parameters_dir().value(),
+      strings::StrCat(io::Basename(io::Dirname(path)), "-",
+                      io::Basename(path), ".batching_parameters.txt"));
+  const Status write_status =
+      WriteTextProto(Env::Default(), file_path, reusable_config);
+  if (!write_status.ok()) {
+    LOG(WARNING) << "Failed to write profiled batching parameters to "
+                 << file_path << ": " << write_status;
+  }
+}
+
 }  // namespace
 
 Status SavedModelBundleFactory::Create(
     const SessionBundleConfig& config,
     std::unique_ptr<SavedModelBundleFactory>* factory) {
   std::shared_ptr<Batcher> batcher;
+  std::shared_ptr<FairShareBatchExecutor> batch_executor;
   if (config.has_batching_parameters()) {
     TF_RETURN_IF_ERROR(
         CreateBatchScheduler(config.batching_parameters(), &batcher));
+    TF_RETURN_IF_ERROR(
+        CreateBatchExecutor(config.batching_parameters(), &batch_executor));
   }
-  factory->reset(new SavedModelBundleFactory(config, batcher));
+  factory->reset(new SavedModelBundleFactory(config, batcher, batch_executor));
   return Status::OK();
 }
 
@@ -77,6 +126,13 @@ Status SavedModelBundleFactory::EstimateResourceRequirement(
 
 Status SavedModelBundleFactory::CreateSavedModelBundle(
     const string& path, std::unique_ptr<SavedModelBundle>* bundle) {
+  return CreateSavedModelBundle(io::Basename(io::Dirname(path)).ToString(),
+                                path, bundle);
+}
+
+Status SavedModelBundleFactory::CreateSavedModelBundle(
+    const string& model_name, const string& path,
+    std::unique_ptr<SavedModelBundle>* bundle) {
   bundle->reset(new SavedModelBundle);
   TF_RETURN_IF_ERROR(LoadSessionBundleOrSavedModelBundle(
       GetSessionOptions(config_), GetRunOptions(config_), path,
@@ -98,16 +154,36 @@ Status SavedModelBundleFactory::CreateSavedModelBundle(
     // Note that in the future, the plan is to enable explicit configuration of
     // the one or many SignatureDefs to enable.
     const std::vector<SignatureDef> signatures = GetSignatureDefs(**bundle);
-    return WrapSessionForBatching(config_.batching_parameters(),
-                                  batch_scheduler_, signatures,
-                                  &(*bundle)->session);
+    BatchingParameters batching_config = config_.batching_parameters();
+    if (batching_config.profile_allowed_batch_sizes() &&
+        batching_config.allowed_batch_sizes().empty()) {
+      ProfileAllowedBatchSizes(path, **bundle, signatures, &batching_config);
+    }
+    std::shared_ptr<const ModelBatchShares> model_batch_shares;
+    {
+      mutex_lock l(mu_);
+      model_batch_shares = model_batch_shares_;
+    }
+    return WrapSessionForBatching(
+        batching_config, batch_scheduler_, batch_executor_,
+        GetExecutorQueueOptions(model_name, model_batch_shares.get()),
+        signatures, &(*bundle)->session);
   }
   return WrapSession(&(*bundle)->session);
 }
 
+void SavedModelBundleFactory::SetModelBatchShares(
+    std::shared_ptr<const ModelBatchShares> shares) {
+  mutex_lock l(mu_);
+  model_batch_shares_ = std::move(shares);
+}
+
 SavedModelBundleFactory::SavedModelBundleFactory(
-    const SessionBundleConfig& config, std::shared_ptr<Batcher> batch_scheduler)
-    : config_(config), batch_scheduler_(batch_scheduler) {}
+    const SessionBundleConfig& config, std::shared_ptr<Batcher> batch_scheduler,
+    std::shared_ptr<FairShareBatchExecutor> batch_executor)
+    : config_(config),
+      batch_scheduler_(batch_scheduler),
+      batch_executor_(batch_executor) {}
 
 }  // namespace serving
 }  // namespace tensorflow
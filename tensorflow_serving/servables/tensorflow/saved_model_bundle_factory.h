@@ -20,8 +20,12 @@ limitations under the License.
 #include "tensorflow/contrib/batching/shared_batch_scheduler.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
 #include "tensorflow_serving/batching/batching_session.h"
+#include "tensorflow_serving/batching/fair_share_batch_executor.h"
 #include "tensorflow_serving/resources/resources.pb.h"
+#include "tensorflow_serving/servables/tensorflow/model_batch_shares.h"
 #include "tensorflow_serving/servables/tensorflow/session_bundle_config.pb.h"
 
 namespace tensorflow {
@@ -64,6 +68,18 @@ class SavedModelBundleFactory {
   Status CreateSavedModelBundle(const string& path,
                                 std::unique_ptr<SavedModelBundle>* bundle);
 
+  /// Like the above, for a version of the model named 'model_name'. If the
+  /// config calls for 'fair_share_batch_threads', the model's batches get its
+  /// share in the ModelBatchShares set with SetModelBatchShares(). (The above
+  /// names the model after the directory 'path' is in instead, and gives it
+  /// the default share.)
+  Status CreateSavedModelBundle(const string& model_name, const string& path,
+                                std::unique_ptr<SavedModelBundle>* bundle);
+
+  /// Sets the batch shares that the bundles created from now on look up the
+  /// share of their model in.
+  void SetModelBatchShares(std::shared_ptr<const ModelBatchShares> shares);
+
   /// Estimates the resources a SavedModel bundle will use once loaded, from its
   /// export path.
   ///
@@ -78,8 +94,10 @@ class SavedModelBundleFactory {
  private:
   using Batcher = SharedBatchScheduler<BatchingSessionTask>;
 
-  SavedModelBundleFactory(const SessionBundleConfig& config,
-                          std::shared_ptr<Batcher> batch_scheduler);
+  SavedModelBundleFactory(
+      const SessionBundleConfig& config,
+      std::shared_ptr<Batcher> batch_scheduler,
+      std::shared_ptr<FairShareBatchExecutor> batch_executor);
 
   const SessionBundleConfig config_;
 
@@ -87,6 +105,14 @@ class SavedModelBundleFactory {
   // emits. If batching is not configured, this remains null.
   std::shared_ptr<Batcher> batch_scheduler_;
 
+  // If 'fair_share_batch_threads' is configured, the executor that shares the
+  // batch threads out among all sessions this factory emits. Otherwise null.
+  std::shared_ptr<FairShareBatchExecutor> batch_executor_;
+
+  mutable mutex mu_;
+  // Null until SetModelBatchShares() is called.
+  std::shared_ptr<const ModelBatchShares> model_batch_shares_ GUARDED_BY(mu_);
+
   TF_DISALLOW_COPY_AND_ASSIGN(SavedModelBundleFactory);
 };
 
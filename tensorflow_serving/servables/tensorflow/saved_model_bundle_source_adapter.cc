@@ -17,6 +17,8 @@ limitations under the License.
 
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/platform/types.h"
@@ -45,12 +47,35 @@ SavedModelBundleSourceAdapter::SavedModelBundleSourceAdapter(
     std::unique_ptr<SavedModelBundleFactory> bundle_factory)
     : bundle_factory_(std::move(bundle_factory)) {}
 
-Status SavedModelBundleSourceAdapter::Convert(const StoragePath& path,
-                                              std::unique_ptr<Loader>* loader) {
+std::vector<ServableData<std::unique_ptr<Loader>>>
+SavedModelBundleSourceAdapter::Adapt(
+    StringPiece servable_name,
+    std::vector<ServableData<StoragePath>> versions) {
+  std::vector<ServableData<std::unique_ptr<Loader>>> adapted_versions;
+  adapted_versions.reserve(versions.size());
+  for (const ServableData<StoragePath>& version : versions) {
+    if (!version.status().ok()) {
+      adapted_versions.emplace_back(version.id(), version.status());
+      continue;
+    }
+    adapted_versions.emplace_back(
+        version.id(),
+        CreateLoader(servable_name.ToString(), version.DataOrDie()));
+  }
+  return adapted_versions;
+}
+
+void SavedModelBundleSourceAdapter::SetModelBatchShares(
+    std::shared_ptr<const ModelBatchShares> shares) {
+  bundle_factory_->SetModelBatchShares(std::move(shares));
+}
+
+std::unique_ptr<Loader> SavedModelBundleSourceAdapter::CreateLoader(
+    const string& servable_name, const StoragePath& path) {
   std::shared_ptr<SavedModelBundleFactory> bundle_factory = bundle_factory_;
-  auto servable_creator = [bundle_factory,
+  auto servable_creator = [bundle_factory, servable_name,
                            path](std::unique_ptr<SavedModelBundle>* bundle) {
-    return bundle_factory->CreateSavedModelBundle(path, bundle);
+    return bundle_factory->CreateSavedModelBundle(servable_name, path, bundle);
   };
   auto resource_estimator = [bundle_factory,
                              path](ResourceAllocation* estimate) {
@@ -79,9 +104,8 @@ Status SavedModelBundleSourceAdapter::Convert(const StoragePath& path,
                                        path](ResourceAllocation* estimate) {
     return bundle_factory->EstimateResourceRequirement(path, estimate);
   };
-  loader->reset(new SimpleLoader<SavedModelBundle>(
+  return std::unique_ptr<Loader>(new SimpleLoader<SavedModelBundle>(
       servable_creator, resource_estimator, post_load_resource_estimator));
-  return Status::OK();
 }
 
 std::function<Status(
@@ -22,6 +22,7 @@ limitations under the License.
 #include "tensorflow_serving/core/loader.h"
 #include "tensorflow_serving/core/source_adapter.h"
 #include "tensorflow_serving/core/storage_path.h"
+#include "tensorflow_serving/servables/tensorflow/model_batch_shares.h"
 #include "tensorflow_serving/servables/tensorflow/saved_model_bundle_factory.h"
 #include "tensorflow_serving/servables/tensorflow/saved_model_bundle_source_adapter.pb.h"
 #include "tensorflow_serving/servables/tensorflow/session_bundle_source_adapter.pb.h"
@@ -33,7 +34,8 @@ namespace serving {
 // It keeps a SavedModelBundleFactory as its state, which may house a batch
 // scheduler that is shared across all of the SavedModel bundles it emits.
 class SavedModelBundleSourceAdapter final
-    : public UnarySourceAdapter<StoragePath, std::unique_ptr<Loader>> {
+    : public SourceAdapter<StoragePath, std::unique_ptr<Loader>>,
+      public ModelBatchSharesUser {
  public:
   // TODO(b/32248363): Switch to SavedModelBundleSourceAdapterConfig after we
   // switch Model Server to Saved Model and populate the "real" fields of
@@ -48,14 +50,23 @@ class SavedModelBundleSourceAdapter final
       std::unique_ptr<SourceAdapter<StoragePath, std::unique_ptr<Loader>>>*)>
   GetCreator(const SessionBundleSourceAdapterConfig& config);
 
+  void SetModelBatchShares(
+      std::shared_ptr<const ModelBatchShares> shares) override;
+
  private:
   friend class SavedModelBundleSourceAdapterCreator;
 
   explicit SavedModelBundleSourceAdapter(
       std::unique_ptr<SavedModelBundleFactory> bundle_factory);
 
-  Status Convert(const StoragePath& path,
-                 std::unique_ptr<Loader>* loader) override;
+  // Creates a Loader for each version, of the model named 'servable_name'.
+  std::vector<ServableData<std::unique_ptr<Loader>>> Adapt(
+      StringPiece servable_name,
+      std::vector<ServableData<StoragePath>> versions) override;
+
+  // Returns a Loader of the version of 'servable_name' at 'path'.
+  std::unique_ptr<Loader> CreateLoader(const string& servable_name,
+                                       const StoragePath& path);
 
   // We use a shared ptr to share ownership with Loaders we emit, in case they
   // outlive this object.
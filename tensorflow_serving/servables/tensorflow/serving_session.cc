@@ -15,6 +15,8 @@ limitations under the License.
 
 #include "tensorflow_serving/servables/tensorflow/serving_session.h"
 
+#include <utility>
+
 #include "tensorflow/core/framework/graph.pb.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/status.h"
@@ -34,5 +36,31 @@ Status ServingSession::Close() {
   return errors::PermissionDenied("State changes denied via ServingSession");
 }
 
+void ServingSession::RunAsync(
+    const RunOptions& run_options,
+    const std::vector<std::pair<string, Tensor>>& inputs,
+    const std::vector<string>& output_tensor_names,
+    std::vector<Tensor>* outputs, RunMetadata* run_metadata,
+    RunAsyncCallback done) {
+  done(Run(run_options, inputs, output_tensor_names, {} /* target nodes */,
+           outputs, run_metadata));
+}
+
+void RunSessionAsync(Session* session, const RunOptions& run_options,
+                     const std::vector<std::pair<string, Tensor>>& inputs,
+                     const std::vector<string>& output_tensor_names,
+                     std::vector<Tensor>* outputs, RunMetadata* run_metadata,
+                     ServingSession::RunAsyncCallback done) {
+  ServingSession* const serving_session =
+      dynamic_cast<ServingSession*>(session);
+  if (serving_session != nullptr) {
+    serving_session->RunAsync(run_options, inputs, output_tensor_names,
+                              outputs, run_metadata, std::move(done));
+    return;
+  }
+  done(session->Run(run_options, inputs, output_tensor_names,
+                    {} /* target nodes */, outputs, run_metadata));
+}
+
 }  // namespace serving
 }  // namespace tensorflow
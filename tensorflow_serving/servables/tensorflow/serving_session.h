@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef TENSORFLOW_SERVING_SERVABLES_TENSORFLOW_SERVING_SESSION_H_
 #define TENSORFLOW_SERVING_SERVABLES_TENSORFLOW_SERVING_SESSION_H_
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <utility>
@@ -32,6 +33,9 @@ namespace serving {
 /// implementations that intend to be read-only and only implement Run().
 class ServingSession : public Session {
  public:
+  // Called once an asynchronous run is done, with its outcome.
+  using RunAsyncCallback = std::function<void(const Status& status)>;
+
   ServingSession() = default;
   ~ServingSession() override = default;
 
@@ -41,8 +45,31 @@ class ServingSession : public Session {
   Status Close() final;
 
   // (Subclasses just implement Run().)
+
+  // Like Run() without target nodes, except that it may return before the run
+  // is done, and calls 'done' once it is, with 'outputs' and 'run_metadata'
+  // filled in. 'inputs', 'output_tensor_names', 'outputs' and 'run_metadata'
+  // (which may be null, as for Run()) must stay alive until then. 'done' may
+  // be called on any thread, including the calling one before RunAsync()
+  // returns.
+  //
+  // The default implementation calls Run() and then 'done'. Subclasses that
+  // can run without holding the calling thread override it.
+  virtual void RunAsync(const RunOptions& run_options,
+                        const std::vector<std::pair<string, Tensor>>& inputs,
+                        const std::vector<string>& output_tensor_names,
+                        std::vector<Tensor>* outputs, RunMetadata* run_metadata,
+                        RunAsyncCallback done);
 };
 
+/// Calls session->RunAsync() if 'session' is a ServingSession, and otherwise
+/// calls session->Run() and then 'done'.
+void RunSessionAsync(Session* session, const RunOptions& run_options,
+                     const std::vector<std::pair<string, Tensor>>& inputs,
+                     const std::vector<string>& output_tensor_names,
+                     std::vector<Tensor>* outputs, RunMetadata* run_metadata,
+                     ServingSession::RunAsyncCallback done);
+
 /// A ServingSession that wraps a given Session, and blocks all calls other than
 /// Run().
 class ServingSessionWrapper : public ServingSession {
@@ -74,6 +101,15 @@ class ServingSessionWrapper : public ServingSession {
     return wrapped_->ListDevices(response);
   }
 
+  void RunAsync(const RunOptions& run_options,
+                const std::vector<std::pair<string, Tensor>>& inputs,
+                const std::vector<string>& output_tensor_names,
+                std::vector<Tensor>* outputs, RunMetadata* run_metadata,
+                RunAsyncCallback done) override {
+    RunSessionAsync(wrapped_.get(), run_options, inputs, output_tensor_names,
+                    outputs, run_metadata, std::move(done));
+  }
+
  private:
   std::unique_ptr<Session> wrapped_;
 
@@ -15,8 +15,11 @@ limitations under the License.
 
 #include "tensorflow_serving/servables/tensorflow/session_bundle_factory.h"
 
+#include <utility>
+
 #include "tensorflow/contrib/session_bundle/bundle_shim.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/io/path.h"
 #include "tensorflow/core/protobuf/config.pb.h"
 #include "tensorflow/core/public/session_options.h"
 #include "tensorflow_serving/servables/tensorflow/bundle_factory_util.h"
@@ -60,11 +63,14 @@ Status SessionBundleFactory::Create(
     const SessionBundleConfig& config,
     std::unique_ptr<SessionBundleFactory>* factory) {
   std::shared_ptr<Batcher> batcher;
+  std::shared_ptr<FairShareBatchExecutor> batch_executor;
   if (config.has_batching_parameters()) {
     TF_RETURN_IF_ERROR(
         CreateBatchScheduler(config.batching_parameters(), &batcher));
+    TF_RETURN_IF_ERROR(
+        CreateBatchExecutor(config.batching_parameters(), &batch_executor));
   }
-  factory->reset(new SessionBundleFactory(config, batcher));
+  factory->reset(new SessionBundleFactory(config, batcher, batch_executor));
   return Status::OK();
 }
 
@@ -75,6 +81,13 @@ Status SessionBundleFactory::EstimateResourceRequirement(
 
 Status SessionBundleFactory::CreateSessionBundle(
     const string& path, std::unique_ptr<SessionBundle>* bundle) {
+  return CreateSessionBundle(io::Basename(io::Dirname(path)).ToString(), path,
+                             bundle);
+}
+
+Status SessionBundleFactory::CreateSessionBundle(
+    const string& model_name, const string& path,
+    std::unique_ptr<SessionBundle>* bundle) {
   bundle->reset(new SessionBundle);
   TF_RETURN_IF_ERROR(LoadSessionBundleFromPathUsingRunOptions(
       GetSessionOptions(config_), GetRunOptions(config_), path, bundle->get()));
@@ -86,16 +99,31 @@ Status SessionBundleFactory::CreateSessionBundle(
     }
     std::vector<SignatureDef> signatures;
     TF_RETURN_IF_ERROR(GetSignatureDefs(**bundle, &signatures));
-    return WrapSessionForBatching(config_.batching_parameters(),
-                                  batch_scheduler_, signatures,
-                                  &(*bundle)->session);
+    std::shared_ptr<const ModelBatchShares> model_batch_shares;
+    {
+      mutex_lock l(mu_);
+      model_batch_shares = model_batch_shares_;
+    }
+    return WrapSessionForBatching(
+        config_.batching_parameters(), batch_scheduler_, batch_executor_,
+        GetExecutorQueueOptions(model_name, model_batch_shares.get()),
+        signatures, &(*bundle)->session);
   }
   return WrapSession(&(*bundle)->session);
 }
 
+void SessionBundleFactory::SetModelBatchShares(
+    std::shared_ptr<const ModelBatchShares> shares) {
+  mutex_lock l(mu_);
+  model_batch_shares_ = std::move(shares);
+}
+
 SessionBundleFactory::SessionBundleFactory(
-    const SessionBundleConfig& config, std::shared_ptr<Batcher> batch_scheduler)
-    : config_(config), batch_scheduler_(batch_scheduler) {}
+    const SessionBundleConfig& config, std::shared_ptr<Batcher> batch_scheduler,
+    std::shared_ptr<FairShareBatchExecutor> batch_executor)
+    : config_(config),
+      batch_scheduler_(batch_scheduler),
+      batch_executor_(batch_executor) {}
 
 }  // namespace serving
 }  // namespace tensorflow
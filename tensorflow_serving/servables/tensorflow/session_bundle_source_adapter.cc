@@ -17,6 +17,8 @@ limitations under the License.
 
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow_serving/core/simple_loader.h"
@@ -41,20 +43,42 @@ SessionBundleSourceAdapter::SessionBundleSourceAdapter(
     std::unique_ptr<SessionBundleFactory> bundle_factory)
     : bundle_factory_(std::move(bundle_factory)) {}
 
-Status SessionBundleSourceAdapter::Convert(const StoragePath& path,
-                                           std::unique_ptr<Loader>* loader) {
+std::vector<ServableData<std::unique_ptr<Loader>>>
+SessionBundleSourceAdapter::Adapt(
+    StringPiece servable_name,
+    std::vector<ServableData<StoragePath>> versions) {
+  std::vector<ServableData<std::unique_ptr<Loader>>> adapted_versions;
+  adapted_versions.reserve(versions.size());
+  for (const ServableData<StoragePath>& version : versions) {
+    if (!version.status().ok()) {
+      adapted_versions.emplace_back(version.id(), version.status());
+      continue;
+    }
+    adapted_versions.emplace_back(
+        version.id(),
+        CreateLoader(servable_name.ToString(), version.DataOrDie()));
+  }
+  return adapted_versions;
+}
+
+void SessionBundleSourceAdapter::SetModelBatchShares(
+    std::shared_ptr<const ModelBatchShares> shares) {
+  bundle_factory_->SetModelBatchShares(std::move(shares));
+}
+
+std::unique_ptr<Loader> SessionBundleSourceAdapter::CreateLoader(
+    const string& servable_name, const StoragePath& path) {
   std::shared_ptr<SessionBundleFactory> bundle_factory = bundle_factory_;
-  auto servable_creator = [bundle_factory,
+  auto servable_creator = [bundle_factory, servable_name,
                            path](std::unique_ptr<SessionBundle>* bundle) {
-    return bundle_factory->CreateSessionBundle(path, bundle);
+    return bundle_factory->CreateSessionBundle(servable_name, path, bundle);
   };
   auto resource_estimator = [bundle_factory,
                              path](ResourceAllocation* estimate) {
     return bundle_factory->EstimateResourceRequirement(path, estimate);
   };
-  loader->reset(
+  return std::unique_ptr<Loader>(
       new SimpleLoader<SessionBundle>(servable_creator, resource_estimator));
-  return Status::OK();
 }
 
 std::function<Status(
@@ -0,0 +1,148 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow_serving/servables/tensorflow/signature_plans.h"
+
+#include <utility>
+
+#include "tensorflow/cc/saved_model/signature_constants.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace serving {
+namespace {
+
+// Resolves the tensors of 'tensor_infos' into 'tensor_plans', and lists their
+// aliases in 'aliases'.
+void PlanTensors(const protobuf::Map<string, TensorInfo>& tensor_infos,
+                 std::unordered_map<string, SignaturePlan::TensorPlan>*
+                     tensor_plans,
+                 string* aliases) {
+  for (const auto& entry : tensor_infos) {
+    const TensorInfo& info = entry.second;
+    SignaturePlan::TensorPlan& plan = (*tensor_plans)[entry.first];
+    plan.name = info.name();
+    plan.dtype = info.dtype();
+    if (info.has_tensor_shape() &&
+        PartialTensorShape::IsValid(info.tensor_shape())) {
+      plan.shape = PartialTensorShape(info.tensor_shape());
+    }
+    strings::StrAppend(aliases, aliases->empty() ? "" : ", ", entry.first);
+  }
+}
+
+}  // namespace
+
+Status ValidateInputTensor(const string& alias,
+                           const SignaturePlan::TensorPlan& plan,
+                           const Tensor& tensor) {
+  if (plan.dtype != DT_INVALID && tensor.dtype() != plan.dtype) {
+    return errors::InvalidArgument(
+        "Expected input tensor ", alias, " to be of type ",
+        DataTypeString(plan.dtype), ". Was: ", DataTypeString(tensor.dtype()));
+  }
+  if (!plan.shape.IsCompatibleWith(tensor.shape())) {
+    return errors::InvalidArgument(
+        "Expected input tensor ", alias, " to have a shape compatible with ",
+        plan.shape.DebugString(), ". Was: ", tensor.shape().DebugString());
+  }
+  return Status::OK();
+}
+
+// static
+Status SignaturePlans::Create(const MetaGraphDef& meta_graph_def,
+                              std::unique_ptr<SignaturePlans>* plans) {
+  plans->reset(new SignaturePlans(&meta_graph_def));
+  for (const auto& entry : meta_graph_def.signature_def()) {
+    const SignatureDef& signature_def = entry.second;
+    SignaturePlan& plan = (*plans)->plans_[entry.first];
+    plan.signature_def = &signature_def;
+    PlanTensors(signature_def.inputs(), &plan.inputs, &plan.input_aliases);
+    PlanTensors(signature_def.outputs(), &plan.outputs, &plan.output_aliases);
+    plan.default_output_tensor_names.reserve(signature_def.outputs().size());
+    plan.default_output_aliases.reserve(signature_def.outputs().size());
+    for (const auto& output : signature_def.outputs()) {
+      plan.default_output_tensor_names.push_back(output.second.name());
+      plan.default_output_aliases.push_back(output.first);
+    }
+  }
+  return Status::OK();
+}
+
+const SignaturePlan* SignaturePlans::Find(const string& signature_name) const {
+  auto found = plans_.find(signature_name.empty()
+                               ? kDefaultServingSignatureDefKey
+                               : signature_name);
+  if (found == plans_.end()) {
+    return nullptr;
+  }
+  return &found->second;
+}
+
+// static
+Status SignaturePlanCache::Create(
+    EventBus<ServableState>* const servable_event_bus,
+    std::unique_ptr<SignaturePlanCache>* const cache) {
+  cache->reset(new SignaturePlanCache());
+  SignaturePlanCache* const raw_cache = cache->get();
+  (*cache)->servable_event_subscription_ = servable_event_bus->Subscribe(
+      [raw_cache](const EventBus<ServableState>::EventAndTime& event) {
+        raw_cache->HandleEvent(event);
+      });
+  return Status::OK();
+}
+
+Status SignaturePlanCache::Get(const ServableId& id,
+                               const MetaGraphDef& meta_graph_def,
+                               std::shared_ptr<const SignaturePlans>* plans) {
+  {
+    mutex_lock l(mu_);
+    auto found = plans_.find(id);
+    // Plans are dropped once their servable is unloaded, at which point no
+    // request can be using it, so the entry should always belong to the
+    // servable currently loaded as 'id'. Building plans is cheap next to
+    // serving with the wrong ones, so check anyway.
+    if (found != plans_.end() &&
+        found->second->meta_graph_def() == &meta_graph_def) {
+      *plans = found->second;
+      return Status::OK();
+    }
+  }
+
+  // Build outside the lock. Concurrent first requests may each build the
+  // plans; the last one to finish wins.
+  std::unique_ptr<SignaturePlans> new_plans;
+  TF_RETURN_IF_ERROR(SignaturePlans::Create(meta_graph_def, &new_plans));
+  *plans = std::move(new_plans);
+  mutex_lock l(mu_);
+  plans_[id] = *plans;
+  return Status::OK();
+}
+
+void SignaturePlanCache::HandleEvent(
+    const EventBus<ServableState>::EventAndTime& event_and_time) {
+  const ServableState& state = event_and_time.event;
+  if (state.manager_state != ServableState::ManagerState::kEnd) {
+    return;
+  }
+  mutex_lock l(mu_);
+  if (plans_.erase(state.id) > 0) {
+    VLOG(1) << "Dropping the signature plans of " << state.id.DebugString();
+  }
+}
+
+}  // namespace serving
+}  // namespace tensorflow
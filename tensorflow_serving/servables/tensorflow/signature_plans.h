@@ -0,0 +1,137 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_SERVING_SERVABLES_TENSORFLOW_SIGNATURE_PLANS_H_
+#define TENSORFLOW_SERVING_SERVABLES_TENSORFLOW_SIGNATURE_PLANS_H_
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/protobuf/meta_graph.pb.h"
+#include "tensorflow_serving/core/servable_id.h"
+#include "tensorflow_serving/core/servable_state.h"
+#include "tensorflow_serving/util/event_bus.h"
+
+namespace tensorflow {
+namespace serving {
+
+// A SignatureDef of a loaded SavedModel, resolved once so that requests don't
+// have to copy it, search it for aliases or rebuild its list of outputs.
+struct SignaturePlan {
+  // One input or output of the signature.
+  struct TensorPlan {
+    // The name of the tensor in the graph.
+    string name;
+    // DT_INVALID if the signature doesn't say.
+    DataType dtype;
+    // Unknown rank if the signature doesn't say.
+    PartialTensorShape shape;
+  };
+
+  // Points into the MetaGraphDef the plan was built from.
+  const SignatureDef* signature_def;
+
+  // Keyed by alias.
+  std::unordered_map<string, TensorPlan> inputs;
+  std::unordered_map<string, TensorPlan> outputs;
+
+  // The aliases of the inputs and of the outputs as comma-separated lists, for
+  // error messages.
+  string input_aliases;
+  string output_aliases;
+
+  // What to fetch when a request doesn't name any outputs: all of them, in the
+  // order the signature lists them.
+  std::vector<string> default_output_tensor_names;
+  std::vector<string> default_output_aliases;
+};
+
+// Returns INVALID_ARGUMENT if 'tensor', fed as the input called 'alias', does
+// not have the dtype and shape that 'plan' expects.
+Status ValidateInputTensor(const string& alias,
+                           const SignaturePlan::TensorPlan& plan,
+                           const Tensor& tensor);
+
+// The plans of all the signatures of one SavedModel.
+class SignaturePlans {
+ public:
+  // 'meta_graph_def' must outlive the plans.
+  static Status Create(const MetaGraphDef& meta_graph_def,
+                       std::unique_ptr<SignaturePlans>* plans);
+
+  ~SignaturePlans() = default;
+
+  // Returns the plan of the signature called 'signature_name', or of the
+  // default serving signature if 'signature_name' is empty. Returns null if
+  // there is no such signature.
+  const SignaturePlan* Find(const string& signature_name) const;
+
+  const MetaGraphDef* meta_graph_def() const { return meta_graph_def_; }
+
+ private:
+  explicit SignaturePlans(const MetaGraphDef* meta_graph_def)
+      : meta_graph_def_(meta_graph_def) {}
+
+  const MetaGraphDef* const meta_graph_def_;
+  std::unordered_map<string, SignaturePlan> plans_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(SignaturePlans);
+};
+
+// The signature plans of the SavedModel servables in a server, built the first
+// time each servable is used.
+//
+// Listens to the servable event bus, and drops the plans of a servable once it
+// has been unloaded.
+class SignaturePlanCache {
+ public:
+  static Status Create(EventBus<ServableState>* servable_event_bus,
+                       std::unique_ptr<SignaturePlanCache>* cache);
+
+  ~SignaturePlanCache() = default;
+
+  // Sets 'plans' to the plans of the servable 'id', whose signatures are in
+  // 'meta_graph_def', building them if needed.
+  Status Get(const ServableId& id, const MetaGraphDef& meta_graph_def,
+             std::shared_ptr<const SignaturePlans>* plans);
+
+ private:
+  SignaturePlanCache() = default;
+
+  void HandleEvent(const EventBus<ServableState>::EventAndTime& event_and_time);
+
+  mutable mutex mu_;
+  std::unordered_map<ServableId, std::shared_ptr<const SignaturePlans>,
+                     HashServableId>
+      plans_ GUARDED_BY(mu_);
+
+  std::unique_ptr<EventBus<ServableState>::Subscription>
+      servable_event_subscription_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(SignaturePlanCache);
+};
+
+}  // namespace serving
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_SERVING_SERVABLES_TENSORFLOW_SIGNATURE_PLANS_H_
@@ -0,0 +1,139 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow_serving/servables/tensorflow/signature_plans.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "tensorflow/cc/saved_model/signature_constants.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+
+namespace tensorflow {
+namespace serving {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::UnorderedElementsAre;
+
+void AddTensorInfo(const string& alias, const string& name,
+                   const DataType dtype, const std::vector<int64>& dims,
+                   protobuf::Map<string, TensorInfo>* tensor_infos) {
+  TensorInfo& info = (*tensor_infos)[alias];
+  info.set_name(name);
+  info.set_dtype(dtype);
+  for (const int64 dim : dims) {
+    info.mutable_tensor_shape()->add_dim()->set_size(dim);
+  }
+}
+
+MetaGraphDef CreateMetaGraphDef() {
+  MetaGraphDef meta_graph_def;
+  SignatureDef& predict =
+      (*meta_graph_def.mutable_signature_def())[kDefaultServingSignatureDefKey];
+  predict.set_method_name(kPredictMethodName);
+  AddTensorInfo("x", "x:0", DT_FLOAT, {-1, 2}, predict.mutable_inputs());
+  AddTensorInfo("y", "y:0", DT_FLOAT, {}, predict.mutable_outputs());
+
+  SignatureDef& untyped = (*meta_graph_def.mutable_signature_def())["untyped"];
+  (*untyped.mutable_inputs())["a"].set_name("a:0");
+  (*untyped.mutable_outputs())["b"].set_name("b:0");
+  (*untyped.mutable_outputs())["c"].set_name("c:0");
+  return meta_graph_def;
+}
+
+TEST(SignaturePlansTest, Find) {
+  const MetaGraphDef meta_graph_def = CreateMetaGraphDef();
+  std::unique_ptr<SignaturePlans> plans;
+  TF_ASSERT_OK(SignaturePlans::Create(meta_graph_def, &plans));
+  EXPECT_EQ(&meta_graph_def, plans->meta_graph_def());
+  EXPECT_EQ(nullptr, plans->Find("missing"));
+
+  const SignaturePlan* plan = plans->Find("");
+  ASSERT_NE(nullptr, plan);
+  EXPECT_EQ(plan, plans->Find(kDefaultServingSignatureDefKey));
+  EXPECT_EQ(
+      &meta_graph_def.signature_def().at(kDefaultServingSignatureDefKey),
+      plan->signature_def);
+  ASSERT_EQ(1, plan->inputs.count("x"));
+  EXPECT_EQ("x:0", plan->inputs.at("x").name);
+  EXPECT_EQ(DT_FLOAT, plan->inputs.at("x").dtype);
+  EXPECT_EQ("[?,2]", plan->inputs.at("x").shape.DebugString());
+  EXPECT_EQ("x", plan->input_aliases);
+  EXPECT_EQ("y", plan->output_aliases);
+  EXPECT_THAT(plan->default_output_tensor_names, ElementsAre("y:0"));
+  EXPECT_THAT(plan->default_output_aliases, ElementsAre("y"));
+
+  plan = plans->Find("untyped");
+  ASSERT_NE(nullptr, plan);
+  EXPECT_EQ(DT_INVALID, plan->inputs.at("a").dtype);
+  EXPECT_TRUE(plan->inputs.at("a").shape.unknown_rank());
+  EXPECT_THAT(plan->default_output_tensor_names,
+              UnorderedElementsAre("b:0", "c:0"));
+  EXPECT_THAT(plan->default_output_aliases, UnorderedElementsAre("b", "c"));
+  // Both lists follow the same order.
+  EXPECT_EQ(plan->outputs.at(plan->default_output_aliases[0]).name,
+            plan->default_output_tensor_names[0]);
+}
+
+TEST(SignaturePlansTest, ValidateInputTensor) {
+  const MetaGraphDef meta_graph_def = CreateMetaGraphDef();
+  std::unique_ptr<SignaturePlans> plans;
+  TF_ASSERT_OK(SignaturePlans::Create(meta_graph_def, &plans));
+  const SignaturePlan::TensorPlan& x = plans->Find("")->inputs.at("x");
+  TF_EXPECT_OK(ValidateInputTensor(
+      "x", x, test::AsTensor<float>({1, 2, 3, 4}, TensorShape({2, 2}))));
+  EXPECT_EQ(
+      error::INVALID_ARGUMENT,
+      ValidateInputTensor("x", x, test::AsTensor<int32>({1, 2}, {1, 2}))
+          .code());
+  EXPECT_EQ(error::INVALID_ARGUMENT,
+            ValidateInputTensor("x", x, test::AsTensor<float>({1, 2, 3}))
+                .code());
+
+  // Anything goes when the signature doesn't say.
+  const SignaturePlan::TensorPlan& a = plans->Find("untyped")->inputs.at("a");
+  TF_EXPECT_OK(ValidateInputTensor("a", a, test::AsScalar<string>("a")));
+}
+
+TEST(SignaturePlanCacheTest, BuildsOncePerServable) {
+  auto servable_event_bus = EventBus<ServableState>::CreateEventBus();
+  std::unique_ptr<SignaturePlanCache> cache;
+  TF_ASSERT_OK(SignaturePlanCache::Create(servable_event_bus.get(), &cache));
+  const MetaGraphDef meta_graph_def = CreateMetaGraphDef();
+  const ServableId id = {"model", 1};
+
+  std::shared_ptr<const SignaturePlans> plans;
+  TF_ASSERT_OK(cache->Get(id, meta_graph_def, &plans));
+  std::shared_ptr<const SignaturePlans> same_plans;
+  TF_ASSERT_OK(cache->Get(id, meta_graph_def, &same_plans));
+  EXPECT_EQ(plans, same_plans);
+
+  // A different MetaGraphDef under the same id gets its own plans.
+  const MetaGraphDef other_meta_graph_def = CreateMetaGraphDef();
+  std::shared_ptr<const SignaturePlans> other_plans;
+  TF_ASSERT_OK(cache->Get(id, other_meta_graph_def, &other_plans));
+  EXPECT_EQ(&other_meta_graph_def, other_plans->meta_graph_def());
+
+  // Unloading drops them.
+  servable_event_bus->Publish(
+      {id, ServableState::ManagerState::kEnd, Status::OK()});
+  std::shared_ptr<const SignaturePlans> new_plans;
+  TF_ASSERT_OK(cache->Get(id, other_meta_graph_def, &new_plans));
+  EXPECT_NE(other_plans, new_plans);
+}
+
+}  // namespace
+}  // namespace serving
+}  // namespace tensorflow
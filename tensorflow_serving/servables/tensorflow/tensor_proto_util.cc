@@ -0,0 +1,102 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_serving/servables/tensorflow/tensor_proto_util.h"
+
+#include <stdint.h>
+#include <utility>
+
+#include "third_party/eigen3/Eigen/Core"
+#include "tensorflow/c/c_api.h"
+#include "tensorflow/c/c_api_internal.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/gtl/inlined_vector.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace serving {
+namespace {
+
+// Deallocator for borrowed buffers: the bytes belong to the proto, so all that
+// is left to do is to drop the reference on the owner.
+void ReleaseOwner(void* data, size_t len, void* owner) {
+  delete static_cast<std::shared_ptr<const void>*>(owner);
+}
+
+// Returns true if 'proto' (whose shape is 'shape') can be decoded by aliasing
+// its 'tensor_content'.
+bool CanBorrowTensorContent(const TensorProto& proto,
+                            const TensorShape& shape) {
+  const DataType dtype = proto.dtype();
+  if (!DataTypeCanUseMemcpy(dtype)) {
+    return false;
+  }
+  const string& content = proto.tensor_content();
+  if (content.empty() ||
+      content.size() != shape.num_elements() * DataTypeSize(dtype)) {
+    return false;
+  }
+  // Tensor buffers are mapped as aligned Eigen tensors, so misaligned bytes
+  // have to be copied.
+  return reinterpret_cast<uintptr_t>(content.data()) % EIGEN_MAX_ALIGN_BYTES ==
+         0;
+}
+
+}  // namespace
+
+bool DecodeTensorProto(const TensorProto& proto,
+                       std::shared_ptr<const void> owner, Tensor* tensor) {
+  if (!TensorShape::IsValid(proto.tensor_shape())) {
+    return false;
+  }
+  const TensorShape shape(proto.tensor_shape());
+  if (CanBorrowTensorContent(proto, shape)) {
+    gtl::InlinedVector<int64_t, 4> dims;
+    for (int i = 0; i < shape.dims(); ++i) {
+      dims.push_back(shape.dim_size(i));
+    }
+    const string& content = proto.tensor_content();
+    // The buffer is only ever read: it is fed to Session::Run(), and
+    // TF_ManagedBuffer reports that it does not own its memory, which keeps
+    // kernels from forwarding it as an output buffer.
+    TF_Tensor* const c_tensor = TF_NewTensor(
+        static_cast<TF_DataType>(proto.dtype()), dims.data(), dims.size(),
+        const_cast<char*>(content.data()), content.size(), ReleaseOwner,
+        new std::shared_ptr<const void>(std::move(owner)));
+    const Status status = TF_TensorToTensor(c_tensor, tensor);
+    // 'tensor' holds its own reference on the buffer.
+    TF_DeleteTensor(c_tensor);
+    if (status.ok()) {
+      return true;
+    }
+  }
+  return tensor->FromProto(proto);
+}
+
+bool DecodeTensorProto(const TensorProto& proto, Tensor* tensor) {
+  return DecodeTensorProto(proto, nullptr, tensor);
+}
+
+void EncodeTensorProtoContent(const Tensor& tensor, TensorProto* proto) {
+  if (DataTypeCanUseMemcpy(tensor.dtype())) {
+    tensor.AsProtoTensorContent(proto);
+  } else {
+    tensor.AsProtoField(proto);
+  }
+}
+
+}  // namespace serving
+}  // namespace tensorflow
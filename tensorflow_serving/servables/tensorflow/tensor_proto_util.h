@@ -0,0 +1,59 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_SERVING_SERVABLES_TENSORFLOW_TENSOR_PROTO_UTIL_H_
+#define TENSORFLOW_SERVING_SERVABLES_TENSORFLOW_TENSOR_PROTO_UTIL_H_
+
+#include <memory>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor.pb.h"
+
+namespace tensorflow {
+namespace serving {
+
+// A drop-in replacement for Tensor::FromProto() that avoids copying large
+// payloads. Returns false iff 'proto' does not describe a valid tensor.
+//
+// If 'proto' carries its payload in 'tensor_content', has a dtype that can be
+// memcpy'd (i.e. not DT_STRING, DT_RESOURCE or DT_VARIANT), and the bytes are
+// aligned to EIGEN_MAX_ALIGN_BYTES, the resulting tensor borrows the bytes of
+// 'tensor_content' rather than copying them into a freshly allocated buffer.
+// Otherwise falls back to Tensor::FromProto(), which copies.
+//
+// When the bytes are borrowed, 'proto' must stay alive and unmodified for as
+// long as 'tensor' or any tensor sharing its buffer (e.g. a Slice()) is alive.
+// 'owner', if non-null, is held until the last such tensor is destroyed, so
+// callers can pass shared ownership of the message containing 'proto' to tie
+// its lifetime to the tensor's.
+bool DecodeTensorProto(const TensorProto& proto,
+                       std::shared_ptr<const void> owner, Tensor* tensor);
+
+// Same as above, for callers that guarantee 'proto' outlives 'tensor', e.g.
+// when decoding an RPC request whose tensors do not escape the RPC.
+bool DecodeTensorProto(const TensorProto& proto, Tensor* tensor);
+
+// Encodes 'tensor' into 'proto', replacing its contents. Numeric tensors are
+// written as packed 'tensor_content' with a single copy of the tensor's
+// buffer; dtypes without a packed wire representation that clients can read
+// (DT_STRING, DT_RESOURCE, DT_VARIANT) are written with Tensor::AsProtoField().
+//
+// If 'proto' lives on an arena, so does the string holding the bytes.
+void EncodeTensorProtoContent(const Tensor& tensor, TensorProto* proto);
+
+}  // namespace serving
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_SERVING_SERVABLES_TENSORFLOW_TENSOR_PROTO_UTIL_H_
@@ -0,0 +1,145 @@
+/* Copyright 2017 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_serving/servables/tensorflow/tensor_proto_util.h"
+
+#include <stdint.h>
+#include <memory>
+
+#include <gtest/gtest.h>
+#include "third_party/eigen3/Eigen/Core"
+#include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+
+namespace tensorflow {
+namespace serving {
+namespace {
+
+// Returns a proto holding 'tensor' in its packed 'tensor_content' form.
+TensorProto PackedProto(const Tensor& tensor) {
+  TensorProto proto;
+  tensor.AsProtoTensorContent(&proto);
+  return proto;
+}
+
+bool IsAligned(const string& bytes) {
+  return reinterpret_cast<uintptr_t>(bytes.data()) % EIGEN_MAX_ALIGN_BYTES ==
+         0;
+}
+
+// Returns true if 'tensor' aliases the bytes of 'proto'.
+bool Aliases(const Tensor& tensor, const TensorProto& proto) {
+  return tensor.tensor_data().data() == proto.tensor_content().data();
+}
+
+TEST(TensorProtoUtilTest, DecodesPackedContent) {
+  const Tensor expected =
+      test::AsTensor<float>({1, 2, 3, 4, 5, 6}, TensorShape({2, 3}));
+  const TensorProto proto = PackedProto(expected);
+
+  Tensor tensor;
+  ASSERT_TRUE(DecodeTensorProto(proto, &tensor));
+  test::ExpectTensorEqual<float>(expected, tensor);
+  // Only aligned bytes can be borrowed; everything else is copied.
+  EXPECT_EQ(IsAligned(proto.tensor_content()), Aliases(tensor, proto));
+}
+
+TEST(TensorProtoUtilTest, BorrowedContentKeepsOwnerAlive) {
+  const Tensor expected = test::AsTensor<int64>({7, 8, 9}, TensorShape({3}));
+  std::shared_ptr<TensorProto> proto(new TensorProto(PackedProto(expected)));
+  const bool aligned = IsAligned(proto->tensor_content());
+  std::weak_ptr<TensorProto> weak_proto = proto;
+
+  Tensor tensor;
+  ASSERT_TRUE(DecodeTensorProto(*proto, proto, &tensor));
+  proto.reset();
+  // A borrowed buffer holds on to the owner; a copy releases it right away.
+  EXPECT_EQ(aligned, !weak_proto.expired());
+  test::ExpectTensorEqual<int64>(expected, tensor);
+
+  tensor = Tensor();
+  EXPECT_TRUE(weak_proto.expired());
+}
+
+TEST(TensorProtoUtilTest, CopiesRepeatedFieldContent) {
+  const Tensor expected = test::AsTensor<int32>({1, 2, 3}, TensorShape({3}));
+  TensorProto proto;
+  expected.AsProtoField(&proto);
+
+  Tensor tensor;
+  ASSERT_TRUE(DecodeTensorProto(proto, &tensor));
+  test::ExpectTensorEqual<int32>(expected, tensor);
+}
+
+TEST(TensorProtoUtilTest, CopiesStrings) {
+  const Tensor expected =
+      test::AsTensor<string>({"a", "bc", "def"}, TensorShape({3}));
+  const TensorProto proto = PackedProto(expected);
+
+  Tensor tensor;
+  ASSERT_TRUE(DecodeTensorProto(proto, &tensor));
+  test::ExpectTensorEqual<string>(expected, tensor);
+}
+
+TEST(TensorProtoUtilTest, RejectsMismatchedContentSize) {
+  TensorProto proto = PackedProto(
+      test::AsTensor<float>({1, 2, 3, 4}, TensorShape({4})));
+  proto.mutable_tensor_shape()->mutable_dim(0)->set_size(5);
+
+  Tensor tensor;
+  EXPECT_FALSE(DecodeTensorProto(proto, &tensor));
+}
+
+TEST(TensorProtoUtilTest, RejectsInvalidShape) {
+  TensorProto proto =
+      PackedProto(test::AsTensor<float>({1, 2}, TensorShape({2})));
+  proto.mutable_tensor_shape()->mutable_dim(0)->set_size(-2);
+
+  Tensor tensor;
+  EXPECT_FALSE(DecodeTensorProto(proto, &tensor));
+}
+
+TEST(TensorProtoUtilTest, EncodesNumericTensorsAsTensorContent) {
+  const Tensor expected =
+      test::AsTensor<float>({1, 2, 3, 4, 5, 6}, TensorShape({3, 2}));
+
+  TensorProto proto;
+  proto.add_float_val(42);
+  EncodeTensorProtoContent(expected, &proto);
+  EXPECT_EQ(0, proto.float_val_size());
+  EXPECT_EQ(expected.TotalBytes(), proto.tensor_content().size());
+
+  Tensor tensor;
+  ASSERT_TRUE(DecodeTensorProto(proto, &tensor));
+  test::ExpectTensorEqual<float>(expected, tensor);
+}
+
+TEST(TensorProtoUtilTest, EncodesStringsAsRepeatedField) {
+  const Tensor expected = test::AsTensor<string>({"a", "bc"}, TensorShape({2}));
+
+  TensorProto proto;
+  EncodeTensorProtoContent(expected, &proto);
+  EXPECT_TRUE(proto.tensor_content().empty());
+  EXPECT_EQ(2, proto.string_val_size());
+
+  Tensor tensor;
+  ASSERT_TRUE(DecodeTensorProto(proto, &tensor));
+  test::ExpectTensorEqual<string>(expected, tensor);
+}
+
+}  // namespace
+}  // namespace serving
+}  // namespace tensorflow
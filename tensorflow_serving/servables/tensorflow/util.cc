@@ -15,6 +15,9 @@ limitations under the License.
 
 #include "tensorflow_serving/servables/tensorflow/util.h"
 
+#include <memory>
+#include <utility>
+
 #include "tensorflow/core/example/example.pb.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/status.h"
@@ -22,6 +25,7 @@ limitations under the License.
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow_serving/apis/input.pb.h"
 #include "tensorflow_serving/apis/internal/serialized_input.pb.h"
+#include "tensorflow_serving/servables/tensorflow/serving_session.h"
 
 namespace tensorflow {
 namespace serving {
@@ -89,16 +93,48 @@ Status PerformOneShotTensorComputation(
     const RunOptions& run_options, const Input& input,
     const string& input_tensor_name,
     const std::vector<string>& output_tensor_names, Session* session,
-    std::vector<Tensor>* outputs, int* num_input_examples) {
+    std::vector<Tensor>* outputs, int* num_input_examples,
+    RunMetadata* run_metadata) {
   // Setup the input Tensor to be a vector of string containing the serialized
   // tensorflow.Example.
   Tensor input_tensor;
   TF_RETURN_IF_ERROR(InputToSerializedExampleTensor(input, &input_tensor));
   *num_input_examples = input_tensor.dim_size(0);
 
-  RunMetadata run_metadata;
-  return session->Run(run_options, {{input_tensor_name, input_tensor}},
-                      output_tensor_names, {}, outputs, &run_metadata);
+  RunMetadata unused_run_metadata;
+  return session->Run(
+      run_options, {{input_tensor_name, input_tensor}}, output_tensor_names,
+      {}, outputs,
+      run_metadata != nullptr ? run_metadata : &unused_run_metadata);
+}
+
+void PerformOneShotTensorComputationAsync(
+    const RunOptions& run_options, const Input& input,
+    const string& input_tensor_name,
+    const std::vector<string>& output_tensor_names, Session* session,
+    std::vector<Tensor>* outputs, int* num_input_examples,
+    RunMetadata* run_metadata, std::function<void(const Status&)> done) {
+  // The arguments of the run, which have to outlive it.
+  struct RunArgs {
+    std::vector<std::pair<string, Tensor>> inputs;
+    // Used if the caller passes no run metadata.
+    RunMetadata unused_run_metadata;
+  };
+  Tensor input_tensor;
+  const Status status = InputToSerializedExampleTensor(input, &input_tensor);
+  if (!status.ok()) {
+    done(status);
+    return;
+  }
+  *num_input_examples = input_tensor.dim_size(0);
+
+  std::shared_ptr<RunArgs> args(new RunArgs);
+  args->inputs.emplace_back(input_tensor_name, std::move(input_tensor));
+  RunSessionAsync(session, run_options, args->inputs, output_tensor_names,
+                  outputs,
+                  run_metadata != nullptr ? run_metadata
+                                          : &args->unused_run_metadata,
+                  [args, done](const Status& run_status) { done(run_status); });
 }
 
 }  // namespace serving
@@ -16,6 +16,9 @@ limitations under the License.
 #ifndef TENSORFLOW_SERVING_SERVABLES_TENSORFLOW_UTIL_H_
 #define TENSORFLOW_SERVING_SERVABLES_TENSORFLOW_UTIL_H_
 
+#include <functional>
+#include <vector>
+
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/public/session.h"
@@ -41,11 +44,24 @@ Status InputToSerializedExampleTensor(const Input& input, Tensor* examples);
 
 // Issues a single Session::Run() call with 'input' to produce 'outputs'.
 // Equivalent to InputToSerializedExampleTensor() followed by Session::Run().
+// The run fills in 'run_metadata', unless it is null.
 Status PerformOneShotTensorComputation(
     const RunOptions& run_options, const Input& input,
     const string& input_tensor_name,
     const std::vector<string>& output_tensor_names, Session* session,
-    std::vector<Tensor>* outputs, int* num_input_examples);
+    std::vector<Tensor>* outputs, int* num_input_examples,
+    RunMetadata* run_metadata);
+
+// Like PerformOneShotTensorComputation(), but runs 'session' with
+// RunSessionAsync(), and calls 'done' with the outcome. 'output_tensor_names',
+// 'outputs', 'num_input_examples' and 'run_metadata' must stay alive until
+// then.
+void PerformOneShotTensorComputationAsync(
+    const RunOptions& run_options, const Input& input,
+    const string& input_tensor_name,
+    const std::vector<string>& output_tensor_names, Session* session,
+    std::vector<Tensor>* outputs, int* num_input_examples,
+    RunMetadata* run_metadata, std::function<void(const Status&)> done);
 
 }  // namespace serving
 }  // namespace tensorflow
@@ -16,14 +16,13 @@ limitations under the License.
 #ifndef TENSORFLOW_SERVING_UTIL_FAST_READ_DYNAMIC_PTR_H_
 #define TENSORFLOW_SERVING_UTIL_FAST_READ_DYNAMIC_PTR_H_
 
-#include <algorithm>
-#include <functional>
+#include <stddef.h>
+#include <atomic>
 #include <memory>
-#include <string>
 
-#include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
 #include "tensorflow/core/platform/types.h"
 
 namespace tensorflow {
@@ -36,10 +35,9 @@ namespace serving {
 // still being used, calling Update() when the new object is ready.  Access to
 // the object is asynchronous relative to update operations, so pointers may
 // exist to both the old and the new object at the same time (although there can
-// never be more than two objects concurrently). After the update begins, any
-// new calls to get() will point to the new object. The update will then block
-// until all pointers to the old object go out of scope.  This is achieved via a
-// reference counted smart pointer.
+// never be more than two objects concurrently). Once the update has swapped in
+// the new object, any new calls to Pin() or get() will point to it. The update
+// will then block until all pointers to the old object go out of scope.
 //
 // This class is functionally very similar to using a shared_ptr guarded by a
 // mutex, with the important distinction that it provides finer control over
@@ -47,6 +45,13 @@ namespace serving {
 // recycle old objects if desired, and it forces an efficient pattern for
 // updating data (swapping in a pointer rather than in-place modification).
 //
+// Reads take no lock and write no memory that other threads write. Each thread
+// is assigned one of kNumSlots slots, and each object has a pin count per
+// slot, on a cache line of its own. A read increments the pin count of its
+// slot, so reads on different threads scale linearly rather than contending
+// for one reference count. Update() waits for the pin counts of the old object
+// to drop to zero.
+//
 // Example Use:
 //
 //  In initialization code:
@@ -59,16 +64,20 @@ namespace serving {
 //    // Reuse old_object, or just destroy it.
 //
 //  From reading thread (executes frequently, high performance requirements):
-//    auto object = ptr.get();
+//    auto object = ptr.Pin();
 //    if (object != nullptr) {
 //      HandleRequest(object.get());
 //    }
 //
 // Care must be taken to not call FastReadDynamicPtr::Update() from a thread
-// that owns any instances of FastReadDynamicPtr::ReadPtr, or else deadlock may
-// occur.
+// that owns any instances of FastReadDynamicPtr::PinnedPtr or ReadPtr, or else
+// deadlock may occur.
 template <typename T>
 class FastReadDynamicPtr {
+ private:
+  // The current or a previous object, along with its pin counts.
+  struct Version;
+
  public:
   // Short, documentative names for the types of smart pointers we use. Callers
   // are not required to use these names; shared_ptr and unique_ptr are part of
@@ -82,39 +91,132 @@ class FastReadDynamicPtr {
   // Used when an object is owned.
   using OwnedPtr = std::unique_ptr<T>;
 
+  // A read-only pointer that pins the object it points to, as returned by
+  // Pin(). Movable, but not copyable. Unlike ReadPtr, it has no reference count
+  // of its own: it only holds the pin it took, which it releases when it is
+  // destroyed or reset.
+  class PinnedPtr {
+   public:
+    PinnedPtr() = default;
+    PinnedPtr(PinnedPtr&& other);
+    PinnedPtr& operator=(PinnedPtr&& other);
+    ~PinnedPtr() { reset(); }
+
+    const T* get() const {
+      return version_ == nullptr ? nullptr : version_->object.get();
+    }
+    const T& operator*() const { return *get(); }
+    const T* operator->() const { return get(); }
+    bool operator==(std::nullptr_t) const { return get() == nullptr; }
+    bool operator!=(std::nullptr_t) const { return get() != nullptr; }
+    friend bool operator==(std::nullptr_t, const PinnedPtr& pointer) {
+      return pointer.get() == nullptr;
+    }
+    friend bool operator!=(std::nullptr_t, const PinnedPtr& pointer) {
+      return pointer.get() != nullptr;
+    }
+
+    // Releases the pin, leaving this pointer null.
+    void reset();
+
+   private:
+    friend class FastReadDynamicPtr;
+
+    PinnedPtr(const FastReadDynamicPtr* owner, Version* version, int slot)
+        : owner_(owner), version_(version), slot_(slot) {}
+
+    const FastReadDynamicPtr* owner_ = nullptr;
+    Version* version_ = nullptr;
+    int slot_ = 0;
+
+    TF_DISALLOW_COPY_AND_ASSIGN(PinnedPtr);
+  };
+
   // Initially contains a null pointer by default.
   explicit FastReadDynamicPtr(OwnedPtr = nullptr);
 
+  // Blocks until all PinnedPtrs and ReadPtrs have been destroyed.
+  ~FastReadDynamicPtr();
+
   // Updates the current object with a new one, returning the old object. This
-  // method will block until all ReadPtrs that point to the previous object have
-  // been destroyed, guaranteeing that the result is truly unique upon return.
-  // This method may be called with a null pointer.
+  // method will block until all PinnedPtrs and ReadPtrs that point to the
+  // previous object have been destroyed, guaranteeing that the result is truly
+  // unique upon return. This method may be called with a null pointer.
+  // Concurrent calls are serialized. Waits on a condition variable, which
+  // readers only signal while an update is waiting.
   //
-  // If the current thread owns any ReadPtrs to the current object, this method
+  // Calls to Pin() and get() that start after this method returns see the new
+  // object; calls made while it runs may see either one, but a thread never
+  // sees the old object again once it has seen the new one.
+  //
+  // If the current thread owns any pointers to the current object, this method
   // will deadlock.
   OwnedPtr Update(OwnedPtr new_object);
 
-  // Returns a read-only pointer to the current object. The object will not be
-  // invalidated as long as the returned ReadPtr hasn't been destroyed. The
-  // return value may be null if update hasn't been called and if no initial
-  // value is provided.
+  // Returns a pointer to the current object, which keeps the object from being
+  // released until it is destroyed. The return value may be null if update
+  // hasn't been called and if no initial value is provided. Neither allocates
+  // nor writes memory that other threads write.
   //
   // Note that Update() should not be called from this thread while the returned
-  // ReadPtr is in scope, or deadlock will occur.
+  // PinnedPtr is in scope, or deadlock will occur.
+  PinnedPtr Pin() const;
+
+  // Same as Pin(), but returns a shared_ptr, for callers that need to copy the
+  // pointer or hand it on as one. Allocates the shared_ptr's reference count,
+  // which is only shared by the copies of the returned pointer.
   ReadPtr get() const;
 
  private:
-  // A class that behaves like a shared_ptr, except it is capable of being
-  // released (as a unique_ptr) when it becomes unique.
-  class ReleasableSharedPtr;
-
-  // The current pointer, and a mutex to guard it. Note that the only operations
-  // performed under lock are swap, during Update(), and incrementing the
-  // reference count, during get().
-  // TODO(b/24973960): Consider implementing userspace RCU instead of this if
-  // performance is ever a concern.
-  mutable mutex mutex_;
-  std::unique_ptr<ReleasableSharedPtr> object_;
+  // The number of slots threads are spread over. Threads beyond the first
+  // kNumSlots share slots, and thus cache lines.
+  static constexpr int kNumSlots = 64;
+
+  // A counter on a cache line of its own.
+  struct Counter {
+    std::atomic<int64> value{0};
+    char padding[64 - sizeof(std::atomic<int64>)];
+  };
+
+  struct Version {
+    explicit Version(OwnedPtr object) : object(std::move(object)) {}
+
+    OwnedPtr object;
+
+    // The number of PinnedPtrs to this version, by the slot of the thread that
+    // created them.
+    Counter pins[kNumSlots];
+  };
+
+  // Returns the slot of the calling thread.
+  static int ThisThreadSlot();
+
+  // Returns whether any of 'counters' is nonzero.
+  static bool AnyNonzero(const Counter* counters);
+
+  // Wakes up the Update() waiting for readers, if any.
+  void NotifyReleased() const;
+
+  // Blocks until no reader can still pin 'version', and it has no pins left.
+  void WaitUntilUnpinned(const Version& version) const;
+
+  // Serializes Update() calls. Never acquired by readers.
+  mutex update_mu_;
+
+  // The current version.
+  std::atomic<Version*> current_;
+
+  // The number of Pin() calls in progress, by slot. A Pin() call that may have
+  // read the previous value of 'current_' but not yet pinned it is counted.
+  mutable Counter pinning_[kNumSlots];
+
+  // The number of updates waiting for readers. Readers only read it, and only
+  // lock 'wait_mu_' when it is nonzero.
+  mutable std::atomic<int> num_waiting_{0};
+
+  mutable mutex wait_mu_;
+  // Notified when a pin or a Pin() call is released while an update waits.
+  mutable condition_variable released_;
 
   TF_DISALLOW_COPY_AND_ASSIGN(FastReadDynamicPtr);
 };
@@ -124,88 +226,123 @@ class FastReadDynamicPtr {
 //
 
 template <typename T>
-class FastReadDynamicPtr<T>::ReleasableSharedPtr {
- public:
-  explicit ReleasableSharedPtr(OwnedPtr object)
-      : object_{std::move(object)},
-        read_only_object_{
-            object_.get(),
-            // Use a destructor that will notify 'no_longer_referenced_' rather
-            // than deleting.
-            std::bind(&Notification::Notify, &no_longer_referenced_)} {}
-
-  ~ReleasableSharedPtr() {
-    // Block destruction until all outstanding references have been cleaned up.
-    // This prevents the last shared_ptr from calling
-    // no_longer_referenced_.set_value() after destruction.
-    BlockingRelease();
-  }
-
-  // Returns a reference to the underlying object, increasing the reference
-  // count by one. May be called concurrently from different threads, but not
-  // concurrently with BlockingRelease().
-  ReadPtr reference() const { return read_only_object_; }
-
-  // Blocks until outstanding values returned by 'reference' have been
-  // destroyed.  Requires that reference() is not being called concurrently.
-  OwnedPtr BlockingRelease() {
-    // Allow the reference count to go to zero.
-    read_only_object_ = nullptr;
-
-    // shared_ptr doesn't call the destructor if it is null, so do not block for
-    // null pointers.
-    if (object_ != nullptr) {
-      no_longer_referenced_.WaitForNotification();
-    }
+FastReadDynamicPtr<T>::PinnedPtr::PinnedPtr(PinnedPtr&& other)
+    : owner_(other.owner_), version_(other.version_), slot_(other.slot_) {
+  other.owner_ = nullptr;
+  other.version_ = nullptr;
+}
 
-    // Yield ownership to the caller.
-    return std::move(object_);
+template <typename T>
+typename FastReadDynamicPtr<T>::PinnedPtr& FastReadDynamicPtr<T>::PinnedPtr::
+operator=(PinnedPtr&& other) {
+  if (this != &other) {
+    reset();
+    owner_ = other.owner_;
+    version_ = other.version_;
+    slot_ = other.slot_;
+    other.owner_ = nullptr;
+    other.version_ = nullptr;
   }
+  return *this;
+}
 
- private:
-  // The current object.
-  OwnedPtr object_;
-
-  // Notified when read_only_object_'s reference count goes to zero.
-  Notification no_longer_referenced_;
-
-  // A shared pointer to object_. Does not actually delete the pointer,
-  // but satisifies 'no_longer_referenced_' upon destruction.
-  ReadPtr read_only_object_;
-
-  TF_DISALLOW_COPY_AND_ASSIGN(ReleasableSharedPtr);
-};
+template <typename T>
+void FastReadDynamicPtr<T>::PinnedPtr::reset() {
+  if (version_ == nullptr) {
+    return;
+  }
+  version_->pins[slot_].value.fetch_sub(1);
+  owner_->NotifyReleased();
+  owner_ = nullptr;
+  version_ = nullptr;
+}
 
 template <typename T>
 FastReadDynamicPtr<T>::FastReadDynamicPtr(OwnedPtr ptr)
-    : object_{new ReleasableSharedPtr{std::move(ptr)}} {}
+    : current_{new Version(std::move(ptr))} {}
+
+template <typename T>
+FastReadDynamicPtr<T>::~FastReadDynamicPtr() {
+  std::unique_ptr<Version> version(current_.load());
+  WaitUntilUnpinned(*version);
+}
 
 template <typename T>
 std::unique_ptr<T> FastReadDynamicPtr<T>::Update(std::unique_ptr<T> object) {
-  // Construct a ReleasableSharedPtr outside of the lock, this performs about
-  // three allocations (the ReleasableSharedPtr, the shared_ptr control block,
-  // and the internal state of std::promise) so we take care to keep it out of
-  // the critical section.
-  std::unique_ptr<ReleasableSharedPtr> local_ptr(
-      new ReleasableSharedPtr{std::move(object)});
-
-  // Swap the new ReleasableSharedPtr under lock.
+  // Allocate the new version outside of the lock.
+  std::unique_ptr<Version> new_version(new Version(std::move(object)));
+
+  std::unique_ptr<Version> old_version;
   {
-    mutex_lock lock(mutex_);
-    using std::swap;
-    swap(object_, local_ptr);
+    mutex_lock lock(update_mu_);
+    old_version.reset(current_.exchange(new_version.release()));
+    WaitUntilUnpinned(*old_version);
   }
+  return std::move(old_version->object);
+}
 
-  // Now local_ptr points to the old object, release it to the caller.  This may
-  // block for a while, so this also must be kept outside of the critical
-  // section.
-  return local_ptr->BlockingRelease();
+template <typename T>
+typename FastReadDynamicPtr<T>::PinnedPtr FastReadDynamicPtr<T>::Pin() const {
+  const int slot = ThisThreadSlot();
+  std::atomic<int64>* const pinning = &pinning_[slot].value;
+  pinning->fetch_add(1);
+  Version* const version = current_.load();
+  version->pins[slot].value.fetch_add(1);
+  pinning->fetch_sub(1);
+  NotifyReleased();
+  return PinnedPtr(this, version, slot);
 }
 
 template <typename T>
 typename FastReadDynamicPtr<T>::ReadPtr FastReadDynamicPtr<T>::get() const {
-  mutex_lock lock(mutex_);
-  return object_->reference();
+  PinnedPtr pinned = Pin();
+  const T* const object = pinned.get();
+  if (object == nullptr) {
+    return nullptr;
+  }
+  return ReadPtr(std::make_shared<PinnedPtr>(std::move(pinned)), object);
+}
+
+template <typename T>
+int FastReadDynamicPtr<T>::ThisThreadSlot() {
+  static std::atomic<int> next_slot{0};
+  static thread_local const int slot =
+      next_slot.fetch_add(1, std::memory_order_relaxed) % kNumSlots;
+  return slot;
+}
+
+template <typename T>
+bool FastReadDynamicPtr<T>::AnyNonzero(const Counter* const counters) {
+  for (int i = 0; i < kNumSlots; ++i) {
+    if (counters[i].value.load() != 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+template <typename T>
+void FastReadDynamicPtr<T>::NotifyReleased() const {
+  // Either WaitUntilUnpinned() sees the release, or this sees the waiter. In
+  // the latter case, the lock makes sure the waiter is waiting before it is
+  // notified.
+  if (num_waiting_.load() > 0) {
+    mutex_lock l(wait_mu_);
+    released_.notify_all();
+  }
+}
+
+template <typename T>
+void FastReadDynamicPtr<T>::WaitUntilUnpinned(const Version& version) const {
+  mutex_lock l(wait_mu_);
+  num_waiting_.fetch_add(1);
+  // A Pin() call that is no longer in progress has pinned 'version' already,
+  // or reads the new version. So once no call is in progress, the pin counts
+  // of 'version' can only drop.
+  while (AnyNonzero(pinning_) || AnyNonzero(version.pins)) {
+    released_.wait(l);
+  }
+  num_waiting_.fetch_sub(1);
 }
 
 }  // namespace serving
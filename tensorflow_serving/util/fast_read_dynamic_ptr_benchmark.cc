@@ -25,6 +25,15 @@ limitations under the License.
 // anticipate less contention as the system will be doing other useful work
 // between reads from the FastReadDynamicPtr.
 //
+// Reads go through Pin(), which touches no cache line that other reading
+// threads write, so the read throughput should scale linearly with the number
+// of threads, up to the number of cores. Each run is labeled with its
+// throughput per thread, which stays flat when it does. The *_Get variants read
+// through get(), which additionally allocates a reference count per read. The
+// *_MutexSharedPtr variants run the same reads against a shared_ptr guarded by
+// a single mutex, the scheme FastReadDynamicPtr used to be built on, as a point
+// of comparison.
+//
 // Run with:
 // bazel run -c opt \
 // tensorflow_serving/util:fast_read_dynamic_ptr_benchmark --
@@ -41,6 +50,7 @@ limitations under the License.
 #include "tensorflow/contrib/batching/util/periodic_function.h"
 #include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/init_main.h"
 #include "tensorflow/core/platform/mutex.h"
@@ -53,14 +63,57 @@ namespace serving {
 
 typedef FastReadDynamicPtr<int> FastReadIntPtr;
 
+// The straightforward alternative to FastReadDynamicPtr: a shared_ptr guarded
+// by a mutex. Every read takes the same lock and increments the same reference
+// count.
+class MutexSharedIntPtr {
+ public:
+  std::shared_ptr<const int> get() const {
+    mutex_lock lock(mu_);
+    return object_;
+  }
+
+  void Update(std::unique_ptr<int> object) {
+    std::shared_ptr<const int> local_ptr(std::move(object));
+    mutex_lock lock(mu_);
+    object_.swap(local_ptr);
+  }
+
+ private:
+  mutable mutex mu_;
+  std::shared_ptr<const int> object_ GUARDED_BY(mu_);
+};
+
+// FastReadIntPtr, read through get() rather than Pin().
+class GetFastReadIntPtr {
+ public:
+  std::shared_ptr<const int> get() const { return ptr_.get(); }
+
+  void Update(std::unique_ptr<int> object) { ptr_.Update(std::move(object)); }
+
+ private:
+  FastReadIntPtr ptr_;
+};
+
+// Reads the current value of 'ptr'.
+FastReadIntPtr::PinnedPtr Read(const FastReadIntPtr& ptr) { return ptr.Pin(); }
+template <typename PtrType>
+std::shared_ptr<const int> Read(const PtrType& ptr) {
+  return ptr.get();
+}
+
 // This class maintains all state for a benchmark and handles the concurrency
-// concerns around the concurrent read and update threads.
+// concerns around the concurrent read and update threads. 'PtrType' is the
+// type of the pointer being read, i.e. FastReadIntPtr, GetFastReadIntPtr or
+// MutexSharedIntPtr.
 //
 // Example:
-//    BenchmarkState state(0 /* no updates */, false /* Don't do any work */);
+//    BenchmarkState<FastReadIntPtr> state(0 /* no updates */,
+//                                         false /* Don't do any work */);
 //    state.Setup();
 //    state.RunBenchmarkReadIterations(5 /* num_threads */, 42 /* iters */);
 //    state.Teardown();
+template <typename PtrType>
 class BenchmarkState {
  public:
   BenchmarkState(const int update_micros, const bool do_work)
@@ -92,8 +145,8 @@ class BenchmarkState {
   // destruct state after it has exited.
   std::unique_ptr<PeriodicFunction> update_thread_;
 
-  // The FastReadIntPtr being benchmarked primarily for read performance.
-  FastReadIntPtr fast_ptr_;
+  // The pointer being benchmarked primarily for read performance.
+  PtrType fast_ptr_;
 
   // The update interval in microseconds.
   int64 update_micros_;
@@ -103,17 +156,15 @@ class BenchmarkState {
   bool do_work_;
 };
 
-void BenchmarkState::RunUpdateThread() {
-  int current_value;
-  {
-    std::shared_ptr<const int> current = fast_ptr_.get();
-    current_value = *current;
-  }
+template <typename PtrType>
+void BenchmarkState<PtrType>::RunUpdateThread() {
+  const int current_value = *Read(fast_ptr_);
   std::unique_ptr<int> tmp(new int(current_value + 1));
   fast_ptr_.Update(std::move(tmp));
 }
 
-void BenchmarkState::Setup() {
+template <typename PtrType>
+void BenchmarkState<PtrType>::Setup() {
   testing::StopTiming();
 
   // setup fast read int ptr:
@@ -131,7 +182,8 @@ void BenchmarkState::Setup() {
   testing::StartTiming();
 }
 
-void BenchmarkState::Teardown() {
+template <typename PtrType>
+void BenchmarkState<PtrType>::Teardown() {
   testing::StopTiming();
 
   // Destruct the update thread which blocks until it exits.
@@ -140,12 +192,13 @@ void BenchmarkState::Teardown() {
   testing::StartTiming();
 }
 
-void BenchmarkState::RunBenchmarkReads(int iters) {
+template <typename PtrType>
+void BenchmarkState<PtrType>::RunBenchmarkReads(int iters) {
   // Wait until all_read_threads_scheduled_ has been notified.
   all_read_threads_scheduled_.WaitForNotification();
 
   for (int i = 0; i < iters; i++) {
-    std::shared_ptr<const int> current = fast_ptr_.get();
+    const auto current = Read(fast_ptr_);
     if (do_work_) {
       // Let's do some work, so that we are not just measuring contention in the
       // mutex.
@@ -160,7 +213,9 @@ void BenchmarkState::RunBenchmarkReads(int iters) {
   }
 }
 
-void BenchmarkState::RunBenchmarkReadIterations(int num_threads, int iters) {
+template <typename PtrType>
+void BenchmarkState<PtrType>::RunBenchmarkReadIterations(int num_threads,
+                                                         int iters) {
   testing::StopTiming();
 
   // The benchmarking system by default uses cpu time to calculate items per
@@ -170,27 +225,39 @@ void BenchmarkState::RunBenchmarkReadIterations(int num_threads, int iters) {
   testing::UseRealTime();
   testing::ItemsProcessed(num_threads * iters);
 
-  thread::ThreadPool pool(Env::Default(), "RunBenchmarkReadThread",
-                          num_threads);
-  for (int thread_index = 0; thread_index < num_threads; ++thread_index) {
-    std::function<void()> run_reads_fn = [iters, this]() {
-      RunBenchmarkReads(iters);
-    };
-    pool.Schedule(run_reads_fn);
+  uint64 start_micros;
+  {
+    thread::ThreadPool pool(Env::Default(), "RunBenchmarkReadThread",
+                            num_threads);
+    for (int thread_index = 0; thread_index < num_threads; ++thread_index) {
+      std::function<void()> run_reads_fn = [iters, this]() {
+        RunBenchmarkReads(iters);
+      };
+      pool.Schedule(run_reads_fn);
+    }
+    testing::StartTiming();
+    start_micros = Env::Default()->NowMicros();
+    all_read_threads_scheduled_.Notify();
+
+    // Note that destructing the threadpool blocks on completion of all
+    // scheduled execution.
+    // This is intentional as we want all threads to complete iters iterations.
+    // It also means that the timing may be off (work done == iters *
+    // num_threads) and includes time scheduling work on the threads.
   }
-  testing::StartTiming();
-  all_read_threads_scheduled_.Notify();
+  const uint64 elapsed_micros =
+      std::max<uint64>(1, Env::Default()->NowMicros() - start_micros);
 
-  // Note that destructing the threadpool blocks on completion of all scheduled
-  // execution.
-  // This is intentional as we want all threads to complete iters iterations.
-  // It also means that the timing may be off (work done == iters *
-  // num_threads) and includes time scheduling work on the threads.
+  // Items per second are reported for all threads together. Reads per second
+  // per thread stay the same as threads are added iff reads scale linearly.
+  testing::SetLabel(strings::StrCat(
+      static_cast<int64>(iters * 1e6 / elapsed_micros), " reads/s/thread"));
 }
 
+template <typename PtrType = FastReadIntPtr>
 static void BenchmarkReadsAndUpdates(int update_micros, bool do_work, int iters,
                                      int num_threads) {
-  BenchmarkState state(update_micros, do_work);
+  BenchmarkState<PtrType> state(update_micros, do_work);
   state.Setup();
   state.RunBenchmarkReadIterations(num_threads, iters);
   state.Teardown();
@@ -216,6 +283,26 @@ static void BM_NoWork_FrequentUpdates_Reads(int iters, int num_threads) {
   BenchmarkReadsAndUpdates(1000, false, iters, num_threads);
 }
 
+static void BM_NoWork_NoUpdates_Reads_Get(int iters, int num_threads) {
+  BenchmarkReadsAndUpdates<GetFastReadIntPtr>(0, false, iters, num_threads);
+}
+
+static void BM_NoWork_FrequentUpdates_Reads_Get(int iters, int num_threads) {
+  BenchmarkReadsAndUpdates<GetFastReadIntPtr>(1000, false, iters,
+                                              num_threads);
+}
+
+static void BM_NoWork_NoUpdates_Reads_MutexSharedPtr(int iters,
+                                                     int num_threads) {
+  BenchmarkReadsAndUpdates<MutexSharedIntPtr>(0, false, iters, num_threads);
+}
+
+static void BM_NoWork_FrequentUpdates_Reads_MutexSharedPtr(int iters,
+                                                           int num_threads) {
+  BenchmarkReadsAndUpdates<MutexSharedIntPtr>(1000, false, iters,
+                                              num_threads);
+}
+
 BENCHMARK(BM_Work_NoUpdates_Reads)
     ->Arg(1)
     ->Arg(2)
@@ -252,6 +339,42 @@ BENCHMARK(BM_NoWork_FrequentUpdates_Reads)
     ->Arg(32)
     ->Arg(64);
 
+BENCHMARK(BM_NoWork_NoUpdates_Reads_Get)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Arg(8)
+    ->Arg(16)
+    ->Arg(32)
+    ->Arg(64);
+
+BENCHMARK(BM_NoWork_FrequentUpdates_Reads_Get)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Arg(8)
+    ->Arg(16)
+    ->Arg(32)
+    ->Arg(64);
+
+BENCHMARK(BM_NoWork_NoUpdates_Reads_MutexSharedPtr)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Arg(8)
+    ->Arg(16)
+    ->Arg(32)
+    ->Arg(64);
+
+BENCHMARK(BM_NoWork_FrequentUpdates_Reads_MutexSharedPtr)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Arg(8)
+    ->Arg(16)
+    ->Arg(32)
+    ->Arg(64);
+
 }  // namespace serving
 }  // namespace tensorflow
 
@@ -18,6 +18,7 @@ limitations under the License.
 #include <vector>
 
 #include <gtest/gtest.h>
+#include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/platform/env.h"
 
 namespace tensorflow {
@@ -84,6 +85,116 @@ TEST(FastReadDynamicPtrTest, MultiThreaded) {
   }
 }
 
+TEST(FastReadDynamicPtrTest, UpdateWaitsForReadersOnOtherThreads) {
+  FastReadIntPtr fast_read_int(std::unique_ptr<int>(new int(1)));
+
+  Notification read;
+  Notification release;
+  std::unique_ptr<Thread> reader(Env::Default()->StartThread(
+      {}, "Reader", [&fast_read_int, &read, &release]() {
+        std::shared_ptr<const int> pointer = fast_read_int.get();
+        EXPECT_EQ(1, *pointer);
+        read.Notify();
+        release.WaitForNotification();
+      }));
+  read.WaitForNotification();
+
+  Notification updated;
+  std::unique_ptr<int> old_value;
+  std::unique_ptr<Thread> updater(Env::Default()->StartThread(
+      {}, "Updater", [&fast_read_int, &updated, &old_value]() {
+        old_value = fast_read_int.Update(std::unique_ptr<int>(new int(2)));
+        updated.Notify();
+      }));
+
+  // The new value may or may not have been swapped in yet, but the update
+  // can't complete while the reader holds on to the old value.
+  Env::Default()->SleepForMicroseconds(50 * 1000);
+  EXPECT_FALSE(updated.HasBeenNotified());
+
+  release.Notify();
+  updated.WaitForNotification();
+  EXPECT_EQ(1, *old_value);
+  EXPECT_EQ(2, *fast_read_int.get());
+}
+
+TEST(FastReadDynamicPtrTest, PinnedPtr) {
+  FastReadIntPtr fast_read_int;
+  {
+    FastReadIntPtr::PinnedPtr pointer = fast_read_int.Pin();
+    EXPECT_EQ(nullptr, pointer);
+  }
+  fast_read_int.Update(std::unique_ptr<int>(new int(1)));
+
+  FastReadIntPtr::PinnedPtr pointer = fast_read_int.Pin();
+  ASSERT_NE(nullptr, pointer);
+  EXPECT_EQ(1, *pointer);
+
+  // Moving a pin moves the pin along.
+  FastReadIntPtr::PinnedPtr moved = std::move(pointer);
+  EXPECT_EQ(nullptr, pointer);
+  EXPECT_EQ(1, *moved);
+
+  moved.reset();
+  EXPECT_EQ(nullptr, moved);
+  // No pins are left, so this doesn't block.
+  EXPECT_EQ(1, *fast_read_int.Update(std::unique_ptr<int>(new int(2))));
+  EXPECT_EQ(2, *fast_read_int.Pin());
+}
+
+TEST(FastReadDynamicPtrTest, UpdateWaitsForPinsAndCopiesOfReadPtrs) {
+  FastReadIntPtr fast_read_int(std::unique_ptr<int>(new int(1)));
+
+  FastReadIntPtr::PinnedPtr pinned = fast_read_int.Pin();
+  std::shared_ptr<const int> copy;
+  {
+    std::shared_ptr<const int> pointer = fast_read_int.get();
+    copy = pointer;
+  }
+
+  Notification updated;
+  std::unique_ptr<Thread> updater(
+      Env::Default()->StartThread({}, "Updater", [&fast_read_int, &updated]() {
+        EXPECT_EQ(1, *fast_read_int.Update(std::unique_ptr<int>(new int(2))));
+        updated.Notify();
+      }));
+
+  Env::Default()->SleepForMicroseconds(50 * 1000);
+  EXPECT_FALSE(updated.HasBeenNotified());
+  pinned.reset();
+  Env::Default()->SleepForMicroseconds(50 * 1000);
+  EXPECT_FALSE(updated.HasBeenNotified());
+  EXPECT_EQ(1, *copy);
+  copy = nullptr;
+  updated.WaitForNotification();
+}
+
+TEST(FastReadDynamicPtrTest, UpdatesWithConcurrentPins) {
+  const int kNumReaders = 4;
+  const int kMaxValue = 1000;
+
+  FastReadIntPtr fast_read_int(std::unique_ptr<int>(new int(0)));
+
+  std::vector<std::unique_ptr<Thread>> readers;
+  for (int i = 0; i < kNumReaders; ++i) {
+    readers.emplace_back(
+        Env::Default()->StartThread({}, "Reader", [&fast_read_int]() {
+          int last_value = -1;
+          while (last_value < kMaxValue) {
+            FastReadIntPtr::PinnedPtr pointer = fast_read_int.Pin();
+            EXPECT_GE(*pointer, last_value);
+            last_value = *pointer;
+          }
+        }));
+  }
+  for (int value = 1; value <= kMaxValue; ++value) {
+    std::unique_ptr<int> old_value =
+        fast_read_int.Update(std::unique_ptr<int>(new int(value)));
+    EXPECT_EQ(value - 1, *old_value);
+  }
+  readers.clear();
+}
+
 }  // namespace
 }  // namespace serving
 }  // namespace tensorflow